@@ -0,0 +1,111 @@
+/**
+ * @file
+ * @author  Oscar Pernas <oscar@pernas.es>
+ * @version 1.2.3
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * Micro-benchmarks of the library, run by ActiveBenchmark without a broker.
+ * Each one prints its results to the stream given.
+ */
+
+#ifndef ACTIVEBENCHMARK_H_
+#define ACTIVEBENCHMARK_H_
+
+#include <ostream>
+
+#include "core/message/ActiveMessage.h"
+
+namespace ai{
+ namespace benchmark{
+
+	/**
+	 * Method that fills the message used by the benchmarks: ints, reals,
+	 * strings, a small bytes parameter and string properties, as the ones
+	 * usually sent by the applications.
+	 *
+	 * @param activeMessage message to fill, it should be empty
+	 */
+	void fillSampleMessage(ai::message::ActiveMessage& activeMessage);
+
+	/**
+	 * Method that returns the number of allocations done by the program, they
+	 * are counted by its operator new
+	 *
+	 * @return allocations done since the program started
+	 */
+	unsigned long long getAllocations();
+
+	/**
+	 * Method that measures the allocations of the receive loop of a consumer,
+	 * reading the StreamMessage received into a new message for each one or
+	 * recycling the same one.
+	 * Messages are received at 100k msgs/s.
+	 *
+	 * @param out stream where the results are printed
+	 * @param count number of messages received
+	 */
+	void receiveBenchmark(std::ostream& out, unsigned int count);
+
+	/**
+	 * Method that measures the time to encode and decode a message and its
+	 * size with the binary codec and with the StreamMessage format
+	 *
+	 * @param out stream where the results are printed
+	 * @param count number of messages encoded and decoded
+	 */
+	void codecBenchmark(std::ostream& out, unsigned int count);
+
+	/**
+	 * Method that measures the time to encode a message sent through 1 to 32
+	 * connections, by each connection or with the body encoded once
+	 *
+	 * @param out stream where the results are printed
+	 * @param count number of messages sent
+	 */
+	void fanoutBenchmark(std::ostream& out, unsigned int count);
+
+	/**
+	 * Method that measures the messages persisted per second by the log and
+	 * by the persistence file of older versions
+	 *
+	 * @param out stream where the results are printed
+	 * @param count number of messages persisted
+	 */
+	void persistBenchmark(std::ostream& out, unsigned int count);
+
+	/**
+	 * Method that measures the records written, read and synchronized to
+	 * disk per second by the log and by the ring file
+	 *
+	 * @param out stream where the results are printed
+	 * @param count number of records written
+	 */
+	void ringBenchmark(std::ostream& out, unsigned int count);
+
+	/**
+	 * Method that measures the cost of the checksum of the records of the
+	 * persistence per MB, with the instruction of the processor and with
+	 * the tables
+	 *
+	 * @param out stream where the results are printed
+	 * @param count number of MB checksummed by each way
+	 */
+	void crcBenchmark(std::ostream& out, unsigned int count);
+ }
+}
+
+#endif /* ACTIVEBENCHMARK_H_ */
@@ -0,0 +1,179 @@
+/**
+ * @file
+ * @author  Oscar Pernas <oscar@pernas.es>
+ * @version 1.2.3
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * Encode and decode time and wire size of the binary codec against the
+ * StreamMessage format. The StreamMessage is built and read as the producer
+ * and the consumer do it, with the messages of activemq-cpp that need no
+ * broker.
+ */
+
+#include <vector>
+
+#include "apr_time.h"
+
+#include <activemq/commands/ActiveMQStreamMessage.h>
+
+#include "ActiveBenchmark.h"
+#include "core/message/ActiveMessageCodec.h"
+#include "utils/defines.h"
+
+using namespace activemq::commands;
+using namespace ai::message;
+using namespace ai::utils;
+
+/**
+ * Method that writes the message in the StreamMessage format, as
+ * ActiveProducer::insertParameters and insertUserProperties do it
+ */
+static void writeStream(ActiveMQStreamMessage& streamMessage, ActiveMessage& activeMessage){
+
+	std::string key;
+	std::vector<unsigned char> packetDesc;
+
+	for (int it=0; it<activeMessage.getParametersSize(); it++){
+		Parameter* parameter=activeMessage.getParameter(it,key);
+		packetDesc.push_back((unsigned char)parameter->getType());
+		if (parameter->getType()==ACTIVE_BYTES_PARAMETER){
+			packetDesc.push_back((unsigned char)((BytesParameter*)parameter)->getValue().size());
+		}
+	}
+	for (int it=0; it<activeMessage.getPropertiesSize(); it++){
+		activeMessage.getProperty(it,key);
+		packetDesc.push_back(ACTIVE_STRING_PROPERTY);
+	}
+	streamMessage.writeBytes(packetDesc);
+
+	for (int it=0; it<activeMessage.getParametersSize(); it++){
+		Parameter* parameter=activeMessage.getParameter(it,key);
+		streamMessage.writeString(key);
+		switch (parameter->getType()){
+		case ACTIVE_INT_PARAMETER:
+			streamMessage.writeInt(((IntParameter*)parameter)->getValue());
+			break;
+		case ACTIVE_REAL_PARAMETER:
+			streamMessage.writeFloat(((RealParameter*)parameter)->getValue());
+			break;
+		case ACTIVE_STRING_PARAMETER:
+			streamMessage.writeString(((StringParameter*)parameter)->getValue());
+			break;
+		case ACTIVE_BYTES_PARAMETER:
+			streamMessage.writeBytes(((BytesParameter*)parameter)->getValue());
+			break;
+		}
+	}
+	//properties are sent twice, as properties and as keys of the stream
+	for (int it=0; it<activeMessage.getPropertiesSize(); it++){
+		StringParameter* property=(StringParameter*)activeMessage.getProperty(it,key);
+		streamMessage.setStringProperty(key,property->getValue());
+		streamMessage.writeString(key);
+	}
+}
+
+/**
+ * Method that reads the message in the StreamMessage format, as the receive
+ * loop of ActiveConsumer does it
+ */
+static void readStream(ActiveMQStreamMessage& streamMessage, ActiveMessage& activeMessage){
+
+	std::vector<unsigned char> packetDesc;
+	std::vector<unsigned char> data;
+
+	int sizePacket=streamMessage.readBytes(packetDesc);
+	for (int it=0; it<sizePacket; it++){
+		std::string key=streamMessage.readString();
+		switch (packetDesc[it]){
+		case ACTIVE_INT_PARAMETER:
+			activeMessage.insertIntParameter(key,streamMessage.readInt());
+			break;
+		case ACTIVE_REAL_PARAMETER:
+			activeMessage.insertRealParameter(key,streamMessage.readFloat());
+			break;
+		case ACTIVE_STRING_PARAMETER:{
+			std::string value=streamMessage.readString();
+			activeMessage.insertStringParameter(key,value);
+		}
+		break;
+		case ACTIVE_BYTES_PARAMETER:
+			++it;
+			streamMessage.readBytes(data);
+			activeMessage.insertBytesParameter(key,data);
+			break;
+		case ACTIVE_STRING_PROPERTY:
+			activeMessage.insertStringProperty(key,streamMessage.getStringProperty(key));
+			break;
+		}
+	}
+}
+
+/**
+ * Method that prints the time of each message and its size
+ */
+static void printResult(std::ostream& out, const char* name, apr_time_t elapsed, unsigned int count, unsigned int size){
+	out << name << (double)elapsed*1000/count << " ns/msg, " << size << " bytes" << std::endl;
+}
+
+void ai::benchmark::codecBenchmark(std::ostream& out, unsigned int count){
+
+	ActiveMessage activeMessage;
+	fillSampleMessage(activeMessage);
+
+	//binary codec, the buffer and the message decoded are reused as the connections do
+	ActiveMessageCodec activeMessageCodec;
+	std::vector<unsigned char> buffer;
+	unsigned int size=0;
+	apr_time_t start=apr_time_now();
+	for (unsigned int i=0; i<count; i++){
+		size=activeMessageCodec.encode(activeMessage,buffer);
+	}
+	printResult(out,"binary encode: ",apr_time_now()-start,count,size);
+
+	ActiveMessage decoded;
+	start=apr_time_now();
+	for (unsigned int i=0; i<count; i++){
+		decoded.recycle();
+		activeMessageCodec.decode(&buffer[0],size,decoded);
+	}
+	printResult(out,"binary decode: ",apr_time_now()-start,count,size);
+
+	//StreamMessage, a new one for each message as the producer creates it
+	start=apr_time_now();
+	for (unsigned int i=0; i<count; i++){
+		ActiveMQStreamMessage streamMessage;
+		writeStream(streamMessage,activeMessage);
+		streamMessage.reset();
+	}
+	apr_time_t elapsed=apr_time_now()-start;
+
+	ActiveMQStreamMessage streamMessage;
+	writeStream(streamMessage,activeMessage);
+	streamMessage.reset();
+	//properties are marshalled apart from the body
+	streamMessage.beforeMarshal(NULL);
+	size=streamMessage.getContent().size()+streamMessage.getMarshalledProperties().size();
+	printResult(out,"stream encode: ",elapsed,count,size);
+
+	start=apr_time_now();
+	for (unsigned int i=0; i<count; i++){
+		decoded.recycle();
+		streamMessage.reset();
+		readStream(streamMessage,decoded);
+	}
+	printResult(out,"stream decode: ",apr_time_now()-start,count,size);
+}
@@ -0,0 +1,83 @@
+/**
+ * @file
+ * @author  Oscar Pernas <oscar@pernas.es>
+ * @version 1.2.3
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * Cost of the checksum of the records of the persistence, with the crc32
+ * instruction of the processor and with the tables, for blocks of the size
+ * of a small record, of a page and of a large message.
+ */
+
+#include <vector>
+
+#include "apr_time.h"
+
+#include "ActiveBenchmark.h"
+#include "utils/ActiveCrc32c.h"
+
+using namespace ai;
+
+/**
+ * Bytes checksummed by the benchmark, 1MB for each one of the count
+ */
+#define CRC_BENCHMARK_MB (1024*1024)
+
+/**
+ * Method that prints the time to checksum 1MB and the bytes per second
+ */
+static void printCost(std::ostream& out, const char* name, unsigned int block, apr_time_t elapsed, unsigned int count){
+	double seconds=elapsed>0?(double)elapsed/APR_USEC_PER_SEC:1e-6;
+	out << name << " blocks of " << block << " bytes: " << (double)elapsed/count << " us/MB, "
+		<< (double)count/seconds << " MB/s" << std::endl;
+}
+
+void ai::benchmark::crcBenchmark(std::ostream& out, unsigned int count){
+
+	static const unsigned int blocks[]={64, 4096, CRC_BENCHMARK_MB};
+	std::vector<unsigned char> data(CRC_BENCHMARK_MB);
+	for (unsigned int i=0; i<data.size(); i++){
+		data[i]=(unsigned char)(i*31+7);
+	}
+	//the checksum is kept so the loops are not removed by the compiler
+	apr_uint32_t crc=0;
+
+	out << "crc32 instruction " << (ActiveCrc32c::isHardware()?"used":"not available") << std::endl;
+	for (unsigned int it=0; it<sizeof(blocks)/sizeof(blocks[0]); it++){
+		unsigned int block=blocks[it];
+
+		apr_time_t start=apr_time_now();
+		for (unsigned int i=0; i<count; i++){
+			for (unsigned int offset=0; offset<CRC_BENCHMARK_MB; offset+=block){
+				crc+=ActiveCrc32c::compute(&data[offset],block);
+			}
+		}
+		printCost(out,"compute: ",block,apr_time_now()-start,count);
+
+		start=apr_time_now();
+		for (unsigned int i=0; i<count; i++){
+			for (unsigned int offset=0; offset<CRC_BENCHMARK_MB; offset+=block){
+				crc+=ActiveCrc32c::extendSoftware(0,&data[offset],block);
+			}
+		}
+		printCost(out,"tables:  ",block,apr_time_now()-start,count);
+	}
+	if (ActiveCrc32c::compute(&data[0],data.size())!=ActiveCrc32c::extendSoftware(0,&data[0],data.size())){
+		out << "ERROR. The checksum of the instruction and of the tables are not the same" << std::endl;
+	}
+	out << "checksum " << crc << std::endl;
+}
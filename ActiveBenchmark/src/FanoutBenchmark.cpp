@@ -0,0 +1,74 @@
+/**
+ * @file
+ * @author  Oscar Pernas <oscar@pernas.es>
+ * @version 1.2.3
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * Time to encode a message sent to a service with several connections.
+ * Each connection encodes the whole message, or the body is encoded once
+ * and each connection only encodes its properties, as ActiveManager does
+ * it for connections with the binary format.
+ */
+
+#include <vector>
+
+#include "apr_time.h"
+
+#include "ActiveBenchmark.h"
+#include "core/message/ActiveMessageCodec.h"
+
+using namespace ai::message;
+
+/**
+ * Max number of connections of the service
+ */
+#define FANOUT_MAX_CONNECTIONS 32
+
+void ai::benchmark::fanoutBenchmark(std::ostream& out, unsigned int count){
+
+	ActiveMessage activeMessage;
+	fillSampleMessage(activeMessage);
+
+	//each connection has its own codec and buffer
+	std::vector<ActiveMessageCodec> codecs(FANOUT_MAX_CONNECTIONS);
+	std::vector<std::vector<unsigned char> > buffers(FANOUT_MAX_CONNECTIONS);
+	std::vector<unsigned char> body;
+
+	for (unsigned int connections=1; connections<=FANOUT_MAX_CONNECTIONS; connections*=2){
+
+		apr_time_t start=apr_time_now();
+		for (unsigned int i=0; i<count; i++){
+			for (unsigned int connection=0; connection<connections; connection++){
+				codecs[connection].encode(activeMessage,buffers[connection]);
+			}
+		}
+		apr_time_t perConnection=apr_time_now()-start;
+
+		start=apr_time_now();
+		for (unsigned int i=0; i<count; i++){
+			ActiveMessageCodec::encodeBody(activeMessage,body);
+			for (unsigned int connection=0; connection<connections; connection++){
+				codecs[connection].encode(activeMessage,body,buffers[connection]);
+			}
+		}
+		apr_time_t shared=apr_time_now()-start;
+
+		out << "1->" << connections << ": encoded by each connection "
+			<< (double)perConnection*1000/count << " ns/msg, body encoded once "
+			<< (double)shared*1000/count << " ns/msg" << std::endl;
+	}
+}
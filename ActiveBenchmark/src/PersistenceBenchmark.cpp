@@ -0,0 +1,247 @@
+/**
+ * @file
+ * @author  Oscar Pernas <oscar@pernas.es>
+ * @version 1.2.3
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * Messages persisted per second. Each message is written as ActivePersistence
+ * does it, one record flushed for each message or a batch of records flushed
+ * by the writer thread, without sync. Messages are read back as the recovery
+ * does it. The log is compared with the persistence file of older versions,
+ * which opened the file and built a boost archive with its header for each
+ * message written or read. The stores of the persistence, the log and the
+ * ring file, are also compared writing the same record.
+ */
+
+#include <boost/archive/binary_iarchive.hpp>
+#include <boost/archive/binary_oarchive.hpp>
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "apr_file_io.h"
+#include "apr_time.h"
+
+#include "ActiveBenchmark.h"
+#include "core/persistence/ActiveLog.h"
+#include "core/persistence/ActiveRingFile.h"
+#include "utils/defines.h"
+
+using namespace ai;
+using namespace ai::message;
+
+/**
+ * Base name of the files written by the benchmarks
+ */
+#define PERSISTENCE_BENCHMARK_FILE "benchmark_persistence"
+
+/**
+ * Size of the segments of the log
+ */
+#define PERSISTENCE_BENCHMARK_SEGMENT (16*1024*1024)
+
+/**
+ * Method that removes the files of the current directory whose name starts
+ * with the prefix given
+ */
+static void removeFiles(const std::string& prefix){
+	apr_pool_t* pool=NULL;
+	apr_dir_t* directory=NULL;
+	apr_finfo_t info;
+
+	apr_pool_create(&pool,NULL);
+	if (apr_dir_open(&directory,".",pool)==APR_SUCCESS){
+		while (apr_dir_read(&info,APR_FINFO_NAME,directory)==APR_SUCCESS){
+			std::string name=info.name;
+			if (name.compare(0,prefix.size(),prefix)==0){
+				apr_file_remove(name.c_str(),pool);
+			}
+		}
+		apr_dir_close(directory);
+	}
+	apr_pool_destroy(pool);
+}
+
+/**
+ * Records synchronized to disk one by one, out of the count, by the
+ * benchmark of the stores
+ */
+#define PERSISTENCE_BENCHMARK_SYNCS 1000
+
+/**
+ * Method that prints the messages and bytes written per second
+ */
+static void printThroughput(std::ostream& out, const char* name, apr_time_t elapsed, unsigned int count, unsigned long long bytes){
+	double seconds=elapsed>0?(double)elapsed/APR_USEC_PER_SEC:1e-6;
+	out << name << (double)count/seconds << " msgs/s, "
+		<< (double)bytes/(1024*1024)/seconds << " MB/s" << std::endl;
+}
+
+/**
+ * Method that encodes the message as ActivePersistence does it for a record
+ */
+static void encodeRecord(ActiveMessage& activeMessage, std::string& record){
+	std::ostringstream recordStream;
+	{
+		boost::archive::binary_oarchive archive(recordStream,boost::archive::no_header);
+		archive << activeMessage;
+	}
+	record=recordStream.str();
+}
+
+void ai::benchmark::persistBenchmark(std::ostream& out, unsigned int count){
+
+	ActiveMessage activeMessage;
+	fillSampleMessage(activeMessage);
+	std::string legacyFile=std::string(PERSISTENCE_BENCHMARK_FILE)+"_legacy";
+	std::string logFile=std::string(PERSISTENCE_BENCHMARK_FILE)+"_log";
+	removeFiles(PERSISTENCE_BENCHMARK_FILE);
+
+	//file of older versions, opened for each message
+	apr_time_t start=apr_time_now();
+	for (unsigned int i=0; i<count; i++){
+		std::ofstream persistenceFile(legacyFile.c_str(),std::ios::app | std::ios::binary);
+		boost::archive::binary_oarchive archive(persistenceFile);
+		archive << activeMessage;
+	}
+	apr_time_t elapsed=apr_time_now()-start;
+	std::ifstream written(legacyFile.c_str(),std::ios::binary | std::ios::ate);
+	printThroughput(out,"file of older versions:        ",elapsed,count,(unsigned long long)written.tellg());
+	written.close();
+
+	//file of older versions, read back opening the file for each message
+	ActiveMessage recovered;
+	std::streampos position=0;
+	start=apr_time_now();
+	for (unsigned int i=0; i<count; i++){
+		std::ifstream persistenceFile(legacyFile.c_str(),std::ios::in | std::ios::binary);
+		persistenceFile.seekg(position);
+		boost::archive::binary_iarchive archive(persistenceFile);
+		recovered.recycle();
+		archive >> recovered;
+		position=persistenceFile.tellg();
+	}
+	printThroughput(out,"file of older versions, read:  ",apr_time_now()-start,count,(unsigned long long)position);
+
+	//log, the record is encoded and flushed for each message
+	unsigned long long bytes=0;
+	std::string record;
+	ActiveLog activeLog;
+	activeLog.open(logFile,PERSISTENCE_BENCHMARK_SEGMENT);
+	start=apr_time_now();
+	for (unsigned int i=0; i<count; i++){
+		encodeRecord(activeMessage,record);
+		activeLog.append((const unsigned char*)record.data(),record.size());
+		activeLog.flush();
+		bytes+=record.size();
+	}
+	elapsed=apr_time_now()-start;
+	printThroughput(out,"segmented log:                 ",elapsed,count,bytes);
+
+	//log, the writer thread flushes a batch of records
+	start=apr_time_now();
+	for (unsigned int i=0; i<count; i++){
+		encodeRecord(activeMessage,record);
+		activeLog.append((const unsigned char*)record.data(),record.size());
+		if ((i+1)%ACTIVE_WRITE_BATCH==0){
+			activeLog.flush();
+		}
+	}
+	activeLog.flush();
+	printThroughput(out,"segmented log, batch:          ",apr_time_now()-start,count,bytes);
+
+	//log, read back from the first record
+	std::vector<unsigned char> data;
+	bytes=0;
+	start=apr_time_now();
+	activeLog.seek(activeLog.getFirstSequence());
+	for (unsigned int i=0; i<count && activeLog.read(data); i++){
+		std::istringstream recordStream(std::string((const char*)&data[0],data.size()));
+		boost::archive::binary_iarchive archive(recordStream,boost::archive::no_header);
+		recovered.recycle();
+		archive >> recovered;
+		bytes+=data.size();
+	}
+	printThroughput(out,"segmented log, read:           ",apr_time_now()-start,count,bytes);
+	activeLog.close();
+
+	removeFiles(PERSISTENCE_BENCHMARK_FILE);
+}
+
+/**
+ * Method that writes, reads and synchronizes the same record with a store,
+ * as ActivePersistence does it with one flush for each message
+ */
+static void storeBenchmark(std::ostream& out, const char* name, ActiveStore& activeStore, const std::string& record, unsigned int count){
+
+	unsigned long long bytes=(unsigned long long)record.size()*count;
+	std::string label;
+
+	apr_time_t start=apr_time_now();
+	for (unsigned int i=0; i<count; i++){
+		activeStore.append((const unsigned char*)record.data(),record.size());
+		activeStore.flush();
+	}
+	label=std::string(name)+":";
+	label.resize(22,' ');
+	printThroughput(out,label.c_str(),apr_time_now()-start,count,bytes);
+
+	std::vector<unsigned char> data;
+	start=apr_time_now();
+	activeStore.seek(activeStore.getFirstSequence());
+	while (activeStore.read(data));
+	label=std::string(name)+", read:";
+	label.resize(22,' ');
+	printThroughput(out,label.c_str(),apr_time_now()-start,count,bytes);
+	activeStore.acknowledge(activeStore.getNextSequence());
+
+	//durability always, each message is on disk before it is sent
+	unsigned int syncs=(count<PERSISTENCE_BENCHMARK_SYNCS)?count:PERSISTENCE_BENCHMARK_SYNCS;
+	start=apr_time_now();
+	for (unsigned int i=0; i<syncs; i++){
+		activeStore.append((const unsigned char*)record.data(),record.size());
+		activeStore.sync();
+	}
+	label=std::string(name)+", sync:";
+	label.resize(22,' ');
+	printThroughput(out,label.c_str(),apr_time_now()-start,syncs,(unsigned long long)record.size()*syncs);
+	activeStore.acknowledge(activeStore.getNextSequence());
+}
+
+void ai::benchmark::ringBenchmark(std::ostream& out, unsigned int count){
+
+	ActiveMessage activeMessage;
+	fillSampleMessage(activeMessage);
+	std::string record;
+	encodeRecord(activeMessage,record);
+	removeFiles(PERSISTENCE_BENCHMARK_FILE);
+
+	ActiveLog activeLog;
+	activeLog.open(std::string(PERSISTENCE_BENCHMARK_FILE)+"_log",PERSISTENCE_BENCHMARK_SEGMENT);
+	storeBenchmark(out,"segmented log",activeLog,record,count);
+	activeLog.close();
+
+	ActiveRingFile activeRingFile;
+	activeRingFile.open(std::string(PERSISTENCE_BENCHMARK_FILE)+"_ring",DEFAULT_RING_SIZE);
+	storeBenchmark(out,"ring file",activeRingFile,record,count);
+	activeRingFile.close();
+
+	removeFiles(PERSISTENCE_BENCHMARK_FILE);
+}
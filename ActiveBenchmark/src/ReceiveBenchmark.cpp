@@ -0,0 +1,224 @@
+/**
+ * @file
+ * @author  Oscar Pernas <oscar@pernas.es>
+ * @version 1.2.3
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * Allocations of the receive loop of a consumer. The StreamMessage received
+ * is read as ActiveConsumer::onReceive does, into a new ActiveMessage each
+ * time, as the loop did before, or into the same one recycled.
+ */
+
+#include <vector>
+
+#include "apr_time.h"
+#include "activemq/commands/ActiveMQStreamMessage.h"
+
+#include "ActiveBenchmark.h"
+#include "utils/defines.h"
+#include "utils/parameters/BytesParameter.h"
+#include "utils/parameters/IntParameter.h"
+#include "utils/parameters/RealParameter.h"
+#include "utils/parameters/StringParameter.h"
+
+using namespace ai::message;
+using namespace ai::utils;
+using activemq::commands::ActiveMQStreamMessage;
+
+/**
+ * Messages received per second
+ */
+#define RECEIVE_RATE 100000
+
+/**
+ * Messages received between two checks of the rate
+ */
+#define RECEIVE_PACE 1000
+
+/**
+ * Size of the blocks used to read a bytes field, as the consumer does
+ */
+#define RECEIVE_BYTES_BLOCK 256
+
+/**
+ * Method that writes the message as ActiveProducer does: packet description,
+ * parameters and the keys of the properties, that are JMS properties
+ */
+static void writeStreamMessage(ActiveMessage& activeMessage, ActiveMQStreamMessage& streamMessage){
+
+	std::string key;
+	std::vector<unsigned char> packetDesc;
+
+	for (int it=0; it<activeMessage.getParametersSize();it++){
+		Parameter* parameter=activeMessage.getParameter(it,key);
+		packetDesc.push_back(parameter->getType());
+		if (parameter->getType()==ACTIVE_BYTES_PARAMETER){
+			packetDesc.push_back(((BytesParameter*)parameter)->getValue().size());
+		}
+	}
+	for (int it=0; it<activeMessage.getPropertiesSize();it++){
+		Parameter* property=activeMessage.getProperty(it,key);
+		switch (property->getType()){
+		case ACTIVE_INT_PARAMETER: packetDesc.push_back(ACTIVE_INT_PROPERTY); break;
+		case ACTIVE_REAL_PARAMETER: packetDesc.push_back(ACTIVE_REAL_PROPERTY); break;
+		case ACTIVE_STRING_PARAMETER: packetDesc.push_back(ACTIVE_STRING_PROPERTY); break;
+		}
+	}
+	streamMessage.writeBytes(packetDesc);
+
+	for (int it=0; it<activeMessage.getParametersSize();it++){
+		Parameter* parameter=activeMessage.getParameter(it,key);
+		streamMessage.writeString(key);
+		switch (parameter->getType()){
+		case ACTIVE_INT_PARAMETER: streamMessage.writeInt(((IntParameter*)parameter)->getValue()); break;
+		case ACTIVE_REAL_PARAMETER: streamMessage.writeFloat(((RealParameter*)parameter)->getValue()); break;
+		case ACTIVE_STRING_PARAMETER: streamMessage.writeString(((StringParameter*)parameter)->getValue()); break;
+		case ACTIVE_BYTES_PARAMETER: streamMessage.writeBytes(((BytesParameter*)parameter)->getValue()); break;
+		}
+	}
+	for (int it=0; it<activeMessage.getPropertiesSize();it++){
+		Parameter* property=activeMessage.getProperty(it,key);
+		switch (property->getType()){
+		case ACTIVE_INT_PARAMETER: streamMessage.setIntProperty(key,((IntParameter*)property)->getValue()); break;
+		case ACTIVE_REAL_PARAMETER: streamMessage.setFloatProperty(key,((RealParameter*)property)->getValue()); break;
+		case ACTIVE_STRING_PARAMETER: streamMessage.setStringProperty(key,((StringParameter*)property)->getValue()); break;
+		}
+		streamMessage.writeString(key);
+	}
+}
+
+/**
+ * Method that reads the message as the loop of ActiveConsumer::onReceive,
+ * with the packet description and bytes buffers of the loop
+ */
+static void readStreamMessage(	ActiveMQStreamMessage& streamMessage,
+								std::vector<unsigned char>& packetDesc,
+								std::vector<unsigned char>& data,
+								ActiveMessage& activeMessage){
+
+	//every receive reads the message from its start
+	streamMessage.reset();
+	int sizePacket=streamMessage.readBytes(packetDesc);
+	for (int it=0; it<sizePacket;it++){
+		switch (packetDesc[it]){
+		case ACTIVE_INT_PARAMETER:{
+			std::string key=streamMessage.readString();
+			int value=streamMessage.readInt();
+			activeMessage.insertIntParameter(key,value);
+		}
+		break;
+		case ACTIVE_REAL_PARAMETER:{
+			std::string key=streamMessage.readString();
+			float value=streamMessage.readFloat();
+			activeMessage.insertRealParameter(key,value);
+		}
+		break;
+		case ACTIVE_STRING_PARAMETER:{
+			std::string key=streamMessage.readString();
+			std::string value=streamMessage.readString();
+			activeMessage.insertStringParameter(key,value);
+		}
+		break;
+		case ACTIVE_BYTES_PARAMETER:{
+			std::string key=streamMessage.readString();
+			++it;
+			unsigned char block[RECEIVE_BYTES_BLOCK];
+			data.clear();
+			for (;;){
+				int length=streamMessage.readBytes(block,RECEIVE_BYTES_BLOCK);
+				if (length<0){
+					break;
+				}
+				data.insert(data.end(),block,block+length);
+			}
+			activeMessage.insertBytesParameter(key,data);
+		}
+		break;
+		case ACTIVE_INT_PROPERTY:{
+			std::string key=streamMessage.readString();
+			int value=streamMessage.getIntProperty(key);
+			activeMessage.insertIntProperty(key,value);
+		}
+		break;
+		case ACTIVE_REAL_PROPERTY:{
+			std::string key=streamMessage.readString();
+			float value=streamMessage.getFloatProperty(key);
+			activeMessage.insertRealProperty(key,value);
+		}
+		break;
+		case ACTIVE_STRING_PROPERTY:{
+			std::string key=streamMessage.readString();
+			std::string value=streamMessage.getStringProperty(key);
+			activeMessage.insertStringProperty(key,value);
+		}
+		break;
+		}
+	}
+}
+
+/**
+ * Method that receives the messages at RECEIVE_RATE and prints the
+ * allocations done by each one
+ */
+static void receive(std::ostream& out, unsigned int count, bool recycle, ActiveMQStreamMessage& received){
+
+	std::vector<unsigned char> packetDesc(MAX_PARAMETERS);
+	std::vector<unsigned char> data;
+	data.reserve(MAX_PARAMETERS);
+	ActiveMessage recycled;
+
+	//first message out of the count, buffers of the recycled message grow with it
+	readStreamMessage(received,packetDesc,data,recycled);
+
+	unsigned long long allocations=ai::benchmark::getAllocations();
+	apr_time_t start=apr_time_now();
+	for (unsigned int i=0; i<count; i++){
+		if (recycle){
+			recycled.recycle();
+			readStreamMessage(received,packetDesc,data,recycled);
+		}else{
+			ActiveMessage activeMessage;
+			readStreamMessage(received,packetDesc,data,activeMessage);
+		}
+		if ((i+1)%RECEIVE_PACE==0){
+			apr_time_t expected=start+(apr_time_t)(i+1)*APR_USEC_PER_SEC/RECEIVE_RATE;
+			apr_time_t now=apr_time_now();
+			if (now<expected){
+				apr_sleep(expected-now);
+			}
+		}
+	}
+	apr_time_t elapsed=apr_time_now()-start;
+	allocations=ai::benchmark::getAllocations()-allocations;
+
+	out << (recycle?"recycled message: ":"new message:      ")
+		<< (double)allocations/count << " allocations/msg, "
+		<< allocations << " allocations, "
+		<< (elapsed>0?(double)count*APR_USEC_PER_SEC/elapsed:0) << " msgs/s" << std::endl;
+}
+
+void ai::benchmark::receiveBenchmark(std::ostream& out, unsigned int count){
+
+	ActiveMessage activeMessage;
+	fillSampleMessage(activeMessage);
+
+	ActiveMQStreamMessage received;
+	writeStreamMessage(activeMessage,received);
+
+	receive(out,count,false,received);
+	receive(out,count,true,received);
+}
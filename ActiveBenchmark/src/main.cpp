@@ -0,0 +1,165 @@
+/**
+ * @file
+ * @author  Oscar Pernas <oscar@pernas.es>
+ * @version 1.2.3
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * Command line program that runs the micro-benchmarks of the library, it
+ * does not need a broker:
+ *
+ * ActiveBenchmark <benchmark>|all [count]
+ *
+ * Benchmarks that write files do it in the current directory.
+ */
+
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "apr_general.h"
+#include "log4cxx/propertyconfigurator.h"
+
+#include "ActiveBenchmark.h"
+#include "utils/exception/ActiveException.h"
+
+using namespace log4cxx;
+using namespace ai;
+using namespace ai::message;
+using namespace ai::benchmark;
+
+/**
+ * Allocations counted by the operator new of the program
+ */
+static unsigned long long allocations=0;
+
+void* operator new(std::size_t size) throw (std::bad_alloc){
+	allocations++;
+	void* pointer=std::malloc(size==0?1:size);
+	if (pointer==NULL){
+		throw std::bad_alloc();
+	}
+	return pointer;
+}
+
+void operator delete(void* pointer) throw (){
+	std::free(pointer);
+}
+
+unsigned long long ai::benchmark::getAllocations(){
+	return allocations;
+}
+
+void ai::benchmark::fillSampleMessage(ActiveMessage& activeMessage){
+	std::stringstream key;
+	for (int i=0; i<4; i++){
+		key.str("");
+		key << "int" << i;
+		std::string name=key.str();
+		activeMessage.insertIntParameter(name,1000*i+7);
+	}
+	for (int i=0; i<2; i++){
+		key.str("");
+		key << "real" << i;
+		std::string name=key.str();
+		activeMessage.insertRealParameter(name,3.25f*i);
+	}
+	for (int i=0; i<2; i++){
+		key.str("");
+		key << "string" << i;
+		std::string name=key.str();
+		std::string value="value of the string parameter";
+		activeMessage.insertStringParameter(name,value);
+	}
+	std::string bytesKey="bytes";
+	std::vector<unsigned char> bytes(64,0xA5);
+	activeMessage.insertBytesParameter(bytesKey,bytes);
+	for (int i=0; i<2; i++){
+		key.str("");
+		key << "property" << i;
+		std::string name=key.str();
+		activeMessage.insertStringProperty(name,"property value");
+	}
+}
+
+/**
+ * Benchmarks that can be run, with the count used by default
+ */
+struct Benchmark{
+	const char* name;
+	void (*run)(std::ostream& out, unsigned int count);
+	unsigned int count;
+};
+
+static const Benchmark benchmarks[]={
+	{"receive", receiveBenchmark, 100000},
+	{"codec", codecBenchmark, 100000},
+	{"fanout", fanoutBenchmark, 20000},
+	{"persist", persistBenchmark, 50000},
+	{"ring", ringBenchmark, 50000},
+	{"crc", crcBenchmark, 1000}
+};
+
+static const unsigned int benchmarksSize=sizeof(benchmarks)/sizeof(benchmarks[0]);
+
+static int usage(){
+	std::cerr << "Usage: ActiveBenchmark <benchmark>|all [count]" << std::endl << "Benchmarks:";
+	for (unsigned int i=0; i<benchmarksSize; i++){
+		std::cerr << " " << benchmarks[i].name;
+	}
+	std::cerr << std::endl;
+	return 2;
+}
+
+int main(int argc, char* argv[]) {
+
+	if (argc<2 || argc>3){
+		return usage();
+	}
+	std::string name=argv[1];
+	unsigned int count=0;
+	if (argc==3){
+		count=(unsigned int)std::strtoul(argv[2],NULL,10);
+		if (count==0){
+			return usage();
+		}
+	}
+
+	apr_initialize();
+	//same logging configuration as the application
+	PropertyConfigurator::configure("log4j.properties");
+
+	bool found=false;
+	for (unsigned int i=0; i<benchmarksSize; i++){
+		if (name=="all" || name==benchmarks[i].name){
+			std::cout << "== " << benchmarks[i].name << std::endl;
+			try{
+				benchmarks[i].run(std::cout,count>0?count:benchmarks[i].count);
+			}catch (ActiveException& ae){
+				std::cerr << ae.getMessage() << std::endl;
+			}
+			found=true;
+		}
+	}
+	apr_terminate();
+	if (!found){
+		return usage();
+	}
+	return 0;
+}
@@ -174,6 +174,64 @@ void ActiveInterface::send(	std::string& serviceId,
 	}
 }
 
+void ActiveInterface::sendAsync(	std::string& serviceId,
+								ActiveMessage& activeMessage,
+								std::list<boost::shared_ptr<ActiveSendHandle> >& handles)
+	throw (ActiveException){
+
+	std::stringstream logMessage;
+	try{
+		if (getState()!=INITIALIZED){
+			AI_THROW_AIE;
+		}
+		readersWriters.readerLock();
+		ActiveManager::getInstance()->sendDataAsync(serviceId,activeMessage,handles);
+		readersWriters.readerUnlock();
+	}catch (ActiveException& ae){
+		readersWriters.readerUnlock();
+		LOG4CXX_ERROR(logger,ae.getMessage().c_str());
+		throw ae;
+	}catch(ActiveInputException& aie){
+		LOG4CXX_ERROR(logger,aie.getMessage().c_str());
+		throw ActiveException(aie.getMessage());
+	}catch (...){
+		readersWriters.readerUnlock();
+		logMessage << "Unknown exception sending data";
+		LOG4CXX_ERROR(logger, logMessage.str().c_str());
+		throw ActiveException(logMessage);
+	}
+}
+
+std::string ActiveInterface::sendStream(	std::string& serviceId,
+										ActiveMessage& activeMessage,
+										std::istream& source,
+										unsigned int chunkSize)
+	throw (ActiveException){
+
+	std::stringstream logMessage;
+	try{
+		if (getState()!=INITIALIZED){
+			AI_THROW_AIE;
+		}
+		readersWriters.readerLock();
+		std::string streamId=ActiveManager::getInstance()->sendStream(serviceId,activeMessage,source,chunkSize);
+		readersWriters.readerUnlock();
+		return streamId;
+	}catch (ActiveException& ae){
+		readersWriters.readerUnlock();
+		LOG4CXX_ERROR(logger,ae.getMessage().c_str());
+		throw ae;
+	}catch(ActiveInputException& aie){
+		LOG4CXX_ERROR(logger,aie.getMessage().c_str());
+		throw ActiveException(aie.getMessage());
+	}catch (...){
+		readersWriters.readerUnlock();
+		logMessage << "Unknown exception sending stream";
+		LOG4CXX_ERROR(logger, logMessage.str().c_str());
+		throw ActiveException(logMessage);
+	}
+}
+
 void ActiveInterface::sendResponse(	std::string& connectionId,
 									ActiveMessage& activeMessage)
 	throw (ActiveException){
@@ -619,6 +677,36 @@ void ActiveInterface::getConnection(std::string& connectionId) throw (ActiveExce
 	}
 }
 
+bool ActiveInterface::getDurabilityStats(std::string& connectionId, ActiveHistogram& commitLatencyR,
+										ActiveHistogram& syncBatchSizeR) throw (ActiveException){
+	std::stringstream logMessage;
+	bool copied=false;
+	try{
+		if (getState()!=INITIALIZED){
+			AI_THROW_AIE;
+		}
+		readersWriters.readerLock();
+		ActiveConnection* activeConnection=ActiveManager::getInstance()->getConnection(connectionId);
+		if (activeConnection!=NULL){
+			copied=activeConnection->getDurabilityStats(commitLatencyR,syncBatchSizeR);
+		}
+		readersWriters.readerUnlock();
+	}catch (ActiveException& ae){
+		readersWriters.readerUnlock();
+		logMessage << "ActiveInterface::getDurabilityStats. Exception " << connectionId << " " << ae.getMessage();
+		LOG4CXX_DEBUG(logger,logMessage.str().c_str());
+	}catch(ActiveInputException& aie){
+		LOG4CXX_ERROR(logger,aie.getMessage().c_str());
+		throw ActiveException(aie.getMessage());
+	}catch (...){
+		readersWriters.readerUnlock();
+		logMessage.str("Unknown exception getting durability stats. Check logs.");
+		LOG4CXX_ERROR(logger, logMessage.str().c_str());
+		throw ActiveException(logMessage);
+	}
+	return copied;
+}
+
 void ActiveInterface::getServices(std::list<std::string>& servicesList) throw (ActiveException){
 	std::stringstream logMessage;
 	try{
@@ -821,6 +909,24 @@ bool ActiveInterface::setLinkConnection(std::string& linkId,
 	return false;
 }
 
+void ActiveInterface::onMessageView(ActiveMessageView& messageView){
+	//by default decoding the whole message
+	onMessage(messageView.getActiveMessage());
+}
+
+void ActiveInterface::onConnectionRecovered(std::string& connectionId, int recovered, int total){
+	//by default nothing to do
+}
+
+void ActiveInterface::onMessageSent(ActiveSendHandle& sendHandle){
+	//by default nothing to do
+}
+
+ActiveStreamSink* ActiveInterface::onStreamStart(ActiveMessageView& header){
+	//by default chunks are received as messages
+	return NULL;
+}
+
 bool ActiveInterface::shutdown() throw (ActiveException){
 
 	std::stringstream logMessage;
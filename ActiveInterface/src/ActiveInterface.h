@@ -41,6 +41,9 @@
 #include "core/ActiveLink.h"
 #include "core/ActiveConnection.h"
 #include "core/message/ActiveMessage.h"
+#include "core/message/ActiveMessageView.h"
+#include "core/message/ActiveStreamSink.h"
+#include "core/message/ActiveFileSink.h"
 #include "utils/exception/ActiveException.h"
 #include "core/concurrent/ReadersWriters.h"
 
@@ -100,6 +103,45 @@ namespace ai{
 					ActiveMessage& activeMessage,
 					std::list<int>& positionInQueue) throw (ActiveException);
 
+		/**
+		 * Method that sends active message to a specific service id without waiting for
+		 * the broker. It returns when the message is in the queue of each link, with a
+		 * handle for each one. A handle is completed when the message is sent to the
+		 * broker (with the latency of the send), when it fails, or when it is only kept
+		 * in the persistence and will be sent later. The user can wait for the handles
+		 * or receive them in onMessageSent.
+		 *
+		 * @param serviceId service id to which we are going to send the message
+		 * @param activeMessage Message that the user have filled in his implementation.
+		 * @param handles reference to a list that method will fill with the handle of each
+		 * link that the message is sent through.
+		 *
+		 * @throws ActiveException if something happens
+		 */
+		void sendAsync(	std::string& serviceId,
+						ActiveMessage& activeMessage,
+						std::list<boost::shared_ptr<ActiveSendHandle> >& handles) throw (ActiveException);
+
+		/**
+		 * Method that sends a stream of bytes to a specific service id in chunks of
+		 * chunkSize bytes, so big payloads are never held in memory. Consumers receive
+		 * it through onStreamStart. It returns when the last chunk is in the queues.
+		 *
+		 * @param serviceId service id to which we are going to send the stream
+		 * @param activeMessage message with properties and parameters that describe the stream,
+		 * they are received with the first chunk.
+		 * @param source stream of bytes to send, it is read until its end
+		 * @param chunkSize max bytes of each chunk
+		 *
+		 * @return id of the stream
+		 *
+		 * @throws ActiveException if something happens
+		 */
+		std::string sendStream(	std::string& serviceId,
+								ActiveMessage& activeMessage,
+								std::istream& source,
+								unsigned int chunkSize=DEFAULT_STREAM_CHUNK_SIZE) throw (ActiveException);
+
 		/**
 		 * Method used to send replys to a specific connection id (not a service)
 		 * this connection needs to be of types 2 o 3 (Producer with request reply or Consumer RR).
@@ -305,6 +347,22 @@ namespace ai{
 		void getConnection(std::string& connectionId)
 			throw (ActiveException);
 
+		/**
+		 * Method that returns a snapshot of the histograms of the persistence of
+		 * a connection, the commit latency in microseconds and the messages
+		 * synchronized to disk each time
+		 *
+		 * @param connectionId identifier of the connection
+		 * @param commitLatencyR histogram where the commit latency is copied
+		 * @param syncBatchSizeR histogram where the messages of each sync are copied
+		 *
+		 * @return true if copied, false if the connection does not exist or has no persistence
+		 *
+		 * @throws ActiveException if something bad happens
+		 */
+		bool getDurabilityStats(std::string& connectionId, ActiveHistogram& commitLatencyR,
+								ActiveHistogram& syncBatchSizeR) throw (ActiveException);
+
 		/**
 		 * Method that returns all services that are using in this time
 		 *
@@ -394,6 +452,28 @@ namespace ai{
 		 */
 		virtual void onMessage(const ActiveMessage& activeMessage) abstract;
 
+		/**
+		 * Callback that the library invokes for each message received. Messages received
+		 * in binary format are not decoded, the view only decodes the fields requested.
+		 * By default the whole message is decoded and onMessage is called. Override it
+		 * if you only need some fields of the messages.
+		 *
+		 * @param messageView is the view of the message received, only valid in this call
+		 */
+		virtual void onMessageView(ActiveMessageView& messageView);
+
+		/**
+		 * Callback that the library invokes when the first chunk of a stream is received.
+		 * The user returns the sink where all chunks of the stream are written (for example
+		 * an ActiveFileSink), the library deletes it when the stream ends. By default it
+		 * returns NULL and each chunk is received as a message in onMessageView.
+		 *
+		 * @param header first chunk, with the properties and parameters sent with the stream
+		 *
+		 * @return sink of the stream or NULL
+		 */
+		virtual ActiveStreamSink* onStreamStart(ActiveMessageView& header);
+
 		/**
 		 * Callback that the library will invoke when connection with one of his associated
 		 * brokers is interrupted.
@@ -436,6 +516,28 @@ namespace ai{
 		 */
 		virtual void onException(std::string& connectionId)abstract;
 
+		/**
+		 * Callback that the library invokes when the persistence of a connection is
+		 * recovered at startup. Connections are recovered by several threads, so it
+		 * can be invoked from several threads at the same time. Messages can be sent
+		 * to a connection recovered while the others are recovering. By default it
+		 * does nothing.
+		 *
+		 * @param connectionId is the connection recovered
+		 * @param recovered number of connections recovered
+		 * @param total number of connections to recover
+		 */
+		virtual void onConnectionRecovered(std::string& connectionId, int recovered, int total);
+
+		/**
+		 * Callback that the library invokes when a message sent with sendAsync is
+		 * completed. It is invoked from the thread of the producer that sends it, so
+		 * it must not block. By default it does nothing.
+		 *
+		 * @param sendHandle handle completed, with its state and latency
+		 */
+		virtual void onMessageSent(ActiveSendHandle& sendHandle);
+
 		/**
 		 * Method that shutdown all the library, close all connections and free all resources
 		 * used by the library
@@ -24,6 +24,10 @@
 
 #include "ActiveConnection.h"
 
+#include <algorithm>
+
+#include <apr_time.h>
+
 using namespace ai;
 using namespace log4cxx;
 using namespace log4cxx::helpers;
@@ -47,8 +51,99 @@ ActiveConnection::ActiveConnection() {
 	password="";
 	linkId.clear();
 	sizePersistence=0;
+	segmentSize=DEFAULT_SEGMENT_SIZE;
+	persistenceType=ACTIVE_LOG_PERSISTENCE;
+	ringSize=DEFAULT_RING_SIZE;
+	sharedLog=DEFAULT_SHARED_LOG;
+	durability=ACTIVE_SYNC_NONE;
+	syncInterval=DEFAULT_SYNC_INTERVAL;
+	syncBatch=DEFAULT_SYNC_BATCH;
+	writeBehind=false;
+	writeQueueSize=DEFAULT_WRITE_QUEUE_SIZE;
+	spill=false;
+	spillWatermark=DEFAULT_SPILL_WATERMARK;
+	persistFrames=false;
+	snapshot=false;
+	deferredPersistence=false;
+	checkpointMessages=DEFAULT_CHECKPOINT_MESSAGES;
+	checkpointTime=DEFAULT_CHECKPOINT_TIME;
 	certificate="";
 	consumerThreadFlag=false;
+	messageFormat=ACTIVE_STREAM_FORMAT;
+	schemaTag=(unsigned int)apr_time_now() ^ (unsigned int)(size_t)this;
+	lastSchema=0;
+	compression=false;
+	compressionThreshold=DEFAULT_COMPRESSION_THRESHOLD;
+	compressedMessages=0;
+	uncompressedBytes=0;
+	compressedBytes=0;
+	compressionTime=0;
+	decompressedMessages=0;
+	decompressionTime=0;
+	batchSize=DEFAULT_BATCH_SIZE;
+	receivedEnvelopePosition=0;
+	lingerTime=DEFAULT_LINGER_TIME;
+	batchBytes=DEFAULT_BATCH_BYTES;
+	batchesSent=0;
+	batchedMessages=0;
+}
+
+unsigned int ActiveConnection::registerSchema(const ActiveMessage& shape){
+
+	std::stringstream logMessage;
+
+	//compact messages are only sent in envelopes, with the definition of their
+	//schema, a message sent alone could not be decoded by a consumer that
+	//did not receive the definition
+	if (!isBatching() || messageFormat!=ACTIVE_BINARY_FORMAT){
+		logMessage << "Schema not registered in connection "<< getId() << ". Schemas are only used "
+			"by producers in binary format that pack messages in envelopes (batchsize>1)";
+		LOG4CXX_WARN(logger, logMessage.str().c_str());
+		return 0;
+	}
+
+	ActiveSchema schema;
+	schema.load(shape);
+
+	schemasMutex.lock();
+	//same shape is the same schema
+	for (unsigned int it=0; it<schemas.size(); it++){
+		if (schemas[it].matches(shape)){
+			schemasMutex.unlock();
+			return it+1;
+		}
+	}
+	schemas.push_back(schema);
+	unsigned int schemaId=schemas.size();
+	schemasMutex.unlock();
+
+	logMessage << "Schema "<< schemaId << " with "<< schema.size() << " fields registered in connection "<< getId();
+	logIt(logMessage);
+	return schemaId;
+}
+
+unsigned int ActiveConnection::findSchema(const ActiveMessage& activeMessage){
+
+	unsigned int schemaId=0;
+
+	schemasMutex.lock();
+	if (!schemas.empty()){
+		if (lastSchema<schemas.size() && schemas[lastSchema].matches(activeMessage)){
+			schemaId=lastSchema+1;
+		}else{
+			for (unsigned int it=0; it<schemas.size() && !schemaId; it++){
+				if (schemas[it].matches(activeMessage)){
+					schemaId=it+1;
+				}
+			}
+		}
+		if (schemaId){
+			lastSchema=schemaId-1;
+		}
+	}
+	schemasMutex.unlock();
+
+	return schemaId;
 }
 
 void ActiveConnection::initSSLSupport(){
@@ -103,6 +198,13 @@ void ActiveConnection::loadPacketDescParameters(ActiveMessage& activeMessage){
 			activeMessage.pushInPacketDesc(bytesParameter->getValue().size());
 		}
 		break;
+		case ACTIVE_INT_ARRAY_PARAMETER:
+		case ACTIVE_REAL_ARRAY_PARAMETER:
+		case ACTIVE_INT64_ARRAY_PARAMETER:{
+			//number of elements is sent in the stream, it does not fit in the description
+			activeMessage.pushInPacketDesc(parameter->getType());
+		}
+		break;
 		}
 	}
 }
@@ -130,6 +232,417 @@ void ActiveConnection::loadPacketDescProperties(ActiveMessage& activeMessage){
 	}
 }
 
+void ActiveConnection::insertJMSProperties(cms::Message* message, ActiveMessage& activeMessage)
+	throw (ActiveException){
+
+	const ParameterList& propertiesList=activeMessage.getPropertiesList();
+
+	try{
+		for (ParameterList::const_iterator it=propertiesList.begin(); it!=propertiesList.end(); ++it){
+			Parameter* property=(*it).second;
+			switch (property->getType()){
+			case ACTIVE_INT_PARAMETER:{
+				message->setIntProperty((*it).first,((IntParameter*)property)->getValue());
+			}
+			break;
+			case ACTIVE_REAL_PARAMETER:{
+				message->setFloatProperty((*it).first,((RealParameter*)property)->getValue());
+			}
+			break;
+			case ACTIVE_STRING_PARAMETER:{
+				message->setStringProperty((*it).first,((StringParameter*)property)->getValue());
+			}
+			break;
+			}
+		}
+	}catch (cms::CMSException& e){
+		throw ActiveException(e.what());
+	}
+}
+
+void ActiveConnection::writeArrayParameter(cms::StreamMessage* streamMessage, const std::string& key, Parameter* parameter)
+	throw (ActiveException){
+
+	unsigned int count=ActiveMessageCodec::arraySize(parameter);
+	std::vector<unsigned char> data(count*ActiveMessageCodec::arrayElementSize(parameter->getType()));
+	if (!data.empty()){
+		ActiveMessageCodec::writeArray(&data[0],parameter);
+	}
+	try{
+		streamMessage->writeString(key);
+		streamMessage->writeInt(count);
+		streamMessage->writeBytes(data);
+	}catch (cms::CMSException& e){
+		throw ActiveException(e.what());
+	}
+}
+
+void ActiveConnection::readBytesField(cms::StreamMessage* streamMessage, std::vector<unsigned char>& value)
+	throw (ActiveException){
+
+	try{
+		//the length of the field is not known, it is read in blocks until the
+		//end of the field is returned (-1) and the value only grows with the
+		//bytes read, a small field takes a small buffer
+		unsigned char block[ACTIVE_BYTES_FIELD_BLOCK];
+		value.clear();
+		for (;;){
+			int length=streamMessage->readBytes(block,ACTIVE_BYTES_FIELD_BLOCK);
+			if (length<0){
+				break;
+			}
+			value.insert(value.end(),block,block+length);
+		}
+	}catch (cms::CMSException& e){
+		throw ActiveException(e.what());
+	}
+}
+
+void ActiveConnection::readArrayParameter(cms::StreamMessage* streamMessage, int type, ActiveMessage& activeMessage)
+	throw (ActiveException){
+
+	try{
+		std::string key=streamMessage->readString();
+		int count=streamMessage->readInt();
+		if (count<0){
+			throw ActiveException("ActiveConnection::readArrayParameter. Number of elements is not valid.");
+		}
+		std::vector<unsigned char> data;
+		readBytesField(streamMessage,data);
+		if (data.size()!=count*ActiveMessageCodec::arrayElementSize(type)){
+			throw ActiveException("ActiveConnection::readArrayParameter. Size of the array is not valid.");
+		}
+		decoder.readArray(data.empty()?NULL:&data[0],count,type,key,activeMessage);
+	}catch (cms::CMSException& e){
+		throw ActiveException(e.what());
+	}
+}
+
+bool ActiveConnection::isSentAsBinary(const ActiveMessage& activeMessage){
+
+	if (!activeMessage.isTextMessage()){
+		return messageFormat==ACTIVE_BINARY_FORMAT;
+	}
+	//big texts are encoded to be compressed
+	return compression && activeMessage.getText().size()>=(unsigned int)compressionThreshold;
+}
+
+unsigned int ActiveConnection::encodeMessage(ActiveMessage& activeMessage, bool inEnvelope)
+	throw (ActiveException){
+
+	//body already encoded for all connections, only properties are encoded
+	const std::vector<unsigned char>* encodedBody=activeMessage.getEncodedBody();
+	if (encodedBody){
+		return encoder.encode(activeMessage,*encodedBody,encodeBuffer);
+	}
+
+	//a consumer only knows the schemas defined in the same envelope
+	unsigned int schemaId=inEnvelope?findSchema(activeMessage):0;
+	if (schemaId){
+		bool definition=std::find(envelopeSchemas.begin(),envelopeSchemas.end(),schemaId)==envelopeSchemas.end();
+		if (definition){
+			envelopeSchemas.push_back(schemaId);
+		}
+		return encoder.encode(activeMessage,encodeBuffer,schemaTag,schemaId,definition);
+	}
+	return encoder.encode(activeMessage,encodeBuffer);
+}
+
+const unsigned char* ActiveConnection::compressMessage(const unsigned char* data, unsigned int& size){
+
+	if (!compression || size<(unsigned int)compressionThreshold){
+		return data;
+	}
+
+	apr_time_t start=apr_time_now();
+	unsigned int compressedSize=encoder.compress(data,size,compressBuffer);
+	apr_time_t elapsed=apr_time_now()-start;
+
+	compressionMutex.lock();
+	compressionTime+=elapsed;
+	if (compressedSize){
+		compressedMessages++;
+		uncompressedBytes+=size;
+		compressedBytes+=compressedSize;
+	}
+	compressionMutex.unlock();
+
+	//if it does not get smaller it is sent uncompressed
+	if (!compressedSize){
+		return data;
+	}
+	size=compressedSize;
+	return &compressBuffer[0];
+}
+
+cms::BytesMessage* ActiveConnection::createEnvelopeMessage(	cms::Session* session,
+															ActiveMessage& first,
+															std::vector<ActiveMessage>& batch,
+															unsigned int batchSizeR)
+	throw (ActiveException){
+
+	cms::BytesMessage* bytesMessage=NULL;
+
+	try{
+		ActiveMessageCodec::startEnvelope(envelopeBuffer);
+		envelopeSchemas.clear();
+		unsigned int size=encodeMessage(first,true);
+		ActiveMessageCodec::appendToEnvelope(envelopeBuffer,&encodeBuffer[0],size);
+		for (unsigned int it=0; it<batchSizeR; it++){
+			size=encodeMessage(batch[it],true);
+			ActiveMessageCodec::appendToEnvelope(envelopeBuffer,&encodeBuffer[0],size);
+		}
+
+		size=envelopeBuffer.size();
+		const unsigned char* data=compressMessage(&envelopeBuffer[0],size);
+
+		bytesMessage=session->createBytesMessage(data,size);
+		bytesMessage->setCMSType(ACTIVE_BINARY_CMS_TYPE);
+		//all messages of the envelope have the same properties
+		insertJMSProperties(bytesMessage,first);
+		return bytesMessage;
+
+	}catch (cms::CMSException& e){
+		delete bytesMessage;
+		throw ActiveException(e.what());
+	}catch (ActiveException& ae){
+		delete bytesMessage;
+		throw ae;
+	}
+}
+
+cms::BytesMessage* ActiveConnection::createBinaryMessage(cms::Session* session, ActiveMessage& activeMessage)
+	throw (ActiveException){
+
+	cms::BytesMessage* bytesMessage=NULL;
+
+	try{
+		unsigned int size=encodeMessage(activeMessage,false);
+		const unsigned char* data=compressMessage(&encodeBuffer[0],size);
+
+		bytesMessage=session->createBytesMessage(data,size);
+		bytesMessage->setCMSType(ACTIVE_BINARY_CMS_TYPE);
+		insertJMSProperties(bytesMessage,activeMessage);
+		return bytesMessage;
+
+	}catch (cms::CMSException& e){
+		delete bytesMessage;
+		throw ActiveException(e.what());
+	}catch (ActiveException& ae){
+		delete bytesMessage;
+		throw ae;
+	}
+}
+
+void ActiveConnection::decodeBinaryMessage(const cms::BytesMessage* bytesMessage, ActiveMessage& activeMessage)
+	throw (ActiveException){
+
+	try{
+		int size=bytesMessage->getBodyLength();
+		if (size<=0){
+			throw ActiveException("ActiveConnection::decodeBinaryMessage. Empty message received.");
+		}
+		//reading into a buffer reused between messages
+		unsigned int bodySize=size;
+		decodeBuffer.resize(bodySize);
+		bytesMessage->readBytes(&decodeBuffer[0],bodySize);
+		decompressMessage(decodeBuffer,bodySize);
+		//schemas are only used inside envelopes
+		decoder.forgetSchemas();
+		if (!decoder.learnSchema(&decodeBuffer[0],bodySize)){
+			throw ActiveException("ActiveConnection::decodeBinaryMessage. Message with a schema not defined in it, sent by an older version.");
+		}
+		decoder.decode(&decodeBuffer[0],bodySize,activeMessage);
+
+	}catch (cms::CMSException& e){
+		throw ActiveException(e.what());
+	}
+}
+
+void ActiveConnection::readBinaryMessage(const cms::BytesMessage* bytesMessage, ActiveMessageView& messageView)
+	throw (ActiveException){
+
+	try{
+		int size=bytesMessage->getBodyLength();
+		if (size<=0){
+			throw ActiveException("ActiveConnection::readBinaryMessage. Empty message received.");
+		}
+		receivedEnvelope.clear();
+		receivedEnvelopePosition=0;
+		//schemas of the previous broker message are not used again
+		decoder.forgetSchemas();
+
+		unsigned int bodySize=size;
+		decodeBuffer.resize(bodySize);
+		bytesMessage->readBytes(&decodeBuffer[0],bodySize);
+		decompressMessage(decodeBuffer,bodySize);
+
+		if (ActiveMessageCodec::isEnvelope(&decodeBuffer[0],bodySize)){
+			//the envelope is kept, its messages are read one by one
+			receivedEnvelope.swap(decodeBuffer);
+			if (!readEnvelopeMessage(messageView)){
+				throw ActiveException("ActiveConnection::readBinaryMessage. Empty envelope received.");
+			}
+			return;
+		}
+
+		//a message alone never uses a schema, it is defined in the message itself
+		if (!decoder.learnSchema(&decodeBuffer[0],bodySize)){
+			throw ActiveException("ActiveConnection::readBinaryMessage. Message with a schema not defined in it, sent by an older version.");
+		}
+		//the view keeps the body, decodeBuffer gets the old one
+		messageView.setBody(decodeBuffer,&decoder);
+
+	}catch (cms::CMSException& e){
+		throw ActiveException(e.what());
+	}
+}
+
+bool ActiveConnection::readEnvelopeMessage(ActiveMessageView& messageView)
+	throw (ActiveException){
+
+	std::stringstream logMessage;
+	const unsigned char* message=NULL;
+	unsigned int messageSize=0;
+
+	while (!receivedEnvelope.empty() &&
+		ActiveMessageCodec::nextInEnvelope(&receivedEnvelope[0],
+											receivedEnvelope.size(),
+											receivedEnvelopePosition,
+											message,
+											messageSize)){
+		decodeBuffer.assign(message,message+messageSize);
+		if (decoder.learnSchema(&decodeBuffer[0],messageSize)){
+			messageView.setBody(decodeBuffer,&decoder);
+			return true;
+		}
+		//only an older version sends a schema defined in other broker message, the rest are read
+		logMessage << "ActiveConnection::readEnvelopeMessage. Message with a schema not defined in the envelope discarded, sent by an older version.";
+		LOG4CXX_ERROR(logger, logMessage.str().c_str());
+		logMessage.str("");
+	}
+	receivedEnvelope.clear();
+	return false;
+}
+
+bool ActiveConnection::nextEnvelopeMessage(ActiveMessageView& messageView){
+
+	std::stringstream logMessage;
+
+	if (receivedEnvelope.empty()){
+		return false;
+	}
+	try{
+		messageView.recycle();
+		return readEnvelopeMessage(messageView);
+	}catch (ActiveException& ae){
+		receivedEnvelope.clear();
+		logMessage << "ActiveConnection::nextEnvelopeMessage. Rest of the envelope discarded. "<< ae.getMessage();
+		LOG4CXX_ERROR(logger, logMessage.str().c_str());
+		return false;
+	}
+}
+
+void ActiveConnection::decompressMessage(std::vector<unsigned char>& buffer, unsigned int& size)
+	throw (ActiveException){
+
+	if (!ActiveMessageCodec::isCompressed(&buffer[0],size)){
+		return;
+	}
+
+	apr_time_t start=apr_time_now();
+	size=ActiveMessageCodec::decompress(&buffer[0],size,decompressBuffer);
+	buffer.swap(decompressBuffer);
+	apr_time_t elapsed=apr_time_now()-start;
+
+	compressionMutex.lock();
+	decompressedMessages++;
+	decompressionTime+=elapsed;
+	compressionMutex.unlock();
+}
+
+apr_uint64_t ActiveConnection::getCompressedMessages(){
+	compressionMutex.lock();
+	apr_uint64_t messages=compressedMessages;
+	compressionMutex.unlock();
+	return messages;
+}
+
+double ActiveConnection::getCompressionRatio(){
+	double ratio=0;
+	compressionMutex.lock();
+	if (uncompressedBytes>0){
+		ratio=(double)compressedBytes/(double)uncompressedBytes;
+	}
+	compressionMutex.unlock();
+	return ratio;
+}
+
+apr_time_t ActiveConnection::getCompressionTime(){
+	compressionMutex.lock();
+	apr_time_t time=compressionTime;
+	compressionMutex.unlock();
+	return time;
+}
+
+apr_uint64_t ActiveConnection::getDecompressedMessages(){
+	compressionMutex.lock();
+	apr_uint64_t messages=decompressedMessages;
+	compressionMutex.unlock();
+	return messages;
+}
+
+apr_time_t ActiveConnection::getDecompressionTime(){
+	compressionMutex.lock();
+	apr_time_t time=decompressionTime;
+	compressionMutex.unlock();
+	return time;
+}
+
+void ActiveConnection::oneMoreBatch(unsigned int messages){
+	batchMutex.lock();
+	batchesSent++;
+	batchedMessages+=messages;
+	batchMutex.unlock();
+}
+
+double ActiveConnection::getAverageBatchSize(){
+	double average=0;
+	batchMutex.lock();
+	if (batchesSent>0){
+		average=(double)batchedMessages/(double)batchesSent;
+	}
+	batchMutex.unlock();
+	return average;
+}
+
+void ActiveConnection::logBatchStats(){
+
+	std::stringstream logMessage;
+
+	if (!isBatching()){
+		return;
+	}
+	logMessage << "Batching of connection " << getId() << ": average of "
+			<< getAverageBatchSize() << " messages in each broker message";
+	logIt(logMessage);
+}
+
+void ActiveConnection::logCompressionStats(){
+
+	std::stringstream logMessage;
+
+	if (!compression && getDecompressedMessages()==0){
+		return;
+	}
+	logMessage << "Compression of connection " << getId() << ": "
+			<< getCompressedMessages() << " messages compressed, ratio " << getCompressionRatio()
+			<< ", " << getCompressionTime() << " us compressing; "
+			<< getDecompressedMessages() << " messages decompressed, "
+			<< getDecompressionTime() << " us decompressing";
+	logIt(logMessage);
+}
+
 std::string ActiveConnection::getStringClientId(){
 	std::stringstream strClientId;
 
@@ -27,6 +27,15 @@
 #define ACTIVECONNECTION_H_
 
 #include "message/ActiveMessage.h"
+#include "message/ActiveMessageCodec.h"
+#include "message/ActiveMessageView.h"
+#include "message/ActiveSchema.h"
+#include "mutex/ActiveMutex.h"
+#include "../utils/ActiveHistogram.h"
+#include <apr_time.h>
+#include <cms/Session.h>
+#include <cms/BytesMessage.h>
+#include <cms/StreamMessage.h>
 
 #include <decaf/lang/System.h>
 
@@ -128,6 +137,71 @@ namespace ai{
 		 */
 		long sizePersistence;
 
+		/**
+		 * Max size in bytes of each segment of the persistence log
+		 */
+		int segmentSize;
+
+		/**
+		 * Type of persistence: log in segments or ring file, and size in bytes
+		 * of the ring
+		 */
+		int persistenceType;
+		int ringSize;
+
+		/**
+		 * Name of the log shared by the connections with shared persistence
+		 */
+		std::string sharedLog;
+
+		/**
+		 * When the persistence is synchronized to disk, and the milliseconds
+		 * or messages between synchronizations
+		 */
+		int durability;
+		int syncInterval;
+		int syncBatch;
+
+		/**
+		 * If true the persistence is written by its own thread, and size of the
+		 * queue of records waiting for it
+		 */
+		bool writeBehind;
+		int writeQueueSize;
+
+		/**
+		 * If true messages are only persisted when they can not be kept in
+		 * memory, and percent of the queue from which they are persisted
+		 */
+		bool spill;
+		int spillWatermark;
+
+		/**
+		 * If true binary messages are persisted encoded as they are sent, so
+		 * they are not encoded again when they are recovered
+		 */
+		bool persistFrames;
+
+		/**
+		 * If true and the connection has not persistence, the messages in
+		 * memory are written to a snapshot when the library is closed and
+		 * enqueued again when it is started
+		 */
+		bool snapshot;
+
+		/**
+		 * If true run does not start the persistence, it is started by the
+		 * recovery threads of the manager or when the first message is delivered
+		 */
+		bool deferredPersistence;
+
+		/**
+		 * The persistence writes a checkpoint each this number of messages sent
+		 * or milliseconds (0 to not use the time)
+		 */
+		int checkpointMessages;
+		int checkpointTime;
+
 		/**
 		 * flag to set the state of this connection
 		 * 0-no initated 1-running  2-persistence 3-closed
@@ -144,6 +218,197 @@ namespace ai{
 		 */
 		bool consumerThreadFlag;
 
+		/**
+		 * Format used to send parameter messages. ACTIVE_STREAM_FORMAT (StreamMessage)
+		 * or ACTIVE_BINARY_FORMAT (whole message encoded in one BytesMessage)
+		 */
+		int messageFormat;
+
+		/**
+		 * Codec used by the thread that sends messages
+		 */
+		ActiveMessageCodec encoder;
+
+		/**
+		 * Codec used by the thread that receives messages
+		 */
+		ActiveMessageCodec decoder;
+
+		/**
+		 * Buffer reused to encode messages in binary format
+		 */
+		std::vector<unsigned char> encodeBuffer;
+
+		/**
+		 * Buffer reused to read messages in binary format
+		 */
+		std::vector<unsigned char> decodeBuffer;
+
+		/**
+		 * Schemas registered to send messages, the schema id is the position + 1
+		 */
+		std::vector<ActiveSchema> schemas;
+
+		/**
+		 * Random tag that identifies the schemas of this connection in consumers
+		 */
+		unsigned int schemaTag;
+
+		/**
+		 * Schemas defined in the envelope that is being encoded. A consumer only
+		 * knows the schemas defined in the broker message it receives, so each
+		 * envelope defines again the schemas it uses.
+		 */
+		std::vector<unsigned int> envelopeSchemas;
+
+		/**
+		 * Position of the last schema used, checked first
+		 */
+		unsigned int lastSchema;
+
+		/**
+		 * Mutex to protect schemas, they are registered by the user and used by
+		 * the sending thread
+		 */
+		ActiveMutex schemasMutex;
+
+		/**
+		 * Method that finds the schema that matches with the message.
+		 *
+		 * @param activeMessage message to check
+		 *
+		 * @return schema id, 0 if there is not any schema for this message.
+		 */
+		unsigned int findSchema(const ActiveMessage& activeMessage);
+
+		/**
+		 * Flag to know if big messages are compressed
+		 */
+		bool compression;
+
+		/**
+		 * Messages encoded with this size or bigger are compressed
+		 */
+		int compressionThreshold;
+
+		/**
+		 * Buffers reused to compress and decompress messages
+		 */
+		std::vector<unsigned char> compressBuffer;
+		std::vector<unsigned char> decompressBuffer;
+
+		/**
+		 * Statistics of compression: messages compressed, bytes before and after
+		 * compressing them and time spent compressing (microseconds)
+		 */
+		apr_uint64_t compressedMessages;
+		apr_uint64_t uncompressedBytes;
+		apr_uint64_t compressedBytes;
+		apr_time_t compressionTime;
+
+		/**
+		 * Statistics of decompression: messages decompressed and time spent
+		 * decompressing them (microseconds)
+		 */
+		apr_uint64_t decompressedMessages;
+		apr_time_t decompressionTime;
+
+		/**
+		 * Mutex to protect statistics, they are updated by sending and receiving
+		 * threads and read by the user
+		 */
+		ActiveMutex compressionMutex;
+
+		/**
+		 * Method that decompresses the message received in buffer if it is compressed
+		 *
+		 * @param buffer message received, replaced by the decompressed message
+		 * @param size size of the message, updated with the decompressed size
+		 *
+		 * @throws ActiveException if the compressed message is not valid
+		 */
+		void decompressMessage(std::vector<unsigned char>& buffer, unsigned int& size)
+			throw (ActiveException);
+
+		/**
+		 * Max number of messages sent in one envelope, 1 to send each message alone
+		 */
+		int batchSize;
+
+		/**
+		 * Buffer reused to build envelopes
+		 */
+		std::vector<unsigned char> envelopeBuffer;
+
+		/**
+		 * Envelope received whose messages are being delivered, and position of
+		 * the next message to read. Empty if there is not any envelope pending.
+		 */
+		std::vector<unsigned char> receivedEnvelope;
+		unsigned int receivedEnvelopePosition;
+
+		/**
+		 * Max time in microseconds that the sending thread waits to fill an envelope,
+		 * 0 to send as soon as a message is ready
+		 */
+		int lingerTime;
+
+		/**
+		 * The sending thread stops waiting when this estimated number of bytes is
+		 * ready to send, 0 for no limit
+		 */
+		int batchBytes;
+
+		/**
+		 * Statistics of batching: broker messages sent and messages sent in them
+		 */
+		apr_uint64_t batchesSent;
+		apr_uint64_t batchedMessages;
+
+		/**
+		 * Mutex to protect the statistics of batching, updated by the sending
+		 * thread for each broker message and read by the user
+		 */
+		ActiveMutex batchMutex;
+
+		/**
+		 * Method that encodes a message into encodeBuffer. In an envelope, with its
+		 * schema if the message matches one, and its definition if the envelope
+		 * did not define it yet.
+		 *
+		 * @param activeMessage message to encode
+		 * @param inEnvelope true if the message is packed in an envelope
+		 *
+		 * @return size of the message encoded
+		 *
+		 * @throws ActiveException if the message can not be encoded
+		 */
+		unsigned int encodeMessage(ActiveMessage& activeMessage, bool inEnvelope)
+			throw (ActiveException);
+
+		/**
+		 * Method that compresses a message encoded if compression is on and the
+		 * message is big enough
+		 *
+		 * @param data message encoded
+		 * @param size size of the message, updated with the size to send
+		 *
+		 * @return bytes to send, data or the compressed message
+		 */
+		const unsigned char* compressMessage(const unsigned char* data, unsigned int& size);
+
+		/**
+		 * Method that reads the next message of the envelope received into the view
+		 *
+		 * @param messageView view where the message is set
+		 *
+		 * @return false if there are not more messages in the envelope
+		 *
+		 * @throws ActiveException if the envelope or the message is not valid
+		 */
+		bool readEnvelopeMessage(ActiveMessageView& messageView)
+			throw (ActiveException);
+
 	protected:
 
 		//////////////////////////////////////////////////////////////////
@@ -192,6 +457,127 @@ namespace ai{
 		 */
 		void loadPacketDescProperties(ActiveMessage& activeMessage);
 
+		/**
+		 * Method that sets the properties of activeMessage as JMS properties, so
+		 * selectors can be used with them.
+		 *
+		 * @param message JMS message where properties are set
+		 * @param activeMessage message from properties are extracted
+		 *
+		 * @throws ActiveException if something bad happens
+		 */
+		void insertJMSProperties(cms::Message* message, ActiveMessage& activeMessage)
+			throw (ActiveException);
+
+		/**
+		 * Method that writes an array parameter into a stream message: key,
+		 * number of elements and one bytes field with all elements in network order
+		 *
+		 * @param streamMessage JMS message where the parameter is written
+		 * @param key key of the parameter
+		 * @param parameter array parameter
+		 *
+		 * @throws ActiveException if something bad happens
+		 */
+		void writeArrayParameter(cms::StreamMessage* streamMessage, const std::string& key, Parameter* parameter)
+			throw (ActiveException);
+
+		/**
+		 * Method that reads a whole bytes field of a stream message, whatever its
+		 * size. The size stored in the packet description is only one byte, so
+		 * it is not used.
+		 *
+		 * @param streamMessage JMS message where the field is read
+		 * @param value where the bytes are read, it is resized to the size of the field
+		 *
+		 * @throws ActiveException if something bad happens
+		 */
+		void readBytesField(cms::StreamMessage* streamMessage, std::vector<unsigned char>& value)
+			throw (ActiveException);
+
+		/**
+		 * Method that reads an array parameter written by writeArrayParameter
+		 * and inserts it into the message
+		 *
+		 * @param streamMessage JMS message where the parameter is read
+		 * @param type type of the array, read from the packet description
+		 * @param activeMessage message where the parameter is inserted
+		 *
+		 * @throws ActiveException if something bad happens
+		 */
+		void readArrayParameter(cms::StreamMessage* streamMessage, int type, ActiveMessage& activeMessage)
+			throw (ActiveException);
+
+		/**
+		 * Method that packs several messages in one envelope and creates the JMS
+		 * BytesMessage that carries it. Properties of the first message are set
+		 * as JMS properties, all messages must be batchable with it.
+		 *
+		 * @param session session used to create the message
+		 * @param first first message of the envelope
+		 * @param batch rest of messages of the envelope
+		 * @param batchSizeR number of messages of batch to pack
+		 *
+		 * @return JMS message created, the caller must delete it
+		 *
+		 * @throws ActiveException if something bad happens
+		 */
+		cms::BytesMessage* createEnvelopeMessage(	cms::Session* session,
+													ActiveMessage& first,
+													std::vector<ActiveMessage>& batch,
+													unsigned int batchSizeR)
+			throw (ActiveException);
+
+		/**
+		 * Method that sets in the view the next message of the last envelope
+		 * received. Errors are logged and the rest of the envelope discarded.
+		 *
+		 * @param messageView view of the message, it is recycled
+		 *
+		 * @return false if there are not more messages
+		 */
+		bool nextEnvelopeMessage(ActiveMessageView& messageView);
+
+		/**
+		 * Method that encodes activeMessage in binary format and creates the
+		 * JMS BytesMessage that carries it. Properties are also set as JMS properties.
+		 * If compression is on, messages of compressionThreshold bytes or bigger
+		 * are compressed.
+		 *
+		 * @param session session used to create the message
+		 * @param activeMessage message to encode
+		 *
+		 * @return JMS message created, the caller must delete it
+		 *
+		 * @throws ActiveException if something bad happens
+		 */
+		cms::BytesMessage* createBinaryMessage(cms::Session* session, ActiveMessage& activeMessage)
+			throw (ActiveException);
+
+		/**
+		 * Method that decodes a JMS message received in binary format into activeMessage
+		 *
+		 * @param bytesMessage JMS message received
+		 * @param activeMessage message where data is inserted
+		 *
+		 * @throws ActiveException if the message is not valid
+		 */
+		void decodeBinaryMessage(const cms::BytesMessage* bytesMessage, ActiveMessage& activeMessage)
+			throw (ActiveException);
+
+		/**
+		 * Method that copies the body of a JMS message received in binary format into
+		 * the view, without decoding it. If it is an envelope, its first message is
+		 * set in the view and the rest are read with nextEnvelopeMessage.
+		 *
+		 * @param bytesMessage JMS message received
+		 * @param messageView view where the body is stored
+		 *
+		 * @throws ActiveException if the message is empty
+		 */
+		void readBinaryMessage(const cms::BytesMessage* bytesMessage, ActiveMessageView& messageView)
+			throw (ActiveException);
+
 		/**
 		 * Method to log some stringstream that calls to log4cxx
 		 */
@@ -216,6 +602,17 @@ namespace ai{
 		 */
 		virtual int send() abstract;
 
+		/**
+		 * Method to know if a message is sent encoded in binary format: parameter
+		 * messages if the format of the connection is binary, and big text messages
+		 * if compression is on, so they can be compressed.
+		 *
+		 * @param activeMessage message to send
+		 *
+		 * @return true if createBinaryMessage should be used
+		 */
+		bool isSentAsBinary(const ActiveMessage& activeMessage);
+
 		/**
 		 * virtual method to deliver a message into the intern queue
 		 *
@@ -237,6 +634,31 @@ namespace ai{
 		 */
 		virtual int deliver (ActiveMessage& activeMessage) abstract;
 
+		/**
+		 * virtual method to enqueue the messages replayed from the persistence into
+		 * the intern queue. They are enqueued without congestion control, as many
+		 * as fit in the queue.
+		 *
+		 * @param messages messages read from the persistence, in order
+		 *
+		 * @return number of messages enqueued, the first ones of messages
+		 *
+		 * @throws ActiveException if something bad happens
+		 */
+		virtual unsigned int replay (const std::vector<ActiveMessage>& messages) throw (ActiveException) abstract;
+
+		/**
+		 * virtual method that copies the histograms of the persistence of the
+		 * connection, the commit latency in microseconds and the messages
+		 * synchronized to disk each time
+		 *
+		 * @param commitLatencyR histogram where the commit latency is copied
+		 * @param syncBatchSizeR histogram where the messages of each sync are copied
+		 *
+		 * @return true if copied, false if the connection has no persistence
+		 */
+		virtual bool getDurabilityStats (ActiveHistogram& commitLatencyR, ActiveHistogram& syncBatchSizeR) abstract;
+
 		/**
 		 * Method that receives the messages synchronously
 		 */
@@ -264,13 +686,164 @@ namespace ai{
 		std::string& getUsername() {return username;}
 		std::string& getPassword() {return password;}
 		long getSizePersistence() {return sizePersistence;}
+		int getSegmentSize() {return segmentSize;}
+		int getPersistenceType() {return persistenceType;}
+		int getRingSize() {return ringSize;}
+		const std::string& getSharedLog() {return sharedLog;}
+		int getDurability() {return durability;}
+		int getSyncInterval() {return syncInterval;}
+		int getSyncBatch() {return syncBatch;}
+		bool getWriteBehind() {return writeBehind;}
+		int getWriteQueueSize() {return writeQueueSize;}
+		bool getSpill() {return spill;}
+		int getSpillWatermark() {return spillWatermark;}
+		bool getPersistFrames() {return persistFrames;}
+		bool getSnapshot() {return snapshot;}
+		bool getDeferredPersistence() {return deferredPersistence;}
+		int getCheckpointMessages() {return checkpointMessages;}
+		int getCheckpointTime() {return checkpointTime;}
 		int getState (){ return state;}
 		std::string& getCertificate(){return certificate;}
 		bool getEndConsumerThread (){ return consumerThreadFlag;}
+		int getMessageFormat (){ return messageFormat;}
+		bool getCompression (){ return compression;}
+		int getCompressionThreshold (){ return compressionThreshold;}
+		int getBatchSize (){ return batchSize;}
+		int getLingerTime (){ return lingerTime;}
+		int getBatchBytes (){ return batchBytes;}
 		void startConsumerThread(){ consumerThreadFlag=false;}
 		////////////////////////////////////////////////////////////////
 		void setLinkId (std::string& linkIdR){ linkId=linkIdR;}
 		void setState (int stateR){state=stateR;}
+		void setMessageFormat (int messageFormatR){messageFormat=messageFormatR;}
+		void setCompression (bool compressionR){compression=compressionR;}
+		void setCompressionThreshold (int compressionThresholdR){compressionThreshold=compressionThresholdR;}
+		void setBatchSize (int batchSizeR){batchSize=batchSizeR;}
+		void setLingerTime (int lingerTimeR){lingerTime=lingerTimeR;}
+		void setBatchBytes (int batchBytesR){batchBytes=batchBytesR;}
+		void setSegmentSize (int segmentSizeR){segmentSize=segmentSizeR;}
+		void setPersistenceType (int persistenceTypeR){persistenceType=persistenceTypeR;}
+		void setRingSize (int ringSizeR){ringSize=ringSizeR;}
+		void setSharedLog (const std::string& sharedLogR){sharedLog=sharedLogR;}
+		void setDurability (int durabilityR){durability=durabilityR;}
+		void setSyncInterval (int syncIntervalR){syncInterval=syncIntervalR;}
+		void setSyncBatch (int syncBatchR){syncBatch=syncBatchR;}
+		void setWriteBehind (bool writeBehindR){writeBehind=writeBehindR;}
+		void setWriteQueueSize (int writeQueueSizeR){writeQueueSize=writeQueueSizeR;}
+		void setSpill (bool spillR){spill=spillR;}
+		void setSpillWatermark (int spillWatermarkR){spillWatermark=spillWatermarkR;}
+		void setPersistFrames (bool persistFramesR){persistFrames=persistFramesR;}
+		void setSnapshot (bool snapshotR){snapshot=snapshotR;}
+		void setDeferredPersistence (bool deferredPersistenceR){deferredPersistence=deferredPersistenceR;}
+		void setCheckpointMessages (int checkpointMessagesR){checkpointMessages=checkpointMessagesR;}
+		void setCheckpointTime (int checkpointTimeR){checkpointTime=checkpointTimeR;}
+
+		/**
+		 * Method to know if this connection packs messages in envelopes. Only
+		 * producers without request reply do it.
+		 *
+		 * @return true if messages are batched
+		 */
+		bool isBatching (){ return batchSize>1 && type==ACTIVE_PRODUCER;}
+
+		/**
+		 * Method that returns the estimated bytes of messages waiting to be sent
+		 *
+		 * @return bytes waiting
+		 */
+		virtual unsigned long getQueuedBytes (){ return 0;}
+
+		/**
+		 * Method that waits until the estimated bytes of messages waiting to be
+		 * sent are not more than a limit, or until the timeout expires
+		 *
+		 * @param limit max bytes waiting
+		 * @param timeout max time to wait (microseconds)
+		 *
+		 * @return true if the bytes waiting are not more than the limit
+		 */
+		virtual bool waitQueuedBytes (unsigned long limit, apr_interval_time_t timeout){ return true;}
+
+		/**
+		 * Method that returns the mutex and condition shared by the handles of
+		 * the messages sent asynchronously through the connection
+		 *
+		 * @return mutex and condition of the connection, empty if it does not send
+		 */
+		virtual boost::shared_ptr<ActiveSendSync> getSendSync (){ return boost::shared_ptr<ActiveSendSync>();}
+
+		/**
+		 * Method that opens the persistence and finds the messages not sent
+		 * before. Connections without persistence do nothing.
+		 */
+		virtual void startPersistence (){}
+
+		/**
+		 * Method that writes the messages in memory to the snapshot of the
+		 * connection when the library is closed. Connections without queue do
+		 * nothing.
+		 */
+		virtual void takeSnapshot (){}
+
+		/**
+		 * Method that counts a broker message sent for batching statistics
+		 *
+		 * @param messages number of messages sent in it
+		 */
+		void oneMoreBatch (unsigned int messages);
+
+		/**
+		 * Method that returns the average number of messages sent in each broker message
+		 *
+		 * @return average batch size, 0 if nothing was sent
+		 */
+		double getAverageBatchSize ();
+
+		/**
+		 * Method that writes the statistics of batching in the log
+		 */
+		void logBatchStats();
+
+		/**
+		 * Methods that return the statistics of compression of this connection
+		 *
+		 * getCompressedMessages: messages sent compressed
+		 * getCompressionRatio: compressed bytes / original bytes of messages compressed, 0 if none
+		 * getCompressionTime: microseconds spent compressing messages, also the ones that
+		 * were not sent compressed because they did not get smaller
+		 * getDecompressedMessages: compressed messages received
+		 * getDecompressionTime: microseconds spent decompressing messages received
+		 */
+		apr_uint64_t getCompressedMessages();
+		double getCompressionRatio();
+		apr_time_t getCompressionTime();
+		apr_uint64_t getDecompressedMessages();
+		apr_time_t getDecompressionTime();
+
+		/**
+		 * Method that writes the statistics of compression in the log
+		 */
+		void logCompressionStats();
+
+		/**
+		 * Method that registers the shape of a message (keys and types of parameters
+		 * and properties) in this connection. Messages sent in binary format that have
+		 * exactly this shape are sent with the schema id and the values only, without
+		 * keys, when they are packed in an envelope. The first message of the envelope
+		 * with the schema carries its definition, so every consumer, of a queue or of a
+		 * topic, receives the definition with the messages that use it. Messages sent
+		 * alone, and the ones that do not match any schema, are sent self described.
+		 *
+		 * NOTE: schemas only save bytes inside envelopes. A compact message has no keys,
+		 * so a consumer that missed the definition could not decode it. The schema is
+		 * not registered, and a warning is logged, if the connection is not a producer
+		 * in binary format with batchsize bigger than 1.
+		 *
+		 * @param shape message used as model, only keys and types are used
+		 *
+		 * @return id of the schema, 0 if it is not registered
+		 */
+		unsigned int registerSchema(const ActiveMessage& shape);
 
 		/**
 		 * virtual method that says if the connection is in recovery mode
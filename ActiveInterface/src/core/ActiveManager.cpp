@@ -30,6 +30,9 @@
 #include "wrapper/ActiveConsumer.h"
 #include "wrapper/ActiveProducer.h"
 
+#include <apr_time.h>
+#include <decaf/util/UUID.h>
+
 using namespace log4cxx;
 using namespace log4cxx::helpers;
 
@@ -51,6 +54,8 @@ ActiveManager::ActiveManager() {
 	activeInterfacePtr=NULL;
 	//by default we are going to serialize messages in consumption
 	messageSerializedInConsumption=false;
+	recoveryThreads=DEFAULT_RECOVERY_THREADS;
+	streamIdleTimeout=DEFAULT_STREAM_IDLE_TIMEOUT;
 }
 
 void ActiveManager::init (	const std::string& configurationFile,
@@ -70,6 +75,13 @@ void ActiveManager::init (	const std::string& configurationFile,
 		initXMLLibrary(configurationFile);
 		//initializing all memory structures extracted from xml
 		initMemStructures();
+		//streams whose sender stops sending chunks are closed
+		if (streamIdleTimeout>0){
+			activeStreamThread.init(*this,ACTIVE_STREAM_CHECK_TIME);
+			if (activeStreamThread.runStreamThread()!=APR_SUCCESS){
+				LOG4CXX_ERROR(logger,"ActiveManager::init. Stream thread can not be started, idle streams are not closed.");
+			}
+		}
 
 	}catch (ActiveException& e){
 		throw e;
@@ -100,6 +112,24 @@ void ActiveManager::initXMLLibrary(const std::string& configurationFile)
 void ActiveManager::startConnections() throw (ActiveException){
 	std::stringstream logMessage;
 	try{
+		//connections with persistence are recovered in parallel, the ones
+		//recovered can be used while the others are recovering
+		if (recoveryThreads>0){
+			std::vector<ActiveConnection*> recoveries;
+			for (std::map<std::string,ActiveConnection*>::iterator it=connectionsMap.begin(); it!=connectionsMap.end(); ++it){
+				ActiveConnection* activeConnection=(*it).second;
+				if (activeConnection && activeConnection->getSizePersistence()>0){
+					activeConnection->setDeferredPersistence(true);
+					recoveries.push_back(activeConnection);
+				}
+			}
+			if (!recoveries.empty() && activeRecoveryPool.start(recoveries,recoveryThreads)==0){
+				//without threads each connection is recovered when it is run
+				for (unsigned int i=0; i<recoveries.size(); i++){
+					recoveries[i]->setDeferredPersistence(false);
+				}
+			}
+		}
 		std::map<std::string,ActiveConnection*>::iterator it=connectionsMap.begin();
 		std::map<std::string,ActiveConnection*>::iterator itEnd=connectionsMap.end();
 		while ( it != itEnd ){
@@ -184,6 +214,7 @@ void ActiveManager::sendData(	std::string& serviceId,
 			std::pair<std::multimap<std::string,ActiveLink*>::iterator, std::multimap<std::string,ActiveLink*>::iterator> iterator;
 
 			iterator = servicesMMap.equal_range(serviceId);
+			shareEncodedBody(iterator.first,iterator.second,activeMessage);
 
 			for(std::multimap<std::string,ActiveLink*>::iterator iteratorAux=iterator.first;
 				iteratorAux!=iterator.second;++iteratorAux){
@@ -207,10 +238,13 @@ void ActiveManager::sendData(	std::string& serviceId,
 					throw ActiveException(logMessage.str());
 				}
 			}
+			activeMessage.releaseEncodedBody();
 		}
 	}catch (ActiveException e){
+		activeMessage.releaseEncodedBody();
 		throw e;
 	}catch (...){
+		activeMessage.releaseEncodedBody();
 		logMessage.str("Unknown Exception sending data.");
 		throw ActiveException(logMessage.str());
 	}
@@ -230,6 +264,7 @@ void ActiveManager::sendData(	std::string& serviceId,
 			std::pair<std::multimap<std::string,ActiveLink*>::iterator, std::multimap<std::string,ActiveLink*>::iterator> iterator;
 
 			iterator = servicesMMap.equal_range(serviceId);
+			shareEncodedBody(iterator.first,iterator.second,activeMessage);
 
 			for(std::multimap<std::string,ActiveLink*>::iterator iteratorAux=iterator.first;
 				iteratorAux!=iterator.second;++iteratorAux){
@@ -255,15 +290,282 @@ void ActiveManager::sendData(	std::string& serviceId,
 					throw ActiveException(logMessage.str());
 				}
 			}
+			activeMessage.releaseEncodedBody();
+		}
+	}catch (ActiveException e){
+		activeMessage.releaseEncodedBody();
+		throw e;
+	}catch (...){
+		activeMessage.releaseEncodedBody();
+		logMessage.str("Unknown Exception sending data.");
+		throw ActiveException(logMessage.str());
+	}
+}
+
+void ActiveManager::sendDataAsync(	std::string& serviceId,
+									ActiveMessage& activeMessage,
+									std::list<boost::shared_ptr<ActiveSendHandle> >& handles) throw (ActiveException){
+
+	std::stringstream logMessage;
+	try{
+		//test if serviceId exists on multimap
+		if(servicesMMap.find(serviceId) == servicesMMap.end()){
+			logMessage << "ActiveManager::sendDataAsync. Service identifier doesnt exist" << serviceId;
+			throw ActiveException(logMessage.str());
+		}else{
+			std::pair<std::multimap<std::string,ActiveLink*>::iterator, std::multimap<std::string,ActiveLink*>::iterator> iterator;
+
+			iterator = servicesMMap.equal_range(serviceId);
+			shareEncodedBody(iterator.first,iterator.second,activeMessage);
+
+			for(std::multimap<std::string,ActiveLink*>::iterator iteratorAux=iterator.first;
+				iteratorAux!=iterator.second;++iteratorAux){
+
+				ActiveLink* activeLink=(ActiveLink*)((*iteratorAux).second);
+				if (activeLink->getActiveConnection()){
+					if (activeLink->getActiveConnection()->getType()==ACTIVE_PRODUCER ||
+						activeLink->getActiveConnection()->getType()==ACTIVE_PRODUCER_RR ){
+
+						//the copies of the message in the queue share the handle of this link
+						boost::shared_ptr<ActiveSendHandle> sendHandle(
+								new ActiveSendHandle(	activeLink->getId(),
+														activeLink->getActiveConnection()->getId(),
+														activeLink->getActiveConnection()->getSendSync()));
+						handles.push_back(sendHandle);
+						activeMessage.setSendHandle(sendHandle);
+						try{
+							activeLink->getActiveConnection()->deliver(activeMessage,*activeLink);
+						}catch (ActiveException& ae){
+							//the handle was completed as failed, other links are still delivered
+							logMessage << "ActiveManager::sendDataAsync. Message not delivered to link " << activeLink->getId()
+									<< ". " << ae.getMessage();
+							LOG4CXX_ERROR(logger, logMessage.str().c_str());
+							logMessage.str("");
+						}
+						activeMessage.releaseSendHandle();
+					}else{
+						logMessage << "ActiveManager::sendDataAsync. Error connection is not ready or is not a producer. "<<activeLink->getId();
+						throw ActiveException(logMessage.str());
+					}
+				}else{
+					logMessage << "ActiveManager::sendDataAsync. This link has no connection to send through: "<< activeLink->getId();
+					throw ActiveException(logMessage.str());
+				}
+			}
+			activeMessage.releaseEncodedBody();
 		}
 	}catch (ActiveException e){
+		activeMessage.releaseSendHandle();
+		activeMessage.releaseEncodedBody();
 		throw e;
 	}catch (...){
+		activeMessage.releaseSendHandle();
+		activeMessage.releaseEncodedBody();
 		logMessage.str("Unknown Exception sending data.");
 		throw ActiveException(logMessage.str());
 	}
 }
 
+void ActiveManager::shareEncodedBody(	std::multimap<std::string,ActiveLink*>::iterator first,
+										std::multimap<std::string,ActiveLink*>::iterator last,
+										ActiveMessage& activeMessage)
+	throw (ActiveException){
+
+	int binaryConnections=0;
+	for (std::multimap<std::string,ActiveLink*>::iterator it=first; it!=last; ++it){
+		ActiveConnection* activeConnection=(*it).second->getActiveConnection();
+		if (activeConnection && activeConnection->isSentAsBinary(activeMessage)){
+			binaryConnections++;
+		}
+	}
+
+	//with only one connection there is nothing to share
+	if (binaryConnections>1){
+		boost::shared_ptr<std::vector<unsigned char> > body(new std::vector<unsigned char>());
+		ActiveMessageCodec::encodeBody(activeMessage,*body);
+		activeMessage.setEncodedBody(body);
+	}
+}
+
+std::string ActiveManager::sendStream(	std::string& serviceId,
+										ActiveMessage& activeMessage,
+										std::istream& source,
+										unsigned int chunkSize) throw (ActiveException){
+
+	std::stringstream logMessage;
+	if (chunkSize==0){
+		throw ActiveException("ActiveManager::sendStream. Size of chunks must be greater than 0.");
+	}
+	if(servicesMMap.find(serviceId) == servicesMMap.end()){
+		logMessage << "ActiveManager::sendStream. Service identifier doesnt exist" << serviceId;
+		throw ActiveException(logMessage.str());
+	}
+	std::pair<std::multimap<std::string,ActiveLink*>::iterator, std::multimap<std::string,ActiveLink*>::iterator> iterator;
+	iterator = servicesMMap.equal_range(serviceId);
+
+	std::string streamId=decaf::util::UUID::randomUUID().toString();
+	std::string idKey(ACTIVE_STREAM_ID_PROPERTY);
+	std::string sequenceKey(ACTIVE_STREAM_SEQUENCE_PROPERTY);
+	std::string lastKey(ACTIVE_STREAM_LAST_PROPERTY);
+	std::string dataKey(ACTIVE_STREAM_DATA_KEY);
+
+	ActiveMessage chunkMessage(activeMessage);
+	chunkMessage.insertStringProperty(idKey,streamId);
+
+	std::vector<unsigned char> chunk;
+	int sequence=0;
+	bool last=false;
+	while (!last){
+		chunk.resize(chunkSize);
+		source.read((char*)&chunk[0],chunkSize);
+		if (source.bad()){
+			logMessage << "ActiveManager::sendStream. Error reading the stream " << streamId;
+			throw ActiveException(logMessage.str());
+		}
+		chunk.resize((unsigned int)source.gcount());
+		last=source.eof() || source.peek()==std::char_traits<char>::eof();
+
+		chunkMessage.insertIntProperty(sequenceKey,sequence);
+		chunkMessage.insertIntProperty(lastKey,last?1:0);
+		chunkMessage.insertBytesParameter(dataKey,chunk);
+		sendData(serviceId,chunkMessage);
+
+		//only the first chunk has the parameters of the user
+		if (sequence==0){
+			chunkMessage.clearParameters();
+		}else{
+			chunkMessage.deleteParameter(dataKey);
+		}
+		chunkMessage.deleteProperty(sequenceKey);
+		chunkMessage.deleteProperty(lastKey);
+		sequence++;
+
+		waitStreamWindow(iterator.first,iterator.second,(unsigned long)ACTIVE_STREAM_WINDOW*chunkSize);
+	}
+
+	logMessage << "ActiveManager::sendStream. Stream " << streamId << " sent in " << sequence << " chunks.";
+	LOG4CXX_DEBUG(logger, logMessage.str().c_str());
+	return streamId;
+}
+
+void ActiveManager::waitStreamWindow(	std::multimap<std::string,ActiveLink*>::iterator first,
+										std::multimap<std::string,ActiveLink*>::iterator last,
+										unsigned long limit){
+
+	for (std::multimap<std::string,ActiveLink*>::iterator it=first; it!=last; ++it){
+		ActiveConnection* activeConnection=(*it).second->getActiveConnection();
+		if (activeConnection==NULL){
+			continue;
+		}
+		//if the connection is down or in persistence, chunks are not kept in memory
+		while (activeConnection->getState()==CONNECTION_RUNNING &&
+				!activeConnection->isInRecoveryMode() &&
+				!activeConnection->waitQueuedBytes(limit,ACTIVE_STREAM_WAIT_TIME)){
+			//woken up when the queue sends a message, the state is checked again
+		}
+	}
+}
+
+bool ActiveManager::onStreamChunk(ActiveMessageView& messageView){
+
+	std::stringstream logMessage;
+	if (!messageView.hasProperty(ACTIVE_STREAM_ID_PROPERTY)){
+		return false;
+	}
+
+	std::string streamId;
+	messageView.getStringProperty(ACTIVE_STREAM_ID_PROPERTY,streamId);
+	int sequence=messageView.getIntProperty(ACTIVE_STREAM_SEQUENCE_PROPERTY);
+	bool last=messageView.getIntProperty(ACTIVE_STREAM_LAST_PROPERTY)!=0;
+
+	streamsMutex.lock();
+	std::map<std::string,ActiveStream>::iterator it=streams.find(streamId);
+	try{
+		if (it==streams.end()){
+			if (sequence!=0){
+				streamsMutex.unlock();
+				logMessage << "ActiveManager::onStreamChunk. Chunk of an unknown stream discarded " << streamId;
+				LOG4CXX_ERROR(logger, logMessage.str().c_str());
+				return true;
+			}
+			it=streams.insert(std::make_pair(streamId,ActiveStream())).first;
+			(*it).second.sink=activeInterfacePtr->onStreamStart(messageView);
+			(*it).second.nextSequence=0;
+		}
+
+		ActiveStream& stream=(*it).second;
+		stream.lastChunk=apr_time_now();
+		if (sequence!=stream.nextSequence){
+			logMessage << "ActiveManager::onStreamChunk. Chunk " << stream.nextSequence <<
+							" of stream " << streamId << " was lost, stream discarded.";
+			LOG4CXX_ERROR(logger, logMessage.str().c_str());
+			bool delivered=stream.sink==NULL;
+			closeStream(it,false);
+			streamsMutex.unlock();
+			return !delivered;
+		}
+		stream.nextSequence++;
+
+		//user wants the chunks as messages
+		if (stream.sink==NULL){
+			if (last){
+				streams.erase(it);
+			}
+			streamsMutex.unlock();
+			return false;
+		}
+
+		messageView.getBytesParameter(ACTIVE_STREAM_DATA_KEY,stream.chunk);
+		stream.sink->write(stream.chunk.empty()?NULL:&stream.chunk[0],stream.chunk.size());
+		if (last){
+			closeStream(it,true);
+		}
+	}catch (...){
+		logMessage << "ActiveManager::onStreamChunk. Error writing stream " << streamId << ", stream discarded.";
+		LOG4CXX_ERROR(logger, logMessage.str().c_str());
+		if (it!=streams.end()){
+			closeStream(it,false);
+		}
+	}
+	streamsMutex.unlock();
+	return true;
+}
+
+void ActiveManager::closeStream(std::map<std::string,ActiveStream>::iterator it, bool complete){
+
+	ActiveStreamSink* sink=(*it).second.sink;
+	streams.erase(it);
+	if (sink){
+		try{
+			sink->close(complete);
+		}catch (...){
+			LOG4CXX_ERROR(logger,"ActiveManager::closeStream. Error closing the sink of a stream.");
+		}
+		delete sink;
+	}
+}
+
+void ActiveManager::closeIdleStreams(){
+
+	std::stringstream logMessage;
+	apr_time_t now=apr_time_now();
+	streamsMutex.lock();
+	std::map<std::string,ActiveStream>::iterator it=streams.begin();
+	while (it!=streams.end()){
+		std::map<std::string,ActiveStream>::iterator current=it++;
+		if (now-(*current).second.lastChunk<apr_time_from_sec(streamIdleTimeout)){
+			continue;
+		}
+		logMessage << "ActiveManager::closeIdleStreams. No chunk of stream " << (*current).first <<
+						" received in " << streamIdleTimeout << " seconds after " << (*current).second.nextSequence <<
+						" chunks, stream closed as not complete.";
+		LOG4CXX_ERROR(logger, logMessage.str().c_str());
+		logMessage.str("");
+		closeStream(current,false);
+	}
+	streamsMutex.unlock();
+}
+
 void ActiveManager::sendResponse (std::string& connectionId, ActiveMessage& activeMessage) throw (ActiveException){
 
 	std::stringstream logMessage;
@@ -970,6 +1272,28 @@ ActiveConnection* ActiveManager::getConnection (std::string& id) throw (ActiveEx
 
 }
 
+ActiveSharedLog* ActiveManager::getSharedLog (const std::string& name, unsigned int segmentSize)
+	throw (ActiveException){
+
+	sharedLogsMutex.lock();
+	std::map<std::string,ActiveSharedLog*>::iterator it=sharedLogs.find(name);
+	if (it!=sharedLogs.end()){
+		sharedLogsMutex.unlock();
+		return (*it).second;
+	}
+	ActiveSharedLog* activeSharedLog=new ActiveSharedLog();
+	try{
+		activeSharedLog->open(name,segmentSize);
+	}catch (ActiveException& ae){
+		delete activeSharedLog;
+		sharedLogsMutex.unlock();
+		throw ae;
+	}
+	sharedLogs[name]=activeSharedLog;
+	sharedLogsMutex.unlock();
+	return activeSharedLog;
+}
+
 bool ActiveManager::insertInLinksMap (	std::string& linkId,
 										ActiveLink* activeLink) throw (ActiveException){
 	std::stringstream logMessage;
@@ -1049,6 +1373,34 @@ void ActiveManager::onMessageCallback (ActiveMessage& activeMessage){
 	}
 }
 
+void ActiveManager::onMessageCallback (ActiveMessageView& messageView){
+
+	std::stringstream logMessage;
+
+	//disable locking if user says that messages are not serialized
+	if (messageSerializedInConsumption){
+		messageSerializer.lock();
+	}
+
+	if (activeInterfacePtr!=NULL){
+		try{
+			if (!onStreamChunk(messageView)){
+				activeInterfacePtr->onMessageView(messageView);
+			}
+		}catch(...){
+			//protecting user error
+			LOG4CXX_DEBUG(logger,"ERROR handling the message by the user, protecting it!");
+		}
+	}else{
+		logMessage << "ActiveManager::onMessageCallback. Callback is null";
+		LOG4CXX_DEBUG(logger, logMessage.str().c_str());
+	}
+
+	if (messageSerializedInConsumption){
+		messageSerializer.unlock();
+	}
+}
+
 //mehtod that returns connection interrupt callback
 void ActiveManager::onConnectionInterruptCallback(std::string& connectionId){
 
@@ -1079,6 +1431,32 @@ void ActiveManager::onConnectionRestoreCallback(std::string& connectionId){
 	messageSerializer.unlock();
 }
 
+void ActiveManager::onConnectionRecoveredCallback(std::string& connectionId, int recovered, int total){
+
+	std::stringstream logMessage;
+
+	logMessage << "Connection " << connectionId << " recovered, " << recovered << " of " << total;
+	LOG4CXX_INFO(logger, logMessage.str().c_str());
+	if (activeInterfacePtr!=NULL){
+		activeInterfacePtr->onConnectionRecovered(connectionId,recovered,total);
+	}
+}
+
+void ActiveManager::onMessageSentCallback(ActiveSendHandle& sendHandle){
+
+	std::stringstream logMessage;
+
+	//not serialized with the other callbacks, producers complete their messages at the same time
+	if (activeInterfacePtr!=NULL){
+		try{
+			activeInterfacePtr->onMessageSent(sendHandle);
+		}catch (...){
+			logMessage << "Exception in the callback of a message sent through the link " << sendHandle.getLinkId();
+			LOG4CXX_ERROR(logger, logMessage.str().c_str());
+		}
+	}
+}
+
 //mehtod that is invoked when a packet is dropped by the queue
 void ActiveManager::onQueuePacketDropped(const ActiveMessage& activeMessage){
 
@@ -1124,6 +1502,28 @@ void ActiveManager::onException(std::string& connectionId){
 
 ActiveManager::~ActiveManager() {
 
+	//connections being recovered are finished, the others are not started
+	activeRecoveryPool.join(true);
+
+	//messages in memory of the connections without persistence are written
+	//to their snapshots in parallel, before the connections are closed
+	std::vector<ActiveConnection*> snapshots;
+	for (std::map<std::string,ActiveConnection*>::iterator it=connectionsMap.begin(); it!=connectionsMap.end(); ++it){
+		ActiveConnection* activeConnection=(*it).second;
+		if (activeConnection && activeConnection->getSnapshot() && activeConnection->getSizePersistence()==0){
+			snapshots.push_back(activeConnection);
+		}
+	}
+	if (!snapshots.empty()){
+		if (activeRecoveryPool.start(snapshots,(recoveryThreads>0)?recoveryThreads:1,true)>0){
+			activeRecoveryPool.join(false);
+		}else{
+			for (unsigned int i=0; i<snapshots.size(); i++){
+				snapshots[i]->takeSnapshot();
+			}
+		}
+	}
+
 	//deleting all connections
 	for( std::map <std::string,ActiveConnection*>::iterator ii=connectionsMap.begin();
 		ii!=connectionsMap.end(); ++ii){
@@ -1136,6 +1536,20 @@ ActiveManager::~ActiveManager() {
 		delete (*ii).second;
 	}
 
+	//shared logs are closed when no connection uses them
+	for( std::map <std::string,ActiveSharedLog*>::iterator ii=sharedLogs.begin();
+		ii!=sharedLogs.end(); ++ii){
+		delete (*ii).second;
+	}
+
+	//streams not finished are not complete
+	activeStreamThread.stop();
+	streamsMutex.lock();
+	while (!streams.empty()){
+		closeStream(streams.begin(),false);
+	}
+	streamsMutex.unlock();
+
 	ActiveManager::instanceFlag=false;
 	ActiveManager::mySelf=NULL;
 
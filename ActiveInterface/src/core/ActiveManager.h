@@ -28,8 +28,12 @@
 #define ACTIVEMANAGER_H_
 
 #include <map>
+#include <istream>
 
 #include "xml/ActiveXML.h"
+#include "persistence/ActiveSharedLog.h"
+#include "persistence/ActiveRecoveryPool.h"
+#include "wrapper/ActiveStreamThread.h"
 #include "../ActiveInterface.h"
 
 #include "log4cxx/logger.h"
@@ -99,6 +103,45 @@ namespace ai{
 						ActiveMessage& activeMessage,
 						std::list<int>& positionInQueue) throw (ActiveException);
 
+		/**
+		 * Method that sends active message to a specific service id without waiting
+		 * for the broker. A handle is created for each link of the service, it is
+		 * completed when the producer sends the message or fails. A link that does
+		 * not accept the message completes its handle as failed, the others are
+		 * still delivered.
+		 *
+		 * @param serviceId service id to which we are going to send the message
+		 * @param activeMessage Message that the user have filled in his implementation.
+		 * @param handles list that the method fills with the handle of each link
+		 *
+		 * @throws ActiveException if the service does not exist or a link is not a producer
+		 */
+		void sendDataAsync(	std::string& serviceId,
+							ActiveMessage& activeMessage,
+							std::list<boost::shared_ptr<ActiveSendHandle> >& handles) throw (ActiveException);
+
+		/**
+		 * Method that sends a stream of bytes to a specific service id as a sequence
+		 * of chunks. Each chunk is a message with the properties of the given message,
+		 * the stream id, its sequence number and a bytes parameter with the data. The
+		 * first chunk also has the parameters of the given message. It waits while the
+		 * queues of the connections have more than ACTIVE_STREAM_WINDOW chunks, so only
+		 * a few chunks are in memory whatever the size of the stream.
+		 *
+		 * @param serviceId service id to which we are going to send the stream
+		 * @param activeMessage message with the properties and parameters of the stream
+		 * @param source stream of bytes to send, it is read until its end
+		 * @param chunkSize max bytes of each chunk
+		 *
+		 * @return id of the stream
+		 *
+		 * @throws ActiveException if something bad happens
+		 */
+		std::string sendStream(	std::string& serviceId,
+								ActiveMessage& activeMessage,
+								std::istream& source,
+								unsigned int chunkSize) throw (ActiveException);
+
 		/**
 		 * Method used to send replys to a specific connection id (not a service)
 		 * this connection needs to be of types 2 o 3 (Producer with request reply or Consumer RR).
@@ -459,6 +502,43 @@ namespace ai{
 		 */
 		bool insertInLinksMap (	std::string& linkId, ActiveLink* activeLink) throw (ActiveException);
 
+		/**
+		 * Method that returns a persistence log shared by several connections,
+		 * it is opened the first time it is used and closed with the manager
+		 *
+		 * @param name name of the log
+		 * @param segmentSize max size in bytes of its segments, used when it is opened
+		 *
+		 * @return the log opened
+		 *
+		 * @throws ActiveException if the log can not be opened
+		 */
+		ActiveSharedLog* getSharedLog (const std::string& name, unsigned int segmentSize) throw (ActiveException);
+
+		/**
+		 * Method that sets the number of threads that recover the persistence
+		 * of the connections when they are started, 0 to recover each one when
+		 * it is run
+		 *
+		 * @param recoveryThreadsR number of threads
+		 */
+		void setRecoveryThreads (int recoveryThreadsR){ recoveryThreads=recoveryThreadsR;}
+
+		/**
+		 * Method that sets the seconds without chunks after which a stream being
+		 * received is closed as not complete, 0 to never close it
+		 *
+		 * @param streamIdleTimeoutR seconds without chunks
+		 */
+		void setStreamIdleTimeout (int streamIdleTimeoutR){ streamIdleTimeout=streamIdleTimeoutR;}
+
+		/**
+		 * Method that closes as not complete the streams being received that
+		 * did not receive any chunk in the idle timeout, their sender stopped or
+		 * their last chunk was lost. It is called periodically by the stream thread.
+		 */
+		void closeIdleStreams();
+
 
 		////////////////////////////////////////////////////////////////////////////////
 		// Callbacks methods
@@ -472,6 +552,14 @@ namespace ai{
 		 */
 		void onMessageCallback (ActiveMessage& activeMessage);
 
+		/**
+		 * Callback that the library will invoke when messages are received, giving
+		 * a view of the message that is decoded only when the user needs it.
+		 *
+		 * @param messageView is the view of the message that the library sends to the user
+		 */
+		void onMessageCallback (ActiveMessageView& messageView);
+
 		/**
 		 * Callback that the library will invoke when connection with one of his associated
 		 * brokers is interrupted.
@@ -509,6 +597,24 @@ namespace ai{
 		 */
 		void onQueuePacketReady(std::string& connectionId);
 
+		/**
+		 * Callback that the library will invoke when the persistence of a
+		 * connection is recovered, it can be invoked from several threads
+		 *
+		 * @param connectionId connection recovered
+		 * @param recovered number of connections recovered
+		 * @param total number of connections to recover
+		 */
+		void onConnectionRecoveredCallback(std::string& connectionId, int recovered, int total);
+
+		/**
+		 * Callback that the library will invoke when a message sent asynchronously
+		 * is completed, from the thread of the producer
+		 *
+		 * @param sendHandle handle completed
+		 */
+		void onMessageSentCallback(ActiveSendHandle& sendHandle);
+
 		/**
 		 * Class that implements the reader & writer thread safe method to
 		 * access to a code block
@@ -571,6 +677,62 @@ namespace ai{
 		 */
 		ActiveMutex messageSerializer;
 
+		/**
+		 * Stream that is being received
+		 */
+		struct ActiveStream{
+			/**
+			 * Sink given by the user, NULL if chunks are delivered as messages
+			 */
+			ActiveStreamSink* sink;
+
+			/**
+			 * Sequence number of the next chunk
+			 */
+			int nextSequence;
+
+			/**
+			 * Buffer where each chunk is read, reused between chunks
+			 */
+			std::vector<unsigned char> chunk;
+
+			/**
+			 * Time when the last chunk was received
+			 */
+			apr_time_t lastChunk;
+		};
+
+		/**
+		 * Streams that are being received, by stream id
+		 */
+		std::map <std::string,ActiveStream> streams;
+
+		/**
+		 * Mutex that protects the streams being received
+		 */
+		ActiveMutex streamsMutex;
+
+		/**
+		 * Seconds without chunks after which a stream is closed, and thread
+		 * that checks them
+		 */
+		int streamIdleTimeout;
+		ActiveStreamThread activeStreamThread;
+
+		/**
+		 * Persistence logs shared by connections, by name, and mutex that
+		 * protects them
+		 */
+		std::map <std::string,ActiveSharedLog*> sharedLogs;
+		ActiveMutex sharedLogsMutex;
+
+		/**
+		 * Threads that recover the persistence of the connections when they
+		 * are started, and max number of them
+		 */
+		ActiveRecoveryPool activeRecoveryPool;
+		int recoveryThreads;
+
 		/**
 		 * Variable to serialize messages received or not for each connection
 		 */
@@ -588,6 +750,55 @@ namespace ai{
 		 */
 		void initMemStructures() throw (ActiveException);
 
+		/**
+		 * Method that writes a chunk of a stream received into the sink of its stream.
+		 * The sink is asked to the user with the first chunk.
+		 *
+		 * @param messageView message received
+		 *
+		 * @return false if the message is not a chunk or the user wants to receive the
+		 * chunks of this stream as messages
+		 */
+		bool onStreamChunk(ActiveMessageView& messageView);
+
+		/**
+		 * Method that closes the sink of a stream and forgets it. It must be
+		 * called with streamsMutex locked.
+		 *
+		 * @param it stream to close
+		 * @param complete true if all chunks were received
+		 */
+		void closeStream(std::map<std::string,ActiveStream>::iterator it, bool complete);
+
+		/**
+		 * Method that waits while the queue of any connection of the service has
+		 * more bytes than the limit and the connection is sending. The queue
+		 * wakes it up when it sends a message.
+		 *
+		 * @param first first link of the service
+		 * @param last end of the links of the service
+		 * @param limit max bytes in the queue of each connection
+		 */
+		void waitStreamWindow(	std::multimap<std::string,ActiveLink*>::iterator first,
+								std::multimap<std::string,ActiveLink*>::iterator last,
+								unsigned long limit);
+
+		/**
+		 * Method that encodes the body of a message only once when it is sent
+		 * in binary format through more than one connection of the service.
+		 * Each connection only encodes its own properties before the shared body.
+		 *
+		 * @param first first link of the service
+		 * @param last end of the links of the service
+		 * @param activeMessage message that is going to be sent
+		 *
+		 * @throws ActiveException if the body can not be encoded
+		 */
+		void shareEncodedBody(	std::multimap<std::string,ActiveLink*>::iterator first,
+								std::multimap<std::string,ActiveLink*>::iterator last,
+								ActiveMessage& activeMessage)
+			throw (ActiveException);
+
 		/**
 		 * Method for initialize ticpp xml library for reading configuration file
 		 *
@@ -0,0 +1,115 @@
+/**
+ * @file
+ * @author  Oscar Pernas <oscar@pernas.es>
+ * @version 1.2.3
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * Class that copies arrays of 32 and 64 bits values converting them between
+ * the byte order of the host and big endian.
+ */
+
+#include "ActiveByteOrder.h"
+
+#include <string.h>
+
+#if defined(__SSSE3__)
+ #include <tmmintrin.h>
+ #define ACTIVE_SSSE3
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP>=2)
+ #include <emmintrin.h>
+ #define ACTIVE_SSE2
+#endif
+
+using namespace ai::message;
+
+bool ActiveByteOrder::isBigEndian(){
+	const unsigned int one=1;
+	return *(const unsigned char*)&one==0;
+}
+
+void ActiveByteOrder::copy32(const void* source, void* destination, unsigned int count){
+
+	const unsigned char* input=(const unsigned char*)source;
+	unsigned char* output=(unsigned char*)destination;
+
+	if (isBigEndian()){
+		memcpy(output,input,count*4);
+		return;
+	}
+
+	unsigned int it=0;
+#if defined(ACTIVE_SSSE3)
+	const __m128i mask=_mm_set_epi8(12,13,14,15,8,9,10,11,4,5,6,7,0,1,2,3);
+	for (; it+4<=count; it+=4){
+		__m128i value=_mm_loadu_si128((const __m128i*)(input+it*4));
+		_mm_storeu_si128((__m128i*)(output+it*4),_mm_shuffle_epi8(value,mask));
+	}
+#elif defined(ACTIVE_SSE2)
+	for (; it+4<=count; it+=4){
+		__m128i value=_mm_loadu_si128((const __m128i*)(input+it*4));
+		//swapping the 16 bits words of each value and then the bytes of each word
+		value=_mm_shufflelo_epi16(value,_MM_SHUFFLE(2,3,0,1));
+		value=_mm_shufflehi_epi16(value,_MM_SHUFFLE(2,3,0,1));
+		value=_mm_or_si128(_mm_slli_epi16(value,8),_mm_srli_epi16(value,8));
+		_mm_storeu_si128((__m128i*)(output+it*4),value);
+	}
+#endif
+	for (; it<count; it++){
+		const unsigned char* in=input+it*4;
+		unsigned char* out=output+it*4;
+		out[0]=in[3];
+		out[1]=in[2];
+		out[2]=in[1];
+		out[3]=in[0];
+	}
+}
+
+void ActiveByteOrder::copy64(const void* source, void* destination, unsigned int count){
+
+	const unsigned char* input=(const unsigned char*)source;
+	unsigned char* output=(unsigned char*)destination;
+
+	if (isBigEndian()){
+		memcpy(output,input,count*8);
+		return;
+	}
+
+	unsigned int it=0;
+#if defined(ACTIVE_SSSE3)
+	const __m128i mask=_mm_set_epi8(8,9,10,11,12,13,14,15,0,1,2,3,4,5,6,7);
+	for (; it+2<=count; it+=2){
+		__m128i value=_mm_loadu_si128((const __m128i*)(input+it*8));
+		_mm_storeu_si128((__m128i*)(output+it*8),_mm_shuffle_epi8(value,mask));
+	}
+#elif defined(ACTIVE_SSE2)
+	for (; it+2<=count; it+=2){
+		__m128i value=_mm_loadu_si128((const __m128i*)(input+it*8));
+		//reversing the 16 bits words of each value and then the bytes of each word
+		value=_mm_shufflelo_epi16(value,_MM_SHUFFLE(0,1,2,3));
+		value=_mm_shufflehi_epi16(value,_MM_SHUFFLE(0,1,2,3));
+		value=_mm_or_si128(_mm_slli_epi16(value,8),_mm_srli_epi16(value,8));
+		_mm_storeu_si128((__m128i*)(output+it*8),value);
+	}
+#endif
+	for (; it<count; it++){
+		const unsigned char* in=input+it*8;
+		unsigned char* out=output+it*8;
+		for (int byte=0; byte<8; byte++){
+			out[byte]=in[7-byte];
+		}
+	}
+}
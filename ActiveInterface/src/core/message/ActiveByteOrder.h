@@ -0,0 +1,67 @@
+/**
+ * @file
+ * @author  Oscar Pernas <oscar@pernas.es>
+ * @version 1.2.3
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * Class that copies arrays of 32 and 64 bits values converting them between
+ * the byte order of the host and the byte order used by the binary format
+ * (big endian). With SSE2 (or SSSE3) 16 bytes are converted at a time.
+ */
+
+#ifndef ACTIVEBYTEORDER_H_
+#define ACTIVEBYTEORDER_H_
+
+namespace ai{
+ namespace message{
+
+	class ActiveByteOrder {
+	private:
+
+		/**
+		 * Method to know if the host is big endian, so values only need to be copied
+		 *
+		 * @return true if the host is big endian
+		 */
+		static bool isBigEndian();
+
+	public:
+
+		/**
+		 * Method that copies 32 bits values converting their byte order, it
+		 * works in both directions (host to big endian and big endian to host)
+		 *
+		 * @param source values to copy, it does not need to be aligned
+		 * @param destination where values are copied, it does not need to be aligned
+		 * @param count number of values
+		 */
+		static void copy32(const void* source, void* destination, unsigned int count);
+
+		/**
+		 * Method that copies 64 bits values converting their byte order, it
+		 * works in both directions (host to big endian and big endian to host)
+		 *
+		 * @param source values to copy, it does not need to be aligned
+		 * @param destination where values are copied, it does not need to be aligned
+		 * @param count number of values
+		 */
+		static void copy64(const void* source, void* destination, unsigned int count);
+	};
+ }
+}
+
+#endif /* ACTIVEBYTEORDER_H_ */
@@ -0,0 +1,201 @@
+/**
+ * @file
+ * @author  Oscar Pernas <oscar@pernas.es>
+ * @version 1.2.3
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * Class that implements a fast LZ77 block compressor used to compress large
+ * messages.
+ */
+
+#include "ActiveCompressor.h"
+
+#include <string.h>
+
+using namespace ai::message;
+
+//shortest match that is encoded
+#define MIN_MATCH 4
+//bits of the hash table
+#define HASH_BITS 12
+//max distance of a match
+#define MAX_OFFSET 65535
+
+static inline unsigned int read32(const unsigned char* data){
+	unsigned int value;
+	memcpy(&value,data,sizeof(value));
+	return value;
+}
+
+static inline unsigned int hash32(unsigned int value){
+	return (value*2654435761U)>>(32-HASH_BITS);
+}
+
+unsigned int ActiveCompressor::maxCompressedSize(unsigned int size){
+	return size+size/255+16;
+}
+
+void ActiveCompressor::writeLength(unsigned char* output, unsigned int& position, unsigned int length){
+	while (length>=255){
+		output[position++]=255;
+		length-=255;
+	}
+	output[position++]=(unsigned char)length;
+}
+
+unsigned int ActiveCompressor::readLength(const unsigned char* input, unsigned int size, unsigned int& position)
+	throw (ActiveException){
+
+	unsigned int length=0;
+	unsigned char value=255;
+	while (value==255){
+		if (position>=size){
+			throw ActiveException("ActiveCompressor::decompress. Block is truncated.");
+		}
+		value=input[position++];
+		length+=value;
+	}
+	return length;
+}
+
+unsigned int ActiveCompressor::compress(const unsigned char* input, unsigned int size, unsigned char* output){
+
+	unsigned int position=0;
+	unsigned int anchor=0;
+	unsigned int current=0;
+
+	hashTable.assign(1<<HASH_BITS,0);
+
+	while (current+MIN_MATCH<=size){
+		unsigned int sequence=read32(input+current);
+		unsigned int& slot=hashTable[hash32(sequence)];
+		unsigned int candidate=slot;
+		slot=current+1;
+
+		if (candidate==0 || current-(candidate-1)>MAX_OFFSET || read32(input+candidate-1)!=sequence){
+			current++;
+			continue;
+		}
+		candidate--;
+
+		//extending the match
+		unsigned int matchLength=MIN_MATCH;
+		while (current+matchLength<size && input[candidate+matchLength]==input[current+matchLength]){
+			matchLength++;
+		}
+
+		//token, literals, offset and match length
+		unsigned int literals=current-anchor;
+		unsigned int tokenPosition=position++;
+		unsigned char token=0;
+		if (literals>=15){
+			token=15<<4;
+			writeLength(output,position,literals-15);
+		}else{
+			token=(unsigned char)(literals<<4);
+		}
+		memcpy(output+position,input+anchor,literals);
+		position+=literals;
+
+		unsigned int offset=current-candidate;
+		output[position++]=(unsigned char)(offset & 0xFF);
+		output[position++]=(unsigned char)(offset>>8);
+
+		if (matchLength-MIN_MATCH>=15){
+			token|=15;
+			writeLength(output,position,matchLength-MIN_MATCH-15);
+		}else{
+			token|=(unsigned char)(matchLength-MIN_MATCH);
+		}
+		output[tokenPosition]=token;
+
+		current+=matchLength;
+		anchor=current;
+	}
+
+	//last sequence, only literals
+	unsigned int literals=size-anchor;
+	if (literals>=15){
+		output[position++]=15<<4;
+		writeLength(output,position,literals-15);
+	}else{
+		output[position++]=(unsigned char)(literals<<4);
+	}
+	memcpy(output+position,input+anchor,literals);
+	position+=literals;
+
+	return position;
+}
+
+void ActiveCompressor::decompress(	const unsigned char* input,
+									unsigned int size,
+									unsigned char* output,
+									unsigned int originalSize)
+	throw (ActiveException){
+
+	unsigned int position=0;
+	unsigned int written=0;
+
+	while (position<size){
+		unsigned char token=input[position++];
+
+		unsigned int literals=token>>4;
+		if (literals==15){
+			literals+=readLength(input,size,position);
+		}
+		if (literals>size-position || literals>originalSize-written){
+			throw ActiveException("ActiveCompressor::decompress. Literals out of block.");
+		}
+		memcpy(output+written,input+position,literals);
+		position+=literals;
+		written+=literals;
+
+		//last sequence
+		if (position==size){
+			break;
+		}
+
+		if (size-position<2){
+			throw ActiveException("ActiveCompressor::decompress. Block is truncated.");
+		}
+		unsigned int offset=input[position] | (input[position+1]<<8);
+		position+=2;
+		if (offset==0 || offset>written){
+			throw ActiveException("ActiveCompressor::decompress. Match offset out of block.");
+		}
+
+		unsigned int matchLength=(token & 15);
+		if (matchLength==15){
+			matchLength+=readLength(input,size,position);
+		}
+		matchLength+=MIN_MATCH;
+		if (matchLength>originalSize-written){
+			throw ActiveException("ActiveCompressor::decompress. Match out of block.");
+		}
+
+		//byte by byte, the match can overlap with the data being written
+		const unsigned char* match=output+written-offset;
+		for (unsigned int it=0; it<matchLength; it++){
+			output[written+it]=match[it];
+		}
+		written+=matchLength;
+	}
+
+	if (written!=originalSize){
+		throw ActiveException("ActiveCompressor::decompress. Size of the block is not valid.");
+	}
+}
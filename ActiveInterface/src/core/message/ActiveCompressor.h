@@ -0,0 +1,129 @@
+/**
+ * @file
+ * @author  Oscar Pernas <oscar@pernas.es>
+ * @version 1.2.3
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * Class that implements a fast LZ77 block compressor used to compress large
+ * messages, it favours speed over ratio. The compressed block is a list of
+ * sequences:
+ *
+ *   token (1 byte): literals length (high 4 bits), match length - 4 (low 4 bits)
+ *   more literals length bytes (255 each) if the literals length is 15
+ *   literals
+ *   match offset (2 bytes, little endian), not present in the last sequence
+ *   more match length bytes (255 each) if the match length is 15
+ *
+ * The last sequence only has literals and ends the block.
+ */
+
+#ifndef ACTIVECOMPRESSOR_H_
+#define ACTIVECOMPRESSOR_H_
+
+#include <vector>
+#include <sstream>
+
+#include "../../utils/exception/ActiveException.h"
+
+namespace ai{
+ namespace message{
+
+	class ActiveCompressor {
+	private:
+
+		/**
+		 * Last position + 1 of each hash of 4 bytes, 0 if empty. Reused between
+		 * blocks to avoid allocations.
+		 */
+		std::vector<unsigned int> hashTable;
+
+		/**
+		 * Method that writes a length that does not fit in the token
+		 *
+		 * @param output where to write
+		 * @param position position where to write, it is moved after the length
+		 * @param length rest of the length (length - 15)
+		 */
+		static void writeLength(unsigned char* output, unsigned int& position, unsigned int length);
+
+		/**
+		 * Method that reads a length that does not fit in the token
+		 *
+		 * @param input block to read
+		 * @param size size of the block
+		 * @param position position to read, it is moved after the length
+		 *
+		 * @return rest of the length
+		 *
+		 * @throws ActiveException if the block ends before the length
+		 */
+		static unsigned int readLength(const unsigned char* input, unsigned int size, unsigned int& position)
+			throw (ActiveException);
+
+	public:
+
+		/**
+		 * Method that returns the max size of a compressed block
+		 *
+		 * @param size size of the data to compress
+		 *
+		 * @return bytes needed in the worst case
+		 */
+		static unsigned int maxCompressedSize(unsigned int size);
+
+		/**
+		 * Method that compresses a block of data
+		 *
+		 * @param input data to compress
+		 * @param size size of the data
+		 * @param output buffer where the block is written, it must have
+		 * maxCompressedSize(size) bytes.
+		 *
+		 * @return size of the compressed block
+		 */
+		unsigned int compress(const unsigned char* input, unsigned int size, unsigned char* output);
+
+		/**
+		 * Method that decompresses a block
+		 *
+		 * @param input compressed block
+		 * @param size size of the block
+		 * @param output buffer where data is written
+		 * @param originalSize size of the data before compressing
+		 *
+		 * @throws ActiveException if the block is not valid
+		 */
+		static void decompress(	const unsigned char* input,
+								unsigned int size,
+								unsigned char* output,
+								unsigned int originalSize)
+			throw (ActiveException);
+
+		/**
+		 * Default constructor
+		 */
+		ActiveCompressor(){}
+
+		/**
+		 * Default destructor
+		 */
+		virtual ~ActiveCompressor(){}
+	};
+ }
+}
+
+#endif /* ACTIVECOMPRESSOR_H_ */
@@ -50,6 +50,13 @@ void ActiveDestination::setReplyTo(const cms::Destination* replyToR){
 	replyTo=replyToR;
 }
 
+void ActiveDestination::release(){
+	if (replyTo){
+		delete replyTo;
+	}
+	replyTo=NULL;
+}
+
 void ActiveDestination::copy(const ActiveDestination& activeDestinationR){
 	setReplyTo(activeDestinationR.getReplyTo());
 }
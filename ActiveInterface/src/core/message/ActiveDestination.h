@@ -85,6 +85,12 @@ namespace ai {
 		 */
 		void clear (){ replyTo=NULL;}
 
+		/**
+		 *	Method that deletes the destination cloned (if any) and clear it.
+		 *	Used when the message that owns it is going to be reused.
+		 */
+		void release ();
+
 		/**
 		 *	Copy constructor
 		 */
@@ -0,0 +1,55 @@
+/**
+ * @file
+ * @author  Oscar Pernas <oscar@pernas.es>
+ * @version 1.2.3
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * Sink that writes a stream received into a file.
+ */
+
+#include <sstream>
+
+#include "ActiveFileSink.h"
+
+#include <cstdio>
+
+using namespace ai::message;
+
+ActiveFileSink::ActiveFileSink(const std::string& pathR) throw (ActiveException){
+	path=pathR;
+	file.open(path.c_str(),std::ios::out | std::ios::binary | std::ios::trunc);
+	if (!file.is_open()){
+		throw ActiveException("ActiveFileSink. Impossible to create the file "+path);
+	}
+}
+
+void ActiveFileSink::write(const unsigned char* data, unsigned int size){
+	file.write((const char*)data,size);
+}
+
+void ActiveFileSink::close(bool complete){
+	file.close();
+	if (!complete || file.fail()){
+		remove(path.c_str());
+	}
+}
+
+ActiveFileSink::~ActiveFileSink(){
+	if (file.is_open()){
+		file.close();
+	}
+}
@@ -0,0 +1,101 @@
+/**
+ * @file
+ * @author  Oscar Pernas <oscar@pernas.es>
+ * @version 1.2.3
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * Sink that writes a stream received into a file. The file is removed if
+ * the stream is not complete.
+ */
+
+#ifndef ACTIVEFILESINK_H_
+#define ACTIVEFILESINK_H_
+
+#ifdef ACTIVEINTERFACE_DLL
+ #ifdef ACTIVEINTERFACE_EXPORTS
+  #define ACTIVEINTERFACE_API __declspec( dllexport )
+ #else
+  #define ACTIVEINTERFACE_API __declspec( dllimport )
+ #endif
+#else
+ #define ACTIVEINTERFACE_API
+#endif
+
+#include "ActiveStreamSink.h"
+#include "../../utils/exception/ActiveException.h"
+
+#include <string>
+#include <fstream>
+
+namespace ai{
+ namespace message{
+
+	class ACTIVEINTERFACE_API ActiveFileSink : public ActiveStreamSink {
+	private:
+
+		/**
+		 * Path of the file written
+		 */
+		std::string path;
+
+		/**
+		 * File written
+		 */
+		std::ofstream file;
+
+	public:
+
+		/**
+		 * Constructor, it creates the file (truncating it if it exists)
+		 *
+		 * @param pathR path of the file
+		 *
+		 * @throws ActiveException if the file can not be created
+		 */
+		ActiveFileSink(const std::string& pathR) throw (ActiveException);
+
+		/**
+		 * Method that appends a chunk to the file
+		 *
+		 * @param data bytes of the chunk
+		 * @param size number of bytes
+		 */
+		void write(const unsigned char* data, unsigned int size);
+
+		/**
+		 * Method that closes the file, removing it if the stream is not complete
+		 *
+		 * @param complete true if all chunks were received
+		 */
+		void close(bool complete);
+
+		/**
+		 * Method that returns the path of the file
+		 *
+		 * @return path of the file
+		 */
+		const std::string& getPath() const { return path;}
+
+		/**
+		 * Default destructor
+		 */
+		virtual ~ActiveFileSink();
+	};
+ }
+}
+
+#endif /* ACTIVEFILESINK_H_ */
@@ -39,6 +39,37 @@ using namespace log4cxx::helpers;
 
 LoggerPtr ActiveMessage::logger(Logger::getLogger("ActiveMessage"));
 
+/**
+ * Bytes used by keys and values of a list
+ */
+static unsigned int estimateSize(const ParameterList& parameterList){
+
+	unsigned int size=0;
+	for (ParameterList::const_iterator it=parameterList.begin(); it!=parameterList.end(); ++it){
+		size+=(*it).first.size();
+		switch ((*it).second->getType()){
+		case ACTIVE_STRING_PARAMETER:
+			size+=((StringParameter*)(*it).second)->getValue().size();
+		break;
+		case ACTIVE_BYTES_PARAMETER:
+			size+=((BytesParameter*)(*it).second)->getValue().size();
+		break;
+		case ACTIVE_INT_ARRAY_PARAMETER:
+			size+=((IntArrayParameter*)(*it).second)->getValue().size()*4;
+		break;
+		case ACTIVE_REAL_ARRAY_PARAMETER:
+			size+=((RealArrayParameter*)(*it).second)->getValue().size()*4;
+		break;
+		case ACTIVE_INT64_ARRAY_PARAMETER:
+			size+=((Int64ArrayParameter*)(*it).second)->getValue().size()*8;
+		break;
+		default:
+			size+=4;
+		}
+	}
+	return size;
+}
+
 
 ActiveMessage::ActiveMessage() {
 
@@ -90,6 +121,10 @@ void ActiveMessage::clone(const ActiveMessage& activeMessageR) throw (ActiveExce
 		cloneLists(activeMessageR);
 		//cloning destination reply to
 		activeDestination.clone(activeMessageR.getDestination());
+		//body encoded is immutable so it is shared, not copied
+		encodedBody=activeMessageR.encodedBody;
+		//the copies in the queue complete the handle of the user
+		sendHandle=activeMessageR.sendHandle;
 
 	}catch (...){
 		throw ActiveException ("Exception cloning data from queue.");
@@ -115,12 +150,10 @@ void ActiveMessage::cloneDestination (const cms::Destination* destinationR){
 }
 
 void ActiveMessage::insertIntParameter(std::string& key, int value){
-
-	std::stringstream logMessage;
-
 	try{
 		parameterList.insertIntParameter(key,value);
 	}catch (ActiveException& ae){
+		std::stringstream logMessage;
 		logMessage << ae.getMessage();
 		LOG4CXX_DEBUG(logger,logMessage.str().c_str());
 	}
@@ -128,33 +161,60 @@ void ActiveMessage::insertIntParameter(std::string& key, int value){
 }
 
 void ActiveMessage::insertRealParameter(std::string& key,float value){
-	std::stringstream logMessage;
-
 	try{
 		parameterList.insertRealParameter(key,value);
 	}catch (ActiveException& ae){
+		std::stringstream logMessage;
 		logMessage << ae.getMessage();
 		LOG4CXX_DEBUG(logger,logMessage.str().c_str());
 	}
 }
 
 void ActiveMessage::insertStringParameter(std::string& key,std::string& value){
-	std::stringstream logMessage;
-
 	try{
 		parameterList.insertStringParameter(key,value);
 	}catch (ActiveException& ae){
+		std::stringstream logMessage;
 		logMessage << ae.getMessage();
 		LOG4CXX_DEBUG(logger,logMessage.str().c_str());
 	}
 }
 
 void ActiveMessage::insertBytesParameter(std::string& key, std::vector<unsigned char>& value){
-	std::stringstream logMessage;
-
 	try{
 		parameterList.insertBytesParameter(key,value);
 	}catch (ActiveException& ae){
+		std::stringstream logMessage;
+		logMessage << ae.getMessage();
+		LOG4CXX_DEBUG(logger,logMessage.str().c_str());
+	}
+}
+
+void ActiveMessage::insertIntArrayParameter(std::string& key, const std::vector<int>& value){
+	try{
+		parameterList.insertIntArrayParameter(key,value);
+	}catch (ActiveException& ae){
+		std::stringstream logMessage;
+		logMessage << ae.getMessage();
+		LOG4CXX_DEBUG(logger,logMessage.str().c_str());
+	}
+}
+
+void ActiveMessage::insertRealArrayParameter(std::string& key, const std::vector<float>& value){
+	try{
+		parameterList.insertRealArrayParameter(key,value);
+	}catch (ActiveException& ae){
+		std::stringstream logMessage;
+		logMessage << ae.getMessage();
+		LOG4CXX_DEBUG(logger,logMessage.str().c_str());
+	}
+}
+
+void ActiveMessage::insertInt64ArrayParameter(std::string& key, const std::vector<long long>& value){
+	try{
+		parameterList.insertInt64ArrayParameter(key,value);
+	}catch (ActiveException& ae){
+		std::stringstream logMessage;
 		logMessage << ae.getMessage();
 		LOG4CXX_DEBUG(logger,logMessage.str().c_str());
 	}
@@ -171,12 +231,10 @@ void ActiveMessage::deleteParameter(std::string& key){
 }
 
 void ActiveMessage::insertIntProperty(std::string& key, int value){
-
-	std::stringstream logMessage;
-
 	try{
 		propertiesList.insertIntParameter(key,value);
 	}catch (ActiveException& ae){
+		std::stringstream logMessage;
 		logMessage << ae.getMessage();
 		LOG4CXX_DEBUG(logger,logMessage.str().c_str());
 	}
@@ -184,22 +242,20 @@ void ActiveMessage::insertIntProperty(std::string& key, int value){
 }
 
 void ActiveMessage::insertRealProperty(std::string& key,float value){
-	std::stringstream logMessage;
-
 	try{
 		propertiesList.insertRealParameter(key,value);
 	}catch (ActiveException& ae){
+		std::stringstream logMessage;
 		logMessage << ae.getMessage();
 		LOG4CXX_DEBUG(logger,logMessage.str().c_str());
 	}
 }
 
 void ActiveMessage::insertStringProperty(std::string& key,const std::string& value){
-	std::stringstream logMessage;
-
 	try{
 		propertiesList.insertStringParameter(key,value);
 	}catch (ActiveException& ae){
+		std::stringstream logMessage;
 		logMessage << ae.getMessage();
 		LOG4CXX_DEBUG(logger,logMessage.str().c_str());
 	}
@@ -260,6 +316,39 @@ BytesParameter* ActiveMessage::getBytesParameter(std::string& key) const
 	}
 }
 
+IntArrayParameter* ActiveMessage::getIntArrayParameter(std::string& key) const
+	throw (ActiveException){
+
+	IntArrayParameter* intArrayParameter=parameterList.getIntArray(key);
+	if (intArrayParameter){
+		return intArrayParameter;
+	}else{
+		throw ActiveException("Parameter is not int array");
+	}
+}
+
+RealArrayParameter* ActiveMessage::getRealArrayParameter(std::string& key) const
+	throw (ActiveException){
+
+	RealArrayParameter* realArrayParameter=parameterList.getRealArray(key);
+	if (realArrayParameter){
+		return realArrayParameter;
+	}else{
+		throw ActiveException("Parameter is not real array");
+	}
+}
+
+Int64ArrayParameter* ActiveMessage::getInt64ArrayParameter(std::string& key) const
+	throw (ActiveException){
+
+	Int64ArrayParameter* int64ArrayParameter=parameterList.getInt64Array(key);
+	if (int64ArrayParameter){
+		return int64ArrayParameter;
+	}else{
+		throw ActiveException("Parameter is not int64 array");
+	}
+}
+
 IntParameter* ActiveMessage::getIntProperty(std::string& key) const
 	throw (ActiveException){
 
@@ -308,6 +397,47 @@ void ActiveMessage::clear(){
 	packetDesc.clear();
 
 	activeDestination.clear();
+	encodedBody.reset();
+	sendHandle.reset();
+}
+
+bool ActiveMessage::isBatchableWith(const ActiveMessage& activeMessageR) const{
+	return	!requestReply && !activeMessageR.getRequestReply() &&
+			priority==activeMessageR.getPriority() &&
+			timeToLive==activeMessageR.getTimeToLive() &&
+			propertiesList.equals(activeMessageR.getPropertiesList());
+}
+
+unsigned int ActiveMessage::getEstimatedSize() const{
+	unsigned int size=text.size()+estimateSize(parameterList)+estimateSize(propertiesList);
+	//recovered messages only have their body encoded
+	if (encodedBody && parameterList.size()==0){
+		size+=encodedBody->size();
+	}
+	return size;
+}
+
+void ActiveMessage::recycle(){
+
+	//flags initialization, clear() keeps the capacity of the strings
+	serviceId.clear();
+	linkId.clear();
+	connectionId.clear();
+	timeToLive=0;
+	priority=0;
+	requestReply=false;
+	correlationId.clear();
+	text.clear();
+	textMessage=false;
+
+	parameterList.recycle();
+	propertiesList.recycle();
+	packetDesc.clear();
+
+	//destination received was cloned by this message
+	activeDestination.release();
+	encodedBody.reset();
+	sendHandle.reset();
 }
 
 void ActiveMessage::clearParameters(){
@@ -42,12 +42,14 @@
 #endif
 
 #include "ActiveDestination.h"
+#include "ActiveSendHandle.h"
 #include "../../utils/parameters/ParameterList.h"
 #include "../../utils/exception/ActiveException.h"
 
 #include <boost/serialization/map.hpp>
 #include <boost/serialization/vector.hpp>
 #include <boost/serialization/string.hpp>
+#include <boost/shared_ptr.hpp>
 
 #include "log4cxx/logger.h"
 #include "log4cxx/helpers/exception.h"
@@ -146,6 +148,19 @@ namespace ai{
 		 */
 		ParameterList propertiesList;
 
+		/**
+		 * Body of the message (parameters and text) already encoded in binary
+		 * format. It is shared by all connections that send this message, it is
+		 * not serialized.
+		 */
+		boost::shared_ptr<const std::vector<unsigned char> > encodedBody;
+
+		/**
+		 * Handle of the link through which the message is sent asynchronously,
+		 * it is shared by the copies in the queue and it is not serialized.
+		 */
+		boost::shared_ptr<ActiveSendHandle> sendHandle;
+
 		/**
 		 * Method to log some stringstream that calls to log4cxx
 		 *
@@ -296,6 +311,36 @@ namespace ai{
 		BytesParameter* getBytesParameter(std::string& key) const
 				throw (ActiveException);
 
+		/**
+		 * Method to get an array of integers parameter directly
+		 *
+		 * @param key key to find.
+		 * @return pointer to the array parameter
+		 * @throw ActiveException if parameter is not an array of integers
+		 */
+		IntArrayParameter* getIntArrayParameter(std::string& key) const
+				throw (ActiveException);
+
+		/**
+		 * Method to get an array of reals parameter directly
+		 *
+		 * @param key key to find.
+		 * @return pointer to the array parameter
+		 * @throw ActiveException if parameter is not an array of reals
+		 */
+		RealArrayParameter* getRealArrayParameter(std::string& key) const
+				throw (ActiveException);
+
+		/**
+		 * Method to get an array of 64 bits integers parameter directly
+		 *
+		 * @param key key to find.
+		 * @return pointer to the array parameter
+		 * @throw ActiveException if parameter is not an array of 64 bits integers
+		 */
+		Int64ArrayParameter* getInt64ArrayParameter(std::string& key) const
+				throw (ActiveException);
+
 		/**
 		 * Method that get parameter by its position in parameter list. Used to loop around
 		 * all parameters
@@ -343,6 +388,36 @@ namespace ai{
 		void insertBytesParameter(	std::string& key,
 									std::vector<unsigned char>& value);
 
+		/**
+		 * Methods that insert an array of integers into parameter list. The
+		 * array is sent as one block, not as one parameter for each element.
+		 *
+		 * @param key key associated with value
+		 * @param value array that is going to be stored
+		 */
+		void insertIntArrayParameter(	std::string& key,
+								const std::vector<int>& value);
+
+		/**
+		 * Methods that insert an array of reals into parameter list. The
+		 * array is sent as one block, not as one parameter for each element.
+		 *
+		 * @param key key associated with value
+		 * @param value array that is going to be stored
+		 */
+		void insertRealArrayParameter(	std::string& key,
+								const std::vector<float>& value);
+
+		/**
+		 * Methods that insert an array of 64 bits integers into parameter list. The
+		 * array is sent as one block, not as one parameter for each element.
+		 *
+		 * @param key key associated with value
+		 * @param value array that is going to be stored
+		 */
+		void insertInt64ArrayParameter(	std::string& key,
+								const std::vector<long long>& value);
+
 		/**
 		 * Method that allows user to delete a parameter included
 		 * in message using the key
@@ -486,6 +561,13 @@ namespace ai{
 		 */
 		void clear();
 
+		/**
+		 * Method that leaves the message as a new one but keeping the memory
+		 * already allocated (parameters, strings and packet description), so a
+		 * message can be filled again without allocating. Used by receiving loops.
+		 */
+		void recycle();
+
 		/**
 		 * Methods to clone message received into new message
 		 *
@@ -495,6 +577,70 @@ namespace ai{
 		 */
 		void clone(const ActiveMessage& activeMessageR) throw (ActiveException);
 
+		/**
+		 * Method to know if other message can be sent in the same envelope that
+		 * this one. Envelopes are filtered by the broker as one message, so both
+		 * messages need the same properties, priority and time to live, and none
+		 * of them can be request reply.
+		 *
+		 * @param activeMessageR message to check
+		 *
+		 * @return true if both messages can be sent together
+		 */
+		bool isBatchableWith(const ActiveMessage& activeMessageR) const;
+
+		/**
+		 * Method that returns an estimation of the bytes that this message uses
+		 * when it is sent: text, keys and values.
+		 *
+		 * @return bytes estimated
+		 */
+		unsigned int getEstimatedSize() const;
+
+		/**
+		 * Method that sets the body of the message already encoded. The body
+		 * must not change while it is set, so parameters and text can not be modified.
+		 *
+		 * @param encodedBodyR body encoded with ActiveMessageCodec::encodeBody
+		 */
+		void setEncodedBody(const boost::shared_ptr<const std::vector<unsigned char> >& encodedBodyR){
+			encodedBody=encodedBodyR;
+		}
+
+		/**
+		 * Method that returns the body of the message already encoded
+		 *
+		 * @return body encoded, NULL if it is not set
+		 */
+		const std::vector<unsigned char>* getEncodedBody() const { return encodedBody.get();}
+
+		/**
+		 * Method that releases the body encoded, the buffer is freed when no
+		 * copy of this message uses it.
+		 */
+		void releaseEncodedBody(){ encodedBody.reset();}
+
+		/**
+		 * Method that sets the handle completed when the message is sent
+		 *
+		 * @param sendHandleR handle of the link
+		 */
+		void setSendHandle(const boost::shared_ptr<ActiveSendHandle>& sendHandleR){
+			sendHandle=sendHandleR;
+		}
+
+		/**
+		 * Method that returns the handle completed when the message is sent
+		 *
+		 * @return the handle, NULL if the message is not sent asynchronously
+		 */
+		ActiveSendHandle* getSendHandle() const { return sendHandle.get();}
+
+		/**
+		 * Method that releases the handle, the message is not tracked anymore
+		 */
+		void releaseSendHandle(){ sendHandle.reset();}
+
 		/**
 		 * Default copy constructor
 		 *
@@ -0,0 +1,762 @@
+/**
+ * @file
+ * @author  Oscar Pernas <oscar@pernas.es>
+ * @version 1.2.3
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * Class that encodes a whole ActiveMessage into one contiguous buffer of bytes
+ * and decodes it back. This buffer is sent as a single JMS BytesMessage instead
+ * of writing field by field into a StreamMessage.
+ */
+
+#include "ActiveMessageCodec.h"
+#include "ActiveByteOrder.h"
+
+#include <cstring>
+
+using namespace ai::message;
+
+unsigned int ActiveMessageCodec::varintSize(unsigned int value){
+
+	unsigned int size=1;
+	while (value>=0x80){
+		value>>=7;
+		size++;
+	}
+	return size;
+}
+
+void ActiveMessageCodec::writeVarint(unsigned char* buffer, unsigned int& position, unsigned int value){
+
+	while (value>=0x80){
+		buffer[position++]=(unsigned char)((value & 0x7F) | 0x80);
+		value>>=7;
+	}
+	buffer[position++]=(unsigned char)value;
+}
+
+unsigned int ActiveMessageCodec::readVarint(const unsigned char* buffer, unsigned int size, unsigned int& position)
+	throw (ActiveException){
+
+	unsigned int value=0;
+	unsigned int shift=0;
+
+	while (shift<35){
+		checkAvailable(size,position,1);
+		unsigned char byte=buffer[position++];
+		value|=((unsigned int)(byte & 0x7F))<<shift;
+		if ((byte & 0x80)==0){
+			return value;
+		}
+		shift+=7;
+	}
+	throw ActiveException("ActiveMessageCodec::readVarint. Malformed length.");
+}
+
+void ActiveMessageCodec::writeInt32(unsigned char* buffer, unsigned int& position, unsigned int value){
+
+	buffer[position++]=(unsigned char)(value>>24);
+	buffer[position++]=(unsigned char)(value>>16);
+	buffer[position++]=(unsigned char)(value>>8);
+	buffer[position++]=(unsigned char)value;
+}
+
+unsigned int ActiveMessageCodec::readInt32(const unsigned char* buffer, unsigned int size, unsigned int& position)
+	throw (ActiveException){
+
+	checkAvailable(size,position,4);
+	unsigned int value=	((unsigned int)buffer[position]<<24) |
+						((unsigned int)buffer[position+1]<<16) |
+						((unsigned int)buffer[position+2]<<8) |
+						(unsigned int)buffer[position+3];
+	position+=4;
+	return value;
+}
+
+void ActiveMessageCodec::checkAvailable(unsigned int size, unsigned int position, unsigned int needed)
+	throw (ActiveException){
+
+	if (position>size || needed>size-position){
+		throw ActiveException("ActiveMessageCodec. Message truncated, buffer is shorter than expected.");
+	}
+}
+
+unsigned int ActiveMessageCodec::readHeader(	const unsigned char* buffer,
+												unsigned int size,
+												unsigned char& flags,
+												unsigned int& schemaTag,
+												unsigned int& schemaId)
+	throw (ActiveException){
+
+	unsigned int position=0;
+
+	checkAvailable(size,position,3);
+	if (buffer[0]!=ACTIVE_CODEC_MAGIC){
+		throw ActiveException("ActiveMessageCodec::decode. Buffer is not an ActiveMessage.");
+	}
+	if (buffer[1]>ACTIVE_CODEC_MAX_VERSION){
+		throw ActiveException("ActiveMessageCodec::decode. Version of the message not supported.");
+	}
+	flags=buffer[2];
+	position=3;
+
+	if (flags & ACTIVE_CODEC_COMPRESSED_FLAG){
+		throw ActiveException("ActiveMessageCodec::decode. Compressed message, it must be decompressed first.");
+	}
+	if (flags & ACTIVE_CODEC_ENVELOPE_FLAG){
+		throw ActiveException("ActiveMessageCodec::decode. Envelope, its messages must be read one by one.");
+	}
+
+	schemaTag=0;
+	schemaId=0;
+	if (flags & (ACTIVE_CODEC_SCHEMA_FLAG | ACTIVE_CODEC_DEFINITION_FLAG)){
+		schemaTag=readInt32(buffer,size,position);
+		schemaId=readVarint(buffer,size,position);
+	}
+	return position;
+}
+
+unsigned int ActiveMessageCodec::keySize(const std::string& key){
+	return varintSize(key.size())+key.size();
+}
+
+unsigned int ActiveMessageCodec::valueSize(Parameter* parameter){
+
+	switch (parameter->getType()){
+	case ACTIVE_INT_PARAMETER:
+	case ACTIVE_REAL_PARAMETER:
+		return 4;
+	case ACTIVE_STRING_PARAMETER:{
+		unsigned int length=((StringParameter*)parameter)->getValue().size();
+		return varintSize(length)+length;
+	}
+	case ACTIVE_BYTES_PARAMETER:{
+		unsigned int length=((BytesParameter*)parameter)->getValue().size();
+		return varintSize(length)+length;
+	}
+	case ACTIVE_INT_ARRAY_PARAMETER:
+	case ACTIVE_REAL_ARRAY_PARAMETER:
+	case ACTIVE_INT64_ARRAY_PARAMETER:{
+		unsigned int count=arraySize(parameter);
+		return varintSize(count)+count*arrayElementSize(parameter->getType());
+	}
+	}
+	return 0;
+}
+
+unsigned int ActiveMessageCodec::arrayElementSize(int type){
+
+	switch (type){
+	case ACTIVE_INT_ARRAY_PARAMETER:
+	case ACTIVE_REAL_ARRAY_PARAMETER:
+		return 4;
+	case ACTIVE_INT64_ARRAY_PARAMETER:
+		return 8;
+	}
+	return 0;
+}
+
+unsigned int ActiveMessageCodec::arraySize(Parameter* parameter){
+
+	switch (parameter->getType()){
+	case ACTIVE_INT_ARRAY_PARAMETER:
+		return ((IntArrayParameter*)parameter)->getValue().size();
+	case ACTIVE_REAL_ARRAY_PARAMETER:
+		return ((RealArrayParameter*)parameter)->getValue().size();
+	case ACTIVE_INT64_ARRAY_PARAMETER:
+		return ((Int64ArrayParameter*)parameter)->getValue().size();
+	}
+	return 0;
+}
+
+void ActiveMessageCodec::writeArray(unsigned char* buffer, Parameter* parameter){
+
+	unsigned int count=arraySize(parameter);
+	if (count==0){
+		return;
+	}
+	switch (parameter->getType()){
+	case ACTIVE_INT_ARRAY_PARAMETER:
+		ActiveByteOrder::copy32(&((IntArrayParameter*)parameter)->getValue()[0],buffer,count);
+	break;
+	case ACTIVE_REAL_ARRAY_PARAMETER:
+		ActiveByteOrder::copy32(&((RealArrayParameter*)parameter)->getValue()[0],buffer,count);
+	break;
+	case ACTIVE_INT64_ARRAY_PARAMETER:
+		ActiveByteOrder::copy64(&((Int64ArrayParameter*)parameter)->getValue()[0],buffer,count);
+	break;
+	}
+}
+
+void ActiveMessageCodec::readArray(	const unsigned char* buffer,
+									unsigned int count,
+									int type,
+									std::string& key,
+									ActiveMessage& activeMessage)
+	throw (ActiveException){
+
+	switch (type){
+	case ACTIVE_INT_ARRAY_PARAMETER:
+		intArrayValue.resize(count);
+		if (count>0){
+			ActiveByteOrder::copy32(buffer,&intArrayValue[0],count);
+		}
+		activeMessage.insertIntArrayParameter(key,intArrayValue);
+	break;
+	case ACTIVE_REAL_ARRAY_PARAMETER:
+		realArrayValue.resize(count);
+		if (count>0){
+			ActiveByteOrder::copy32(buffer,&realArrayValue[0],count);
+		}
+		activeMessage.insertRealArrayParameter(key,realArrayValue);
+	break;
+	case ACTIVE_INT64_ARRAY_PARAMETER:
+		int64ArrayValue.resize(count);
+		if (count>0){
+			ActiveByteOrder::copy64(buffer,&int64ArrayValue[0],count);
+		}
+		activeMessage.insertInt64ArrayParameter(key,int64ArrayValue);
+	break;
+	default:
+		throw ActiveException("ActiveMessageCodec::readArray. Type is not an array.");
+	}
+}
+
+void ActiveMessageCodec::writeBlock(	unsigned char* buffer,
+										unsigned int& position,
+										const void* data,
+										unsigned int length){
+
+	writeVarint(buffer,position,length);
+	if (length>0){
+		memcpy(buffer+position,data,length);
+		position+=length;
+	}
+}
+
+void ActiveMessageCodec::writeValue(	unsigned char* buffer,
+										unsigned int& position,
+										Parameter* parameter){
+
+	switch (parameter->getType()){
+	case ACTIVE_INT_PARAMETER:{
+		writeInt32(buffer,position,(unsigned int)((IntParameter*)parameter)->getValue());
+	}
+	break;
+	case ACTIVE_REAL_PARAMETER:{
+		float value=((RealParameter*)parameter)->getValue();
+		unsigned int bits;
+		memcpy(&bits,&value,sizeof(bits));
+		writeInt32(buffer,position,bits);
+	}
+	break;
+	case ACTIVE_STRING_PARAMETER:{
+		const std::string& value=((StringParameter*)parameter)->getValue();
+		writeBlock(buffer,position,value.data(),value.size());
+	}
+	break;
+	case ACTIVE_BYTES_PARAMETER:{
+		const std::vector<unsigned char>& value=((BytesParameter*)parameter)->getValue();
+		writeBlock(buffer,position,value.empty()?NULL:&value[0],value.size());
+	}
+	break;
+	case ACTIVE_INT_ARRAY_PARAMETER:
+	case ACTIVE_REAL_ARRAY_PARAMETER:
+	case ACTIVE_INT64_ARRAY_PARAMETER:{
+		writeVarint(buffer,position,arraySize(parameter));
+		writeArray(buffer+position,parameter);
+		position+=arraySize(parameter)*arrayElementSize(parameter->getType());
+	}
+	break;
+	}
+}
+
+unsigned int ActiveMessageCodec::encode(const ActiveMessage& activeMessage, std::vector<unsigned char>& buffer)
+	throw (ActiveException){
+	return encodeMessage(activeMessage,buffer,0,0,0);
+}
+
+unsigned int ActiveMessageCodec::fieldsSize(const ParameterList& parameterList){
+
+	unsigned int size=varintSize(parameterList.size())+parameterList.size();
+	for (ParameterList::const_iterator it=parameterList.begin(); it!=parameterList.end(); ++it){
+		size+=keySize((*it).first)+valueSize((*it).second);
+	}
+	return size;
+}
+
+void ActiveMessageCodec::writeFields(	unsigned char* buffer,
+										unsigned int& position,
+										const ParameterList& parameterList,
+										unsigned char typeOffset){
+
+	ParameterList::const_iterator it;
+
+	writeVarint(buffer,position,parameterList.size());
+	for (it=parameterList.begin(); it!=parameterList.end(); ++it){
+		buffer[position++]=(unsigned char)((*it).second->getType()+typeOffset);
+	}
+	for (it=parameterList.begin(); it!=parameterList.end(); ++it){
+		writeBlock(buffer,position,(*it).first.data(),(*it).first.size());
+		writeValue(buffer,position,(*it).second);
+	}
+}
+
+void ActiveMessageCodec::encodeBody(const ActiveMessage& activeMessage, std::vector<unsigned char>& body)
+	throw (ActiveException){
+
+	unsigned int size=fieldsSize(activeMessage.getParameterList());
+	if (activeMessage.isTextMessage()){
+		size+=varintSize(activeMessage.getText().size())+activeMessage.getText().size();
+	}
+
+	body.resize(size);
+	unsigned int position=0;
+	writeFields(&body[0],position,activeMessage.getParameterList(),0);
+	if (activeMessage.isTextMessage()){
+		const std::string& text=activeMessage.getText();
+		writeBlock(&body[0],position,text.data(),text.size());
+	}
+}
+
+unsigned int ActiveMessageCodec::encode(const ActiveMessage& activeMessage,
+										const std::vector<unsigned char>& body,
+										std::vector<unsigned char>& buffer)
+	throw (ActiveException){
+
+	const ParameterList& propertiesList=activeMessage.getPropertiesList();
+	for (ParameterList::const_iterator it=propertiesList.begin(); it!=propertiesList.end(); ++it){
+		if ((*it).second->getType()>=ACTIVE_BYTES_PARAMETER){
+			throw ActiveException("ActiveMessageCodec::encode. Bytes and array properties are not supported.");
+		}
+	}
+
+	unsigned int size=3+fieldsSize(propertiesList)+body.size();
+	buffer.resize(size);
+	unsigned char* data=&buffer[0];
+	unsigned int position=0;
+
+	data[position++]=ACTIVE_CODEC_MAGIC;
+	data[position++]=ACTIVE_CODEC_SHARED_VERSION;
+	data[position++]=ACTIVE_CODEC_SHARED_FLAG | (activeMessage.isTextMessage()?ACTIVE_CODEC_TEXT_FLAG:0);
+
+	//own properties and then the body shared with other connections
+	writeFields(data,position,propertiesList,ACTIVE_INT_PROPERTY);
+	if (!body.empty()){
+		memcpy(data+position,&body[0],body.size());
+		position+=body.size();
+	}
+	return position;
+}
+
+unsigned int ActiveMessageCodec::encode(const ActiveMessage& activeMessage,
+										std::vector<unsigned char>& buffer,
+										unsigned int schemaTag,
+										unsigned int schemaId,
+										bool definition)
+	throw (ActiveException){
+	return encodeMessage(	activeMessage,buffer,
+							definition?ACTIVE_CODEC_DEFINITION_FLAG:ACTIVE_CODEC_SCHEMA_FLAG,
+							schemaTag,schemaId);
+}
+
+unsigned int ActiveMessageCodec::encodeMessage(	const ActiveMessage& activeMessage,
+												std::vector<unsigned char>& buffer,
+												unsigned char flags,
+												unsigned int schemaTag,
+												unsigned int schemaId)
+	throw (ActiveException){
+
+	const ParameterList& parameterList=activeMessage.getParameterList();
+	const ParameterList& propertiesList=activeMessage.getPropertiesList();
+	ParameterList::const_iterator it;
+
+	unsigned int fields=parameterList.size()+propertiesList.size();
+	//with schema keys and types are not sent
+	bool selfDescribed=!(flags & ACTIVE_CODEC_SCHEMA_FLAG);
+
+	//computing the size to make only one allocation (none if buffer is reused)
+	unsigned int size=3;
+	if (flags & (ACTIVE_CODEC_SCHEMA_FLAG | ACTIVE_CODEC_DEFINITION_FLAG)){
+		size+=4+varintSize(schemaId);
+	}
+	if (selfDescribed){
+		size+=varintSize(fields)+fields;
+	}
+	for (it=parameterList.begin(); it!=parameterList.end(); ++it){
+		size+=valueSize((*it).second);
+		if (selfDescribed){
+			size+=keySize((*it).first);
+		}
+	}
+	for (it=propertiesList.begin(); it!=propertiesList.end(); ++it){
+		if ((*it).second->getType()>=ACTIVE_BYTES_PARAMETER){
+			throw ActiveException("ActiveMessageCodec::encode. Bytes and array properties are not supported.");
+		}
+		size+=valueSize((*it).second);
+		if (selfDescribed){
+			size+=keySize((*it).first);
+		}
+	}
+	if (activeMessage.isTextMessage()){
+		flags|=ACTIVE_CODEC_TEXT_FLAG;
+		size+=varintSize(activeMessage.getText().size())+activeMessage.getText().size();
+	}
+
+	buffer.resize(size);
+	unsigned char* data=&buffer[0];
+	unsigned int position=0;
+
+	//header
+	data[position++]=ACTIVE_CODEC_MAGIC;
+	if (flags & (ACTIVE_CODEC_SCHEMA_FLAG | ACTIVE_CODEC_DEFINITION_FLAG)){
+		data[position++]=ACTIVE_CODEC_SCHEMA_VERSION;
+		data[position++]=flags;
+		writeInt32(data,position,schemaTag);
+		writeVarint(data,position,schemaId);
+	}else{
+		data[position++]=ACTIVE_CODEC_VERSION;
+		data[position++]=flags;
+	}
+
+	if (selfDescribed){
+		writeVarint(data,position,fields);
+
+		//type table, properties use the same codes of packet description
+		for (it=parameterList.begin(); it!=parameterList.end(); ++it){
+			data[position++]=(unsigned char)(*it).second->getType();
+		}
+		for (it=propertiesList.begin(); it!=propertiesList.end(); ++it){
+			data[position++]=(unsigned char)((*it).second->getType()+ACTIVE_INT_PROPERTY);
+		}
+	}
+
+	//fields
+	for (it=parameterList.begin(); it!=parameterList.end(); ++it){
+		if (selfDescribed){
+			writeBlock(data,position,(*it).first.data(),(*it).first.size());
+		}
+		writeValue(data,position,(*it).second);
+	}
+	for (it=propertiesList.begin(); it!=propertiesList.end(); ++it){
+		if (selfDescribed){
+			writeBlock(data,position,(*it).first.data(),(*it).first.size());
+		}
+		writeValue(data,position,(*it).second);
+	}
+
+	//text body
+	if (activeMessage.isTextMessage()){
+		const std::string& text=activeMessage.getText();
+		writeBlock(data,position,text.data(),text.size());
+	}
+
+	return position;
+}
+
+void ActiveMessageCodec::readValue(	const unsigned char* buffer,
+									unsigned int size,
+									unsigned int& position,
+									unsigned char type,
+									ActiveMessage& activeMessage)
+	throw (ActiveException){
+
+	switch (type){
+	case ACTIVE_INT_PARAMETER:{
+		int value=(int)readInt32(buffer,size,position);
+		activeMessage.insertIntParameter(key,value);
+	}
+	break;
+	case ACTIVE_REAL_PARAMETER:{
+		unsigned int bits=readInt32(buffer,size,position);
+		float value;
+		memcpy(&value,&bits,sizeof(value));
+		activeMessage.insertRealParameter(key,value);
+	}
+	break;
+	case ACTIVE_STRING_PARAMETER:{
+		unsigned int length=readVarint(buffer,size,position);
+		checkAvailable(size,position,length);
+		stringValue.assign((const char*)buffer+position,length);
+		position+=length;
+		activeMessage.insertStringParameter(key,stringValue);
+	}
+	break;
+	case ACTIVE_BYTES_PARAMETER:{
+		unsigned int length=readVarint(buffer,size,position);
+		checkAvailable(size,position,length);
+		bytesValue.assign(buffer+position,buffer+position+length);
+		position+=length;
+		activeMessage.insertBytesParameter(key,bytesValue);
+	}
+	break;
+	case ACTIVE_INT_ARRAY_PARAMETER:
+	case ACTIVE_REAL_ARRAY_PARAMETER:
+	case ACTIVE_INT64_ARRAY_PARAMETER:{
+		unsigned int count=readVarint(buffer,size,position);
+		unsigned int elementSize=arrayElementSize(type);
+		if (position>size || count>(size-position)/elementSize){
+			throw ActiveException("ActiveMessageCodec::decode. Message truncated.");
+		}
+		readArray(buffer+position,count,type,key,activeMessage);
+		position+=count*elementSize;
+	}
+	break;
+	case ACTIVE_INT_PROPERTY:{
+		int value=(int)readInt32(buffer,size,position);
+		activeMessage.insertIntProperty(key,value);
+	}
+	break;
+	case ACTIVE_REAL_PROPERTY:{
+		unsigned int bits=readInt32(buffer,size,position);
+		float value;
+		memcpy(&value,&bits,sizeof(value));
+		activeMessage.insertRealProperty(key,value);
+	}
+	break;
+	case ACTIVE_STRING_PROPERTY:{
+		unsigned int length=readVarint(buffer,size,position);
+		checkAvailable(size,position,length);
+		stringValue.assign((const char*)buffer+position,length);
+		position+=length;
+		activeMessage.insertStringProperty(key,stringValue);
+	}
+	break;
+	default:
+		throw ActiveException("ActiveMessageCodec::decode. Unknown type of field.");
+	}
+}
+
+void ActiveMessageCodec::readFields(	const unsigned char* buffer,
+										unsigned int size,
+										unsigned int& position,
+										ActiveMessage& activeMessage)
+	throw (ActiveException){
+
+	unsigned int fields=readVarint(buffer,size,position);
+	checkAvailable(size,position,fields);
+	unsigned int typesPosition=position;
+	position+=fields;
+
+	for (unsigned int field=0; field<fields; field++){
+		unsigned int length=readVarint(buffer,size,position);
+		checkAvailable(size,position,length);
+		key.assign((const char*)buffer+position,length);
+		position+=length;
+		readValue(buffer,size,position,buffer[typesPosition+field],activeMessage);
+	}
+}
+
+void ActiveMessageCodec::decode(const unsigned char* buffer, unsigned int size, ActiveMessage& activeMessage)
+	throw (ActiveException){
+
+	unsigned char flags=0;
+	unsigned int schemaTag=0;
+	unsigned int schemaId=0;
+	unsigned int position=readHeader(buffer,size,flags,schemaTag,schemaId);
+
+	if (flags & ACTIVE_CODEC_SCHEMA_FLAG){
+		//only values, keys and types are in the schema
+		const ActiveSchema* schema=getSchema(schemaTag,schemaId);
+		if (schema==NULL){
+			throw ActiveException("ActiveMessageCodec::decode. Message with unknown schema.");
+		}
+		for (unsigned int field=0; field<schema->size(); field++){
+			key.assign(schema->getKey(field));
+			readValue(buffer,size,position,schema->getType(field),activeMessage);
+		}
+	}else{
+		readFields(buffer,size,position,activeMessage);
+		//properties were the first section, the body is the second one
+		if (flags & ACTIVE_CODEC_SHARED_FLAG){
+			readFields(buffer,size,position,activeMessage);
+		}
+	}
+
+	if (flags & ACTIVE_CODEC_TEXT_FLAG){
+		unsigned int length=readVarint(buffer,size,position);
+		checkAvailable(size,position,length);
+		stringValue.assign((const char*)buffer+position,length);
+		activeMessage.setText(stringValue);
+	}
+}
+
+unsigned int ActiveMessageCodec::decodeProperties(const unsigned char* buffer, unsigned int size, ActiveMessage& activeMessage)
+	throw (ActiveException){
+
+	unsigned char flags=0;
+	unsigned int schemaTag=0;
+	unsigned int schemaId=0;
+	unsigned int position=readHeader(buffer,size,flags,schemaTag,schemaId);
+
+	if (!(flags & ACTIVE_CODEC_SHARED_FLAG)){
+		throw ActiveException("ActiveMessageCodec::decodeProperties. Message without its body shared.");
+	}
+	readFields(buffer,size,position,activeMessage);
+	return position;
+}
+
+bool ActiveMessageCodec::learnSchema(const unsigned char* buffer, unsigned int size)
+	throw (ActiveException){
+
+	unsigned char flags=0;
+	unsigned int schemaTag=0;
+	unsigned int schemaId=0;
+	unsigned int position=readHeader(buffer,size,flags,schemaTag,schemaId);
+
+	if (flags & ACTIVE_CODEC_SCHEMA_FLAG){
+		return getSchema(schemaTag,schemaId)!=NULL;
+	}else if (flags & ACTIVE_CODEC_DEFINITION_FLAG){
+		//storing keys and types, values are skipped
+		ActiveSchema& schema=schemas[std::make_pair(schemaTag,schemaId)];
+		schema.clear();
+
+		unsigned int fields=readVarint(buffer,size,position);
+		checkAvailable(size,position,fields);
+		unsigned int typesPosition=position;
+		position+=fields;
+
+		for (unsigned int field=0; field<fields; field++){
+			unsigned char type=buffer[typesPosition+field];
+			unsigned int length=readVarint(buffer,size,position);
+			checkAvailable(size,position,length);
+			schema.addField(std::string((const char*)buffer+position,length),type);
+			position+=length;
+
+			switch (type){
+			case ACTIVE_INT_PARAMETER:
+			case ACTIVE_REAL_PARAMETER:
+			case ACTIVE_INT_PROPERTY:
+			case ACTIVE_REAL_PROPERTY:
+				length=4;
+			break;
+			case ACTIVE_INT_ARRAY_PARAMETER:
+			case ACTIVE_REAL_ARRAY_PARAMETER:
+			case ACTIVE_INT64_ARRAY_PARAMETER:{
+				unsigned int count=readVarint(buffer,size,position);
+				if (position>size || count>(size-position)/arrayElementSize(type)){
+					throw ActiveException("ActiveMessageCodec::learnSchema. Message truncated.");
+				}
+				length=count*arrayElementSize(type);
+			}
+			break;
+			default:
+				length=readVarint(buffer,size,position);
+			}
+			checkAvailable(size,position,length);
+			position+=length;
+		}
+	}
+	return true;
+}
+
+unsigned int ActiveMessageCodec::compress(const unsigned char* message, unsigned int size, std::vector<unsigned char>& buffer){
+
+	unsigned int position=0;
+	unsigned int needed=3+varintSize(size)+ActiveCompressor::maxCompressedSize(size);
+	if (buffer.size()<needed){
+		buffer.resize(needed);
+	}
+	unsigned char* data=&buffer[0];
+
+	data[position++]=ACTIVE_CODEC_MAGIC;
+	data[position++]=ACTIVE_CODEC_COMPRESSED_VERSION;
+	data[position++]=ACTIVE_CODEC_COMPRESSED_FLAG;
+	writeVarint(data,position,size);
+	position+=compressor.compress(message,size,data+position);
+
+	//not worth it
+	if (position>=size){
+		return 0;
+	}
+	return position;
+}
+
+bool ActiveMessageCodec::isCompressed(const unsigned char* buffer, unsigned int size){
+	return size>=3 && buffer[0]==ACTIVE_CODEC_MAGIC && (buffer[2] & ACTIVE_CODEC_COMPRESSED_FLAG);
+}
+
+unsigned int ActiveMessageCodec::decompress(const unsigned char* buffer, unsigned int size, std::vector<unsigned char>& message)
+	throw (ActiveException){
+
+	unsigned int position=3;
+	if (!isCompressed(buffer,size) || buffer[1]>ACTIVE_CODEC_MAX_VERSION){
+		throw ActiveException("ActiveMessageCodec::decompress. Buffer is not a compressed ActiveMessage.");
+	}
+	unsigned int originalSize=readVarint(buffer,size,position);
+	//a byte of the block can not expand to more than 255 bytes
+	if (originalSize==0 || originalSize/255>size){
+		throw ActiveException("ActiveMessageCodec::decompress. Size of the message is not valid.");
+	}
+	message.resize(originalSize);
+	ActiveCompressor::decompress(buffer+position,size-position,&message[0],originalSize);
+	return originalSize;
+}
+
+void ActiveMessageCodec::startEnvelope(std::vector<unsigned char>& envelope){
+	envelope.clear();
+	envelope.push_back(ACTIVE_CODEC_MAGIC);
+	envelope.push_back(ACTIVE_CODEC_ENVELOPE_VERSION);
+	envelope.push_back(ACTIVE_CODEC_ENVELOPE_FLAG);
+}
+
+void ActiveMessageCodec::appendToEnvelope(	std::vector<unsigned char>& envelope,
+											const unsigned char* message,
+											unsigned int size){
+
+	unsigned int position=envelope.size();
+	envelope.resize(position+varintSize(size)+size);
+	writeVarint(&envelope[0],position,size);
+	memcpy(&envelope[position],message,size);
+}
+
+bool ActiveMessageCodec::isEnvelope(const unsigned char* buffer, unsigned int size){
+	return size>=3 && buffer[0]==ACTIVE_CODEC_MAGIC && (buffer[2] & ACTIVE_CODEC_ENVELOPE_FLAG);
+}
+
+bool ActiveMessageCodec::nextInEnvelope(const unsigned char* envelope,
+										unsigned int size,
+										unsigned int& position,
+										const unsigned char*& message,
+										unsigned int& messageSize)
+	throw (ActiveException){
+
+	if (position==0){
+		if (!isEnvelope(envelope,size) || envelope[1]>ACTIVE_CODEC_MAX_VERSION){
+			throw ActiveException("ActiveMessageCodec::nextInEnvelope. Buffer is not an envelope.");
+		}
+		position=3;
+	}
+	if (position>=size){
+		return false;
+	}
+	messageSize=readVarint(envelope,size,position);
+	checkAvailable(size,position,messageSize);
+	message=envelope+position;
+	position+=messageSize;
+	return true;
+}
+
+const ActiveSchema* ActiveMessageCodec::getSchema(unsigned int schemaTag, unsigned int schemaId) const{
+
+	std::map<std::pair<unsigned int,unsigned int>,ActiveSchema>::const_iterator it=
+			schemas.find(std::make_pair(schemaTag,schemaId));
+	if (it!=schemas.end()){
+		return &((*it).second);
+	}
+	return NULL;
+}
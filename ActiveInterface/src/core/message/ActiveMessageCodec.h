@@ -0,0 +1,588 @@
+/**
+ * @file
+ * @author  Oscar Pernas <oscar@pernas.es>
+ * @version 1.2.3
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * Class that encodes a whole ActiveMessage into one contiguous buffer of bytes
+ * and decodes it back. This buffer is sent as a single JMS BytesMessage instead
+ * of writing field by field into a StreamMessage.
+ *
+ * Format of the buffer (all multibyte numbers in network order):
+ *
+ *   magic (1 byte) | version (1 byte) | flags (1 byte)
+ *   schema tag (4 bytes) and schema id (varint), only with schema flags
+ *   number of fields (varint)
+ *   type table, one type byte for each field (same codes of packet description)
+ *   for each field: key length (varint), key, value
+ *   text length (varint) and text, only if flags says that is a text message
+ *
+ * Values are: 4 bytes for ints and reals, length (varint) and data for strings
+ * and bytes, number of elements (varint) and one block with all elements for
+ * arrays (4 bytes each for ints and reals, 8 bytes for int64).
+ *
+ * A message with the definition flag is a normal message that also defines the
+ * schema (tag,id) with its keys and types; decoders cache it. A message with the
+ * schema flag only has the values, in the order of the schema, after the schema
+ * id: no number of fields, type table nor keys. The schema tag identifies the
+ * connection that defined the schema, so schemas of different producers do not
+ * collide. Schemas are only used inside an envelope, after the message that
+ * defines them, so a consumer never depends on a broker message that other
+ * consumer received. Decoders forget them when the next broker message arrives.
+ *
+ * A compressed message has its own header, the whole message is compressed with
+ * ActiveCompressor after it:
+ *
+ *   magic (1 byte) | version 3 (1 byte) | compressed flag (1 byte)
+ *   size of the message (varint) | compressed block
+ *
+ * An envelope packs several messages sent together in one broker message:
+ *
+ *   magic (1 byte) | version 4 (1 byte) | envelope flag (1 byte)
+ *   for each message: size (varint) and the message encoded
+ *
+ * Envelopes can be compressed, messages inside an envelope are not compressed
+ * nor envelopes.
+ *
+ * A message sent to several connections can have its body (parameters and text)
+ * encoded only once with encodeBody. Each connection adds its own properties
+ * before the shared body:
+ *
+ *   magic (1 byte) | version 5 (1 byte) | shared flag and text flag (1 byte)
+ *   number of properties (varint) | type table | for each property: key, value
+ *   body: number of parameters (varint) | type table | for each parameter: key, value
+ *   text length (varint) and text, only if flags says that is a text message
+ *
+ * Decoding reuses internal buffers, so each thread should use its own codec.
+ */
+
+#ifndef ACTIVEMESSAGECODEC_H_
+#define ACTIVEMESSAGECODEC_H_
+
+#include "ActiveMessage.h"
+#include "ActiveSchema.h"
+#include "ActiveCompressor.h"
+#include "../../utils/exception/ActiveException.h"
+
+#include <vector>
+#include <string>
+#include <map>
+
+namespace ai{
+ namespace message{
+
+	class ActiveMessageCodec {
+	private:
+
+		/**
+		 * Strings and buffer reused while decoding to avoid allocations
+		 */
+		std::string key;
+		std::string stringValue;
+		std::vector<unsigned char> bytesValue;
+		std::vector<int> intArrayValue;
+		std::vector<float> realArrayValue;
+		std::vector<long long> int64ArrayValue;
+
+		/**
+		 * Schemas received in the current broker message, by schema tag and
+		 * schema id
+		 */
+		std::map<std::pair<unsigned int,unsigned int>,ActiveSchema> schemas;
+
+		/**
+		 * Compressor used to compress messages, it reuses its tables
+		 */
+		ActiveCompressor compressor;
+
+		/**
+		 * Method that returns the size that the key of a field is going to use encoded
+		 *
+		 * @param key key of the field
+		 *
+		 * @return bytes needed
+		 */
+		static unsigned int keySize(const std::string& key);
+
+		/**
+		 * Method that returns the size that the value of a field is going to use encoded
+		 *
+		 * @param parameter value of the field
+		 *
+		 * @return bytes needed
+		 */
+		static unsigned int valueSize(Parameter* parameter);
+
+		/**
+		 * Method that writes a block of bytes preceded by its length
+		 *
+		 * @param buffer where to write
+		 * @param position position where to write, it is moved to the end of the block
+		 * @param data bytes to write
+		 * @param length number of bytes to write
+		 */
+		static void writeBlock(	unsigned char* buffer,
+								unsigned int& position,
+								const void* data,
+								unsigned int length);
+
+		/**
+		 * Method that writes the value of a field in the buffer
+		 *
+		 * @param buffer where to write
+		 * @param position position where to write, it is moved to the end of the field
+		 * @param parameter value of the field
+		 */
+		static void writeValue(	unsigned char* buffer,
+								unsigned int& position,
+								Parameter* parameter);
+
+		/**
+		 * Method that returns the size of a list encoded as a section of fields:
+		 * number of fields, type table, keys and values.
+		 *
+		 * @param parameterList list to encode
+		 *
+		 * @return bytes needed
+		 */
+		static unsigned int fieldsSize(const ParameterList& parameterList);
+
+		/**
+		 * Method that writes a list as a section of fields
+		 *
+		 * @param buffer where to write
+		 * @param position position where to write, it is moved to the end of the section
+		 * @param parameterList list to write
+		 * @param typeOffset added to the type of each field, ACTIVE_INT_PROPERTY for properties
+		 */
+		static void writeFields(unsigned char* buffer,
+								unsigned int& position,
+								const ParameterList& parameterList,
+								unsigned char typeOffset);
+
+		/**
+		 * Method that reads a section of fields and inserts them in the message
+		 *
+		 * @param buffer buffer to read
+		 * @param size size of the buffer
+		 * @param position position to read, it is moved after the section
+		 * @param activeMessage message where fields are inserted
+		 *
+		 * @throws ActiveException if the buffer is not valid
+		 */
+		void readFields(const unsigned char* buffer,
+						unsigned int size,
+						unsigned int& position,
+						ActiveMessage& activeMessage)
+			throw (ActiveException);
+
+		/**
+		 * Method that reads the value of a field and inserts it in the message
+		 * with the key stored in key attribute.
+		 *
+		 * @param buffer buffer to read
+		 * @param size size of the buffer
+		 * @param position position to read, it is moved after the value
+		 * @param type type of the field
+		 * @param activeMessage message where value is inserted
+		 *
+		 * @throws ActiveException if the buffer is not valid
+		 */
+		void readValue(	const unsigned char* buffer,
+						unsigned int size,
+						unsigned int& position,
+						unsigned char type,
+						ActiveMessage& activeMessage)
+			throw (ActiveException);
+
+		/**
+		 * Method that encodes the message
+		 *
+		 * @param activeMessage message to encode
+		 * @param buffer buffer where the message is encoded
+		 * @param flags schema flags of the message
+		 * @param schemaTag tag of the schema, only used with schema flags
+		 * @param schemaId id of the schema, only used with schema flags
+		 *
+		 * @return size of the message encoded
+		 */
+		unsigned int encodeMessage(	const ActiveMessage& activeMessage,
+									std::vector<unsigned char>& buffer,
+									unsigned char flags,
+									unsigned int schemaTag,
+									unsigned int schemaId)
+			throw (ActiveException);
+
+	public:
+
+		/**
+		 * Method that returns the bytes needed to encode a number as varint
+		 *
+		 * @param value number to encode
+		 *
+		 * @return number of bytes
+		 */
+		static unsigned int varintSize(unsigned int value);
+
+		/**
+		 * Method that returns the size of each element of an array parameter
+		 *
+		 * @param type type of the parameter
+		 *
+		 * @return bytes of each element, 0 if the type is not an array
+		 */
+		static unsigned int arrayElementSize(int type);
+
+		/**
+		 * Method that returns the number of elements of an array parameter
+		 *
+		 * @param parameter array parameter
+		 *
+		 * @return number of elements, 0 if the parameter is not an array
+		 */
+		static unsigned int arraySize(Parameter* parameter);
+
+		/**
+		 * Method that writes all elements of an array parameter as one block
+		 * in network order
+		 *
+		 * @param buffer where to write, arraySize*arrayElementSize bytes
+		 * @param parameter array parameter
+		 */
+		static void writeArray(unsigned char* buffer, Parameter* parameter);
+
+		/**
+		 * Method that reads a block written by writeArray and inserts it in
+		 * the message as an array parameter
+		 *
+		 * @param buffer block to read
+		 * @param count number of elements of the block
+		 * @param type type of the array
+		 * @param key key of the parameter
+		 * @param activeMessage message where the parameter is inserted
+		 *
+		 * @throws ActiveException if the type is not an array
+		 */
+		void readArray(	const unsigned char* buffer,
+						unsigned int count,
+						int type,
+						std::string& key,
+						ActiveMessage& activeMessage)
+			throw (ActiveException);
+
+		/**
+		 * Method that writes a number as varint (7 bits each byte, high bit set
+		 * if there are more bytes)
+		 *
+		 * @param buffer where to write
+		 * @param position position where to write, it is moved after the number
+		 * @param value number to write
+		 */
+		static void writeVarint(unsigned char* buffer, unsigned int& position, unsigned int value);
+
+		/**
+		 * Method that reads a varint
+		 *
+		 * @param buffer buffer to read
+		 * @param size size of the buffer
+		 * @param position position to read, it is moved after the number
+		 *
+		 * @return number read
+		 *
+		 * @throws ActiveException if the buffer ends before the number
+		 */
+		static unsigned int readVarint(const unsigned char* buffer, unsigned int size, unsigned int& position)
+			throw (ActiveException);
+
+		/**
+		 * Method that writes 4 bytes in network order
+		 *
+		 * @param buffer where to write
+		 * @param position position where to write, it is moved after the number
+		 * @param value number to write
+		 */
+		static void writeInt32(unsigned char* buffer, unsigned int& position, unsigned int value);
+
+		/**
+		 * Method that reads 4 bytes in network order
+		 *
+		 * @param buffer buffer to read
+		 * @param size size of the buffer
+		 * @param position position to read, it is moved after the number
+		 *
+		 * @return number read
+		 *
+		 * @throws ActiveException if the buffer ends before the number
+		 */
+		static unsigned int readInt32(const unsigned char* buffer, unsigned int size, unsigned int& position)
+			throw (ActiveException);
+
+		/**
+		 * Method that checks that there are enough bytes to read in the buffer
+		 *
+		 * @param size size of the buffer
+		 * @param position position to read
+		 * @param needed bytes that are going to be read
+		 *
+		 * @throws ActiveException if the buffer is shorter
+		 */
+		static void checkAvailable(unsigned int size, unsigned int position, unsigned int needed)
+			throw (ActiveException);
+
+		/**
+		 * Method that reads the header of a message
+		 *
+		 * @param buffer buffer to read
+		 * @param size size of the buffer
+		 * @param flags flags of the message
+		 * @param schemaTag tag of the schema, if the message has schema flags
+		 * @param schemaId id of the schema, if the message has schema flags
+		 *
+		 * @return position after the header
+		 *
+		 * @throws ActiveException if the buffer is not a valid message
+		 */
+		static unsigned int readHeader(	const unsigned char* buffer,
+										unsigned int size,
+										unsigned char& flags,
+										unsigned int& schemaTag,
+										unsigned int& schemaId)
+			throw (ActiveException);
+
+		/**
+		 * Method that encodes the message given into the buffer. The buffer is sized
+		 * once with the size needed, so if it is reused no allocation is done.
+		 *
+		 * @param activeMessage message to encode
+		 * @param buffer buffer where the message is encoded
+		 *
+		 * @return size of the message encoded
+		 *
+		 * @throws ActiveException if the message can not be encoded
+		 */
+		unsigned int encode(const ActiveMessage& activeMessage, std::vector<unsigned char>& buffer)
+			throw (ActiveException);
+
+		/**
+		 * Method that encodes a message that matches a schema.
+		 *
+		 * @param activeMessage message to encode, it must match the schema
+		 * @param buffer buffer where the message is encoded
+		 * @param schemaTag tag of the connection that defines the schema
+		 * @param schemaId id of the schema
+		 * @param definition if true the message is self described and defines the
+		 * schema, else only values are encoded.
+		 *
+		 * @return size of the message encoded
+		 *
+		 * @throws ActiveException if the message can not be encoded
+		 */
+		unsigned int encode(const ActiveMessage& activeMessage,
+							std::vector<unsigned char>& buffer,
+							unsigned int schemaTag,
+							unsigned int schemaId,
+							bool definition)
+			throw (ActiveException);
+
+		/**
+		 * Method that encodes the body of a message (parameters and text) to be
+		 * shared by several connections
+		 *
+		 * @param activeMessage message to encode
+		 * @param body buffer where the body is encoded
+		 *
+		 * @throws ActiveException if the message can not be encoded
+		 */
+		static void encodeBody(const ActiveMessage& activeMessage, std::vector<unsigned char>& body)
+			throw (ActiveException);
+
+		/**
+		 * Method that encodes the properties of the message followed by its body
+		 * already encoded
+		 *
+		 * @param activeMessage message whose properties are encoded
+		 * @param body body of the message encoded with encodeBody
+		 * @param buffer buffer where the message is encoded
+		 *
+		 * @return size of the message encoded
+		 *
+		 * @throws ActiveException if the message can not be encoded
+		 */
+		unsigned int encode(const ActiveMessage& activeMessage,
+							const std::vector<unsigned char>& body,
+							std::vector<unsigned char>& buffer)
+			throw (ActiveException);
+
+		/**
+		 * Method that decodes the buffer into the message given
+		 *
+		 * @param buffer bytes received
+		 * @param size size of the bytes received
+		 * @param activeMessage message where data is inserted
+		 *
+		 * @throws ActiveException if the buffer is not a valid message or its
+		 * schema is unknown.
+		 */
+		void decode(const unsigned char* buffer, unsigned int size, ActiveMessage& activeMessage)
+			throw (ActiveException);
+
+		/**
+		 * Method that decodes only the properties of a message encoded with its
+		 * body shared, the body is left encoded
+		 *
+		 * @param buffer message encoded
+		 * @param size size of the message
+		 * @param activeMessage message where properties are inserted
+		 *
+		 * @return position in the buffer where the body starts
+		 *
+		 * @throws ActiveException if the buffer is not a message with its body shared
+		 */
+		unsigned int decodeProperties(const unsigned char* buffer, unsigned int size, ActiveMessage& activeMessage)
+			throw (ActiveException);
+
+		/**
+		 * Method that checks the schema of a message received. If it defines a schema,
+		 * the schema is stored. If it uses a schema, the schema should be known.
+		 *
+		 * @param buffer bytes received
+		 * @param size size of the bytes received
+		 *
+		 * @return false if the message uses a schema that is unknown, it can not
+		 * be decoded
+		 *
+		 * @throws ActiveException if the definition is not valid
+		 */
+		bool learnSchema(const unsigned char* buffer, unsigned int size)
+			throw (ActiveException);
+
+		/**
+		 * Method that forgets the schemas received, called when a new broker
+		 * message arrives because schemas are only valid inside the envelope
+		 * that defines them
+		 */
+		void forgetSchemas(){schemas.clear();}
+
+		/**
+		 * Method that compresses a message encoded
+		 *
+		 * @param message message encoded
+		 * @param size size of the message encoded
+		 * @param buffer buffer where the compressed message is written
+		 *
+		 * @return size of the compressed message, 0 if compression does not
+		 * reduce the size of the message.
+		 */
+		unsigned int compress(const unsigned char* message, unsigned int size, std::vector<unsigned char>& buffer);
+
+		/**
+		 * Method to know if a message received is compressed
+		 *
+		 * @param buffer bytes received
+		 * @param size size of the bytes received
+		 *
+		 * @return true if it is compressed
+		 */
+		static bool isCompressed(const unsigned char* buffer, unsigned int size);
+
+		/**
+		 * Method that decompresses a message received
+		 *
+		 * @param buffer bytes received, a compressed message
+		 * @param size size of the bytes received
+		 * @param message buffer where the message is written
+		 *
+		 * @return size of the message
+		 *
+		 * @throws ActiveException if the compressed message is not valid
+		 */
+		static unsigned int decompress(const unsigned char* buffer, unsigned int size, std::vector<unsigned char>& message)
+			throw (ActiveException);
+
+		/**
+		 * Method that starts an empty envelope
+		 *
+		 * @param envelope buffer where the envelope is written, its capacity is kept
+		 */
+		static void startEnvelope(std::vector<unsigned char>& envelope);
+
+		/**
+		 * Method that appends a message encoded to an envelope
+		 *
+		 * @param envelope envelope started with startEnvelope
+		 * @param message message encoded
+		 * @param size size of the message encoded
+		 */
+		static void appendToEnvelope(	std::vector<unsigned char>& envelope,
+										const unsigned char* message,
+										unsigned int size);
+
+		/**
+		 * Method to know if a message received is an envelope
+		 *
+		 * @param buffer bytes received, already decompressed
+		 * @param size size of the bytes received
+		 *
+		 * @return true if it is an envelope
+		 */
+		static bool isEnvelope(const unsigned char* buffer, unsigned int size);
+
+		/**
+		 * Method that reads the next message of an envelope
+		 *
+		 * @param envelope envelope received
+		 * @param size size of the envelope
+		 * @param position position to read, 0 for the first message. It is moved
+		 * after the message read.
+		 * @param message set to the message encoded, inside the envelope
+		 * @param messageSize set to the size of the message
+		 *
+		 * @return false if there are not more messages
+		 *
+		 * @throws ActiveException if the envelope is not valid
+		 */
+		static bool nextInEnvelope(	const unsigned char* envelope,
+									unsigned int size,
+									unsigned int& position,
+									const unsigned char*& message,
+									unsigned int& messageSize)
+			throw (ActiveException);
+
+		/**
+		 * Method that returns a schema received
+		 *
+		 * @param schemaTag tag of the schema
+		 * @param schemaId id of the schema
+		 *
+		 * @return the schema or NULL if it is unknown
+		 */
+		const ActiveSchema* getSchema(unsigned int schemaTag, unsigned int schemaId) const;
+
+		/**
+		 * Default constructor
+		 */
+		ActiveMessageCodec(){}
+
+		/**
+		 * Default destructor
+		 */
+		virtual ~ActiveMessageCodec(){}
+	};
+ }
+}
+
+#endif /* ACTIVEMESSAGECODEC_H_ */
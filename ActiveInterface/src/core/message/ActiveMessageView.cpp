@@ -0,0 +1,364 @@
+/**
+ * @file
+ * @author  Oscar Pernas <oscar@pernas.es>
+ * @version 1.2.3
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * Class that gives a lazily decoded view of a received message.
+ */
+
+#include "ActiveMessageView.h"
+#include "ActiveByteOrder.h"
+
+#include <cstring>
+
+using namespace ai::message;
+
+ActiveMessageView::ActiveMessageView(){
+	indexed=false;
+	decoded=true;
+	codec=NULL;
+}
+
+void ActiveMessageView::recycle(){
+	body.clear();
+	fieldsIndex.clear();
+	indexed=false;
+	decoded=true;
+	activeMessage.recycle();
+}
+
+void ActiveMessageView::setBody(std::vector<unsigned char>& bodyR, ActiveMessageCodec* codecR){
+	codec=codecR;
+	body.swap(bodyR);
+	fieldsIndex.clear();
+	indexed=false;
+	decoded=false;
+}
+
+const ActiveMessage& ActiveMessageView::getActiveMessage() throw (ActiveException){
+	if (!decoded){
+		decoded=true;
+		codec->decode(&body[0],body.size(),activeMessage);
+	}
+	return activeMessage;
+}
+
+void ActiveMessageView::index() throw (ActiveException){
+
+	if (indexed){
+		return;
+	}
+
+	const unsigned char* data=&body[0];
+	unsigned int size=body.size();
+	unsigned char flags=0;
+	unsigned int schemaTag=0;
+	unsigned int schemaId=0;
+	unsigned int position=ActiveMessageCodec::readHeader(data,size,flags,schemaTag,schemaId);
+
+	//with schema, keys and types are taken from the schema
+	const ActiveSchema* schema=NULL;
+	if (flags & ACTIVE_CODEC_SCHEMA_FLAG){
+		schema=codec->getSchema(schemaTag,schemaId);
+		if (schema==NULL){
+			throw ActiveException("ActiveMessageView::index. Message with unknown schema.");
+		}
+	}
+
+	fieldsIndex.clear();
+	indexFields(data,size,position,schema);
+	//properties were the first section, the shared body is the second one
+	if (flags & ACTIVE_CODEC_SHARED_FLAG){
+		indexFields(data,size,position,NULL);
+	}
+	indexed=true;
+}
+
+void ActiveMessageView::indexFields(	const unsigned char* data,
+										unsigned int size,
+										unsigned int& position,
+										const ActiveSchema* schema)
+	throw (ActiveException){
+
+	unsigned int fields=0;
+	unsigned int typesPosition=0;
+	if (schema){
+		fields=schema->size();
+	}else{
+		fields=ActiveMessageCodec::readVarint(data,size,position);
+		ActiveMessageCodec::checkAvailable(size,position,fields);
+		typesPosition=position;
+		position+=fields;
+	}
+
+	unsigned int first=fieldsIndex.size();
+	fieldsIndex.resize(first+fields);
+	for (unsigned int it=0; it<fields; it++){
+		FieldIndex& field=fieldsIndex[first+it];
+		if (schema){
+			field.type=schema->getType(it);
+			field.key=schema->getKey(it).data();
+			field.keyLength=schema->getKey(it).size();
+		}else{
+			field.type=data[typesPosition+it];
+			field.keyLength=ActiveMessageCodec::readVarint(data,size,position);
+			ActiveMessageCodec::checkAvailable(size,position,field.keyLength);
+			field.key=(const char*)data+position;
+			position+=field.keyLength;
+		}
+		field.valuePosition=position;
+
+		//skipping the value
+		unsigned int length=0;
+		switch (field.type){
+		case ACTIVE_INT_PARAMETER:
+		case ACTIVE_REAL_PARAMETER:
+		case ACTIVE_INT_PROPERTY:
+		case ACTIVE_REAL_PROPERTY:
+			length=4;
+		break;
+		case ACTIVE_STRING_PARAMETER:
+		case ACTIVE_BYTES_PARAMETER:
+		case ACTIVE_STRING_PROPERTY:
+			length=ActiveMessageCodec::readVarint(data,size,position);
+		break;
+		case ACTIVE_INT_ARRAY_PARAMETER:
+		case ACTIVE_REAL_ARRAY_PARAMETER:
+		case ACTIVE_INT64_ARRAY_PARAMETER:{
+			unsigned int count=ActiveMessageCodec::readVarint(data,size,position);
+			unsigned int elementSize=ActiveMessageCodec::arrayElementSize(field.type);
+			if (position>size || count>(size-position)/elementSize){
+				throw ActiveException("ActiveMessageView::index. Message truncated.");
+			}
+			length=count*elementSize;
+		}
+		break;
+		default:
+			throw ActiveException("ActiveMessageView::index. Unknown type of field.");
+		}
+		if (position>size || length>size-position){
+			throw ActiveException("ActiveMessageView::index. Message truncated.");
+		}
+		position+=length;
+	}
+}
+
+const ActiveMessageView::FieldIndex& ActiveMessageView::find(const std::string& key, unsigned char type)
+	throw (ActiveException){
+
+	index();
+	for (unsigned int it=0; it<fieldsIndex.size(); it++){
+		const FieldIndex& field=fieldsIndex[it];
+		if (field.keyLength==key.size() &&
+			memcmp(field.key,key.data(),field.keyLength)==0){
+			if (field.type!=type){
+				throw ActiveException("ActiveMessageView. Field has other type: "+key);
+			}
+			return field;
+		}
+	}
+	throw ActiveException("ActiveMessageView. Field not found: "+key);
+}
+
+const unsigned char* ActiveMessageView::readBlock(const FieldIndex& field, unsigned int& length)
+	throw (ActiveException){
+
+	unsigned int position=field.valuePosition;
+	length=ActiveMessageCodec::readVarint(&body[0],body.size(),position);
+	return &body[0]+position;
+}
+
+const unsigned char* ActiveMessageView::readArray(const FieldIndex& field, unsigned int& count)
+	throw (ActiveException){
+
+	unsigned int position=field.valuePosition;
+	count=ActiveMessageCodec::readVarint(&body[0],body.size(),position);
+	return &body[0]+position;
+}
+
+bool ActiveMessageView::hasParameter(const std::string& key) throw (ActiveException){
+
+	if (!isLazy()){
+		const ParameterList& parameterList=activeMessage.getParameterList();
+		for (ParameterList::const_iterator it=parameterList.begin(); it!=parameterList.end(); ++it){
+			if ((*it).first==key){
+				return true;
+			}
+		}
+		return false;
+	}
+
+	index();
+	for (unsigned int it=0; it<fieldsIndex.size(); it++){
+		const FieldIndex& field=fieldsIndex[it];
+		if (field.type<ACTIVE_INT_PROPERTY && field.keyLength==key.size() &&
+			memcmp(field.key,key.data(),field.keyLength)==0){
+			return true;
+		}
+	}
+	return false;
+}
+
+bool ActiveMessageView::hasProperty(const std::string& key) throw (ActiveException){
+
+	if (!isLazy()){
+		const ParameterList& propertiesList=activeMessage.getPropertiesList();
+		for (ParameterList::const_iterator it=propertiesList.begin(); it!=propertiesList.end(); ++it){
+			if ((*it).first==key){
+				return true;
+			}
+		}
+		return false;
+	}
+
+	index();
+	for (unsigned int it=0; it<fieldsIndex.size(); it++){
+		const FieldIndex& field=fieldsIndex[it];
+		if (field.type>=ACTIVE_INT_PROPERTY && field.keyLength==key.size() &&
+			memcmp(field.key,key.data(),field.keyLength)==0){
+			return true;
+		}
+	}
+	return false;
+}
+
+int ActiveMessageView::getIntParameter(const std::string& key) throw (ActiveException){
+
+	if (!isLazy()){
+		return activeMessage.getIntParameter(const_cast<std::string&>(key))->getValue();
+	}
+	unsigned int position=find(key,ACTIVE_INT_PARAMETER).valuePosition;
+	return (int)ActiveMessageCodec::readInt32(&body[0],body.size(),position);
+}
+
+float ActiveMessageView::getRealParameter(const std::string& key) throw (ActiveException){
+
+	if (!isLazy()){
+		return activeMessage.getRealParameter(const_cast<std::string&>(key))->getValue();
+	}
+	unsigned int position=find(key,ACTIVE_REAL_PARAMETER).valuePosition;
+	unsigned int bits=ActiveMessageCodec::readInt32(&body[0],body.size(),position);
+	float value;
+	memcpy(&value,&bits,sizeof(value));
+	return value;
+}
+
+void ActiveMessageView::getStringParameter(const std::string& key, std::string& value)
+	throw (ActiveException){
+
+	if (!isLazy()){
+		value=activeMessage.getStringParameter(const_cast<std::string&>(key))->getValue();
+		return;
+	}
+	unsigned int length=0;
+	const unsigned char* block=readBlock(find(key,ACTIVE_STRING_PARAMETER),length);
+	value.assign((const char*)block,length);
+}
+
+void ActiveMessageView::getBytesParameter(const std::string& key, std::vector<unsigned char>& value)
+	throw (ActiveException){
+
+	if (!isLazy()){
+		value=activeMessage.getBytesParameter(const_cast<std::string&>(key))->getValue();
+		return;
+	}
+	unsigned int length=0;
+	const unsigned char* block=readBlock(find(key,ACTIVE_BYTES_PARAMETER),length);
+	value.assign(block,block+length);
+}
+
+void ActiveMessageView::getIntArrayParameter(const std::string& key, std::vector<int>& value)
+	throw (ActiveException){
+
+	if (!isLazy()){
+		value=activeMessage.getIntArrayParameter(const_cast<std::string&>(key))->getValue();
+		return;
+	}
+	unsigned int count=0;
+	const unsigned char* block=readArray(find(key,ACTIVE_INT_ARRAY_PARAMETER),count);
+	value.resize(count);
+	if (count>0){
+		ActiveByteOrder::copy32(block,&value[0],count);
+	}
+}
+
+void ActiveMessageView::getRealArrayParameter(const std::string& key, std::vector<float>& value)
+	throw (ActiveException){
+
+	if (!isLazy()){
+		value=activeMessage.getRealArrayParameter(const_cast<std::string&>(key))->getValue();
+		return;
+	}
+	unsigned int count=0;
+	const unsigned char* block=readArray(find(key,ACTIVE_REAL_ARRAY_PARAMETER),count);
+	value.resize(count);
+	if (count>0){
+		ActiveByteOrder::copy32(block,&value[0],count);
+	}
+}
+
+void ActiveMessageView::getInt64ArrayParameter(const std::string& key, std::vector<long long>& value)
+	throw (ActiveException){
+
+	if (!isLazy()){
+		value=activeMessage.getInt64ArrayParameter(const_cast<std::string&>(key))->getValue();
+		return;
+	}
+	unsigned int count=0;
+	const unsigned char* block=readArray(find(key,ACTIVE_INT64_ARRAY_PARAMETER),count);
+	value.resize(count);
+	if (count>0){
+		ActiveByteOrder::copy64(block,&value[0],count);
+	}
+}
+
+int ActiveMessageView::getIntProperty(const std::string& key) throw (ActiveException){
+
+	if (!isLazy()){
+		return activeMessage.getIntProperty(const_cast<std::string&>(key))->getValue();
+	}
+	unsigned int position=find(key,ACTIVE_INT_PROPERTY).valuePosition;
+	return (int)ActiveMessageCodec::readInt32(&body[0],body.size(),position);
+}
+
+float ActiveMessageView::getRealProperty(const std::string& key) throw (ActiveException){
+
+	if (!isLazy()){
+		return activeMessage.getRealProperty(const_cast<std::string&>(key))->getValue();
+	}
+	unsigned int position=find(key,ACTIVE_REAL_PROPERTY).valuePosition;
+	unsigned int bits=ActiveMessageCodec::readInt32(&body[0],body.size(),position);
+	float value;
+	memcpy(&value,&bits,sizeof(value));
+	return value;
+}
+
+void ActiveMessageView::getStringProperty(const std::string& key, std::string& value)
+	throw (ActiveException){
+
+	if (!isLazy()){
+		value=activeMessage.getStringProperty(const_cast<std::string&>(key))->getValue();
+		return;
+	}
+	unsigned int length=0;
+	const unsigned char* block=readBlock(find(key,ACTIVE_STRING_PROPERTY),length);
+	value.assign((const char*)block,length);
+}
+
+ActiveMessageView::~ActiveMessageView(){
+}
@@ -0,0 +1,260 @@
+/**
+ * @file
+ * @author  Oscar Pernas <oscar@pernas.es>
+ * @version 1.2.3
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * Class that gives a lazily decoded view of a received message. When the message
+ * arrives in binary format the view keeps the raw body received, the position of
+ * each field is indexed the first time that a field is requested and values are
+ * only decoded when they are asked for. The whole ActiveMessage is decoded only
+ * if getActiveMessage() is called.
+ *
+ * Messages received in other formats are decoded when received, and the view
+ * reads the fields from its ActiveMessage.
+ *
+ * A view is only valid inside the onMessageView callback, the library reuses it
+ * for next messages. Use getActiveMessage() to keep a copy of the message.
+ */
+
+#ifndef ACTIVEMESSAGEVIEW_H_
+#define ACTIVEMESSAGEVIEW_H_
+
+#ifdef ACTIVEINTERFACE_DLL
+ #ifdef ACTIVEINTERFACE_EXPORTS
+  #define ACTIVEINTERFACE_API __declspec( dllexport )
+ #else
+  #define ACTIVEINTERFACE_API __declspec( dllimport )
+ #endif
+#else
+ #define ACTIVEINTERFACE_API
+#endif
+
+#include "ActiveMessage.h"
+#include "ActiveMessageCodec.h"
+#include "../../utils/exception/ActiveException.h"
+
+#include <vector>
+#include <string>
+
+namespace ai{
+ namespace message{
+
+	class ACTIVEINTERFACE_API ActiveMessageView {
+	private:
+
+		/**
+		 * Position of a field inside the body
+		 */
+		struct FieldIndex{
+			unsigned char type;
+			const char* key;
+			unsigned int keyLength;
+			unsigned int valuePosition;
+		};
+
+		/**
+		 * Raw body received in binary format. Empty if the message was
+		 * received in other format.
+		 */
+		std::vector<unsigned char> body;
+
+		/**
+		 * Index of the fields of the body, built on first access
+		 */
+		std::vector<FieldIndex> fieldsIndex;
+
+		/**
+		 * Flag to know if the body was already indexed
+		 */
+		bool indexed;
+
+		/**
+		 * Flag to know if all fields were decoded into activeMessage
+		 */
+		bool decoded;
+
+		/**
+		 * Message that stores the header data (connection, link, request reply)
+		 * and all parameters and properties once decoded
+		 */
+		ActiveMessage activeMessage;
+
+		/**
+		 * codec of the connection used to decode the message, it knows the
+		 * schemas received by the connection
+		 */
+		ActiveMessageCodec* codec;
+
+		/**
+		 * Method that builds the index of the fields if it is not built.
+		 *
+		 * @throws ActiveException if the body is not valid
+		 */
+		void index() throw (ActiveException);
+
+		/**
+		 * Method that indexes a section of fields and appends them to the index
+		 *
+		 * @param data body of the message
+		 * @param size size of the body
+		 * @param position position of the section, it is moved after the section
+		 * @param schema schema with keys and types, NULL if the section is self described
+		 *
+		 * @throws ActiveException if the section is not valid
+		 */
+		void indexFields(	const unsigned char* data,
+							unsigned int size,
+							unsigned int& position,
+							const ActiveSchema* schema)
+			throw (ActiveException);
+
+		/**
+		 * Method that finds a field in the index
+		 *
+		 * @param key key of the field
+		 * @param type type of the field wanted (packet description codes)
+		 *
+		 * @return the field
+		 *
+		 * @throws ActiveException if there is not a field with this key and type
+		 */
+		const FieldIndex& find(const std::string& key, unsigned char type) throw (ActiveException);
+
+		/**
+		 * Method that reads a string or bytes value of a field
+		 *
+		 * @param field field to read
+		 * @param length length of the value read
+		 *
+		 * @return pointer to the value inside the body
+		 */
+		const unsigned char* readBlock(const FieldIndex& field, unsigned int& length) throw (ActiveException);
+
+		/**
+		 * Method that reads an array value of a field
+		 *
+		 * @param field field to read
+		 * @param count number of elements of the array
+		 *
+		 * @return pointer to the elements inside the body, in network order
+		 */
+		const unsigned char* readArray(const FieldIndex& field, unsigned int& count) throw (ActiveException);
+
+	public:
+
+		/**
+		 * Default constructor
+		 */
+		ActiveMessageView();
+
+		/**
+		 * Method that leaves the view empty to be reused with other message.
+		 * Used internally by the library.
+		 */
+		void recycle();
+
+		/**
+		 * Method that sets the binary message received as body. The buffer given
+		 * is swapped with the body, so it gets the old body to be reused and
+		 * nothing is copied. Used internally by the library.
+		 *
+		 * @param bodyR buffer with the message received
+		 * @param codecR codec of the connection that receives the message
+		 */
+		void setBody(std::vector<unsigned char>& bodyR, ActiveMessageCodec* codecR);
+
+		/**
+		 * Method that returns the message where header data is set. Parameters are
+		 * not decoded. Used internally by the library.
+		 *
+		 * @return message with the header data
+		 */
+		ActiveMessage& getMessageHeader(){ return activeMessage;}
+
+		/**
+		 * Method that returns the whole message decoded. Only the first call
+		 * decodes the message.
+		 *
+		 * @return message with all parameters and properties
+		 *
+		 * @throws ActiveException if the message received is not valid
+		 */
+		const ActiveMessage& getActiveMessage() throw (ActiveException);
+
+		/**
+		 * Methods to know data about the message received, they do not decode anything
+		 */
+		const std::string& getConnectionId() const { return activeMessage.getConnectionId();}
+		const std::string& getLinkId() const { return activeMessage.getLinkId();}
+		const std::string& getCorrelationId() const { return activeMessage.getCorrelationId();}
+		bool isWithRequestReply() const { return activeMessage.isWithRequestReply();}
+		bool isLazy() const { return !body.empty();}
+
+		/**
+		 * Method to know if the message has a parameter with this key
+		 *
+		 * @param key key of the parameter
+		 *
+		 * @return true if it exists
+		 */
+		bool hasParameter(const std::string& key) throw (ActiveException);
+
+		/**
+		 * Method to know if the message has a property
+		 *
+		 * @param key key of the property
+		 *
+		 * @return true if it exists
+		 */
+		bool hasProperty(const std::string& key) throw (ActiveException);
+
+		/**
+		 * Methods that returns the value of a parameter, decoding only this one
+		 *
+		 * @param key key of the parameter
+		 *
+		 * @throws ActiveException if the parameter does not exist or its type is other
+		 */
+		int getIntParameter(const std::string& key) throw (ActiveException);
+		float getRealParameter(const std::string& key) throw (ActiveException);
+		void getStringParameter(const std::string& key, std::string& value) throw (ActiveException);
+		void getBytesParameter(const std::string& key, std::vector<unsigned char>& value) throw (ActiveException);
+		void getIntArrayParameter(const std::string& key, std::vector<int>& value) throw (ActiveException);
+		void getRealArrayParameter(const std::string& key, std::vector<float>& value) throw (ActiveException);
+		void getInt64ArrayParameter(const std::string& key, std::vector<long long>& value) throw (ActiveException);
+
+		/**
+		 * Methods that returns the value of a property, decoding only this one
+		 *
+		 * @param key key of the property
+		 *
+		 * @throws ActiveException if the property does not exist or its type is other
+		 */
+		int getIntProperty(const std::string& key) throw (ActiveException);
+		float getRealProperty(const std::string& key) throw (ActiveException);
+		void getStringProperty(const std::string& key, std::string& value) throw (ActiveException);
+
+		/**
+		 * Default destructor
+		 */
+		virtual ~ActiveMessageView();
+	};
+ }
+}
+
+#endif /* ACTIVEMESSAGEVIEW_H_ */
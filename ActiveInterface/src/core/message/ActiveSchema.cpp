@@ -0,0 +1,71 @@
+/**
+ * @file
+ * @author  Oscar Pernas <oscar@pernas.es>
+ * @version 1.2.3
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * Class that stores the shape of a message: the ordered list of keys and types of
+ * its parameters and properties.
+ */
+
+#include "ActiveSchema.h"
+
+using namespace ai::message;
+
+void ActiveSchema::load(const ActiveMessage& activeMessage){
+
+	const ParameterList& parameterList=activeMessage.getParameterList();
+	const ParameterList& propertiesList=activeMessage.getPropertiesList();
+	ParameterList::const_iterator it;
+
+	clear();
+	for (it=parameterList.begin(); it!=parameterList.end(); ++it){
+		addField((*it).first,(unsigned char)(*it).second->getType());
+	}
+	for (it=propertiesList.begin(); it!=propertiesList.end(); ++it){
+		addField((*it).first,(unsigned char)((*it).second->getType()+ACTIVE_INT_PROPERTY));
+	}
+}
+
+void ActiveSchema::addField(const std::string& key, unsigned char type){
+	keys.push_back(key);
+	types.push_back(type);
+}
+
+bool ActiveSchema::matches(const ActiveMessage& activeMessage) const{
+
+	const ParameterList& parameterList=activeMessage.getParameterList();
+	const ParameterList& propertiesList=activeMessage.getPropertiesList();
+	ParameterList::const_iterator it;
+
+	if (parameterList.size()+propertiesList.size()!=keys.size()){
+		return false;
+	}
+
+	unsigned int field=0;
+	for (it=parameterList.begin(); it!=parameterList.end(); ++it, field++){
+		if (types[field]!=(*it).second->getType() || keys[field]!=(*it).first){
+			return false;
+		}
+	}
+	for (it=propertiesList.begin(); it!=propertiesList.end(); ++it, field++){
+		if (types[field]!=(*it).second->getType()+ACTIVE_INT_PROPERTY || keys[field]!=(*it).first){
+			return false;
+		}
+	}
+	return true;
+}
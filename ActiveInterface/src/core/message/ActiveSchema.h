@@ -0,0 +1,112 @@
+/**
+ * @file
+ * @author  Oscar Pernas <oscar@pernas.es>
+ * @version 1.2.3
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * Class that stores the shape of a message: the ordered list of keys and types of
+ * its parameters and properties. Messages that match a schema registered in a
+ * connection are sent in binary format with only the schema id and the values.
+ */
+
+#ifndef ACTIVESCHEMA_H_
+#define ACTIVESCHEMA_H_
+
+#ifdef ACTIVEINTERFACE_DLL
+ #ifdef ACTIVEINTERFACE_EXPORTS
+  #define ACTIVEINTERFACE_API __declspec( dllexport )
+ #else
+  #define ACTIVEINTERFACE_API __declspec( dllimport )
+ #endif
+#else
+ #define ACTIVEINTERFACE_API
+#endif
+
+#include "ActiveMessage.h"
+
+#include <vector>
+#include <string>
+
+namespace ai{
+ namespace message{
+
+	class ACTIVEINTERFACE_API ActiveSchema {
+	private:
+
+		/**
+		 * keys of the fields, parameters first and then properties, both in
+		 * the order that the message stores them
+		 */
+		std::vector<std::string> keys;
+
+		/**
+		 * type of each field, with the codes of the packet description
+		 */
+		std::vector<unsigned char> types;
+
+	public:
+
+		/**
+		 * Default constructor
+		 */
+		ActiveSchema(){}
+
+		/**
+		 * Method that loads the shape of the message given
+		 *
+		 * @param activeMessage message used as model
+		 */
+		void load(const ActiveMessage& activeMessage);
+
+		/**
+		 * Method that adds a field to the schema
+		 *
+		 * @param key key of the field
+		 * @param type type of the field (packet description code)
+		 */
+		void addField(const std::string& key, unsigned char type);
+
+		/**
+		 * Method that removes all fields
+		 */
+		void clear(){ keys.clear(); types.clear();}
+
+		/**
+		 * Method to know if a message has exactly this shape
+		 *
+		 * @param activeMessage message to check
+		 *
+		 * @return true if keys and types are the same
+		 */
+		bool matches(const ActiveMessage& activeMessage) const;
+
+		/**
+		 * getters
+		 */
+		unsigned int size() const { return keys.size();}
+		const std::string& getKey(unsigned int index) const { return keys[index];}
+		unsigned char getType(unsigned int index) const { return types[index];}
+
+		/**
+		 * Default destructor
+		 */
+		virtual ~ActiveSchema(){}
+	};
+ }
+}
+
+#endif /* ACTIVESCHEMA_H_ */
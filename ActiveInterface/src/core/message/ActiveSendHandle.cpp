@@ -0,0 +1,113 @@
+/**
+ * @file
+ * @author  Oscar Pernas <oscar@pernas.es>
+ * @version 1.2.3
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * Handle of a message sent asynchronously through one link.
+ */
+
+#include "ActiveSendHandle.h"
+#include "../../utils/defines.h"
+
+using namespace ai::message;
+
+ActiveSendSync::ActiveSendSync(){
+	apr_pool_create(&mp, NULL);
+	apr_thread_mutex_create(&mutex,APR_THREAD_MUTEX_UNNESTED,mp);
+	apr_thread_cond_create(&cond,mp);
+}
+
+ActiveSendSync::~ActiveSendSync(){
+	apr_pool_destroy(mp);
+}
+
+ActiveSendHandle::ActiveSendHandle(	const std::string& linkIdR,
+									const std::string& connectionIdR,
+									const boost::shared_ptr<ActiveSendSync>& syncR){
+	linkId=linkIdR;
+	connectionId=connectionIdR;
+	state=ACTIVE_SEND_PENDING;
+	latency=0;
+	sync=syncR;
+	if (!sync){
+		sync.reset(new ActiveSendSync());
+	}
+}
+
+bool ActiveSendHandle::complete(int stateR, long long latencyR, const std::string& errorR){
+	bool completed=false;
+
+	apr_thread_mutex_lock(sync->mutex);
+	if (state==ACTIVE_SEND_PENDING){
+		state=stateR;
+		latency=latencyR;
+		error=errorR;
+		completed=true;
+		apr_thread_cond_broadcast(sync->cond);
+	}
+	apr_thread_mutex_unlock(sync->mutex);
+	return completed;
+}
+
+bool ActiveSendHandle::wait(long long timeout){
+	apr_time_t deadline=apr_time_now()+timeout;
+
+	apr_thread_mutex_lock(sync->mutex);
+	while (state==ACTIVE_SEND_PENDING){
+		if (timeout<0){
+			apr_thread_cond_wait(sync->cond,sync->mutex);
+		}else{
+			apr_time_t now=apr_time_now();
+			if (now>=deadline){
+				break;
+			}
+			apr_thread_cond_timedwait(sync->cond,sync->mutex,deadline-now);
+		}
+	}
+	bool done=(state!=ACTIVE_SEND_PENDING);
+	apr_thread_mutex_unlock(sync->mutex);
+	return done;
+}
+
+bool ActiveSendHandle::isDone(){
+	return getState()!=ACTIVE_SEND_PENDING;
+}
+
+int ActiveSendHandle::getState(){
+	apr_thread_mutex_lock(sync->mutex);
+	int stateNow=state;
+	apr_thread_mutex_unlock(sync->mutex);
+	return stateNow;
+}
+
+long long ActiveSendHandle::getLatency(){
+	apr_thread_mutex_lock(sync->mutex);
+	long long latencyNow=latency;
+	apr_thread_mutex_unlock(sync->mutex);
+	return latencyNow;
+}
+
+std::string ActiveSendHandle::getError(){
+	apr_thread_mutex_lock(sync->mutex);
+	std::string errorNow=error;
+	apr_thread_mutex_unlock(sync->mutex);
+	return errorNow;
+}
+
+ActiveSendHandle::~ActiveSendHandle(){
+}
@@ -0,0 +1,182 @@
+/**
+ * @file
+ * @author  Oscar Pernas <oscar@pernas.es>
+ * @version 1.2.3
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * Handle of a message sent asynchronously through one link. It is completed
+ * by the producer when the message is sent to the broker, when it fails, or
+ * when it is only kept in the persistence and will be sent later. The user
+ * can wait for it or ask if it is done, so several messages can be sent
+ * without blocking a thread for each one.
+ */
+
+#ifndef ACTIVESENDHANDLE_H_
+#define ACTIVESENDHANDLE_H_
+
+#ifdef ACTIVEINTERFACE_DLL
+ #ifdef ACTIVEINTERFACE_EXPORTS
+  #define ACTIVEINTERFACE_API __declspec( dllexport )
+ #else
+  #define ACTIVEINTERFACE_API __declspec( dllimport )
+ #endif
+#else
+ #define ACTIVEINTERFACE_API
+#endif
+
+#include <string>
+
+#include <apr_general.h>
+#include <apr_time.h>
+#include <apr_thread_mutex.h>
+#include <apr_thread_cond.h>
+
+#include <boost/shared_ptr.hpp>
+
+namespace ai{
+ namespace message{
+
+	/**
+	 * Mutex and condition shared by the handles of the messages sent through
+	 * the same producer, so they are created once for the producer and not
+	 * for each message. A completion wakes up all the threads waiting for a
+	 * handle of the producer, each one checks its own handle again.
+	 */
+	class ACTIVEINTERFACE_API ActiveSendSync {
+	private:
+
+		/**
+		 * Not copyable, it is shared by the handles
+		 */
+		ActiveSendSync(const ActiveSendSync&);
+		ActiveSendSync& operator=(const ActiveSendSync&);
+
+	public:
+
+		/**
+		 * APR pool, mutex and condition to wait for the completions
+		 */
+		apr_pool_t* mp;
+		apr_thread_mutex_t* mutex;
+		apr_thread_cond_t* cond;
+
+		/**
+		 * Default constructor, creates the mutex and the condition
+		 */
+		ActiveSendSync();
+
+		/**
+		 * Default destructor
+		 */
+		virtual ~ActiveSendSync();
+	};
+
+	class ACTIVEINTERFACE_API ActiveSendHandle {
+	private:
+
+		/**
+		 * Id of the link and of the connection through which the message is sent
+		 */
+		std::string linkId;
+		std::string connectionId;
+
+		/**
+		 * State of the send, ACTIVE_SEND_PENDING until it is completed
+		 */
+		int state;
+
+		/**
+		 * Microseconds that the send to the broker took
+		 */
+		long long latency;
+
+		/**
+		 * Description of the error if the send failed
+		 */
+		std::string error;
+
+		/**
+		 * Mutex and condition to wait for the completion, shared with the
+		 * other handles of the producer
+		 */
+		boost::shared_ptr<ActiveSendSync> sync;
+
+		/**
+		 * Not copyable, it is shared by the message and the user
+		 */
+		ActiveSendHandle(const ActiveSendHandle&);
+		ActiveSendHandle& operator=(const ActiveSendHandle&);
+
+	public:
+
+		/**
+		 * Constructor
+		 *
+		 * @param linkIdR id of the link
+		 * @param connectionIdR id of the connection of the link
+		 * @param syncR mutex and condition of the producer, if it is empty the
+		 * handle creates its own ones
+		 */
+		ActiveSendHandle(	const std::string& linkIdR,
+							const std::string& connectionIdR,
+							const boost::shared_ptr<ActiveSendSync>& syncR=boost::shared_ptr<ActiveSendSync>());
+
+		/**
+		 * Method that completes the handle and wakes up the threads waiting for
+		 * it. Only the first completion is kept.
+		 *
+		 * @param stateR ACTIVE_SEND_DONE, ACTIVE_SEND_PERSISTED or ACTIVE_SEND_FAILED
+		 * @param latencyR microseconds that the send to the broker took
+		 * @param errorR description of the error if it failed
+		 *
+		 * @return true if the handle was completed by this call
+		 */
+		bool complete(int stateR, long long latencyR, const std::string& errorR="");
+
+		/**
+		 * Method that waits until the handle is completed
+		 *
+		 * @param timeout max microseconds to wait, negative to wait forever
+		 *
+		 * @return true if it is completed
+		 */
+		bool wait(long long timeout=-1);
+
+		/**
+		 * Method that tells if the handle is completed, without waiting
+		 *
+		 * @return true if it is completed
+		 */
+		bool isDone();
+
+		/**
+		 * Default destructor
+		 */
+		virtual ~ActiveSendHandle();
+
+		/////////////////////////////////////////////////////////////////
+		//getters, state, latency and error are valid when it is done
+		const std::string& getLinkId() const { return linkId;}
+		const std::string& getConnectionId() const { return connectionId;}
+		int getState();
+		long long getLatency();
+		std::string getError();
+	};
+ }
+}
+
+#endif /* ACTIVESENDHANDLE_H_ */
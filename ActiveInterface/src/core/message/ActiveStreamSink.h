@@ -0,0 +1,74 @@
+/**
+ * @file
+ * @author  Oscar Pernas <oscar@pernas.es>
+ * @version 1.2.3
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * Interface of the destination of a stream of bytes received in chunks. The
+ * user returns a sink from ActiveInterface::onStreamStart and the library
+ * writes each chunk into it as soon as it is received, so the whole stream
+ * is never held in memory.
+ */
+
+#ifndef ACTIVESTREAMSINK_H_
+#define ACTIVESTREAMSINK_H_
+
+#ifdef ACTIVEINTERFACE_DLL
+ #ifdef ACTIVEINTERFACE_EXPORTS
+  #define ACTIVEINTERFACE_API __declspec( dllexport )
+ #else
+  #define ACTIVEINTERFACE_API __declspec( dllimport )
+ #endif
+#else
+ #define ACTIVEINTERFACE_API
+#endif
+
+#include "../../utils/defines.h"
+
+namespace ai{
+ namespace message{
+
+	class ACTIVEINTERFACE_API ActiveStreamSink {
+	public:
+
+		/**
+		 * Method invoked for each chunk received, in order
+		 *
+		 * @param data bytes of the chunk, only valid in this call
+		 * @param size number of bytes
+		 */
+		virtual void write(const unsigned char* data, unsigned int size) abstract;
+
+		/**
+		 * Method invoked when the stream ends. After this call the library
+		 * deletes the sink.
+		 *
+		 * @param complete true if all chunks were received, false if some chunk
+		 * was lost, no chunk was received in the idle timeout of the streams or
+		 * the library was shut down before the last chunk
+		 */
+		virtual void close(bool complete) abstract;
+
+		/**
+		 * Default destructor
+		 */
+		virtual ~ActiveStreamSink(){}
+	};
+ }
+}
+
+#endif /* ACTIVESTREAMSINK_H_ */
@@ -0,0 +1,136 @@
+/**
+ * @file
+ * @author  Oscar Pernas <oscar@pernas.es>
+ * @version 1.2.3
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * Checkpoint of the persistence written in two slots.
+ * Each slot: magic (4) | generation (4) | sequence (8) | checksum (4), big endian.
+ */
+
+#include "ActiveCheckpoint.h"
+#include "../../utils/defines.h"
+
+#include <cstring>
+
+using namespace ai;
+
+ActiveCheckpoint::ActiveCheckpoint(){
+	pool=NULL;
+	file=NULL;
+	generation=0;
+}
+
+apr_uint32_t ActiveCheckpoint::checksum(const unsigned char* slot){
+	//FNV-1a
+	apr_uint32_t hash=2166136261U;
+	for (unsigned int i=0; i<ACTIVE_CHECKPOINT_SLOT_SIZE-4; i++){
+		hash^=slot[i];
+		hash*=16777619U;
+	}
+	return hash;
+}
+
+void ActiveCheckpoint::open(const std::string& pathR) throw (ActiveException){
+	close();
+	path=pathR;
+	apr_pool_create(&pool,NULL);
+	if (apr_file_open(&file,path.c_str(),APR_FOPEN_READ | APR_FOPEN_WRITE | APR_FOPEN_CREATE | APR_FOPEN_BINARY,
+			APR_OS_DEFAULT,pool)!=APR_SUCCESS){
+		apr_pool_destroy(pool);
+		pool=NULL;
+		file=NULL;
+		throw ActiveException("ActiveCheckpoint. Impossible to open the file "+path);
+	}
+	long long sequence=0;
+	generation=0;
+	read(sequence);
+}
+
+bool ActiveCheckpoint::read(long long& sequence){
+	unsigned char slots[2*ACTIVE_CHECKPOINT_SLOT_SIZE];
+	apr_size_t bytesRead=0;
+	apr_off_t offset=0;
+	bool found=false;
+
+	if (file==NULL){
+		return false;
+	}
+	apr_file_seek(file,APR_SET,&offset);
+	apr_file_read_full(file,slots,sizeof(slots),&bytesRead);
+	for (unsigned int i=0; i+ACTIVE_CHECKPOINT_SLOT_SIZE<=bytesRead; i+=ACTIVE_CHECKPOINT_SLOT_SIZE){
+		const unsigned char* slot=slots+i;
+		apr_uint32_t slotChecksum=((apr_uint32_t)slot[16]<<24) | ((apr_uint32_t)slot[17]<<16) |
+				((apr_uint32_t)slot[18]<<8) | (apr_uint32_t)slot[19];
+		if (memcmp(slot,ACTIVE_CHECKPOINT_MAGIC,4)!=0 || slotChecksum!=checksum(slot)){
+			continue;
+		}
+		apr_uint32_t slotGeneration=((apr_uint32_t)slot[4]<<24) | ((apr_uint32_t)slot[5]<<16) |
+				((apr_uint32_t)slot[6]<<8) | (apr_uint32_t)slot[7];
+		if (!found || slotGeneration>generation){
+			unsigned long long slotSequence=0;
+			for (unsigned int j=8; j<16; j++){
+				slotSequence=(slotSequence<<8) | slot[j];
+			}
+			sequence=(long long)slotSequence;
+			generation=slotGeneration;
+			found=true;
+		}
+	}
+	return found;
+}
+
+void ActiveCheckpoint::write(long long sequence) throw (ActiveException){
+	unsigned char slot[ACTIVE_CHECKPOINT_SLOT_SIZE];
+
+	if (file==NULL){
+		throw ActiveException("ActiveCheckpoint. File "+path+" is not open");
+	}
+	generation++;
+	memcpy(slot,ACTIVE_CHECKPOINT_MAGIC,4);
+	for (unsigned int j=0; j<4; j++){
+		slot[4+j]=(unsigned char)(generation>>(24-8*j));
+	}
+	for (unsigned int j=0; j<8; j++){
+		slot[8+j]=(unsigned char)((unsigned long long)sequence>>(56-8*j));
+	}
+	apr_uint32_t slotChecksum=checksum(slot);
+	for (unsigned int j=0; j<4; j++){
+		slot[16+j]=(unsigned char)(slotChecksum>>(24-8*j));
+	}
+	//the older slot is overwritten, the newer one is still valid if this write breaks
+	apr_off_t offset=(generation%2)*ACTIVE_CHECKPOINT_SLOT_SIZE;
+	if (apr_file_seek(file,APR_SET,&offset)!=APR_SUCCESS ||
+			apr_file_write_full(file,slot,ACTIVE_CHECKPOINT_SLOT_SIZE,NULL)!=APR_SUCCESS){
+		throw ActiveException("ActiveCheckpoint. Error writing the file "+path+". Disk is full?");
+	}
+}
+
+void ActiveCheckpoint::close(){
+	if (file!=NULL){
+		apr_file_close(file);
+		file=NULL;
+	}
+	if (pool!=NULL){
+		apr_pool_destroy(pool);
+		pool=NULL;
+	}
+}
+
+ActiveCheckpoint::~ActiveCheckpoint(){
+	close();
+}
@@ -0,0 +1,116 @@
+/**
+ * @file
+ * @author  Oscar Pernas <oscar@pernas.es>
+ * @version 1.2.3
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * Checkpoint of the persistence, the sequence of the first message not sent.
+ * The file has two slots written alternately, each one with a generation and
+ * a checksum, so if the process dies while a slot is written the other one
+ * is still valid.
+ * This class is not thread safe, the persistence locks it.
+ */
+
+#ifndef ACTIVECHECKPOINT_H_
+#define ACTIVECHECKPOINT_H_
+
+#include <sstream>
+#include <string>
+
+#include "apr_general.h"
+#include "apr_pools.h"
+#include "apr_file_io.h"
+
+#include "../../utils/exception/ActiveException.h"
+
+namespace ai{
+
+	class ActiveCheckpoint {
+	private:
+
+		/**
+		 * Path of the file
+		 */
+		std::string path;
+
+		/**
+		 * Pool of the file and file, kept open while the checkpoint is open
+		 */
+		apr_pool_t* pool;
+		apr_file_t* file;
+
+		/**
+		 * Generation of the last slot written
+		 */
+		apr_uint32_t generation;
+
+		/**
+		 * Method that returns the checksum of a slot
+		 *
+		 * @param slot bytes of the slot, the checksum is not included
+		 *
+		 * @return checksum
+		 */
+		static apr_uint32_t checksum(const unsigned char* slot);
+
+	public:
+
+		/**
+		 * Default constructor
+		 */
+		ActiveCheckpoint();
+
+		/**
+		 * Method that opens the file, creating it if it does not exist
+		 *
+		 * @param pathR path of the file
+		 *
+		 * @throws ActiveException if the file can not be opened
+		 */
+		void open(const std::string& pathR) throw (ActiveException);
+
+		/**
+		 * Method that reads the sequence of the newest valid slot
+		 *
+		 * @param sequence sequence read
+		 *
+		 * @return false if there is not any valid slot
+		 */
+		bool read(long long& sequence);
+
+		/**
+		 * Method that writes a sequence in the slot older
+		 *
+		 * @param sequence sequence to write
+		 *
+		 * @throws ActiveException if the file can not be written. Disk is full?
+		 */
+		void write(long long sequence) throw (ActiveException);
+
+		/**
+		 * Method that closes the file
+		 */
+		void close();
+
+		/**
+		 * Default destructor
+		 */
+		virtual ~ActiveCheckpoint();
+	};
+}
+
+#endif /* ACTIVECHECKPOINT_H_ */
@@ -0,0 +1,759 @@
+/**
+ * @file
+ * @author  Oscar Pernas <oscar@pernas.es>
+ * @version 1.2.3
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * Append only log used by the persistence, written in segments.
+ */
+
+#include "ActiveLog.h"
+#include "../../utils/defines.h"
+#include "../../utils/ActiveCrc32c.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iomanip>
+
+using namespace log4cxx;
+using namespace log4cxx::helpers;
+using namespace ai;
+
+LoggerPtr ActiveLog::logger(Logger::getLogger("ActiveLog"));
+
+/**
+ * Functions that write and read the length of a record, big endian
+ */
+static void encodeLength(unsigned char* buffer, unsigned int length){
+	buffer[0]=(unsigned char)(length>>24);
+	buffer[1]=(unsigned char)(length>>16);
+	buffer[2]=(unsigned char)(length>>8);
+	buffer[3]=(unsigned char)length;
+}
+
+static unsigned int decodeLength(const unsigned char* buffer){
+	return ((unsigned int)buffer[0]<<24) | ((unsigned int)buffer[1]<<16) |
+			((unsigned int)buffer[2]<<8) | (unsigned int)buffer[3];
+}
+
+/**
+ * Function that reads the data of a record and checks its checksum
+ */
+static bool checkRecord(apr_file_t* file, unsigned int length, apr_uint32_t checksum, std::vector<unsigned char>& data){
+	data.resize(length);
+	if (length>0 && apr_file_read_full(file,&data[0],length,NULL)!=APR_SUCCESS){
+		return false;
+	}
+	return ActiveCrc32c::compute(length>0?&data[0]:NULL,length)==checksum;
+}
+
+ActiveLog::ActiveLog(){
+	segmentSize=DEFAULT_SEGMENT_SIZE;
+	nextSequence=0;
+	pool=NULL;
+	writerPool=NULL;
+	readerPool=NULL;
+	writer=NULL;
+	indexWriter=NULL;
+	writerSize=0;
+	writerRecords=0;
+	reader=NULL;
+	readAheadPosition=0;
+	readAheadEnd=0;
+	readerSegment=0;
+	readerVersion=ACTIVE_LOG_VERSION;
+	readSequence=0;
+}
+
+bool ActiveLog::compareSegments(const Segment& first, const Segment& second){
+	return first.firstSequence<second.firstSequence;
+}
+
+std::string ActiveLog::segmentPath(long long firstSequence){
+	std::stringstream path;
+	path << baseName << "." << std::setw(20) << std::setfill('0') << firstSequence;
+	return path.str();
+}
+
+std::string ActiveLog::indexPath(const Segment& segment){
+	return segment.path+".idx";
+}
+
+void ActiveLog::open(const std::string& baseNameR, unsigned int segmentSizeR) throw (ActiveException){
+	std::stringstream logMessage;
+
+	close();
+	baseName=baseNameR;
+	segmentSize=segmentSizeR;
+	segments.clear();
+	writeBuffer.clear();
+	indexBuffer.clear();
+	nextSequence=0;
+	if (pool==NULL){
+		apr_pool_create(&pool,NULL);
+	}
+
+	//looking for the segments that already exist in the directory of the log
+	std::string directory=".";
+	std::string prefix=baseName+".";
+	std::string::size_type slash=baseName.find_last_of("/\\");
+	if (slash!=std::string::npos){
+		directory=(slash==0)?baseName.substr(0,1):baseName.substr(0,slash);
+		prefix=baseName.substr(slash+1)+".";
+	}
+	apr_pool_t* directoryPool=NULL;
+	apr_dir_t* directoryHandle=NULL;
+	apr_pool_create(&directoryPool,pool);
+	if (apr_dir_open(&directoryHandle,directory.c_str(),directoryPool)==APR_SUCCESS){
+		apr_finfo_t info;
+		while (apr_dir_read(&info,APR_FINFO_NAME,directoryHandle)==APR_SUCCESS){
+			std::string name(info.name);
+			if (name.size()==prefix.size()+20 && name.compare(0,prefix.size(),prefix)==0 &&
+					name.find_first_not_of("0123456789",prefix.size())==std::string::npos){
+				Segment segment;
+				std::istringstream sequence(name.substr(prefix.size()));
+				sequence >> segment.firstSequence;
+				segment.path=segmentPath(segment.firstSequence);
+				segment.version=ACTIVE_LOG_VERSION;
+				segments.push_back(segment);
+			}
+		}
+		apr_dir_close(directoryHandle);
+	}
+	apr_pool_destroy(directoryPool);
+	std::sort(segments.begin(),segments.end(),compareSegments);
+
+	if (segments.empty()){
+		Segment segment;
+		segment.firstSequence=0;
+		segment.path=segmentPath(0);
+		segments.push_back(segment);
+		openWriter(true);
+	}else{
+		//segments written by older versions have not index
+		apr_off_t validSize=0;
+		apr_off_t fileSize=0;
+		for (unsigned int i=0; i+1<segments.size(); i++){
+			indexSegment(segments[i],validSize,fileSize);
+		}
+		//only the last segment can have records not complete
+		long long records=indexSegment(segments.back(),validSize,fileSize);
+		nextSequence=segments.back().firstSequence+records;
+		//a segment of an older version without records is written again
+		if (validSize<ACTIVE_LOG_HEADER_SIZE || (records==0 && segments.back().version<ACTIVE_LOG_VERSION)){
+			openWriter(true);
+		}else{
+			openWriter(false);
+			if (validSize<fileSize){
+				logMessage << "POSSIBLE DATA LOSS. Truncating "<<(fileSize-validSize)<<" bytes of a record not complete or with a wrong checksum at the end of "
+						<< segments.back().path;
+				LOG4CXX_ERROR(logger,logMessage.str().c_str());
+				logMessage.str("");
+				if (apr_file_trunc(writer,validSize)!=APR_SUCCESS){
+					closeWriter();
+					throw ActiveException("ActiveLog. Impossible to truncate the segment "+segments.back().path);
+				}
+			}
+			writerSize=validSize;
+			writerRecords=records;
+			//records of the current version are not appended to a segment of an older one
+			if (segments.back().version<ACTIVE_LOG_VERSION){
+				roll();
+			}
+		}
+	}
+	readSequence=getFirstSequence();
+
+	logMessage << "Log "<<baseName<<" opened with "<<segments.size()<<" segments and records from "
+			<<getFirstSequence()<<" to "<<nextSequence;
+	LOG4CXX_DEBUG(logger,logMessage.str().c_str());
+}
+
+void ActiveLog::openWriter(bool create) throw (ActiveException){
+	apr_int32_t flags=APR_FOPEN_WRITE | APR_FOPEN_CREATE | APR_FOPEN_APPEND | APR_FOPEN_BINARY;
+	if (create){
+		flags|=APR_FOPEN_TRUNCATE;
+	}
+	apr_pool_create(&writerPool,pool);
+	if (apr_file_open(&writer,segments.back().path.c_str(),flags,APR_OS_DEFAULT,writerPool)!=APR_SUCCESS){
+		apr_pool_destroy(writerPool);
+		writerPool=NULL;
+		writer=NULL;
+		throw ActiveException("ActiveLog. Impossible to open the segment "+segments.back().path);
+	}
+	if (apr_file_open(&indexWriter,indexPath(segments.back()).c_str(),flags,APR_OS_DEFAULT,writerPool)!=APR_SUCCESS){
+		indexWriter=NULL;
+		closeWriter();
+		throw ActiveException("ActiveLog. Impossible to open the index of the segment "+segments.back().path);
+	}
+	if (create){
+		unsigned char header[ACTIVE_LOG_HEADER_SIZE];
+		memset(header,0,ACTIVE_LOG_HEADER_SIZE);
+		memcpy(header,ACTIVE_LOG_MAGIC,4);
+		header[4]=ACTIVE_LOG_VERSION;
+		segments.back().version=ACTIVE_LOG_VERSION;
+		if (apr_file_write_full(writer,header,ACTIVE_LOG_HEADER_SIZE,NULL)!=APR_SUCCESS){
+			closeWriter();
+			throw ActiveException("ActiveLog. Impossible to write the header of the segment "+segments.back().path);
+		}
+		writerSize=ACTIVE_LOG_HEADER_SIZE;
+		writerRecords=0;
+	}
+}
+
+void ActiveLog::closeWriter(){
+	if (writer!=NULL){
+		apr_file_close(writer);
+		writer=NULL;
+	}
+	if (indexWriter!=NULL){
+		apr_file_close(indexWriter);
+		indexWriter=NULL;
+	}
+	if (writerPool!=NULL){
+		apr_pool_destroy(writerPool);
+		writerPool=NULL;
+	}
+}
+
+void ActiveLog::openReader(const Segment& segment) throw (ActiveException){
+	closeReader();
+	apr_pool_create(&readerPool,pool);
+	//not buffered by apr, the log reads ahead
+	if (apr_file_open(&reader,segment.path.c_str(),APR_FOPEN_READ | APR_FOPEN_BINARY,
+			APR_OS_DEFAULT,readerPool)!=APR_SUCCESS){
+		apr_pool_destroy(readerPool);
+		readerPool=NULL;
+		reader=NULL;
+		throw ActiveException("ActiveLog. Impossible to open the segment "+segment.path);
+	}
+	if (readAhead.size()<ACTIVE_LOG_READ_AHEAD){
+		readAhead.resize(ACTIVE_LOG_READ_AHEAD);
+	}
+	readAheadPosition=0;
+	readAheadEnd=0;
+	if (!fillReadAhead(ACTIVE_LOG_HEADER_SIZE) ||
+			memcmp(&readAhead[readAheadPosition],ACTIVE_LOG_MAGIC,4)!=0){
+		closeReader();
+		throw ActiveException("ActiveLog. Not valid header in the segment "+segment.path);
+	}
+	readerVersion=readAhead[readAheadPosition+4];
+	readAheadPosition+=ACTIVE_LOG_HEADER_SIZE;
+	readerSegment=segment.firstSequence;
+	readSequence=segment.firstSequence;
+}
+
+void ActiveLog::closeReader(){
+	if (reader!=NULL){
+		apr_file_close(reader);
+		reader=NULL;
+	}
+	if (readerPool!=NULL){
+		apr_pool_destroy(readerPool);
+		readerPool=NULL;
+	}
+}
+
+long long ActiveLog::indexSegment(Segment& segment, apr_off_t& validSize, apr_off_t& fileSize)
+	throw (ActiveException){
+
+	apr_pool_t* indexPool=NULL;
+	apr_file_t* file=NULL;
+	apr_file_t* index=NULL;
+	apr_pool_create(&indexPool,pool);
+	if (apr_file_open(&file,segment.path.c_str(),APR_FOPEN_READ | APR_FOPEN_BINARY | APR_FOPEN_BUFFERED,
+			APR_OS_DEFAULT,indexPool)!=APR_SUCCESS){
+		apr_pool_destroy(indexPool);
+		throw ActiveException("ActiveLog. Impossible to open the segment "+segment.path);
+	}
+	if (apr_file_open(&index,indexPath(segment).c_str(),APR_FOPEN_READ | APR_FOPEN_WRITE | APR_FOPEN_CREATE | APR_FOPEN_BINARY,
+			APR_OS_DEFAULT,indexPool)!=APR_SUCCESS){
+		apr_file_close(file);
+		apr_pool_destroy(indexPool);
+		throw ActiveException("ActiveLog. Impossible to open the index of the segment "+segment.path);
+	}
+	apr_finfo_t info;
+	apr_file_info_get(&info,APR_FINFO_SIZE,file);
+	fileSize=info.size;
+	apr_file_info_get(&info,APR_FINFO_SIZE,index);
+	long long entries=info.size/4;
+	long long validEntries=0;
+
+	long long records=0;
+	bool validHeader=true;
+	unsigned char header[ACTIVE_LOG_HEADER_SIZE];
+	unsigned char length[ACTIVE_LOG_RECORD_HEADER];
+	std::vector<unsigned char> newEntries;
+	std::vector<unsigned char> data;
+	validSize=0;
+	if (fileSize>=ACTIVE_LOG_HEADER_SIZE && apr_file_read_full(file,header,ACTIVE_LOG_HEADER_SIZE,NULL)==APR_SUCCESS){
+		if (memcmp(header,ACTIVE_LOG_MAGIC,4)!=0){
+			validHeader=false;
+		}else{
+			segment.version=header[4];
+			bool checksum=segment.version>=ACTIVE_LOG_CHECKSUM_VERSION;
+			unsigned int recordHeader=checksum?ACTIVE_LOG_RECORD_HEADER:4;
+
+			//last entry of the index whose record is complete
+			validSize=ACTIVE_LOG_HEADER_SIZE;
+			while (entries>0){
+				apr_off_t position=(entries-1)*4;
+				apr_file_seek(index,APR_SET,&position);
+				if (apr_file_read_full(index,length,4,NULL)==APR_SUCCESS){
+					apr_off_t offset=decodeLength(length);
+					apr_file_seek(file,APR_SET,&offset);
+					if (offset>=ACTIVE_LOG_HEADER_SIZE && offset+recordHeader<=fileSize &&
+							apr_file_read_full(file,length,recordHeader,NULL)==APR_SUCCESS &&
+							offset+recordHeader+decodeLength(length)<=fileSize &&
+							(!checksum || checkRecord(file,decodeLength(length),decodeLength(length+4),data))){
+						validSize=offset+recordHeader+decodeLength(length);
+						break;
+					}
+				}
+				entries--;
+			}
+			validEntries=entries;
+			records=entries;
+			//records not in the index, jumping from length to length
+			apr_off_t offset=validSize;
+			apr_file_seek(file,APR_SET,&offset);
+			while (validSize+recordHeader<=fileSize && apr_file_read_full(file,length,recordHeader,NULL)==APR_SUCCESS){
+				apr_off_t recordEnd=validSize+recordHeader+decodeLength(length);
+				if (recordEnd>fileSize){
+					break;
+				}
+				//a record written in part is found by its checksum, not only by its length
+				if (checksum && !checkRecord(file,decodeLength(length),decodeLength(length+4),data)){
+					break;
+				}
+				encodeLength(length,(unsigned int)validSize);
+				newEntries.insert(newEntries.end(),length,length+4);
+				offset=recordEnd;
+				apr_file_seek(file,APR_SET,&offset);
+				validSize=recordEnd;
+				records++;
+			}
+		}
+	}
+	//index with the entries of the complete records
+	apr_file_trunc(index,validEntries*4);
+	if (!newEntries.empty()){
+		apr_off_t position=validEntries*4;
+		apr_file_seek(index,APR_SET,&position);
+		apr_file_write_full(index,&newEntries[0],newEntries.size(),NULL);
+	}
+	apr_file_close(index);
+	apr_file_close(file);
+	apr_pool_destroy(indexPool);
+	if (!validHeader){
+		throw ActiveException("ActiveLog. Not valid header in the segment "+segment.path);
+	}
+	return records;
+}
+
+bool ActiveLog::fillReadAhead(unsigned int needed){
+	if (readAheadEnd-readAheadPosition>=needed){
+		return true;
+	}
+	//bytes not read yet moved to the beginning
+	if (readAheadPosition>0){
+		memmove(&readAhead[0],&readAhead[readAheadPosition],readAheadEnd-readAheadPosition);
+		readAheadEnd-=readAheadPosition;
+		readAheadPosition=0;
+	}
+	if (readAhead.size()<needed){
+		readAhead.resize(needed);
+	}
+	while (readAheadEnd<needed){
+		apr_size_t bytesRead=readAhead.size()-readAheadEnd;
+		if (apr_file_read(reader,&readAhead[readAheadEnd],&bytesRead)!=APR_SUCCESS || bytesRead==0){
+			return false;
+		}
+		readAheadEnd+=bytesRead;
+	}
+	return true;
+}
+
+bool ActiveLog::readLength(unsigned int& length, apr_uint32_t& checksum) throw (ActiveException){
+	unsigned int recordHeader=(readerVersion>=ACTIVE_LOG_CHECKSUM_VERSION)?ACTIVE_LOG_RECORD_HEADER:4;
+	if (!fillReadAhead(recordHeader)){
+		if (readAheadEnd==readAheadPosition){
+			return false;
+		}
+		throw ActiveException("ActiveLog. Error reading a record of the segment "+segmentPath(readerSegment));
+	}
+	length=decodeLength(&readAhead[readAheadPosition]);
+	checksum=(recordHeader>4)?decodeLength(&readAhead[readAheadPosition+4]):0;
+	readAheadPosition+=recordHeader;
+	return true;
+}
+
+long long ActiveLog::append(const unsigned char* data, unsigned int size) throw (ActiveException){
+	if (writer==NULL){
+		throw ActiveException("ActiveLog. Log "+baseName+" is not open");
+	}
+	if (writerRecords>0 && writerSize+ACTIVE_LOG_RECORD_HEADER+size>(apr_off_t)segmentSize){
+		roll();
+	}
+	unsigned char length[ACTIVE_LOG_RECORD_HEADER];
+	encodeLength(length,(unsigned int)writerSize);
+	indexBuffer.insert(indexBuffer.end(),length,length+4);
+	encodeLength(length,size);
+	encodeLength(length+4,ActiveCrc32c::compute(data,size));
+	writeBuffer.insert(writeBuffer.end(),length,length+ACTIVE_LOG_RECORD_HEADER);
+	writeBuffer.insert(writeBuffer.end(),data,data+size);
+	writerSize+=ACTIVE_LOG_RECORD_HEADER+size;
+	writerRecords++;
+	return nextSequence++;
+}
+
+void ActiveLog::flush() throw (ActiveException){
+	if (!writeBuffer.empty()){
+		if (writer==NULL){
+			throw ActiveException("ActiveLog. Log "+baseName+" is not open");
+		}
+		if (apr_file_write_full(writer,&writeBuffer[0],writeBuffer.size(),NULL)!=APR_SUCCESS){
+			throw ActiveException("ActiveLog. Error writing the segment "+segments.back().path+". Disk is full?");
+		}
+		writeBuffer.clear();
+		//the index is written after the records, it never has offsets of records not written
+		if (apr_file_write_full(indexWriter,&indexBuffer[0],indexBuffer.size(),NULL)!=APR_SUCCESS){
+			throw ActiveException("ActiveLog. Error writing the index of the segment "+segments.back().path+". Disk is full?");
+		}
+		indexBuffer.clear();
+	}
+}
+
+void ActiveLog::sync() throw (ActiveException){
+	flush();
+	if (writer!=NULL && apr_file_datasync(writer)!=APR_SUCCESS){
+		throw ActiveException("ActiveLog. Error synchronizing the segment "+segments.back().path);
+	}
+}
+
+void ActiveLog::seek(long long sequence) throw (ActiveException){
+	std::stringstream logMessage;
+
+	if (sequence<getFirstSequence() || sequence>nextSequence){
+		logMessage << "ActiveLog. Record "<<sequence<<" is not in the log "<<baseName;
+		throw ActiveException(logMessage.str());
+	}
+	flush();
+	//last segment that begins before the record
+	unsigned int index=segments.size()-1;
+	while (index>0 && segments[index].firstSequence>sequence){
+		index--;
+	}
+	if (reader==NULL || readerSegment!=segments[index].firstSequence){
+		openReader(segments[index]);
+	}
+	apr_off_t offset=ACTIVE_LOG_HEADER_SIZE;
+	if (sequence==nextSequence){
+		offset=writerSize;
+	}else if (sequence>segments[index].firstSequence){
+		offset=recordOffset(segments[index],sequence);
+	}
+	if (apr_file_seek(reader,APR_SET,&offset)!=APR_SUCCESS){
+		logMessage << "ActiveLog. Impossible to seek the record "<<sequence<<" in the segment "<<segments[index].path;
+		throw ActiveException(logMessage.str());
+	}
+	readAheadPosition=0;
+	readAheadEnd=0;
+	readSequence=sequence;
+}
+
+apr_off_t ActiveLog::recordOffset(const Segment& segment, long long sequence) throw (ActiveException){
+	apr_pool_t* indexPool=NULL;
+	apr_file_t* index=NULL;
+	unsigned char entry[4];
+
+	apr_pool_create(&indexPool,pool);
+	if (apr_file_open(&index,indexPath(segment).c_str(),APR_FOPEN_READ | APR_FOPEN_BINARY,APR_OS_DEFAULT,indexPool)!=APR_SUCCESS){
+		apr_pool_destroy(indexPool);
+		throw ActiveException("ActiveLog. Impossible to open the index of the segment "+segment.path);
+	}
+	apr_off_t position=(sequence-segment.firstSequence)*4;
+	apr_status_t status=apr_file_seek(index,APR_SET,&position);
+	if (status==APR_SUCCESS){
+		status=apr_file_read_full(index,entry,4,NULL);
+	}
+	apr_file_close(index);
+	apr_pool_destroy(indexPool);
+	if (status!=APR_SUCCESS){
+		throw ActiveException("ActiveLog. Error reading the index of the segment "+segment.path);
+	}
+	return decodeLength(entry);
+}
+
+bool ActiveLog::read(std::vector<unsigned char>& record) throw (ActiveException){
+	if (readSequence>=nextSequence){
+		return false;
+	}
+	flush();
+	if (reader==NULL){
+		seek(readSequence);
+	}
+	unsigned int length=0;
+	apr_uint32_t checksum=0;
+	if (!readLength(length,checksum)){
+		//end of the segment, the next one begins with this record
+		unsigned int index=0;
+		while (index<segments.size() && segments[index].firstSequence!=readSequence){
+			index++;
+		}
+		if (index==segments.size()){
+			std::stringstream logMessage;
+			logMessage << "ActiveLog. Record "<<readSequence<<" not found in the log "<<baseName;
+			throw ActiveException(logMessage.str());
+		}
+		openReader(segments[index]);
+		if (!readLength(length,checksum)){
+			throw ActiveException("ActiveLog. Segment "+segments[index].path+" has not records");
+		}
+	}
+	if (!fillReadAhead(length)){
+		throw ActiveException("ActiveLog. Error reading a record of the segment "+segmentPath(readerSegment));
+	}
+	if (readerVersion>=ACTIVE_LOG_CHECKSUM_VERSION &&
+			ActiveCrc32c::compute(length>0?&readAhead[readAheadPosition]:NULL,length)!=checksum){
+		std::stringstream logMessage;
+		logMessage << "ActiveLog. Wrong checksum of the record "<<readSequence<<" in the segment "<<segmentPath(readerSegment);
+		throw ActiveException(logMessage.str());
+	}
+	record.assign(readAhead.begin()+readAheadPosition,readAhead.begin()+readAheadPosition+length);
+	readAheadPosition+=length;
+	readSequence++;
+	return true;
+}
+
+void ActiveLog::acknowledge(long long sequence){
+	std::stringstream logMessage;
+
+	while (segments.size()>1 && segments[1].firstSequence<=sequence){
+		if (reader!=NULL && readerSegment==segments.front().firstSequence){
+			closeReader();
+		}
+		apr_file_remove(indexPath(segments.front()).c_str(),pool);
+		if (apr_file_remove(segments.front().path.c_str(),pool)!=APR_SUCCESS){
+			logMessage << "Impossible to delete the segment "<<segments.front().path;
+			LOG4CXX_ERROR(logger,logMessage.str().c_str());
+		}else{
+			logMessage << "Segment "<<segments.front().path<<" deleted, all its records are sent";
+			LOG4CXX_DEBUG(logger,logMessage.str().c_str());
+		}
+		logMessage.str("");
+		segments.pop_front();
+	}
+}
+
+void ActiveLog::compact(long long sequence) throw (ActiveException){
+	std::stringstream logMessage;
+
+	if (sequence>nextSequence){
+		sequence=nextSequence;
+	}
+	acknowledge(sequence);
+	if (segments.empty() || sequence<=segments.front().firstSequence){
+		return;
+	}
+	flush();
+	Segment& segment=segments.front();
+	bool last=(segments.size()==1);
+	//offset of the first record kept
+	apr_off_t offset=(sequence==nextSequence)?writerSize:recordOffset(segment,sequence);
+	if (reader!=NULL && readerSegment==segment.firstSequence){
+		closeReader();
+	}
+	if (last){
+		closeWriter();
+	}
+
+	Segment compacted;
+	compacted.firstSequence=sequence;
+	compacted.path=segmentPath(sequence);
+	compacted.version=segment.version;
+	std::string temporaryPath=compacted.path+".tmp";
+	std::string temporaryIndexPath=indexPath(compacted)+".tmp";
+
+	apr_pool_t* compactPool=NULL;
+	apr_file_t* source=NULL;
+	apr_file_t* sourceIndex=NULL;
+	apr_file_t* target=NULL;
+	apr_file_t* targetIndex=NULL;
+	apr_pool_create(&compactPool,pool);
+	apr_status_t status=apr_file_open(&source,segment.path.c_str(),APR_FOPEN_READ | APR_FOPEN_BINARY,APR_OS_DEFAULT,compactPool);
+	if (status==APR_SUCCESS){
+		status=apr_file_open(&sourceIndex,indexPath(segment).c_str(),APR_FOPEN_READ | APR_FOPEN_BINARY | APR_FOPEN_BUFFERED,
+				APR_OS_DEFAULT,compactPool);
+	}
+	if (status==APR_SUCCESS){
+		status=apr_file_open(&target,temporaryPath.c_str(),APR_FOPEN_WRITE | APR_FOPEN_CREATE | APR_FOPEN_TRUNCATE | APR_FOPEN_BINARY,
+				APR_OS_DEFAULT,compactPool);
+	}
+	if (status==APR_SUCCESS){
+		status=apr_file_open(&targetIndex,temporaryIndexPath.c_str(),APR_FOPEN_WRITE | APR_FOPEN_CREATE | APR_FOPEN_TRUNCATE |
+				APR_FOPEN_BINARY | APR_FOPEN_BUFFERED,APR_OS_DEFAULT,compactPool);
+	}
+
+	//same header, then the records from the offset as they are
+	std::vector<unsigned char> buffer(ACTIVE_LOG_READ_AHEAD);
+	if (status==APR_SUCCESS){
+		status=apr_file_read_full(source,&buffer[0],ACTIVE_LOG_HEADER_SIZE,NULL);
+	}
+	if (status==APR_SUCCESS){
+		status=apr_file_write_full(target,&buffer[0],ACTIVE_LOG_HEADER_SIZE,NULL);
+	}
+	if (status==APR_SUCCESS){
+		status=apr_file_seek(source,APR_SET,&offset);
+	}
+	while (status==APR_SUCCESS){
+		apr_size_t bytesRead=buffer.size();
+		apr_status_t readStatus=apr_file_read(source,&buffer[0],&bytesRead);
+		if (bytesRead>0){
+			status=apr_file_write_full(target,&buffer[0],bytesRead,NULL);
+		}
+		if (readStatus!=APR_SUCCESS || bytesRead==0){
+			break;
+		}
+	}
+
+	//entries of the index moved by the bytes deleted
+	apr_off_t removed=offset-ACTIVE_LOG_HEADER_SIZE;
+	long long kept=0;
+	if (status==APR_SUCCESS){
+		apr_off_t position=(sequence-segment.firstSequence)*4;
+		status=apr_file_seek(sourceIndex,APR_SET,&position);
+	}
+	unsigned char entry[4];
+	while (status==APR_SUCCESS && apr_file_read_full(sourceIndex,entry,4,NULL)==APR_SUCCESS){
+		encodeLength(entry,(unsigned int)(decodeLength(entry)-removed));
+		status=apr_file_write_full(targetIndex,entry,4,NULL);
+		kept++;
+	}
+	if (status==APR_SUCCESS){
+		status=apr_file_flush(targetIndex);
+	}
+	if (status==APR_SUCCESS){
+		status=apr_file_datasync(target);
+	}
+	apr_file_t* files[4]={source,sourceIndex,target,targetIndex};
+	for (int i=0; i<4; i++){
+		if (files[i]!=NULL){
+			apr_file_close(files[i]);
+		}
+	}
+
+	//the new segment is complete before the old one is deleted
+	if (status==APR_SUCCESS){
+		status=apr_file_rename(temporaryIndexPath.c_str(),indexPath(compacted).c_str(),compactPool);
+	}
+	if (status==APR_SUCCESS){
+		status=apr_file_rename(temporaryPath.c_str(),compacted.path.c_str(),compactPool);
+	}
+	if (status!=APR_SUCCESS){
+		apr_file_remove(temporaryPath.c_str(),compactPool);
+		apr_file_remove(temporaryIndexPath.c_str(),compactPool);
+		apr_pool_destroy(compactPool);
+		if (last){
+			openWriter(false);
+		}
+		throw ActiveException("ActiveLog. Error compacting the segment "+segment.path+". Disk is full?");
+	}
+	apr_file_remove(indexPath(segment).c_str(),compactPool);
+	apr_file_remove(segment.path.c_str(),compactPool);
+	apr_pool_destroy(compactPool);
+
+	logMessage << "Segment "<<segment.path<<" compacted to "<<compacted.path<<", "<<removed<<" bytes of "
+			<<(sequence-segment.firstSequence)<<" records deleted";
+	LOG4CXX_DEBUG(logger,logMessage.str().c_str());
+	segment=compacted;
+	if (last){
+		openWriter(false);
+		writerSize-=removed;
+		writerRecords=kept;
+	}
+	if (readSequence<sequence){
+		readSequence=sequence;
+	}
+}
+
+apr_off_t ActiveLog::getDiskSize(){
+	apr_off_t size=0;
+	apr_finfo_t info;
+	apr_pool_t* statPool=NULL;
+	apr_pool_create(&statPool,pool);
+	for (unsigned int i=0; i<segments.size(); i++){
+		if (apr_stat(&info,segments[i].path.c_str(),APR_FINFO_SIZE,statPool)==APR_SUCCESS){
+			size+=info.size;
+		}
+		if (apr_stat(&info,indexPath(segments[i]).c_str(),APR_FINFO_SIZE,statPool)==APR_SUCCESS){
+			size+=info.size;
+		}
+	}
+	apr_pool_destroy(statPool);
+	return size;
+}
+
+void ActiveLog::roll() throw (ActiveException){
+	if (writerRecords>0){
+		sync();
+		closeWriter();
+		Segment segment;
+		segment.firstSequence=nextSequence;
+		segment.path=segmentPath(nextSequence);
+		segments.push_back(segment);
+		openWriter(true);
+	}
+}
+
+void ActiveLog::reset() throw (ActiveException){
+	closeReader();
+	closeWriter();
+	writeBuffer.clear();
+	indexBuffer.clear();
+	for (unsigned int i=0; i<segments.size(); i++){
+		apr_file_remove(indexPath(segments[i]).c_str(),pool);
+		apr_file_remove(segments[i].path.c_str(),pool);
+	}
+	segments.clear();
+	Segment segment;
+	segment.firstSequence=nextSequence;
+	segment.path=segmentPath(nextSequence);
+	segments.push_back(segment);
+	openWriter(true);
+	readSequence=nextSequence;
+}
+
+void ActiveLog::close(){
+	if (writer!=NULL){
+		try{
+			flush();
+		}catch (ActiveException& ae){
+			LOG4CXX_ERROR(logger,ae.getMessage());
+		}
+	}
+	closeReader();
+	closeWriter();
+}
+
+ActiveLog::~ActiveLog(){
+	close();
+	if (pool!=NULL){
+		apr_pool_destroy(pool);
+		pool=NULL;
+	}
+}
@@ -0,0 +1,377 @@
+/**
+ * @file
+ * @author  Oscar Pernas <oscar@pernas.es>
+ * @version 1.2.3
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * Append only log used by the persistence. Records are written in segments
+ * of a max size named <base>.<first sequence>, each one with a header and
+ * each record prefixed with its length and its CRC32C (4 bytes each, big
+ * endian; segments of version 1 have only the length). Every record
+ * has a sequence number, a segment is deleted when all its records are
+ * acknowledged.
+ * Each segment has an index <segment>.idx with the offset of each record
+ * (4 bytes, big endian), so the log is opened and a record is found without
+ * reading the records.
+ * This class is not thread safe, the persistence locks it.
+ */
+
+#ifndef ACTIVELOG_H_
+#define ACTIVELOG_H_
+
+#include <sstream>
+#include <string>
+#include <deque>
+#include <vector>
+
+#include "apr_general.h"
+#include "apr_pools.h"
+#include "apr_file_io.h"
+
+#include "../../utils/exception/ActiveException.h"
+#include "ActiveStore.h"
+
+#include "log4cxx/logger.h"
+
+namespace ai{
+
+	class ActiveLog : public ActiveStore {
+	private:
+
+		/**
+		 * Segment of the log, file and sequence of its first record
+		 */
+		struct Segment {
+			long long firstSequence;
+			std::string path;
+			unsigned char version;
+		};
+
+		/**
+		 * Name of the log, segments are named <baseName>.<first sequence>
+		 */
+		std::string baseName;
+
+		/**
+		 * Max size in bytes of a segment
+		 */
+		unsigned int segmentSize;
+
+		/**
+		 * Segments of the log ordered by sequence, the last one is the one written
+		 */
+		std::deque<Segment> segments;
+
+		/**
+		 * Sequence that will be given to the next record appended
+		 */
+		long long nextSequence;
+
+		/**
+		 * Pool of the log, and pools of the files open so they are freed when
+		 * the file is closed
+		 */
+		apr_pool_t* pool;
+		apr_pool_t* writerPool;
+		apr_pool_t* readerPool;
+
+		/**
+		 * File of the last segment and its index, kept open while the log is open
+		 */
+		apr_file_t* writer;
+		apr_file_t* indexWriter;
+
+		/**
+		 * Size of the last segment, including records not flushed yet, and
+		 * number of records in it
+		 */
+		apr_off_t writerSize;
+		long long writerRecords;
+
+		/**
+		 * Records appended and not written to the file yet, and their offsets
+		 */
+		std::vector<unsigned char> writeBuffer;
+		std::vector<unsigned char> indexBuffer;
+
+		/**
+		 * File of the segment that is being read, NULL if none
+		 */
+		apr_file_t* reader;
+
+		/**
+		 * Bytes read ahead from the reader, and the part of them not read yet
+		 */
+		std::vector<unsigned char> readAhead;
+		unsigned int readAheadPosition;
+		unsigned int readAheadEnd;
+
+		/**
+		 * First sequence of the segment being read
+		 */
+		long long readerSegment;
+
+		/**
+		 * Version of the segment being read, records have checksum from version 2
+		 */
+		unsigned char readerVersion;
+
+		/**
+		 * Sequence of the next record that will be read
+		 */
+		long long readSequence;
+
+		//static var for logger
+		static log4cxx::LoggerPtr logger;
+
+		/**
+		 * Method that orders segments by their first sequence
+		 */
+		static bool compareSegments(const Segment& first, const Segment& second);
+
+		/**
+		 * Method that returns the path of the segment starting in a sequence
+		 *
+		 * @param firstSequence sequence of the first record of the segment
+		 *
+		 * @return path of the segment
+		 */
+		std::string segmentPath(long long firstSequence);
+
+		/**
+		 * Method that returns the path of the index of a segment
+		 *
+		 * @param segment segment of the index
+		 *
+		 * @return path of the index
+		 */
+		std::string indexPath(const Segment& segment);
+
+		/**
+		 * Method that opens the last segment and its index to write. If it is created the
+		 * header is written.
+		 *
+		 * @param create true to create the segment, false to append to it
+		 *
+		 * @throws ActiveException if the file can not be opened
+		 */
+		void openWriter(bool create) throw (ActiveException);
+
+		/**
+		 * Method that closes the file of the last segment
+		 */
+		void closeWriter();
+
+		/**
+		 * Method that opens a segment to read, positioned in its first record
+		 *
+		 * @param segment segment to read
+		 *
+		 * @throws ActiveException if the file can not be opened or has not a valid header
+		 */
+		void openReader(const Segment& segment) throw (ActiveException);
+
+		/**
+		 * Method that closes the file being read
+		 */
+		void closeReader();
+
+		/**
+		 * Method that checks the index of a segment and counts its records. The
+		 * entries of records not complete are removed, and records not in the
+		 * index are added jumping from length to length, only the records at the
+		 * end, or all of them if the index does not exist. The checksum of the
+		 * last record of the index and of the records added is checked, the
+		 * segment is valid up to the first record with a wrong one. The version
+		 * of the segment is read from its header.
+		 *
+		 * @param segment segment to index
+		 * @param validSize size of the segment up to the last complete record
+		 * @param fileSize size of the file
+		 *
+		 * @return number of records
+		 *
+		 * @throws ActiveException if the files can not be read
+		 */
+		long long indexSegment(Segment& segment, apr_off_t& validSize, apr_off_t& fileSize)
+			throw (ActiveException);
+
+		/**
+		 * Method that returns the offset of a record in its segment
+		 *
+		 * @param segment segment of the record
+		 * @param sequence sequence of the record
+		 *
+		 * @return offset of the record
+		 *
+		 * @throws ActiveException if the index can not be read
+		 */
+		apr_off_t recordOffset(const Segment& segment, long long sequence) throw (ActiveException);
+
+		/**
+		 * Method that reads from the reader until the bytes read ahead and not
+		 * read yet are at least a number
+		 *
+		 * @param needed number of bytes
+		 *
+		 * @return false if the end of the segment is reached before
+		 */
+		bool fillReadAhead(unsigned int needed);
+
+		/**
+		 * Method that reads the header of the next record of the reader
+		 *
+		 * @param length length read
+		 * @param checksum checksum read, 0 in segments of version 1
+		 *
+		 * @return false if the end of the segment is reached
+		 *
+		 * @throws ActiveException if the file can not be read
+		 */
+		bool readLength(unsigned int& length, apr_uint32_t& checksum) throw (ActiveException);
+
+	public:
+
+		/**
+		 * Default constructor
+		 */
+		ActiveLog();
+
+		/**
+		 * Method that opens the log, finding the segments that already exist.
+		 * A record not complete at the end of the last segment, written when
+		 * the process died, is truncated.
+		 *
+		 * @param baseNameR name of the log
+		 * @param segmentSizeR max size in bytes of a segment
+		 *
+		 * @throws ActiveException if the segments can not be opened
+		 */
+		void open(const std::string& baseNameR, unsigned int segmentSizeR) throw (ActiveException);
+
+		/**
+		 * Method that appends a record. It is buffered until flush is invoked.
+		 *
+		 * @param data bytes of the record
+		 * @param size number of bytes
+		 *
+		 * @return sequence of the record
+		 *
+		 * @throws ActiveException if a new segment can not be created
+		 */
+		long long append(const unsigned char* data, unsigned int size) throw (ActiveException);
+
+		/**
+		 * Method that writes the records appended to the file
+		 *
+		 * @throws ActiveException if the records can not be written. Disk is full?
+		 */
+		void flush() throw (ActiveException);
+
+		/**
+		 * Method that writes the records appended and synchronizes the last
+		 * segment to disk. The index is not synchronized, it is rebuilt from
+		 * the records when the log is opened.
+		 *
+		 * @throws ActiveException if the segment can not be synchronized
+		 */
+		void sync() throw (ActiveException);
+
+		/**
+		 * Method that sets the next record that will be read
+		 *
+		 * @param sequence sequence of the record
+		 *
+		 * @throws ActiveException if the record is not in the log
+		 */
+		void seek(long long sequence) throw (ActiveException);
+
+		/**
+		 * Method that reads the next record
+		 *
+		 * @param record vector in which the record is stored
+		 *
+		 * @return false if there are no more records
+		 *
+		 * @throws ActiveException if the record can not be read
+		 */
+		bool read(std::vector<unsigned char>& record) throw (ActiveException);
+
+		/**
+		 * Method that deletes the segments whose records are all before a sequence
+		 *
+		 * @param sequence first record that is not acknowledged
+		 */
+		void acknowledge(long long sequence);
+
+		/**
+		 * Method that deletes the records before a sequence, the segments with
+		 * all of them and the first records of the segment where the sequence
+		 * is. That segment is copied from the record, without reading the
+		 * records one by one, to a new one named by the sequence. Sequences of
+		 * the records are kept.
+		 *
+		 * @param sequence first record that is not deleted
+		 *
+		 * @throws ActiveException if the segment can not be copied
+		 */
+		void compact(long long sequence) throw (ActiveException);
+
+		/**
+		 * Method that returns the bytes of the segments on disk
+		 *
+		 * @return size of the log
+		 */
+		apr_off_t getDiskSize();
+
+		/**
+		 * Method that starts a new segment, if the last one has records. The
+		 * last one is synchronized to disk before it is closed.
+		 *
+		 * @throws ActiveException if the segment can not be created
+		 */
+		void roll() throw (ActiveException);
+
+		/**
+		 * Method that deletes all the segments and starts a new one. Sequences
+		 * are not restarted.
+		 *
+		 * @throws ActiveException if the segment can not be created
+		 */
+		void reset() throw (ActiveException);
+
+		/**
+		 * Method that writes pending records and closes the files
+		 */
+		void close();
+
+		/**
+		 * Default destructor
+		 */
+		virtual ~ActiveLog();
+
+		/////////////////////////////////////////////////////////////////
+		//getters
+		long long getFirstSequence(){return segments.empty()?nextSequence:segments.front().firstSequence;}
+		long long getNextSequence(){return nextSequence;}
+		long long getReadSequence(){return readSequence;}
+		long long getSegmentRecords(){return writerRecords;}
+		unsigned int getNumberSegments(){return segments.size();}
+	};
+}
+
+#endif /* ACTIVELOG_H_ */
@@ -29,9 +29,14 @@
 #include <boost/archive/binary_iarchive.hpp>
 #include <boost/archive/text_oarchive.hpp>
 #include <boost/archive/text_iarchive.hpp>
+#include <boost/iostreams/device/array.hpp>
+#include <boost/iostreams/stream.hpp>
+
+#include <cstdio>
 
 #include "ActivePersistence.h"
 #include "../ActiveConnection.h"
+#include "../ActiveManager.h"
 #include "../../utils/exception/ActiveException.h"
 
 using namespace log4cxx;
@@ -49,15 +54,28 @@ ActivePersistence::ActivePersistence(){
 	lastSent=0;
 	lastEnqueue=0;
 	lastWrote=0;
+	lastCheckpoint=0;
+	lastCheckpointTime=0;
+	checkpointMessages=DEFAULT_CHECKPOINT_MESSAGES;
+	checkpointTime=DEFAULT_CHECKPOINT_TIME;
+	recoveryStart=0;
+	recoveryReplayed=0;
+	replayedMessages=0;
+	replayTime=0;
+	durability=ACTIVE_SYNC_NONE;
+	syncInterval=DEFAULT_SYNC_INTERVAL;
+	syncBatch=DEFAULT_SYNC_BATCH;
+	durableSequence=0;
+	lastSyncTime=0;
+	writeBehind=false;
 	//initialized to false
 	initialized=false;
 	//recovery mode to false
 	recoveryMode=false;
 
-	//positin in file to 0
-	positionInFile=0;
-
 	activeConnection=NULL;
+	activeStore=NULL;
+	sharedStore=NULL;
 }
 
 void ActivePersistence::init(ActiveConnection& activeConnectionR) {
@@ -77,35 +95,90 @@ void ActivePersistence::init(ActiveConnection& activeConnectionR) {
 
 	//persistence is initialized and ready to use
 	setSizePersistence(activeConnectionR.getSizePersistence());
+	checkpointMessages=activeConnectionR.getCheckpointMessages();
+	checkpointTime=activeConnectionR.getCheckpointTime();
+	durability=activeConnectionR.getDurability();
+	syncInterval=activeConnectionR.getSyncInterval();
+	syncBatch=activeConnectionR.getSyncBatch();
+	writeBehind=activeConnectionR.getWriteBehind();
 	initialized=true;
 
 	activeConnection=&activeConnectionR;
 
 	if (isEnabled()){
+		//opening the store, the messages written before are found
+		try{
+			if (activeConnectionR.getPersistenceType()==ACTIVE_RING_PERSISTENCE){
+				activeStore=new ActiveRingFile();
+				activeStore->open(dataFilename.str(),activeConnectionR.getRingSize());
+			}else if (activeConnectionR.getPersistenceType()==ACTIVE_SHARED_PERSISTENCE){
+				//the checkpoint is written in the shared log, there is no control file
+				ActiveSharedLog* activeSharedLog=ActiveManager::getInstance()->getSharedLog(
+						activeConnectionR.getSharedLog(),activeConnectionR.getSegmentSize());
+				sharedStore=new ActiveSharedStore(*activeSharedLog,activeConnectionR.getId());
+				activeStore=sharedStore;
+				activeStore->open(dataFilename.str(),activeConnectionR.getSegmentSize());
+			}else{
+				activeStore=new ActiveLog();
+				activeStore->open(dataFilename.str(),activeConnectionR.getSegmentSize());
+			}
+			if (sharedStore==NULL){
+				activeCheckpoint.open(controlFilename.str());
+			}
+			//messages found were written before, they are considered on disk
+			durableSequence=activeStore->getNextSequence();
+			lastSyncTime=apr_time_now();
+		}catch (ActiveException& ae){
+			std::stringstream logMessage;
+			logMessage << "DATA LOSS. Persistence disabled. " << ae.getMessage();
+			LOG4CXX_FATAL (logger,logMessage.str().c_str());
+			initialized=false;
+			return;
+		}
 		//initializing thread
 		activePersistenceThread.init(*this);
 		//starting thread
 		activePersistenceThread.runPersistenceThread();
+		if (writeBehind){
+			writeQueue.init(activeConnectionR.getWriteQueueSize());
+			activeWriterThread.init(*this);
+			if (activeWriterThread.runWriterThread()!=APR_SUCCESS){
+				LOG4CXX_ERROR (logger,"Persistence writer thread can not start. Records are written by deliver.");
+				writeBehind=false;
+			}
+		}
 	}
 }
 
 void ActivePersistence::crashRecovery(){
 
-	long howManyToSend=0;
+	long long howManyToSend=0;
+	bool legacyMoved=true;
 	std::stringstream logMessage;
 	try{
 		persistenceMutex.lock();
-		if (isEnabled()){
-			long controlFileSent=getLastSentFromFile();
-			long controlFileWrote=getNumberMessagesSerialized();
+		legacyMoved=!isEnabled() || migrateLegacyFile();
+		if (isEnabled() && legacyMoved){
+			long long controlFileSent=getLastSentFromFile();
+			long long controlFileWrote=getNumberMessagesSerialized();
+			//segments of sent messages could be deleted after the control file was written
+			if (controlFileSent<activeStore->getFirstSequence()){
+				controlFileSent=activeStore->getFirstSequence();
+			}else if (controlFileSent>controlFileWrote){
+				controlFileSent=controlFileWrote;
+			}
 			lastEnqueue=controlFileSent;
 			lastSent=controlFileSent;
 			lastWrote=controlFileWrote;
+			lastCheckpoint=controlFileSent;
+			lastCheckpointTime=apr_time_now();
+			activeWriterThread.setWritten(lastWrote);
 			if (lastWrote>lastSent){
 				logMessage<< "RECOVERING DATA: We need to recover from:"<<lastSent <<" to "<<lastWrote;
 				LOG4CXX_DEBUG(logger,logMessage.str().c_str());
 				setPositionToSend();
 				setRecoveryMode(true);
+				startReplay();
 				//we are going to send one message for each space
 				//in the queue that we have
 				//fix: but if the queue is bigger than the number of messages waiting
@@ -129,13 +202,26 @@ void ActivePersistence::crashRecovery(){
 	}catch (...){
 		persistenceMutex.unlock();
 	}
+	//nothing is written over the files kept, they are moved again when it starts again
+	if (!legacyMoved){
+		stopThread();
+		initialized=false;
+	}
 }
 
-long ActivePersistence::getLastSentFromFile(){
+long long ActivePersistence::getLastSentFromFile(){
 	std::stringstream logMessage;
 
-	long lastSentFromFile=0;
+	long long lastSentFromFile=0;
 	if (isEnabled()){
+		if (sharedStore!=NULL){
+			sharedStore->readCursor(lastSentFromFile);
+			return lastSentFromFile;
+		}
+		if (activeCheckpoint.read(lastSentFromFile)){
+			return lastSentFromFile;
+		}
+		//control file written by older versions
 		try{
 			std::ifstream ifs (controlFilename.str().c_str(),std::ios::in);
 			boost::archive::text_iarchive controlPersistence(ifs);
@@ -152,99 +238,219 @@ long ActivePersistence::getLastSentFromFile(){
 	return 0;
 }
 
-long ActivePersistence::getNumberMessagesSerialized(){
+long long ActivePersistence::getNumberMessagesSerialized(){
+	return activeStore->getNextSequence();
+}
+
+bool ActivePersistence::migrateLegacyFile(){
 
 	std::stringstream logMessage;
-	bool moreToRead=true;
 	long position=0;
-	long localPositionInFile=0;
+	long long localPositionInFile=0;
 	ActiveMessage messageAux;
+	bool moved=true;
+
+	std::ifstream ifs(dataFilename.str().c_str(), std::ios::in | std::ios::binary );
+	if (!ifs.is_open()){
+		return true;
+	}
+	//in the old file the control file has the number of messages sent
+	long legacySent=(long)getLastSentFromFile();
+	long long firstSequence=activeStore->getNextSequence();
 	try{
-		std::ifstream ifs(dataFilename.str().c_str(), std::ios::in | std::ios::binary );
-		while (moreToRead){
-			try{
-				ifs.seekg(localPositionInFile);
-				boost::archive::binary_iarchive persistenceFile(ifs);
-				persistenceFile >> messageAux;
-				position++;
-				localPositionInFile=ifs.tellg();
-			}catch(...){
-				logMessage << "No more data to read from file.";
-				LOG4CXX_DEBUG (logger,logMessage.str().c_str());
-				moreToRead=false;
+		while (true){
+			ifs.seekg(localPositionInFile);
+			//the end of the file is only found between messages
+			if (ifs.peek()==std::char_traits<char>::eof()){
+				break;
+			}
+			boost::archive::binary_iarchive persistenceFile(ifs);
+			persistenceFile >> messageAux;
+			localPositionInFile=ifs.tellg();
+			if (position>=legacySent){
+				appendToLog(messageAux);
 			}
+			position++;
 		}
-		return position;
+		activeStore->flush();
+	}catch (ActiveException& ae){
+		logMessage << ae.getMessage();
+		moved=false;
 	}catch (...){
-		logMessage << "Error reading persistence_file. File exists? Messages cant be recovered.";
-		LOG4CXX_DEBUG (logger,logMessage.str().c_str());
-		return 0;
+		logMessage << "Message " << position << " can not be read";
+		moved=false;
 	}
-	return 0;
+	ifs.close();
+	if (moved){
+		try{
+			//control file has now the sequence of the first message moved, before the file is removed
+			lastSent=firstSequence;
+			writeCheckpoint();
+		}catch (ActiveException& ae){
+			logMessage << ae.getMessage();
+			moved=false;
+		}
+	}
+	if (!moved){
+		//the records already appended are after the sequence written when it is moved again
+		std::string reason=logMessage.str();
+		logMessage.str("");
+		logMessage << "DATA LOSS. Persistence disabled. Persistence file " << dataFilename.str()
+				<< " could not be moved to the log, it is kept to move it when the connection starts again. " << reason;
+		LOG4CXX_FATAL (logger,logMessage.str().c_str());
+		return false;
+	}
+	if (std::remove(dataFilename.str().c_str())!=0){
+		logMessage << "Persistence file " << dataFilename.str() << " moved to the log could not be removed, "
+				<< "remove it before the connection starts again or its messages are sent twice. ";
+		LOG4CXX_ERROR (logger,logMessage.str().c_str());
+		logMessage.str("");
+	}
+	logMessage << "Persistence file " << dataFilename.str() << " moved to the log, "
+			<< (activeStore->getNextSequence()-firstSequence) << " messages not sent";
+	LOG4CXX_INFO (logger,logMessage.str().c_str());
+	return true;
 }
 
 void ActivePersistence::enqueue(){
 	std::stringstream logMessage;
+	std::vector<ActiveMessage> messages;
+	std::vector<long long> sequences;
+	long long readEnd=0;
+	bool replaying=false;
+	unsigned int restored=0;
+
+	//as many messages as free space in the queue
+	long long toEnqueue=activePersistenceThread.getActiveSharedObject()->getMessagesReady();
+	if (toEnqueue>ACTIVE_REPLAY_BATCH){
+		toEnqueue=ACTIVE_REPLAY_BATCH;
+	}
+
+	replayMutex.lock();
+	persistenceMutex.lock();
 	try{
-		persistenceMutex.lock();
-		if (isEnabled()){
-			ActiveMessage messageToEnqueue;
-			if (getNextMessage(messageToEnqueue)){
-				//std::cout << "antes del deliver"<< std::endl;
-				if (activeConnection->deliver(messageToEnqueue)!=-1){
-					newMessage(false);
-					logMessage << "Message recovered from "<<getDataFilename();
-					LOG4CXX_DEBUG (logger,logMessage.str().c_str());
-				}else{
-					newMessage(false);
-					logMessage.str("DATA LOSS. Message was rejected by the queue.");
-					LOG4CXX_FATAL (logger,logMessage.str().c_str());
-				}
-				//std::cout << "despues del deliver"<< std::endl;
-			}else{
-				newMessage(false);
-				logMessage << "DATA LOSS. Error reading entry " << lastEnqueue << " from persistence file " << getDataFilename();
-				LOG4CXX_FATAL (logger,logMessage.str().c_str());
-			}
+		//out of recovery every message in the log is in the queue too
+		replaying=isEnabled() && getRecoveryMode();
+		if (replaying){
+			readBatch(toEnqueue,messages,sequences);
 		}
-		persistenceMutex.unlock();
-		//sleep to a insignificant time to try to
-		//give the processor to the producer thread to
-		//try to dont be blocked without enqueue
-		apr_sleep (1);
 	}catch (ActiveException& ae){
-		logMessage << ae.getMessage();
+		logMessage << "POSSIBLE DATA LOSS. " << ae.getMessage();
 		LOG4CXX_FATAL (logger,logMessage.str().c_str());
-		persistenceMutex.unlock();
+		logMessage.str("");
 	}catch (...){
-		logMessage << "DATA LOSS. Message was not recovered from file with "<< lastEnqueue << " from persistence file " << getDataFilename();
+		logMessage << "POSSIBLE DATA LOSS. Error reading entry " << lastEnqueue << " from persistence file " << getDataFilename();
 		LOG4CXX_FATAL (logger,logMessage.str().c_str());
+		logMessage.str("");
+	}
+	if (replaying){
+		readEnd=activeStore->getReadSequence();
+	}
+	persistenceMutex.unlock();
+
+	//enqueued without the persistence mutex and without congestion control
+	try{
+		if (!messages.empty()){
+			restored=activeConnection->replay(messages);
+		}
+	}catch (ActiveException& ae){
+		logMessage << "Messages recovered from " << getDataFilename() << " were not enqueued, they are read again. " << ae.getMessage();
+		LOG4CXX_ERROR (logger,logMessage.str().c_str());
+		logMessage.str("");
+	}
+
+	if (replaying){
+		persistenceMutex.lock();
+		recoveryReplayed+=restored;
+		replayedMessages+=restored;
+		try{
+			if (restored<messages.size()){
+				//the queue is full, the rest are read again when it has space
+				lastEnqueue=sequences[restored];
+				activeStore->seek(lastEnqueue);
+			}else{
+				lastEnqueue=readEnd;
+			}
+		}catch (ActiveException& ae){
+			logMessage << "POSSIBLE DATA LOSS. Messages not enqueued are not read again from " << getDataFilename() << ". " << ae.getMessage();
+			LOG4CXX_FATAL (logger,logMessage.str().c_str());
+			logMessage.str("");
+		}
 		persistenceMutex.unlock();
+		logMessage << restored << " messages recovered from "<<getDataFilename();
+		LOG4CXX_DEBUG (logger,logMessage.str().c_str());
+	}
+	replayMutex.unlock();
+	activePersistenceThread.messagesEnqueued(toEnqueue);
+}
+
+void ActivePersistence::readBatch(long long count, std::vector<ActiveMessage>& messages, std::vector<long long>& sequences)
+	throw (ActiveException){
+
+	std::stringstream logMessage;
+	//the position to send could not be set while its record was not written
+	if (activeStore->getReadSequence()!=lastEnqueue){
+		if (lastEnqueue>activeStore->getNextSequence()){
+			return;
+		}
+		activeStore->seek(lastEnqueue);
+	}
+	while ((long long)messages.size()<count){
+		long long sequence=activeStore->getReadSequence();
+		//records not written yet are read when the writer wakes up the thread
+		if (sequence>=activeStore->getNextSequence()){
+			break;
+		}
+		messages.push_back(ActiveMessage());
+		if (getNextMessage(messages.back())){
+			sequences.push_back(sequence);
+			continue;
+		}
+		messages.pop_back();
+		logMessage.str("");
+		logMessage << "DATA LOSS. Error reading entry " << sequence << " from persistence file " << getDataFilename() << ", it is skipped";
+		LOG4CXX_FATAL (logger,logMessage.str().c_str());
+		if (activeStore->getReadSequence()==sequence){
+			activeStore->seek(sequence+1);
+		}
 	}
 }
 
+void ActivePersistence::startReplay(){
+	recoveryStart=apr_time_now();
+	recoveryReplayed=0;
+}
+
 bool ActivePersistence::getNextMessage(ActiveMessage& activeMessageR){
 
 	std::stringstream logMessage;
 	if (isEnabled()){
 		try{
-			std::ifstream ifs(dataFilename.str().c_str(), std::ios::in | std::ios::binary );
-			ifs.seekg(positionInFile);
-			boost::archive::binary_iarchive persistenceFile(ifs);
+			if (!activeStore->read(record)){
+				return false;
+			}
+			if (!record.empty() && record[0]==ACTIVE_FRAME_RECORD){
+				decodeFrame(activeMessageR);
+				return true;
+			}
+			boost::iostreams::stream<boost::iostreams::array_source> recordStream((const char*)&record[0],record.size());
+			boost::archive::binary_iarchive persistenceFile(recordStream,boost::archive::no_header);
 			persistenceFile >> activeMessageR;
-			//persistenceFile.next_object_pointer(ifs);
-			positionInFile=ifs.tellg();
 			return true;
+		}catch (ActiveException& ae){
+			logMessage << "POSSIBLE DATA LOSS. " << ae.getMessage();
+			LOG4CXX_DEBUG (logger,logMessage.str().c_str());
+			return false;
 		}catch (boost::exception& be){
-			logMessage << "POSSIBLE DATA LOSS. Boost Exception. Message was not found in position "<<positionInFile;
+			logMessage << "POSSIBLE DATA LOSS. Boost Exception. Message was not found in position "<<activeStore->getReadSequence();
 			LOG4CXX_DEBUG (logger,logMessage.str().c_str());
 			return false;
 		}catch (boost::archive::archive_exception& be){
-			logMessage << "POSSIBLE DATA LOSS. Boost Exception. Message was not found in position "<<positionInFile << be.what();
+			logMessage << "POSSIBLE DATA LOSS. Boost Exception. Message was not found in position "<<activeStore->getReadSequence() << be.what();
 			LOG4CXX_DEBUG (logger,logMessage.str().c_str());
 			return false;
 		}catch (...){
-			logMessage << "POSSIBLE DATA LOSS. Message was not found in position "<<positionInFile;
+			logMessage << "POSSIBLE DATA LOSS. Message was not found in position "<<activeStore->getReadSequence();
 			LOG4CXX_DEBUG (logger,logMessage.str().c_str());
 			return false;
 		}
@@ -269,16 +475,27 @@ void ActivePersistence::oneMoreEnqueued(){
 void ActivePersistence::oneMoreSent (bool dequeueInRecovery){
 	std::stringstream logMessage;
 	try{
+		//the message is counted when its record is written
+		if (writeBehind){
+			activeWriterThread.waitWritten(lastSent+1);
+		}
+		//the end of the recovery is not checked while a batch is being enqueued
+		replayMutex.lock();
 		persistenceMutex.lock();
 		if (isEnabled()){
 			increaseSent();
 			if (getRecoveryMode() && dequeueInRecovery){
-				if (lastEnqueue==lastWrote){
-					logMessage << "Recovery: All data is sent. Going back to normal mode";
-					LOG4CXX_DEBUG(logger,logMessage.str().c_str());
+				if (lastEnqueue==lastWrote && writeQueue.isEmpty()){
+					apr_time_t elapsed=apr_time_now()-recoveryStart;
+					replayTime+=elapsed;
+					logMessage << "Recovery: All data is sent. Going back to normal mode. " << recoveryReplayed
+							<< " messages recovered in " << (elapsed/1000) << " ms";
+					if (elapsed>0){
+						logMessage << " (" << (recoveryReplayed*APR_USEC_PER_SEC/elapsed) << " messages/s)";
+					}
+					LOG4CXX_INFO(logger,logMessage.str().c_str());
 					setRecoveryMode(false);
 					activeConnection->setState(CONNECTION_RUNNING);
-					positionInFile=0;
 				}else if (activePersistenceThread.getActiveSharedObject()->getMessagesReady()<(lastWrote-lastEnqueue)){
 					newMessage(true);
 				}
@@ -286,8 +503,10 @@ void ActivePersistence::oneMoreSent (bool dequeueInRecovery){
 			rollFile();
 		}
 		persistenceMutex.unlock();
+		replayMutex.unlock();
 	}catch (ActiveException& ae){
 		persistenceMutex.unlock();
+		replayMutex.unlock();
 		LOG4CXX_FATAL (logger,ae.getMessage());
 	}
 }
@@ -296,41 +515,52 @@ void ActivePersistence::increaseSent()  throw (ActiveException) {
 	std::stringstream logMessage;
 
 	if (isEnabled()){
-		try{
-			lastSent++;
-			std::ofstream ofs (controlFilename.str().c_str(),std::ios::out | std::ios::trunc);
-			boost::archive::text_oarchive controlPersistence(ofs);
-			controlPersistence<< lastSent;
-			//std::cout << "wrote last sent to control file " << lastSent << std::endl;
-		}catch (...){
-			logMessage << "Unknown exception increasing control file of persistence. Disk is full?";
-			throw ActiveException(logMessage.str());
+		lastSent++;
+		if ((lastSent-lastCheckpoint>=checkpointMessages) ||
+				(checkpointTime>0 && apr_time_now()-lastCheckpointTime>=(apr_time_t)checkpointTime*1000)){
+			writeCheckpoint();
 		}
 	}
 }
 
+void ActivePersistence::writeCheckpoint() throw (ActiveException){
+	std::stringstream logMessage;
+
+	try{
+		if (sharedStore!=NULL){
+			sharedStore->writeCursor(lastSent);
+		}else{
+			activeCheckpoint.write(lastSent);
+		}
+		lastCheckpoint=lastSent;
+		lastCheckpointTime=apr_time_now();
+	}catch (ActiveException& ae){
+		logMessage << "Exception writing control file of persistence. " << ae.getMessage();
+		throw ActiveException(logMessage.str());
+	}
+}
+
 void ActivePersistence::rollFile() throw (ActiveException){
 	std::stringstream logMessage;
 
 	if (isEnabled()){
 		try{
 			//if we have the same number of messages
-			//acked and sent and the file is over the
-			//maximun size we are going to truncate
-			//the persistence file
+			//acked and sent and the last segment is over the
+			//maximun size we are going to start a new one
 			if ((lastEnqueue==lastSent) && (lastEnqueue==lastWrote)
-					&&(lastSent>=sizePersistence)){
+					&&(activeStore->getSegmentRecords()>=sizePersistence)){
 
 				logMessage << "Rolling file " << dataFilename.str().c_str() << " with last sent "<< lastSent << "and lastEnqueue "<< lastEnqueue;
 				LOG4CXX_DEBUG (logger,logMessage.str().c_str());
 
-				std::ofstream ofsData (dataFilename.str().c_str(),std::ios::out | std::ios::trunc);
-				std::ofstream ofsControl (controlFilename.str().c_str(),std::ios::out | std::ios::trunc);
-				lastSent=0;
-				lastEnqueue=0;
-				lastWrote=0;
-				positionInFile=0;
+				activeStore->roll();
 			}
+			//segments with all messages sent are deleted
+			activeStore->acknowledge(lastSent);
+		}catch (ActiveException& ae){
+			logMessage << "ERROR rolling persistence file. " << ae.getMessage();
+			throw ActiveException(logMessage.str());
 		}catch(...){
 			logMessage << "ERROR. Unknown exception rolling persistence file.";
 			throw ActiveException(logMessage.str());
@@ -342,20 +572,43 @@ int ActivePersistence::serialize (ActiveMessage& activeMessage){
 	std::stringstream logMessage;
 
 	if (isEnabled()){
+		if (writeBehind){
+			try{
+				pushToWriter(activeMessage);
+			}catch (ActiveException& ae){
+				logMessage << "POSSIBLE DATA LOSS. Error writing persistence file " << getDataFilename() << ". " << ae.getMessage();
+				LOG4CXX_FATAL (logger,logMessage.str().c_str());
+				throw ActiveException (logMessage.str());
+			}catch (...){
+				logMessage << "POSSIBLE DATA LOSS. Error serializing message for persistence file " << getDataFilename() << ". Unknown.";
+				LOG4CXX_FATAL (logger,logMessage.str().c_str());
+				throw ActiveException (logMessage.str());
+			}
+			return 0;
+		}
+		apr_time_t start=apr_time_now();
+		long long sequence=0;
 		try{
 			persistenceMutex.lock();
-			// create and open a character archive for output
-			{
-				std::ofstream ofs(dataFilename.str().c_str(), std::ios::binary | std::ios::app);
-				boost::archive::binary_oarchive persistenceFile(ofs);
-				persistenceFile << activeMessage;
-			}
-			lastWrote++;
+			appendToLog(activeMessage);
+			activeStore->flush();
+			lastWrote=activeStore->getNextSequence();
 			logMessage << "Object serialized " << " in position " << lastWrote;
 			LOG4CXX_DEBUG (logger,logMessage.str().c_str());
+			sequence=lastWrote-1;
+			if ((durability==ACTIVE_SYNC_BATCH && lastWrote-durableSequence>=syncBatch) ||
+					(durability==ACTIVE_SYNC_INTERVAL && start-lastSyncTime>=(apr_time_t)syncInterval*1000)){
+				syncStore();
+			}
 			//unlocking mutex
 			persistenceMutex.unlock();
 
+		}catch (ActiveException& ae){
+			//unlocking mutex
+			persistenceMutex.unlock();
+			logMessage << "POSSIBLE DATA LOSS. Error writing persistence file " << getDataFilename() << ". " << ae.getMessage();
+			LOG4CXX_FATAL (logger,logMessage.str().c_str());
+			throw ActiveException (logMessage.str());
 		}catch (boost::exception& be){
 			//unlocking mutex
 			persistenceMutex.unlock();
@@ -375,22 +628,244 @@ int ActivePersistence::serialize (ActiveMessage& activeMessage){
 			LOG4CXX_FATAL (logger,logMessage.str().c_str());
 			throw ActiveException (logMessage.str());
 		}
+		//the mutex is not held here, commit locks it and releases it when it fails
+		try{
+			if (durability==ACTIVE_SYNC_ALWAYS){
+				commit(sequence);
+			}
+		}catch (ActiveException& ae){
+			logMessage.str("");
+			logMessage << "POSSIBLE DATA LOSS. Error synchronizing persistence file " << getDataFilename() << ". " << ae.getMessage();
+			LOG4CXX_FATAL (logger,logMessage.str().c_str());
+			throw ActiveException (logMessage.str());
+		}
+		commitLatency.add(apr_time_now()-start);
 	}
 	return 0;
 }
 
+void ActivePersistence::syncStore() throw (ActiveException){
+	long long target=activeStore->getNextSequence();
+	if (target>durableSequence){
+		activeStore->sync();
+		syncBatchSize.add(target-durableSequence);
+		durableSequence=target;
+	}
+	lastSyncTime=apr_time_now();
+}
+
+void ActivePersistence::commit(long long sequence) throw (ActiveException){
+	//the calls that wait while other one synchronizes find their messages on disk
+	persistenceMutex.lock();
+	try{
+		if (sequence>=durableSequence){
+			syncStore();
+		}
+	}catch (ActiveException& ae){
+		persistenceMutex.unlock();
+		throw ae;
+	}
+	persistenceMutex.unlock();
+}
+
+void ActivePersistence::encode(ActiveMessage& activeMessage, std::string& recordData){
+	//text messages are not encoded to be sent, there is nothing to save
+	if (activeConnection->getPersistFrames() && !activeMessage.isTextMessage() &&
+			activeConnection->isSentAsBinary(activeMessage)){
+		encodeFrame(activeMessage,recordData);
+		return;
+	}
+	std::ostringstream recordStream;
+	{
+		boost::archive::binary_oarchive persistenceFile(recordStream,boost::archive::no_header);
+		persistenceFile << activeMessage;
+	}
+	recordData=recordStream.str();
+}
+
+void ActivePersistence::encodeFrame(ActiveMessage& activeMessage, std::string& recordData) throw (ActiveException){
+	std::vector<unsigned char> ownBody;
+	const std::vector<unsigned char>* body=activeMessage.getEncodedBody();
+	if (body==NULL){
+		ActiveMessageCodec::encodeBody(activeMessage,ownBody);
+		body=&ownBody;
+	}
+	ActiveMessageCodec encoder;
+	std::vector<unsigned char> frame;
+	unsigned int frameSize=encoder.encode(activeMessage,*body,frame);
+
+	const std::string* ids[4]={	&activeMessage.getServiceId(),&activeMessage.getLinkId(),
+								&activeMessage.getConnectionId(),&activeMessage.getCorrelationId()};
+	unsigned int size=1+4+8+1;
+	for (int it=0; it<4; it++){
+		size+=ActiveMessageCodec::varintSize(ids[it]->size())+ids[it]->size();
+	}
+
+	std::vector<unsigned char> header(size);
+	unsigned int position=0;
+	unsigned long long timeToLive=(unsigned long long)activeMessage.getTimeToLive();
+	header[position++]=ACTIVE_FRAME_RECORD;
+	ActiveMessageCodec::writeInt32(&header[0],position,(unsigned int)activeMessage.getPriority());
+	ActiveMessageCodec::writeInt32(&header[0],position,(unsigned int)(timeToLive>>32));
+	ActiveMessageCodec::writeInt32(&header[0],position,(unsigned int)timeToLive);
+	header[position++]=activeMessage.getRequestReply()?1:0;
+	for (int it=0; it<4; it++){
+		ActiveMessageCodec::writeVarint(&header[0],position,ids[it]->size());
+		memcpy(&header[position],ids[it]->data(),ids[it]->size());
+		position+=ids[it]->size();
+	}
+
+	recordData.reserve(size+frameSize);
+	recordData.assign((const char*)&header[0],size);
+	recordData.append((const char*)&frame[0],frameSize);
+}
+
+void ActivePersistence::decodeFrame(ActiveMessage& activeMessageR) throw (ActiveException){
+	const unsigned char* buffer=&record[0];
+	unsigned int size=record.size();
+	unsigned int position=1;
+
+	activeMessageR.setPriority((int)ActiveMessageCodec::readInt32(buffer,size,position));
+	unsigned long long timeToLive=ActiveMessageCodec::readInt32(buffer,size,position);
+	timeToLive=(timeToLive<<32) | ActiveMessageCodec::readInt32(buffer,size,position);
+	activeMessageR.setTimeToLive((long long)timeToLive);
+	ActiveMessageCodec::checkAvailable(size,position,1);
+	activeMessageR.setRequestReply(buffer[position++]!=0);
+	for (int it=0; it<4; it++){
+		unsigned int length=ActiveMessageCodec::readVarint(buffer,size,position);
+		ActiveMessageCodec::checkAvailable(size,position,length);
+		frameField.assign((const char*)buffer+position,length);
+		position+=length;
+		switch (it){
+		case 0: activeMessageR.setServiceId(frameField); break;
+		case 1: activeMessageR.setLinkId(frameField); break;
+		case 2: activeMessageR.setConnectionId(frameField); break;
+		default: activeMessageR.setCorrelationId(frameField); break;
+		}
+	}
+
+	if (activeConnection->getMessageFormat()!=ACTIVE_BINARY_FORMAT){
+		//the connection does not send binary messages any more
+		frameDecoder.decode(buffer+position,size-position,activeMessageR);
+		return;
+	}
+	unsigned int bodyPosition=position+frameDecoder.decodeProperties(buffer+position,size-position,activeMessageR);
+	boost::shared_ptr<std::vector<unsigned char> > body(new std::vector<unsigned char>(buffer+bodyPosition,buffer+size));
+	activeMessageR.setEncodedBody(body);
+}
+
+void ActivePersistence::appendToLog(ActiveMessage& activeMessage) throw (ActiveException){
+	std::string recordData;
+	encode(activeMessage,recordData);
+	activeStore->append((const unsigned char*)recordData.data(),recordData.size());
+}
+
+void ActivePersistence::pushToWriter(ActiveMessage& activeMessage) throw (ActiveException){
+	std::string recordData;
+	encode(activeMessage,recordData);
+	apr_time_t now=apr_time_now();
+	bool pushed=writeQueue.push(recordData,now);
+	while (!pushed){
+		//queue is full, helping the writer thread
+		activeWriterThread.wakeUp();
+		long long written=writeBatch();
+		pushed=writeQueue.push(recordData,now);
+		if (!pushed && written==0){
+			throw ActiveException("Queue of records to write is full and the log can not be written");
+		}
+	}
+	activeWriterThread.wakeUp();
+}
+
+long long ActivePersistence::writeBatch(){
+	persistenceMutex.lock();
+	long long written=writeRecords();
+	persistenceMutex.unlock();
+	return written;
+}
+
+long long ActivePersistence::writeRecords(){
+	std::stringstream logMessage;
+	std::string* recordData=NULL;
+	apr_time_t accepted=0;
+	apr_time_t oldest=0;
+	long long written=0;
+
+	try{
+		//a record is taken out of the queue when the store has it
+		while (written<ACTIVE_WRITE_BATCH && writeQueue.front(recordData,accepted)){
+			activeStore->append((const unsigned char*)recordData->data(),recordData->size());
+			writeQueue.pop();
+			if (written==0){
+				oldest=accepted;
+			}
+			written++;
+		}
+	}catch (ActiveException& ae){
+		logMessage << "Error writing persistence file " << getDataFilename() << ", records are written again later. " << ae.getMessage();
+		LOG4CXX_ERROR (logger,logMessage.str().c_str());
+	}
+	if (written>0){
+		try{
+			activeStore->flush();
+			lastWrote=activeStore->getNextSequence();
+			apr_time_t now=apr_time_now();
+			if (durability==ACTIVE_SYNC_ALWAYS ||
+					(durability==ACTIVE_SYNC_BATCH && lastWrote-durableSequence>=syncBatch) ||
+					(durability==ACTIVE_SYNC_INTERVAL && now-lastSyncTime>=(apr_time_t)syncInterval*1000)){
+				syncStore();
+			}
+			//latency of the oldest record of the batch
+			commitLatency.add(apr_time_now()-oldest);
+		}catch (ActiveException& ae){
+			logMessage << "POSSIBLE DATA LOSS. Error writing persistence file " << getDataFilename() << ". " << ae.getMessage();
+			LOG4CXX_FATAL (logger,logMessage.str().c_str());
+		}
+		//in recovery the records are read from the store, waking up the reader if it stopped
+		if (getRecoveryMode() && lastWrote>lastEnqueue && activePersistenceThread.getActiveSharedObject()->getMessagesReady()==0){
+			newMessage(true);
+		}
+		activeWriterThread.setWritten((durability==ACTIVE_SYNC_ALWAYS)?durableSequence:lastWrote);
+	}
+	return written;
+}
+
+bool ActivePersistence::isDrained(){
+	persistenceMutex.lock();
+	bool drained=!getRecoveryMode() && lastSent==lastWrote && writeQueue.isEmpty();
+	persistenceMutex.unlock();
+	return drained;
+}
+
+void ActivePersistence::flushWrites(){
+	if (writeBehind){
+		while (writeBatch()>0){
+		}
+	}
+}
+
 void ActivePersistence::deserialize (ActiveMessage& activeMessageR){
 	std::stringstream logMessage;
 
 	if (isEnabled()){
 		try{
 			persistenceMutex.lock();
-			std::ifstream ifs(dataFilename.str().c_str(), std::ios::binary );
-			boost::archive::binary_iarchive persistenceFile(ifs);
+			if (!activeStore->read(record)){
+				throw ActiveException("There are no more messages in the log");
+			}
+			boost::iostreams::stream<boost::iostreams::array_source> recordStream((const char*)&record[0],record.size());
+			boost::archive::binary_iarchive persistenceFile(recordStream,boost::archive::no_header);
 			persistenceFile >> activeMessageR;
 			//unlocking mutex
 			persistenceMutex.unlock();
 
+		}catch (ActiveException& ae){
+			//unlocking mutex
+			persistenceMutex.unlock();
+			logMessage << "POSSIBLE DATA LOSS. Error reading persistence file " << getDataFilename() << ". " << ae.getMessage();
+			LOG4CXX_FATAL (logger,logMessage.str().c_str());
+			throw ActiveException (logMessage.str());
+
 		}catch (boost::exception& be){
 			//unlocking mutex
 			persistenceMutex.unlock();
@@ -417,9 +892,14 @@ int ActivePersistence::startRecoveryMode(){
 	std::stringstream logMessage;
 	if (isEnabled()){
 		persistenceMutex.lock();
+		//the records of the writer are written before the position to send is set
+		while (writeRecords()>0){
+		}
 		setRecoveryMode(true);
+		startReplay();
 		logMessage << "Started RecoveryMode. Message could not be inserted in the queue.";
 		LOG4CXX_ERROR(logger, logMessage.str().c_str());
+		logMessage.str("");
 		//is started, now we are going to set the first position in the file to send
 		//to set the cursor to this position (is an optimization)
 		setPositionToSend();
@@ -435,40 +915,45 @@ int ActivePersistence::startRecoveryMode(){
 
 void ActivePersistence::setPositionToSend(){
 	std::stringstream logMessage;
-	long l=0;
-	ActiveMessage activeMessageAux;
 	if (isEnabled()){
 		try{
-			std::ifstream ifs(dataFilename.str().c_str(), std::ios::in | std::ios::binary );
-			for (l=0; l<lastEnqueue; l++){
-				ifs.seekg(positionInFile);
-				boost::archive::binary_iarchive persistenceFile(ifs);
-				persistenceFile >> activeMessageAux;
-				positionInFile=ifs.tellg();
+			//never past the written records, the reader seeks when they are written
+			if (lastEnqueue>activeStore->getNextSequence()){
+				logMessage << "Recovery from message "<<lastEnqueue<<" waits for the records written until "
+						<< activeStore->getNextSequence() << " in " << dataFilename.str();
+				LOG4CXX_ERROR (logger,logMessage.str().c_str());
+				return;
 			}
-			//positionInFile=ifs.tellg();
-			logMessage.str("");
-			logMessage << "Started recovery from file position "<<positionInFile << std::endl;
-			LOG4CXX_DEBUG (logger,logMessage.str().c_str());
-		}catch (boost::exception& be){
-			logMessage << "Serializing exception. POSSIBLE DATA LOSS. Imposible to positioning to the position "<<positionInFile << std::endl;
+			activeStore->seek(lastEnqueue);
+			logMessage << "Started recovery from message "<<lastEnqueue;
 			LOG4CXX_DEBUG (logger,logMessage.str().c_str());
 		}catch (ActiveException& ae){
-			logMessage << "Active exception. POSSIBLE DATA LOSS. " << ae.getMessage() << std::endl;
-			LOG4CXX_DEBUG (logger,logMessage.str().c_str());
-		}catch (boost::archive::archive_exception& stdexc){
-			logMessage << "Boost archive exception. POSSIBLE DATA LOSS. "<<dataFilename.str() << stdexc.what() << std::endl;
-			LOG4CXX_DEBUG (logger,logMessage.str().c_str());
+			logMessage << "Active exception. POSSIBLE DATA LOSS. " << ae.getMessage();
+			LOG4CXX_FATAL (logger,logMessage.str().c_str());
 		}catch (...){
-			logMessage << "Unknown exception. POSSIBLE DATA LOSS. File exists? "<<dataFilename.str() << std::endl;
-			LOG4CXX_DEBUG (logger,logMessage.str().c_str());
+			logMessage << "Unknown exception. POSSIBLE DATA LOSS. File exists? "<<dataFilename.str();
+			LOG4CXX_FATAL (logger,logMessage.str().c_str());
 		}
 	}
 }
 
 void ActivePersistence::resetFiles(){
-	std::ofstream ofsData (dataFilename.str().c_str(),std::ios::out | std::ios::trunc);
-	std::ofstream ofsControl (controlFilename.str().c_str(),std::ios::out | std::ios::trunc);
+	std::stringstream logMessage;
+	try{
+		activeStore->reset();
+	}catch (ActiveException& ae){
+		logMessage << "Error resetting persistence log. " << ae.getMessage();
+		LOG4CXX_ERROR (logger,logMessage.str().c_str());
+	}
+	lastSent=activeStore->getNextSequence();
+	lastEnqueue=lastSent;
+	lastWrote=lastSent;
+	try{
+		writeCheckpoint();
+	}catch (ActiveException& ae){
+		logMessage << "Error resetting control file. " << ae.getMessage();
+		LOG4CXX_ERROR (logger,logMessage.str().c_str());
+	}
 }
 
 bool ActivePersistence::isEnabled(){
@@ -481,9 +966,64 @@ bool ActivePersistence::isEnabled(){
 void ActivePersistence::stopThread(){
 	if (isEnabled()){
 		activePersistenceThread.stop();
+		activeWriterThread.stop();
 	}
 }
 
-ActivePersistence::~ActivePersistence() {
+void ActivePersistence::checkpoint(){
+	flushWrites();
+	try{
+		persistenceMutex.lock();
+		if (isEnabled() && durability!=ACTIVE_SYNC_NONE){
+			syncStore();
+		}
+		if (isEnabled() && lastSent!=lastCheckpoint){
+			writeCheckpoint();
+		}
+		persistenceMutex.unlock();
+	}catch (ActiveException& ae){
+		persistenceMutex.unlock();
+		LOG4CXX_ERROR (logger,ae.getMessage());
+	}
+}
 
+void ActivePersistence::syncIfDue(){
+	try{
+		persistenceMutex.lock();
+		if (isEnabled() && durability==ACTIVE_SYNC_INTERVAL &&
+				apr_time_now()-lastSyncTime>=(apr_time_t)syncInterval*1000){
+			syncStore();
+		}
+		persistenceMutex.unlock();
+	}catch (ActiveException& ae){
+		persistenceMutex.unlock();
+		LOG4CXX_ERROR (logger,ae.getMessage());
+	}
+}
+
+apr_interval_time_t ActivePersistence::getSyncWait(){
+	if (durability==ACTIVE_SYNC_INTERVAL && syncInterval>0){
+		return (apr_interval_time_t)syncInterval*1000;
+	}
+	return 0;
+}
+
+void ActivePersistence::logDurabilityStats(){
+	std::stringstream logMessage;
+
+	if (!isEnabled() || commitLatency.getCount()==0){
+		return;
+	}
+	logMessage << "Persistence " << getDataFilename() << ". Commit latency in us: " << commitLatency.toString()
+			<< ", p50 " << commitLatency.getPercentile(50) << ", p99 " << commitLatency.getPercentile(99)
+			<< ". Messages each sync to disk: " << syncBatchSize.toString();
+	LOG4CXX_INFO (logger,logMessage.str().c_str());
+}
+
+ActivePersistence::~ActivePersistence() {
+	activeWriterThread.stop();
+	checkpoint();
+	if (activeStore!=NULL){
+		delete activeStore;
+	}
 }
@@ -18,10 +18,24 @@
  *
  * @section DESCRIPTION
  *
- * Class that implements the persistence module of this library. Persistence file is
- * implemented using boost-serialization library and is written to a file per
+ * Class that implements the persistence module of this library. Messages are
+ * serialized using boost-serialization library and are written to a log per
  * connection to broker.
- * Each connection will be persisted in file persistence_file_1 for connection 1
+ * Each connection will be persisted in segments persistence_file_1.<sequence> for connection 1,
+ * or in the ring file persistence_file_1.ring if the connection uses persistencetype="ring"
+ * The first message not sent is written to control_file_1 each checkpointmessages
+ * messages or checkpointtime milliseconds, and when the connection is stopped.
+ * After a crash the messages sent since the last checkpoint are sent again: at most
+ * checkpointmessages-1, messages are never lost by the checkpoint.
+ * Messages written are synchronized to disk as durability says: never (the
+ * system writes them), each syncinterval milliseconds, each syncbatch messages
+ * or before serialize returns. In the last case the deliver calls waiting are
+ * synchronized together by the first one.
+ * With writebehind, deliver only pushes the record to a queue and a writer thread
+ * writes it; a message sent is counted when its record is written (on disk with
+ * durability always).
+ * With spill, the producer only persists messages when the queue fills, the
+ * transport is interrupted or it is closed (see ActiveProducer).
  *
  */
 
@@ -35,6 +49,13 @@
 #include "../mutex/ActiveMutex.h"
 #include "../message/ActiveMessage.h"
 #include "ActivePersistenceThread.h"
+#include "ActiveLog.h"
+#include "ActiveRingFile.h"
+#include "ActiveSharedStore.h"
+#include "ActiveCheckpoint.h"
+#include "ActiveWriterThread.h"
+#include "../queue/ActiveRecordQueue.h"
+#include "../../utils/ActiveHistogram.h"
 
 #include "log4cxx/logger.h"
 #include "log4cxx/helpers/exception.h"
@@ -53,16 +74,20 @@ namespace ai{
 		//mutex to access to files
 		ActiveMutex persistenceMutex;
 
-		//counter to know which is the last packet sent
-		long lastSent;
+		//mutex held while a batch goes from the log to the queue, so the
+		//sender does not look for the end of the recovery in the middle
+		ActiveMutex replayMutex;
 
-		//counter to know the last packet that
-		//was inserted into the queue
-		long lastEnqueue;
+		//sequence of the first message not sent
+		long long lastSent;
 
-		//counter to know which is the last registry
-		//serialized into file
-		long lastWrote;
+		//sequence of the first message not
+		//inserted into the queue
+		long long lastEnqueue;
+
+		//sequence of the next message that
+		//will be serialized into the log
+		long long lastWrote;
 
 		//var to know if we have to use persistence or not
 		bool initialized;
@@ -86,33 +111,218 @@ namespace ai{
 		ActiveConnection* activeConnection;
 
 		/**
-		 * position in file to dont have to iterate over
-		 * all entries in file
+		 * store in which messages are written, log or ring file
+		 */
+		ActiveStore* activeStore;
+
+		/**
+		 * store of the connection in a log shared with other connections, NULL
+		 * if the persistence has its own files. It is the activeStore too.
+		 */
+		ActiveSharedStore* sharedStore;
+
+		/**
+		 * buffer of the last record read from the log
+		 */
+		std::vector<unsigned char> record;
+
+		/**
+		 * decoder of the records with the message encoded as it is sent, and
+		 * string in which their fields are read
+		 */
+		ActiveMessageCodec frameDecoder;
+		std::string frameField;
+
+		/**
+		 * checkpoint in which the first message not sent is written
+		 */
+		ActiveCheckpoint activeCheckpoint;
+
+		/**
+		 * sequence written in the last checkpoint and when it was written
+		 */
+		long long lastCheckpoint;
+		apr_time_t lastCheckpointTime;
+
+		/**
+		 * messages and milliseconds after which a checkpoint is written,
+		 * 0 to not use the time
 		 */
-		long long positionInFile;
+		int checkpointMessages;
+		int checkpointTime;
 
 		/**
-		 * Method that increase the number of messages sent
+		 * when the recovery started and messages enqueued from the log since then
+		 */
+		apr_time_t recoveryStart;
+		long long recoveryReplayed;
+
+		/**
+		 * statistics of all recoveries: messages enqueued from the log and time
+		 * in microseconds spent recovering
+		 */
+		apr_uint64_t replayedMessages;
+		apr_uint64_t replayTime;
+
+		/**
+		 * when the store is synchronized to disk, and the milliseconds or
+		 * messages between synchronizations
+		 */
+		int durability;
+		int syncInterval;
+		int syncBatch;
+
+		/**
+		 * sequence of the first message not synchronized to disk, and when the
+		 * store was synchronized the last time
+		 */
+		long long durableSequence;
+		apr_time_t lastSyncTime;
+
+		/**
+		 * microseconds spent by each serialize, and messages synchronized to
+		 * disk by each synchronization
+		 */
+		ActiveHistogram commitLatency;
+		ActiveHistogram syncBatchSize;
+
+		/**
+		 * if true records are written by the writer thread, from the queue
+		 */
+		bool writeBehind;
+		ActiveRecordQueue writeQueue;
+		ActiveWriterThread activeWriterThread;
+
+		/**
+		 * Method that synchronizes the store to disk if there are messages not
+		 * synchronized. The persistence mutex must be locked.
+		 *
+		 * @throws ActiveException if the store can not be synchronized
+		 */
+		void syncStore() throw (ActiveException);
+
+		/**
+		 * Method that waits until a message is on disk. If other call has
+		 * synchronized it meanwhile, it returns without synchronizing.
+		 *
+		 * @param sequence sequence of the message
+		 *
+		 * @throws ActiveException if the store can not be synchronized
+		 */
+		void commit(long long sequence) throw (ActiveException);
+
+		/**
+		 * Method that increase the number of messages sent, writing a checkpoint
+		 * if there are enough messages or time since the last one.
 		 *
 		 * @throws ActiveException if something bad happens.
 		 */
 		void increaseSent() throw (ActiveException);
 
+		/**
+		 * Method that writes the first message not sent to the checkpoint
+		 *
+		 * @throws ActiveException if the checkpoint can not be written
+		 */
+		void writeCheckpoint() throw (ActiveException);
+
 		/**
 		 * Method that sets the next position to send. Use the
-		 * lastSent to set the position to it.
+		 * lastEnqueue to set the position to it. If that record is not
+		 * written yet the position is set by the next batch read.
 		 */
 		void setPositionToSend();
 
 		/**
-		 * Method that gets the nextMessage to the actual position
-		 * of the cursor positionInFile
+		 * Method that gets the next message of the log to enqueue
 		 *
 		 * @param activeMessageR message in which message read from file is
 		 * going to be stored.
 		 */
 		bool getNextMessage(ActiveMessage& activeMessageR);
 
+		/**
+		 * Method that reads from the log the next messages to replay, up to the
+		 * last record written. A record that can not be read is skipped. The
+		 * persistence mutex must be locked.
+		 *
+		 * @param count max number of messages to read
+		 * @param messages where the messages read are added
+		 * @param sequences where the sequence of each message read is added
+		 *
+		 * @throws ActiveException if the reader can not skip a record
+		 */
+		void readBatch(long long count, std::vector<ActiveMessage>& messages, std::vector<long long>& sequences)
+			throw (ActiveException);
+
+		/**
+		 * Method that writes to the store a batch of the records pushed by
+		 * deliver, with the persistence mutex already locked
+		 *
+		 * @return number of records written
+		 */
+		long long writeRecords();
+
+		/**
+		 * Method that serializes a message and appends it to the log
+		 *
+		 * @param activeMessage message that is going to be serialized.
+		 *
+		 * @throws ActiveException if the log can not be written
+		 */
+		void appendToLog(ActiveMessage& activeMessage) throw (ActiveException);
+
+		/**
+		 * Method that serializes a message into a record
+		 *
+		 * @param activeMessage message that is going to be serialized.
+		 * @param recordData string in which the record is stored
+		 */
+		void encode(ActiveMessage& activeMessage, std::string& recordData);
+
+		/**
+		 * Method that stores a message in a record encoded as it is sent: mark,
+		 * priority, time to live, request reply, service, link, connection and
+		 * correlation ids, and the message encoded with its body shared. The
+		 * body already encoded for other connections is used if it is set.
+		 *
+		 * @param activeMessage message that is going to be stored
+		 * @param recordData string in which the record is stored
+		 *
+		 * @throws ActiveException if the message can not be encoded
+		 */
+		void encodeFrame(ActiveMessage& activeMessage, std::string& recordData) throw (ActiveException);
+
+		/**
+		 * Method that reads a record written by encodeFrame. If the connection
+		 * sends binary messages only the properties are decoded and the body is
+		 * kept encoded to be sent as it is, if not the whole message is decoded.
+		 *
+		 * @param activeMessageR message where data is inserted
+		 *
+		 * @throws ActiveException if the record is not valid
+		 */
+		void decodeFrame(ActiveMessage& activeMessageR) throw (ActiveException);
+
+		/**
+		 * Method that serializes a message and pushes it to the queue of the
+		 * writer thread. If the queue is full this thread writes records too.
+		 *
+		 * @param activeMessage message that is going to be serialized.
+		 *
+		 * @throws ActiveException if the queue is full and records can not be written
+		 */
+		void pushToWriter(ActiveMessage& activeMessage) throw (ActiveException);
+
+		/**
+		 * Method that moves the messages not sent of a persistence file written
+		 * by older versions, a file with all messages, to the log. The file and
+		 * its control file are only replaced when all of them are in the log.
+		 *
+		 * @return false if the file is kept because it could not be moved
+		 */
+		bool migrateLegacyFile();
+
 	public:
 
 		/**
@@ -138,16 +348,16 @@ namespace ai{
 		/**
 		 *	Method that gets the last sent from control_file file.
 		 *
-		 *	@return long The number of the last message sent
+		 *	@return long long The sequence of the first message not sent
 		 */
-		long getLastSentFromFile();
+		long long getLastSentFromFile();
 
 		/**
-		 *	Method that returns the number of messages serialized
+		 *	Method that returns the sequence of the next message serialized
 		 *
-		 *	@return the number of messages that are serialized into the file.
+		 *	@return the sequence that will be given to the next message written into the log.
 		 */
-		long getNumberMessagesSerialized();
+		long long getNumberMessagesSerialized();
 
 		/**
 		 * method that increase the number of the last
@@ -161,10 +371,18 @@ namespace ai{
 
 		/**
 		 *	Method that is invoked by the thread and enqueue data into the
-		 *	connection queue.
+		 *	connection queue. It enqueues a batch of messages, as many as the
+		 *	free space that the queue has. The batch is read with the persistence
+		 *	mutex locked and enqueued without it and without congestion control,
+		 *	so serialize is not stopped by the replay.
 		 */
 		void enqueue();
 
+		/**
+		 * Method that starts measuring the rate of a recovery
+		 */
+		void startReplay();
+
 		/**
 		 *	Method that gets the message stored in file in position lastEnqueued.
 		 *
@@ -195,9 +413,9 @@ namespace ai{
 		long getSizePersistenceFile();
 
 		/**
-		 *	Method that is invoked every sent and that checks if the number of
-		 *	messages that are stored in persistence file are more than the specified
-		 *	If messagesStored>persistence then the persistence file is truncated.
+		 *	Method that is invoked every sent and deletes the segments of the log
+		 *	whose messages are all sent. If all messages are sent and the last segment
+		 *	stores more messages than the specified, a new segment is started.
 		 *
 		 *	@throws ActiveException if something bad happens
 		 */
@@ -211,7 +429,7 @@ namespace ai{
 		int serialize(ActiveMessage& activeMessage);
 
 		/**
-		 *	Method that deserializes a message from the file
+		 *	Method that deserializes the next message from the log
 		 *
 		 *	@param activeMessage message that is going to be deserialized from file
 		 */
@@ -229,7 +447,7 @@ namespace ai{
 		int startRecoveryMode();
 
 		/**
-		 *	Method that reset control and persistence files.
+		 *	Method that reset control file and persistence log.
 		 */
 		void resetFiles();
 
@@ -238,6 +456,60 @@ namespace ai{
 		 */
 		void stopThread();
 
+		/**
+		 * Method that writes a checkpoint if messages were sent since the last
+		 * one. It is invoked when the connection is stopped.
+		 */
+		void checkpoint();
+
+		/**
+		 * Method that synchronizes the store to disk if the interval of the
+		 * durability has passed. It is invoked by the persistence thread.
+		 */
+		void syncIfDue();
+
+		/**
+		 * Method that returns how much the persistence thread can wait before
+		 * invoking syncIfDue
+		 *
+		 * @return microseconds to wait, 0 to wait for messages only
+		 */
+		apr_interval_time_t getSyncWait();
+
+		/**
+		 * Method that logs the histograms of the commit latency and of the
+		 * messages synchronized each time
+		 */
+		void logDurabilityStats();
+
+		/**
+		 * Method that writes to the store a batch of the records pushed by
+		 * deliver. It is invoked by the writer thread.
+		 *
+		 * @return number of records written
+		 */
+		long long writeBatch();
+
+		/**
+		 * Method to know if there are records pushed by deliver not written yet
+		 *
+		 * @return true if there are records waiting
+		 */
+		bool hasPendingWrites(){ return !writeQueue.isEmpty();}
+
+		/**
+		 * Method that writes all the records pushed by deliver, in the thread
+		 * that invokes it
+		 */
+		void flushWrites();
+
+		/**
+		 * Method to know if all the messages persisted are sent
+		 *
+		 * @return true if there are no messages persisted waiting
+		 */
+		bool isDrained();
+
 		/**
 		 *	Default destructor
 		 */
@@ -252,6 +524,11 @@ namespace ai{
 		long getSizePersistence(){return sizePersistence;}
 		void setSizePersistence(long sizePersistenceR){sizePersistence=sizePersistenceR;}
 		bool getRecoveryMode (){return recoveryMode;}
+		apr_uint64_t getReplayedMessages (){return replayedMessages;}
+		apr_uint64_t getReplayTime (){return replayTime;}
+		ActiveHistogram& getCommitLatency (){return commitLatency;}
+		ActiveHistogram& getSyncBatchSize (){return syncBatchSize;}
+		bool isWriteBehind (){return writeBehind;}
 		void setRecoveryMode(bool recoveryModeR){recoveryMode=recoveryModeR;}
 	};
 }
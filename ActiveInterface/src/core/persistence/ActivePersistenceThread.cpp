@@ -70,9 +70,17 @@ static void* APR_THREAD_FUNC persistenceThread(apr_thread_t *thd, void *data){
 		mySharedObject->setRunningThread();
 
 		while(true){
+			//with a durability interval the thread wakes up to synchronize the store
+			apr_interval_time_t syncWait=myActivePersistence->getSyncWait();
 			apr_thread_mutex_lock(mySharedObject->getMutex());
 			while (mySharedObject->getMessagesReady() == 0 && !mySharedObject->getEndThread()) {
-				apr_thread_cond_wait(mySharedObject->getCond(), mySharedObject->getMutex());
+				if (syncWait>0){
+					if (apr_thread_cond_timedwait(mySharedObject->getCond(), mySharedObject->getMutex(), syncWait)==APR_TIMEUP){
+						break;
+					}
+				}else{
+					apr_thread_cond_wait(mySharedObject->getCond(), mySharedObject->getMutex());
+				}
 			}
 			if (mySharedObject->getEndThread()){
 				apr_thread_mutex_unlock(mySharedObject->getMutex());
@@ -81,6 +89,7 @@ static void* APR_THREAD_FUNC persistenceThread(apr_thread_t *thd, void *data){
 
 			apr_thread_mutex_unlock(mySharedObject->getMutex());
 
+			myActivePersistence->syncIfDue();
 			if (mySharedObject->getMessagesReady()>0){
 				//std::cout << "antes del enqueue persistence" << std::endl;
 				myActivePersistence->enqueue();
@@ -122,6 +131,18 @@ void ActivePersistenceThread::newMessage(bool received){
 	}
 }
 
+void ActivePersistenceThread::messagesEnqueued(long long count){
+
+	try{
+		apr_thread_mutex_lock(activeSharedObject.getMutex());
+		activeSharedObject.setMessagesReady(activeSharedObject.getMessagesReady()-count);
+		apr_thread_cond_signal(activeSharedObject.getCond());
+		apr_thread_mutex_unlock(activeSharedObject.getMutex());
+	}catch (...){
+		throw ActiveException ("Unknown exception with semaphore in persistence queue.");
+	}
+}
+
 void ActivePersistenceThread::endThread(){
 	apr_thread_mutex_lock(activeSharedObject.getMutex());
 	activeSharedObject.setEndThread();
@@ -137,6 +137,14 @@ namespace ai{
 		 */
 		void newMessage(bool receive);
 
+		/**
+		 * Method that decrements the number of messages pending to send by the
+		 * thread after a batch of them is enqueued.
+		 *
+		 * @param count number of messages enqueued
+		 */
+		void messagesEnqueued(long long count);
+
 		/**
 		 * Method to end the thread
 		 */
@@ -0,0 +1,139 @@
+/**
+ * @file
+ * @author  Oscar Pernas <oscar@pernas.es>
+ * @version 1.2.3
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * Threads that start the persistence of the connections when the library
+ * starts, and write their snapshots when it is closed.
+ */
+
+#include "ActiveRecoveryPool.h"
+#include "../ActiveManager.h"
+
+using namespace log4cxx;
+using namespace log4cxx::helpers;
+using namespace ai;
+
+LoggerPtr ActiveRecoveryPool::logger(Logger::getLogger("ActiveRecoveryPool"));
+
+ActiveRecoveryPool::ActiveRecoveryPool(){
+	mp=NULL;
+	thd_attr=NULL;
+	nextConnection=0;
+	recovered=0;
+	stopping=false;
+	snapshot=false;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////
+//// thread that recovers connections
+///////////////////////////////////////////////////////////////////////////////////////////
+static void* APR_THREAD_FUNC recoveryThread(apr_thread_t *thd, void *data){
+
+	if (data){
+		ActiveRecoveryPool* myRecoveryPool=(ActiveRecoveryPool*)data;
+		ActiveConnection* activeConnection=NULL;
+
+		while ((activeConnection=myRecoveryPool->takeConnection())!=NULL){
+			myRecoveryPool->process(activeConnection);
+		}
+		apr_thread_exit(thd, APR_SUCCESS);
+		return NULL;
+	}else{
+		std::cout << "Recovery thread can not start." << std::endl;
+		return NULL;
+	}
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int ActiveRecoveryPool::start(const std::vector<ActiveConnection*>& connectionsR, int threadsR, bool snapshotR){
+	std::stringstream logMessage;
+
+	recoveryMutex.lock();
+	connections=connectionsR;
+	nextConnection=0;
+	recovered=0;
+	stopping=false;
+	snapshot=snapshotR;
+	recoveryMutex.unlock();
+
+	if (mp==NULL){
+		apr_pool_create(&mp, NULL);
+		apr_threadattr_create(&thd_attr, mp);
+	}
+
+	int started=0;
+	for (int i=0; i<threadsR && (unsigned int)i<connectionsR.size(); i++){
+		apr_thread_t* thread=NULL;
+		if (apr_thread_create(&thread, thd_attr, recoveryThread, (void*)this, mp)==APR_SUCCESS){
+			threads.push_back(thread);
+			started++;
+		}
+	}
+	logMessage << (snapshotR?"Writing snapshots of ":"Recovering ") << connectionsR.size() << " connections with " << started << " threads";
+	LOG4CXX_DEBUG (logger,logMessage.str().c_str());
+	return started;
+}
+
+ActiveConnection* ActiveRecoveryPool::takeConnection(){
+	ActiveConnection* activeConnection=NULL;
+	recoveryMutex.lock();
+	if (!stopping && nextConnection<connections.size()){
+		activeConnection=connections[nextConnection++];
+	}
+	recoveryMutex.unlock();
+	return activeConnection;
+}
+
+void ActiveRecoveryPool::process(ActiveConnection* activeConnection){
+	if (snapshot){
+		activeConnection->takeSnapshot();
+	}else{
+		activeConnection->startPersistence();
+		connectionRecovered(activeConnection);
+	}
+}
+
+void ActiveRecoveryPool::connectionRecovered(ActiveConnection* activeConnection){
+	recoveryMutex.lock();
+	int recoveredNow=++recovered;
+	int total=connections.size();
+	recoveryMutex.unlock();
+	ActiveManager::getInstance()->onConnectionRecoveredCallback(activeConnection->getId(),recoveredNow,total);
+}
+
+void ActiveRecoveryPool::join(bool stop){
+	apr_status_t rv;
+
+	if (stop){
+		recoveryMutex.lock();
+		stopping=true;
+		recoveryMutex.unlock();
+	}
+	for (unsigned int i=0; i<threads.size(); i++){
+		apr_thread_join(&rv, threads[i]);
+	}
+	threads.clear();
+}
+
+ActiveRecoveryPool::~ActiveRecoveryPool(){
+	join(true);
+	if (mp!=NULL){
+		apr_pool_destroy(mp);
+	}
+}
@@ -0,0 +1,153 @@
+/**
+ * @file
+ * @author  Oscar Pernas <oscar@pernas.es>
+ * @version 1.2.3
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * Threads that start the persistence of the connections when the library
+ * starts, so the logs of several connections are opened and scanned at the
+ * same time. A connection whose persistence is started can be used while
+ * the others are still recovering; a message delivered to a connection not
+ * started yet starts it and waits for it. The manager is told when each
+ * connection is recovered.
+ * When the library is closed the same threads write the snapshots of the
+ * connections without persistence.
+ */
+
+#ifndef ACTIVERECOVERYPOOL_H_
+#define ACTIVERECOVERYPOOL_H_
+
+#include <vector>
+
+#include <apr_general.h>
+#include <apr_thread_proc.h>
+
+#include "log4cxx/logger.h"
+#include "log4cxx/helpers/exception.h"
+
+#include "../ActiveConnection.h"
+#include "../mutex/ActiveMutex.h"
+
+namespace ai{
+
+	class ActiveRecoveryPool {
+	private:
+
+		/**
+		 * APR pool to manage threads
+		 */
+		apr_pool_t *mp;
+
+		/**
+		 * APR pointer to pass atts to the threads
+		 */
+		apr_threadattr_t *thd_attr;
+
+		/**
+		 * APR pointers to the real threads
+		 */
+		std::vector<apr_thread_t*> threads;
+
+		/**
+		 * Connections to recover, and position of the next one
+		 */
+		std::vector<ActiveConnection*> connections;
+		unsigned int nextConnection;
+
+		/**
+		 * Number of connections recovered
+		 */
+		int recovered;
+
+		/**
+		 * Flag to stop taking connections
+		 */
+		bool stopping;
+
+		/**
+		 * If true the threads write the snapshots of the connections instead
+		 * of starting their persistence
+		 */
+		bool snapshot;
+
+		/**
+		 * Mutex that protects the connections and the counters
+		 */
+		ActiveMutex recoveryMutex;
+
+		/**
+		 * Static var use by log4cxx for the logging system
+		 */
+		static log4cxx::LoggerPtr logger;
+
+	public:
+
+		/**
+		 * Default constructor
+		 */
+		ActiveRecoveryPool();
+
+		/**
+		 * Method that starts the threads, they end when all connections are
+		 * recovered
+		 *
+		 * @param connectionsR connections to recover
+		 * @param threadsR max number of threads
+		 * @param snapshotR true to write the snapshots of the connections
+		 *
+		 * @return number of threads started
+		 */
+		int start(const std::vector<ActiveConnection*>& connectionsR, int threadsR, bool snapshotR=false);
+
+		/**
+		 * Method that returns the next connection to recover
+		 *
+		 * @return the connection or NULL if there are no more
+		 */
+		ActiveConnection* takeConnection();
+
+		/**
+		 * Method invoked by a thread with each connection taken, it recovers the
+		 * connection or writes its snapshot
+		 *
+		 * @param activeConnection connection taken
+		 */
+		void process(ActiveConnection* activeConnection);
+
+		/**
+		 * Method invoked by a thread when it has recovered a connection
+		 *
+		 * @param activeConnection connection recovered
+		 */
+		void connectionRecovered(ActiveConnection* activeConnection);
+
+		/**
+		 * Method that waits for the threads. With stop the connections not
+		 * taken yet are not recovered.
+		 *
+		 * @param stop true to not take more connections
+		 */
+		void join(bool stop);
+
+		/**
+		 * Default destructor
+		 */
+		virtual ~ActiveRecoveryPool();
+	};
+}
+
+#endif /* ACTIVERECOVERYPOOL_H_ */
@@ -0,0 +1,368 @@
+/**
+ * @file
+ * @author  Oscar Pernas <oscar@pernas.es>
+ * @version 1.2.3
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * Store of the persistence in a ring file mapped in memory.
+ */
+
+#include "ActiveRingFile.h"
+#include "../../utils/defines.h"
+#include "../../utils/ActiveCrc32c.h"
+
+#include <cstring>
+
+#ifdef _WIN32
+ #include <windows.h>
+#else
+ #include <sys/mman.h>
+ #include <unistd.h>
+#endif
+
+using namespace log4cxx;
+using namespace log4cxx::helpers;
+using namespace ai;
+
+LoggerPtr ActiveRingFile::logger(Logger::getLogger("ActiveRingFile"));
+
+//bytes before the data of each record: length and sequence, and checksum from version 2
+#define RING_RECORD_HEADER 12
+#define RING_RECORD_CHECKSUM 4
+
+ActiveRingFile::ActiveRingFile(){
+	pool=NULL;
+	file=NULL;
+	map=NULL;
+	header=NULL;
+	data=NULL;
+	firstSequence=0;
+	nextSequence=0;
+	readPosition=0;
+	readSequence=0;
+	syncPosition=0;
+	recordHeader=RING_RECORD_HEADER+RING_RECORD_CHECKSUM;
+}
+
+void ActiveRingFile::copyIn(apr_uint64_t position, const void* bytes, apr_uint64_t size){
+	apr_uint64_t offset=position%header->capacity;
+	apr_uint64_t first=(size<header->capacity-offset)?size:header->capacity-offset;
+	memcpy(data+offset,bytes,first);
+	if (first<size){
+		memcpy(data,(const unsigned char*)bytes+first,size-first);
+	}
+}
+
+void ActiveRingFile::copyOut(apr_uint64_t position, void* bytes, apr_uint64_t size){
+	apr_uint64_t offset=position%header->capacity;
+	apr_uint64_t first=(size<header->capacity-offset)?size:header->capacity-offset;
+	memcpy(bytes,data+offset,first);
+	if (first<size){
+		memcpy((unsigned char*)bytes+first,data,size-first);
+	}
+}
+
+void ActiveRingFile::recordAt(apr_uint64_t position, apr_uint32_t& length, long long& sequence){
+	copyOut(position,&length,4);
+	copyOut(position+4,&sequence,8);
+}
+
+bool ActiveRingFile::checkRecord(apr_uint64_t position, apr_uint32_t length){
+	if (recordHeader==RING_RECORD_HEADER){
+		return true;
+	}
+	unsigned char prefix[RING_RECORD_HEADER];
+	apr_uint32_t checksum=0;
+	copyOut(position,prefix,RING_RECORD_HEADER);
+	copyOut(position+RING_RECORD_HEADER,&checksum,RING_RECORD_CHECKSUM);
+	apr_uint32_t crc=ActiveCrc32c::compute(prefix,RING_RECORD_HEADER);
+	//the data can be in two parts, at the end and at the beginning of the ring
+	apr_uint64_t offset=(position+recordHeader)%header->capacity;
+	apr_uint64_t first=(length<header->capacity-offset)?length:header->capacity-offset;
+	crc=ActiveCrc32c::extend(crc,data+offset,(size_t)first);
+	if (first<length){
+		crc=ActiveCrc32c::extend(crc,data,(size_t)(length-first));
+	}
+	return crc==checksum;
+}
+
+void ActiveRingFile::syncMap(apr_uint64_t offset, apr_uint64_t size) throw (ActiveException){
+	unsigned char* base=(unsigned char*)map->mm;
+#ifdef _WIN32
+	if (FlushViewOfFile(base+offset,(SIZE_T)size)==0){
+		throw ActiveException("ActiveRingFile. Error synchronizing the file "+path);
+	}
+#else
+	//msync needs an address aligned to the page
+	apr_uint64_t pageSize=(apr_uint64_t)sysconf(_SC_PAGESIZE);
+	apr_uint64_t start=offset-(offset%pageSize);
+	if (msync(base+start,(size_t)(size+offset-start),MS_SYNC)!=0){
+		throw ActiveException("ActiveRingFile. Error synchronizing the file "+path);
+	}
+#endif
+}
+
+void ActiveRingFile::create(unsigned int capacity) throw (ActiveException){
+	std::stringstream logMessage;
+	apr_file_t* newFile=NULL;
+
+	if (apr_file_open(&newFile,path.c_str(),APR_FOPEN_WRITE | APR_FOPEN_CREATE | APR_FOPEN_TRUNCATE | APR_FOPEN_BINARY,
+			APR_OS_DEFAULT,pool)!=APR_SUCCESS){
+		throw ActiveException("ActiveRingFile. Impossible to create the file "+path);
+	}
+	//header page and all the space written, so the disk can not be full later
+	std::vector<unsigned char> block(65536,0);
+	RingHeader newHeader;
+	memset(&newHeader,0,sizeof(newHeader));
+	memcpy(newHeader.magic,ACTIVE_RING_MAGIC,4);
+	newHeader.version=ACTIVE_RING_VERSION;
+	newHeader.capacity=capacity;
+	memcpy(&block[0],&newHeader,sizeof(newHeader));
+	apr_status_t status=apr_file_write_full(newFile,&block[0],ACTIVE_RING_HEADER_SIZE,NULL);
+	memset(&block[0],0,sizeof(newHeader));
+	for (apr_uint64_t written=0; written<capacity && status==APR_SUCCESS; written+=block.size()){
+		apr_uint64_t size=(capacity-written<block.size())?capacity-written:block.size();
+		status=apr_file_write_full(newFile,&block[0],(apr_size_t)size,NULL);
+	}
+	apr_file_close(newFile);
+	if (status!=APR_SUCCESS){
+		apr_file_remove(path.c_str(),pool);
+		throw ActiveException("ActiveRingFile. Error creating the file "+path+". Disk is full?");
+	}
+	logMessage << "Ring file "<<path<<" created with "<<capacity<<" bytes";
+	LOG4CXX_DEBUG(logger,logMessage.str().c_str());
+}
+
+void ActiveRingFile::open(const std::string& baseNameR, unsigned int sizeR) throw (ActiveException){
+	std::stringstream logMessage;
+
+	close();
+	path=baseNameR+".ring";
+	apr_pool_create(&pool,NULL);
+
+	apr_finfo_t info;
+	if (apr_stat(&info,path.c_str(),APR_FINFO_SIZE,pool)!=APR_SUCCESS || info.size<ACTIVE_RING_HEADER_SIZE){
+		create(sizeR);
+	}
+	if (apr_file_open(&file,path.c_str(),APR_FOPEN_READ | APR_FOPEN_WRITE | APR_FOPEN_BINARY,APR_OS_DEFAULT,pool)!=APR_SUCCESS){
+		file=NULL;
+		close();
+		throw ActiveException("ActiveRingFile. Impossible to open the file "+path);
+	}
+	apr_file_info_get(&info,APR_FINFO_SIZE,file);
+	if (apr_mmap_create(&map,file,0,(apr_size_t)info.size,APR_MMAP_READ | APR_MMAP_WRITE,pool)!=APR_SUCCESS){
+		map=NULL;
+		close();
+		throw ActiveException("ActiveRingFile. Impossible to map the file "+path);
+	}
+	header=(RingHeader*)map->mm;
+	data=(unsigned char*)map->mm+ACTIVE_RING_HEADER_SIZE;
+	if (memcmp(header->magic,ACTIVE_RING_MAGIC,4)!=0 || header->version<1 || header->version>ACTIVE_RING_VERSION ||
+			header->capacity+ACTIVE_RING_HEADER_SIZE!=(apr_uint64_t)info.size || header->tail-header->head>header->capacity){
+		close();
+		throw ActiveException("ActiveRingFile. Not valid header in the file "+path);
+	}
+	if (header->capacity!=sizeR){
+		logMessage << "Ring file "<<path<<" keeps its size of "<<header->capacity<<" bytes";
+		LOG4CXX_INFO(logger,logMessage.str().c_str());
+		logMessage.str("");
+	}
+	//records of a ring of version 1 have no checksum, it is added once the ring is empty
+	if (header->version<ACTIVE_RING_CHECKSUM_VERSION && header->head==header->tail){
+		header->version=ACTIVE_RING_VERSION;
+		logMessage << "Ring file "<<path<<" of an older version is empty, it is written with checksums from now on";
+		LOG4CXX_INFO(logger,logMessage.str().c_str());
+		logMessage.str("");
+	}
+	recordHeader=(header->version>=ACTIVE_RING_CHECKSUM_VERSION)?RING_RECORD_HEADER+RING_RECORD_CHECKSUM:RING_RECORD_HEADER;
+
+	//checking the records from the first one not acknowledged
+	apr_uint64_t position=header->head;
+	long long records=0;
+	nextSequence=(long long)header->nextSequence;
+	firstSequence=nextSequence;
+	while (position<header->tail){
+		apr_uint32_t length=0;
+		long long sequence=0;
+		if (header->tail-position<recordHeader){
+			break;
+		}
+		recordAt(position,length,sequence);
+		if (position+recordHeader+length>header->tail || (records>0 && sequence!=nextSequence) ||
+				!checkRecord(position,length)){
+			break;
+		}
+		if (records==0){
+			firstSequence=sequence;
+		}
+		nextSequence=sequence+1;
+		position+=recordHeader+length;
+		records++;
+	}
+	if (position!=header->tail){
+		logMessage << "POSSIBLE DATA LOSS. Discarding "<<(header->tail-position)<<" bytes not complete or with a wrong checksum at the end of the ring "<<path;
+		LOG4CXX_ERROR(logger,logMessage.str().c_str());
+		logMessage.str("");
+		header->tail=position;
+	}
+	header->nextSequence=nextSequence;
+	readPosition=header->head;
+	readSequence=firstSequence;
+	syncPosition=header->tail;
+
+	logMessage << "Ring file "<<path<<" opened with records from "<<firstSequence<<" to "<<nextSequence;
+	LOG4CXX_DEBUG(logger,logMessage.str().c_str());
+}
+
+long long ActiveRingFile::append(const unsigned char* dataR, unsigned int size) throw (ActiveException){
+	std::stringstream logMessage;
+
+	if (header==NULL){
+		throw ActiveException("ActiveRingFile. File "+path+" is not open");
+	}
+	apr_uint64_t tail=header->tail;
+	if (tail-header->head+recordHeader+size>header->capacity){
+		logMessage << "ActiveRingFile. Ring "<<path<<" is full, "<<(tail-header->head)<<" bytes of "
+				<<header->capacity<<" used by messages not sent";
+		throw ActiveException(logMessage.str());
+	}
+	apr_uint32_t length=size;
+	unsigned char prefix[RING_RECORD_HEADER];
+	memcpy(prefix,&length,4);
+	memcpy(prefix+4,&nextSequence,8);
+	copyIn(tail,prefix,RING_RECORD_HEADER);
+	if (recordHeader>RING_RECORD_HEADER){
+		apr_uint32_t checksum=ActiveCrc32c::extend(ActiveCrc32c::compute(prefix,RING_RECORD_HEADER),dataR,size);
+		copyIn(tail+RING_RECORD_HEADER,&checksum,RING_RECORD_CHECKSUM);
+	}
+	copyIn(tail+recordHeader,dataR,size);
+	header->nextSequence=nextSequence+1;
+	//the record is visible now
+	header->tail=tail+recordHeader+size;
+	return nextSequence++;
+}
+
+void ActiveRingFile::sync() throw (ActiveException){
+	if (header!=NULL && syncPosition<header->tail){
+		apr_uint64_t offset=syncPosition%header->capacity;
+		apr_uint64_t size=header->tail-syncPosition;
+		if (size>=header->capacity){
+			syncMap(ACTIVE_RING_HEADER_SIZE,header->capacity);
+		}else if (offset+size<=header->capacity){
+			syncMap(ACTIVE_RING_HEADER_SIZE+offset,size);
+		}else{
+			syncMap(ACTIVE_RING_HEADER_SIZE+offset,header->capacity-offset);
+			syncMap(ACTIVE_RING_HEADER_SIZE,size-(header->capacity-offset));
+		}
+		//cursors after the records
+		syncMap(0,sizeof(RingHeader));
+		syncPosition=header->tail;
+	}
+}
+
+void ActiveRingFile::seek(long long sequence) throw (ActiveException){
+	std::stringstream logMessage;
+
+	if (header==NULL || sequence<firstSequence || sequence>nextSequence){
+		logMessage << "ActiveRingFile. Record "<<sequence<<" is not in the ring "<<path;
+		throw ActiveException(logMessage.str());
+	}
+	if (sequence<readSequence || readSequence<firstSequence){
+		readPosition=header->head;
+		readSequence=firstSequence;
+	}
+	while (readSequence<sequence){
+		apr_uint32_t length=0;
+		long long recordSequence=0;
+		recordAt(readPosition,length,recordSequence);
+		readPosition+=recordHeader+length;
+		readSequence++;
+	}
+}
+
+bool ActiveRingFile::read(std::vector<unsigned char>& record) throw (ActiveException){
+	std::stringstream logMessage;
+
+	if (header==NULL || readSequence>=nextSequence){
+		return false;
+	}
+	if (readSequence<firstSequence){
+		seek(readSequence);
+	}
+	apr_uint32_t length=0;
+	long long sequence=0;
+	recordAt(readPosition,length,sequence);
+	if (sequence!=readSequence){
+		logMessage << "ActiveRingFile. Record "<<readSequence<<" not valid in the ring "<<path;
+		throw ActiveException(logMessage.str());
+	}
+	if (!checkRecord(readPosition,length)){
+		logMessage << "ActiveRingFile. Wrong checksum of the record "<<readSequence<<" in the ring "<<path;
+		throw ActiveException(logMessage.str());
+	}
+	record.resize(length);
+	if (length>0){
+		copyOut(readPosition+recordHeader,&record[0],length);
+	}
+	readPosition+=recordHeader+length;
+	readSequence++;
+	return true;
+}
+
+void ActiveRingFile::acknowledge(long long sequence){
+	if (header!=NULL){
+		apr_uint64_t head=header->head;
+		while (firstSequence<sequence && firstSequence<nextSequence){
+			apr_uint32_t length=0;
+			long long recordSequence=0;
+			recordAt(head,length,recordSequence);
+			head+=recordHeader+length;
+			firstSequence++;
+		}
+		header->head=head;
+	}
+}
+
+void ActiveRingFile::reset() throw (ActiveException){
+	if (header!=NULL){
+		header->head=header->tail;
+		firstSequence=nextSequence;
+		readPosition=header->tail;
+		readSequence=nextSequence;
+	}
+}
+
+void ActiveRingFile::close(){
+	if (map!=NULL){
+		apr_mmap_delete(map);
+		map=NULL;
+	}
+	header=NULL;
+	data=NULL;
+	if (file!=NULL){
+		apr_file_close(file);
+		file=NULL;
+	}
+	if (pool!=NULL){
+		apr_pool_destroy(pool);
+		pool=NULL;
+	}
+}
+
+ActiveRingFile::~ActiveRingFile(){
+	close();
+}
@@ -0,0 +1,277 @@
+/**
+ * @file
+ * @author  Oscar Pernas <oscar@pernas.es>
+ * @version 1.2.3
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * Store of the persistence in a ring file of fixed size, <base>.ring, created
+ * with all its space and mapped in memory. The first page has the cursors of
+ * the ring; records are copied after it and the space of the records
+ * acknowledged is used again. When the ring is full new records are rejected.
+ * Each record: length (4) | sequence (8) | checksum (4) | data, in the byte
+ * order of the machine. The checksum is the CRC32C of the length, the
+ * sequence and the data; rings of version 1 have records without it.
+ *
+ * A record is visible when the write cursor is moved after it. If the
+ * process dies while the record is copied, the map still has the cursor
+ * before it and the record is not found. If the system crashes or the power
+ * is lost, the pages of the map not synchronized are written in any order:
+ * the header with the cursor can reach the disk before the record. The
+ * checksum finds such a record when the ring is opened, and it is discarded
+ * with the ones after it. Only the records written before the last sync are
+ * sure to be on disk.
+ */
+
+#ifndef ACTIVERINGFILE_H_
+#define ACTIVERINGFILE_H_
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "apr_general.h"
+#include "apr_pools.h"
+#include "apr_file_io.h"
+#include "apr_mmap.h"
+
+#include "../../utils/exception/ActiveException.h"
+#include "ActiveStore.h"
+
+#include "log4cxx/logger.h"
+
+namespace ai{
+
+	class ActiveRingFile : public ActiveStore {
+	private:
+
+		/**
+		 * Header of the ring, at the beginning of the file. Positions are
+		 * counted from the creation of the ring, the offset in the ring is
+		 * position % capacity.
+		 */
+		struct RingHeader {
+			char magic[4];
+			apr_uint32_t version;
+			apr_uint64_t capacity;
+			//position of the first record not acknowledged
+			apr_uint64_t head;
+			//position in which the next record is written
+			apr_uint64_t tail;
+			//sequence of the next record, used when the ring is empty
+			apr_uint64_t nextSequence;
+		};
+
+		/**
+		 * Path of the file
+		 */
+		std::string path;
+
+		/**
+		 * Pool, file and its map in memory
+		 */
+		apr_pool_t* pool;
+		apr_file_t* file;
+		apr_mmap_t* map;
+
+		/**
+		 * Header and data of the ring, in the map
+		 */
+		RingHeader* header;
+		unsigned char* data;
+
+		/**
+		 * Sequences of the first record not acknowledged and of the next record
+		 */
+		long long firstSequence;
+		long long nextSequence;
+
+		/**
+		 * Position and sequence of the next record that will be read
+		 */
+		apr_uint64_t readPosition;
+		long long readSequence;
+
+		/**
+		 * Position from which records are not synchronized to disk yet
+		 */
+		apr_uint64_t syncPosition;
+
+		/**
+		 * Bytes before the data of each record, without checksum in rings of
+		 * version 1
+		 */
+		apr_uint64_t recordHeader;
+
+		//static var for logger
+		static log4cxx::LoggerPtr logger;
+
+		/**
+		 * Methods that copy bytes into and from the ring, in two parts if they
+		 * reach the end of it
+		 *
+		 * @param position position in the ring
+		 * @param bytes bytes copied
+		 * @param size number of bytes
+		 */
+		void copyIn(apr_uint64_t position, const void* bytes, apr_uint64_t size);
+		void copyOut(apr_uint64_t position, void* bytes, apr_uint64_t size);
+
+		/**
+		 * Method that reads the header of the record in a position
+		 *
+		 * @param position position of the record
+		 * @param length length of the data of the record
+		 * @param sequence sequence of the record
+		 */
+		void recordAt(apr_uint64_t position, apr_uint32_t& length, long long& sequence);
+
+		/**
+		 * Method that checks the checksum of the record in a position. Records
+		 * of rings of version 1 have no checksum and are always valid.
+		 *
+		 * @param position position of the record
+		 * @param length length of the data of the record
+		 *
+		 * @return true if the checksum is the one stored in the record
+		 */
+		bool checkRecord(apr_uint64_t position, apr_uint32_t length);
+
+		/**
+		 * Method that synchronizes to disk a part of the map
+		 *
+		 * @param offset offset in the map
+		 * @param size number of bytes
+		 *
+		 * @throws ActiveException if it can not be synchronized
+		 */
+		void syncMap(apr_uint64_t offset, apr_uint64_t size) throw (ActiveException);
+
+		/**
+		 * Method that creates the file with all its space
+		 *
+		 * @param capacity size of the data of the ring
+		 *
+		 * @throws ActiveException if the file can not be created
+		 */
+		void create(unsigned int capacity) throw (ActiveException);
+
+	public:
+
+		/**
+		 * Default constructor
+		 */
+		ActiveRingFile();
+
+		/**
+		 * Method that opens the ring, creating it if it does not exist. If it
+		 * exists it keeps its size. The records are checked from the first one
+		 * not acknowledged, with their checksum; the one not valid and the ones
+		 * after it are discarded. An empty ring of version 1 is written with
+		 * checksums from now on.
+		 *
+		 * @param baseNameR name of the ring, the file is <baseNameR>.ring
+		 * @param sizeR size in bytes of the data of the ring
+		 *
+		 * @throws ActiveException if the file can not be opened or mapped
+		 */
+		void open(const std::string& baseNameR, unsigned int sizeR) throw (ActiveException);
+
+		/**
+		 * Method that copies a record into the ring
+		 *
+		 * @param dataR bytes of the record
+		 * @param size number of bytes
+		 *
+		 * @return sequence of the record
+		 *
+		 * @throws ActiveException if the ring is full
+		 */
+		long long append(const unsigned char* dataR, unsigned int size) throw (ActiveException);
+
+		/**
+		 * Nothing to do, the records are in the map
+		 */
+		void flush() throw (ActiveException){}
+
+		/**
+		 * Method that synchronizes to disk the records appended and the header
+		 *
+		 * @throws ActiveException if they can not be synchronized
+		 */
+		void sync() throw (ActiveException);
+
+		/**
+		 * Method that sets the next record that will be read
+		 *
+		 * @param sequence sequence of the record
+		 *
+		 * @throws ActiveException if the record is not in the ring
+		 */
+		void seek(long long sequence) throw (ActiveException);
+
+		/**
+		 * Method that reads the next record
+		 *
+		 * @param record vector in which the record is stored
+		 *
+		 * @return false if there are no more records
+		 *
+		 * @throws ActiveException if the record can not be read or its checksum
+		 * is wrong
+		 */
+		bool read(std::vector<unsigned char>& record) throw (ActiveException);
+
+		/**
+		 * Method that frees the space of the records before a sequence
+		 *
+		 * @param sequence first record that is not acknowledged
+		 */
+		void acknowledge(long long sequence);
+
+		/**
+		 * Nothing to do, the space is used again
+		 */
+		void roll() throw (ActiveException){}
+
+		/**
+		 * Method that frees the space of all the records
+		 */
+		void reset() throw (ActiveException);
+
+		/**
+		 * Method that closes the ring. The records not synchronized are written
+		 * to disk by the system.
+		 */
+		void close();
+
+		/**
+		 * Default destructor
+		 */
+		virtual ~ActiveRingFile();
+
+		/////////////////////////////////////////////////////////////////
+		//Setters & getters
+		long long getFirstSequence(){return firstSequence;}
+		long long getNextSequence(){return nextSequence;}
+		long long getReadSequence(){return readSequence;}
+		long long getSegmentRecords(){return 0;}
+		apr_uint64_t getCapacity(){return (header==NULL)?0:header->capacity;}
+		apr_uint64_t getUsedBytes(){return (header==NULL)?0:header->tail-header->head;}
+	};
+}
+
+#endif /* ACTIVERINGFILE_H_ */
@@ -0,0 +1,334 @@
+/**
+ * @file
+ * @author  Oscar Pernas <oscar@pernas.es>
+ * @version 1.2.3
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * Log of the persistence shared by several connections.
+ */
+
+#include "ActiveSharedLog.h"
+#include "../../utils/defines.h"
+
+#include <cstring>
+
+using namespace log4cxx;
+using namespace log4cxx::helpers;
+using namespace ai;
+
+LoggerPtr ActiveSharedLog::logger(Logger::getLogger("ActiveSharedLog"));
+
+/**
+ * Functions that write and read numbers of the header of a record, big endian
+ */
+static void encodeNumber(unsigned char* buffer, unsigned long long number, int size){
+	for (int i=size-1; i>=0; i--){
+		buffer[i]=(unsigned char)number;
+		number>>=8;
+	}
+}
+
+static unsigned long long decodeNumber(const unsigned char* buffer, int size){
+	unsigned long long number=0;
+	for (int i=0; i<size; i++){
+		number=(number<<8) | buffer[i];
+	}
+	return number;
+}
+
+ActiveSharedLog::ActiveSharedLog(){
+}
+
+void ActiveSharedLog::open(const std::string& baseNameR, unsigned int segmentSizeR) throw (ActiveException){
+	std::stringstream logMessage;
+
+	sharedLogMutex.lock();
+	try{
+		activeLog.open(baseNameR,segmentSizeR);
+
+		//finding the records of each connection
+		unsigned char type=0;
+		std::string connectionId;
+		long long sequence=0;
+		if (activeLog.getFirstSequence()<activeLog.getNextSequence()){
+			activeLog.seek(activeLog.getFirstSequence());
+		}
+		while (activeLog.read(readRecord)){
+			long long position=activeLog.getReadSequence()-1;
+			try{
+				readHeader(type,connectionId,sequence);
+			}catch (ActiveException& ae){
+				logMessage << "Record " << position << " of the log " << baseNameR << " skipped. " << ae.getMessage();
+				LOG4CXX_ERROR(logger,logMessage.str().c_str());
+				logMessage.str("");
+				continue;
+			}
+			Cursor& cursor=getCursor(connectionId);
+			if (type==ACTIVE_SHARED_CURSOR){
+				cursor.sent=sequence;
+			}else{
+				if (cursor.positions.empty()){
+					cursor.firstSequence=sequence;
+				}
+				cursor.positions.push_back(position);
+				cursor.nextSequence=sequence+1;
+			}
+		}
+
+		//records before the cursor were sent
+		for (std::map<std::string,Cursor>::iterator it=cursors.begin(); it!=cursors.end(); ++it){
+			Cursor& cursor=(*it).second;
+			while (!cursor.positions.empty() && cursor.firstSequence<cursor.sent){
+				cursor.positions.pop_front();
+				cursor.firstSequence++;
+			}
+			if (cursor.positions.empty() && cursor.sent>cursor.nextSequence){
+				cursor.nextSequence=cursor.sent;
+			}
+			if (cursor.positions.empty()){
+				cursor.firstSequence=cursor.nextSequence;
+			}
+			logMessage << "Connection " << (*it).first << " has " << cursor.positions.size()
+					<< " records not sent in the log " << baseNameR;
+			LOG4CXX_DEBUG(logger,logMessage.str().c_str());
+			logMessage.str("");
+		}
+		collect();
+	}catch (ActiveException& ae){
+		sharedLogMutex.unlock();
+		throw ae;
+	}
+	sharedLogMutex.unlock();
+}
+
+ActiveSharedLog::Cursor& ActiveSharedLog::getCursor(const std::string& connectionId){
+	std::map<std::string,Cursor>::iterator it=cursors.find(connectionId);
+	if (it!=cursors.end()){
+		return (*it).second;
+	}
+	Cursor& cursor=cursors[connectionId];
+	cursor.firstSequence=0;
+	cursor.nextSequence=0;
+	cursor.sent=-1;
+	return cursor;
+}
+
+long long ActiveSharedLog::appendRecord(	unsigned char type,
+											const std::string& connectionId,
+											long long sequence,
+											const unsigned char* data,
+											unsigned int size)
+	throw (ActiveException){
+
+	unsigned int headerSize=1+4+connectionId.size()+8;
+	writeRecord.resize(headerSize+size);
+	unsigned char* buffer=&writeRecord[0];
+	buffer[0]=type;
+	encodeNumber(buffer+1,connectionId.size(),4);
+	memcpy(buffer+5,connectionId.data(),connectionId.size());
+	encodeNumber(buffer+5+connectionId.size(),(unsigned long long)sequence,8);
+	if (size>0){
+		memcpy(buffer+headerSize,data,size);
+	}
+	return activeLog.append(buffer,writeRecord.size());
+}
+
+unsigned int ActiveSharedLog::readHeader(unsigned char& type, std::string& connectionId, long long& sequence)
+	throw (ActiveException){
+
+	if (readRecord.size()<5){
+		throw ActiveException("ActiveSharedLog. Record truncated.");
+	}
+	type=readRecord[0];
+	unsigned int length=(unsigned int)decodeNumber(&readRecord[1],4);
+	if (length>readRecord.size()-5 || readRecord.size()-5-length<8){
+		throw ActiveException("ActiveSharedLog. Record truncated.");
+	}
+	if (type!=ACTIVE_SHARED_DATA && type!=ACTIVE_SHARED_CURSOR){
+		throw ActiveException("ActiveSharedLog. Unknown type of record.");
+	}
+	connectionId.assign((const char*)&readRecord[5],length);
+	sequence=(long long)decodeNumber(&readRecord[5+length],8);
+	return 5+length+8;
+}
+
+void ActiveSharedLog::writeCursors() throw (ActiveException){
+	for (std::map<std::string,Cursor>::iterator it=cursors.begin(); it!=cursors.end(); ++it){
+		appendRecord(ACTIVE_SHARED_CURSOR,(*it).first,(*it).second.firstSequence,NULL,0);
+		(*it).second.sent=(*it).second.firstSequence;
+	}
+}
+
+void ActiveSharedLog::collect(){
+	//first record that some connection has not acknowledged
+	long long sequence=activeLog.getNextSequence();
+	for (std::map<std::string,Cursor>::iterator it=cursors.begin(); it!=cursors.end(); ++it){
+		if (!(*it).second.positions.empty() && (*it).second.positions.front()<sequence){
+			sequence=(*it).second.positions.front();
+		}
+	}
+	activeLog.acknowledge(sequence);
+}
+
+long long ActiveSharedLog::append(const std::string& connectionId, const unsigned char* data, unsigned int size)
+	throw (ActiveException){
+
+	sharedLogMutex.lock();
+	try{
+		Cursor& cursor=getCursor(connectionId);
+		long long sequence=cursor.nextSequence;
+		cursor.positions.push_back(appendRecord(ACTIVE_SHARED_DATA,connectionId,sequence,data,size));
+		cursor.nextSequence++;
+		//a new segment has the cursors, the old ones can be deleted
+		if (activeLog.getSegmentRecords()==1){
+			writeCursors();
+		}
+		sharedLogMutex.unlock();
+		return sequence;
+	}catch (ActiveException& ae){
+		sharedLogMutex.unlock();
+		throw ae;
+	}
+}
+
+void ActiveSharedLog::flush() throw (ActiveException){
+	sharedLogMutex.lock();
+	try{
+		activeLog.flush();
+	}catch (ActiveException& ae){
+		sharedLogMutex.unlock();
+		throw ae;
+	}
+	sharedLogMutex.unlock();
+}
+
+void ActiveSharedLog::sync() throw (ActiveException){
+	sharedLogMutex.lock();
+	try{
+		activeLog.sync();
+	}catch (ActiveException& ae){
+		sharedLogMutex.unlock();
+		throw ae;
+	}
+	sharedLogMutex.unlock();
+}
+
+bool ActiveSharedLog::read(const std::string& connectionId, long long sequence, std::vector<unsigned char>& record)
+	throw (ActiveException){
+
+	sharedLogMutex.lock();
+	try{
+		Cursor& cursor=getCursor(connectionId);
+		if (sequence<cursor.firstSequence || sequence>=cursor.nextSequence){
+			sharedLogMutex.unlock();
+			return false;
+		}
+		long long position=cursor.positions[sequence-cursor.firstSequence];
+
+		//records of other connections near the one wanted are read instead of seeking
+		long long readSequence=activeLog.getReadSequence();
+		if (readSequence<activeLog.getFirstSequence() || position<readSequence ||
+				position-readSequence>ACTIVE_SHARED_SKIP){
+			activeLog.seek(position);
+		}else{
+			while (activeLog.getReadSequence()<position){
+				activeLog.read(readRecord);
+			}
+		}
+		if (!activeLog.read(readRecord)){
+			throw ActiveException("ActiveSharedLog. Record not found in the log.");
+		}
+
+		unsigned char type=0;
+		std::string recordConnection;
+		long long recordSequence=0;
+		unsigned int dataPosition=readHeader(type,recordConnection,recordSequence);
+		if (type!=ACTIVE_SHARED_DATA || recordSequence!=sequence || recordConnection!=connectionId){
+			throw ActiveException("ActiveSharedLog. Record of the log is not the one expected.");
+		}
+		record.assign(readRecord.begin()+dataPosition,readRecord.end());
+	}catch (ActiveException& ae){
+		sharedLogMutex.unlock();
+		throw ae;
+	}
+	sharedLogMutex.unlock();
+	return true;
+}
+
+void ActiveSharedLog::acknowledge(const std::string& connectionId, long long sequence){
+	sharedLogMutex.lock();
+	Cursor& cursor=getCursor(connectionId);
+	while (!cursor.positions.empty() && cursor.firstSequence<sequence){
+		cursor.positions.pop_front();
+		cursor.firstSequence++;
+	}
+	collect();
+	sharedLogMutex.unlock();
+}
+
+void ActiveSharedLog::writeCursor(const std::string& connectionId, long long sequence) throw (ActiveException){
+	sharedLogMutex.lock();
+	try{
+		Cursor& cursor=getCursor(connectionId);
+		appendRecord(ACTIVE_SHARED_CURSOR,connectionId,sequence,NULL,0);
+		cursor.sent=sequence;
+		if (activeLog.getSegmentRecords()==1){
+			writeCursors();
+		}
+		activeLog.flush();
+	}catch (ActiveException& ae){
+		sharedLogMutex.unlock();
+		throw ae;
+	}
+	sharedLogMutex.unlock();
+}
+
+bool ActiveSharedLog::readCursor(const std::string& connectionId, long long& sequence){
+	bool found=false;
+	sharedLogMutex.lock();
+	std::map<std::string,Cursor>::iterator it=cursors.find(connectionId);
+	if (it!=cursors.end() && (*it).second.sent>=0){
+		sequence=(*it).second.sent;
+		found=true;
+	}
+	sharedLogMutex.unlock();
+	return found;
+}
+
+long long ActiveSharedLog::getFirstSequence(const std::string& connectionId){
+	sharedLogMutex.lock();
+	long long sequence=getCursor(connectionId).firstSequence;
+	sharedLogMutex.unlock();
+	return sequence;
+}
+
+long long ActiveSharedLog::getNextSequence(const std::string& connectionId){
+	sharedLogMutex.lock();
+	long long sequence=getCursor(connectionId).nextSequence;
+	sharedLogMutex.unlock();
+	return sequence;
+}
+
+void ActiveSharedLog::close(){
+	sharedLogMutex.lock();
+	activeLog.close();
+	sharedLogMutex.unlock();
+}
+
+ActiveSharedLog::~ActiveSharedLog(){
+	close();
+}
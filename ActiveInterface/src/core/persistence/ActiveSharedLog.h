@@ -0,0 +1,254 @@
+/**
+ * @file
+ * @author  Oscar Pernas <oscar@pernas.es>
+ * @version 1.2.3
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * Log of the persistence shared by several connections, so the disk writes
+ * one file sequentially instead of a file for each connection. It is an
+ * ActiveLog whose records are tagged with the connection:
+ * type (1) | length of the id (4, big endian) | id | sequence (8, big endian) | data.
+ * Each connection has its own sequences. A record of type cursor has the
+ * first sequence not sent of the connection, it replaces its control file;
+ * the cursors of all connections are written again at the beginning of each
+ * segment so they are not lost when old segments are deleted. A segment is
+ * deleted when all connections have acknowledged its records.
+ * The log is opened once, reading all its records to find the records of
+ * each connection. It is thread safe.
+ */
+
+#ifndef ACTIVESHAREDLOG_H_
+#define ACTIVESHAREDLOG_H_
+
+#include <deque>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../../utils/exception/ActiveException.h"
+#include "../mutex/ActiveMutex.h"
+#include "ActiveLog.h"
+
+#include "log4cxx/logger.h"
+
+namespace ai{
+
+	class ActiveSharedLog {
+	private:
+
+		/**
+		 * Records of a connection: sequences of the first record not
+		 * acknowledged and of the next record, and positions in the log of
+		 * the records not acknowledged
+		 */
+		struct Cursor {
+			long long firstSequence;
+			long long nextSequence;
+			std::deque<long long> positions;
+			//first sequence not sent found in the log, -1 if there is none
+			long long sent;
+		};
+
+		/**
+		 * Log in which the records are written
+		 */
+		ActiveLog activeLog;
+
+		/**
+		 * Records of each connection, by its id
+		 */
+		std::map<std::string,Cursor> cursors;
+
+		/**
+		 * Buffers of the record written and of the record read
+		 */
+		std::vector<unsigned char> writeRecord;
+		std::vector<unsigned char> readRecord;
+
+		/**
+		 * Mutex that protects the log, it is used by all connections
+		 */
+		ActiveMutex sharedLogMutex;
+
+		//static var for logger
+		static log4cxx::LoggerPtr logger;
+
+		/**
+		 * Method that appends a record of a connection to the log
+		 *
+		 * @param type type of the record, data or cursor
+		 * @param connectionId connection of the record
+		 * @param sequence sequence of the record in the connection
+		 * @param data bytes of the record
+		 * @param size number of bytes
+		 *
+		 * @return position of the record in the log
+		 *
+		 * @throws ActiveException if the record can not be appended
+		 */
+		long long appendRecord(	unsigned char type,
+								const std::string& connectionId,
+								long long sequence,
+								const unsigned char* data,
+								unsigned int size)
+			throw (ActiveException);
+
+		/**
+		 * Method that reads the header of the last record read
+		 *
+		 * @param type type of the record
+		 * @param connectionId connection of the record
+		 * @param sequence sequence of the record in the connection
+		 *
+		 * @return position in the record where the data starts
+		 *
+		 * @throws ActiveException if the record is not valid
+		 */
+		unsigned int readHeader(unsigned char& type, std::string& connectionId, long long& sequence)
+			throw (ActiveException);
+
+		/**
+		 * Method that writes the cursors of all connections
+		 *
+		 * @throws ActiveException if they can not be written
+		 */
+		void writeCursors() throw (ActiveException);
+
+		/**
+		 * Method that deletes the segments acknowledged by all connections
+		 */
+		void collect();
+
+		/**
+		 * Method that returns the cursor of a connection, it is created if
+		 * the log has not records of it
+		 *
+		 * @param connectionId id of the connection
+		 */
+		Cursor& getCursor(const std::string& connectionId);
+
+	public:
+
+		/**
+		 * Default constructor
+		 */
+		ActiveSharedLog();
+
+		/**
+		 * Method that opens the log and reads all its records to find the
+		 * records and the cursor of each connection
+		 *
+		 * @param baseNameR name of the log
+		 * @param segmentSizeR max size in bytes of a segment
+		 *
+		 * @throws ActiveException if the log can not be opened
+		 */
+		void open(const std::string& baseNameR, unsigned int segmentSizeR) throw (ActiveException);
+
+		/**
+		 * Method that appends a record of a connection. It is buffered until
+		 * flush is invoked.
+		 *
+		 * @param connectionId connection of the record
+		 * @param data bytes of the record
+		 * @param size number of bytes
+		 *
+		 * @return sequence of the record in the connection
+		 *
+		 * @throws ActiveException if the record can not be appended
+		 */
+		long long append(const std::string& connectionId, const unsigned char* data, unsigned int size)
+			throw (ActiveException);
+
+		/**
+		 * Method that writes the records appended by all connections
+		 *
+		 * @throws ActiveException if the records can not be written
+		 */
+		void flush() throw (ActiveException);
+
+		/**
+		 * Method that writes the records appended by all connections and
+		 * synchronizes them to disk
+		 *
+		 * @throws ActiveException if the records can not be synchronized
+		 */
+		void sync() throw (ActiveException);
+
+		/**
+		 * Method that reads a record of a connection
+		 *
+		 * @param connectionId connection of the record
+		 * @param sequence sequence of the record in the connection
+		 * @param record vector in which the data of the record is stored
+		 *
+		 * @return false if the connection has not this record
+		 *
+		 * @throws ActiveException if the record can not be read
+		 */
+		bool read(const std::string& connectionId, long long sequence, std::vector<unsigned char>& record)
+			throw (ActiveException);
+
+		/**
+		 * Method that frees the records of a connection before a sequence,
+		 * the segments acknowledged by all connections are deleted
+		 *
+		 * @param connectionId connection of the records
+		 * @param sequence first record that is not acknowledged
+		 */
+		void acknowledge(const std::string& connectionId, long long sequence);
+
+		/**
+		 * Method that writes the first sequence not sent of a connection
+		 *
+		 * @param connectionId id of the connection
+		 * @param sequence first sequence not sent
+		 *
+		 * @throws ActiveException if the cursor can not be written
+		 */
+		void writeCursor(const std::string& connectionId, long long sequence) throw (ActiveException);
+
+		/**
+		 * Method that reads the first sequence not sent of a connection
+		 *
+		 * @param connectionId id of the connection
+		 * @param sequence sequence read
+		 *
+		 * @return false if the log has not a cursor of the connection
+		 */
+		bool readCursor(const std::string& connectionId, long long& sequence);
+
+		/**
+		 * Method that writes pending records and closes the log
+		 */
+		void close();
+
+		/**
+		 * Default destructor
+		 */
+		virtual ~ActiveSharedLog();
+
+		/////////////////////////////////////////////////////////////////
+		//getters
+		long long getFirstSequence(const std::string& connectionId);
+		long long getNextSequence(const std::string& connectionId);
+		unsigned int getNumberSegments(){return activeLog.getNumberSegments();}
+	};
+}
+
+#endif /* ACTIVESHAREDLOG_H_ */
@@ -0,0 +1,96 @@
+/**
+ * @file
+ * @author  Oscar Pernas <oscar@pernas.es>
+ * @version 1.2.3
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * Store of the persistence of a connection in a log shared with other
+ * connections.
+ */
+
+#include "ActiveSharedStore.h"
+
+using namespace log4cxx;
+using namespace log4cxx::helpers;
+using namespace ai;
+
+LoggerPtr ActiveSharedStore::logger(Logger::getLogger("ActiveSharedStore"));
+
+ActiveSharedStore::ActiveSharedStore(ActiveSharedLog& activeSharedLogR, const std::string& connectionIdR){
+	activeSharedLog=&activeSharedLogR;
+	connectionId=connectionIdR;
+	readSequence=0;
+}
+
+void ActiveSharedStore::open(const std::string& baseNameR, unsigned int sizeR) throw (ActiveException){
+	readSequence=getFirstSequence();
+}
+
+long long ActiveSharedStore::append(const unsigned char* data, unsigned int size) throw (ActiveException){
+	return activeSharedLog->append(connectionId,data,size);
+}
+
+void ActiveSharedStore::flush() throw (ActiveException){
+	activeSharedLog->flush();
+}
+
+void ActiveSharedStore::sync() throw (ActiveException){
+	activeSharedLog->sync();
+}
+
+void ActiveSharedStore::seek(long long sequence) throw (ActiveException){
+	std::stringstream logMessage;
+
+	if (sequence<getFirstSequence() || sequence>getNextSequence()){
+		logMessage << "ActiveSharedStore. Record "<<sequence<<" of the connection "<<connectionId<<" is not in the log";
+		throw ActiveException(logMessage.str());
+	}
+	readSequence=sequence;
+}
+
+bool ActiveSharedStore::read(std::vector<unsigned char>& record) throw (ActiveException){
+	if (!activeSharedLog->read(connectionId,readSequence,record)){
+		return false;
+	}
+	readSequence++;
+	return true;
+}
+
+void ActiveSharedStore::acknowledge(long long sequence){
+	activeSharedLog->acknowledge(connectionId,sequence);
+}
+
+void ActiveSharedStore::reset() throw (ActiveException){
+	activeSharedLog->acknowledge(connectionId,getNextSequence());
+	readSequence=getNextSequence();
+}
+
+void ActiveSharedStore::close(){
+	try{
+		activeSharedLog->flush();
+	}catch (ActiveException& ae){
+		LOG4CXX_ERROR(logger,ae.getMessage());
+	}
+}
+
+void ActiveSharedStore::writeCursor(long long sequence) throw (ActiveException){
+	activeSharedLog->writeCursor(connectionId,sequence);
+}
+
+bool ActiveSharedStore::readCursor(long long& sequence){
+	return activeSharedLog->readCursor(connectionId,sequence);
+}
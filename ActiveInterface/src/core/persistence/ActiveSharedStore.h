@@ -0,0 +1,179 @@
+/**
+ * @file
+ * @author  Oscar Pernas <oscar@pernas.es>
+ * @version 1.2.3
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * Store of the persistence of a connection in a log shared with other
+ * connections. The checkpoint of the connection is written in the log too.
+ */
+
+#ifndef ACTIVESHAREDSTORE_H_
+#define ACTIVESHAREDSTORE_H_
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../../utils/exception/ActiveException.h"
+#include "ActiveStore.h"
+#include "ActiveSharedLog.h"
+
+#include "log4cxx/logger.h"
+
+namespace ai{
+
+	class ActiveSharedStore : public ActiveStore {
+	private:
+
+		/**
+		 * Log in which the records are written, it is not owned by the store
+		 */
+		ActiveSharedLog* activeSharedLog;
+
+		/**
+		 * Id of the connection, the records are tagged with it
+		 */
+		std::string connectionId;
+
+		/**
+		 * Sequence of the next record that will be read
+		 */
+		long long readSequence;
+
+		//static var for logger
+		static log4cxx::LoggerPtr logger;
+
+	public:
+
+		/**
+		 * Constructor
+		 *
+		 * @param activeSharedLogR log opened by the manager
+		 * @param connectionIdR id of the connection
+		 */
+		ActiveSharedStore(ActiveSharedLog& activeSharedLogR, const std::string& connectionIdR);
+
+		/**
+		 * Nothing to open, the log was opened by the manager
+		 */
+		void open(const std::string& baseNameR, unsigned int sizeR) throw (ActiveException);
+
+		/**
+		 * Method that appends a record of the connection
+		 *
+		 * @param data bytes of the record
+		 * @param size number of bytes
+		 *
+		 * @return sequence of the record
+		 *
+		 * @throws ActiveException if the record can not be appended
+		 */
+		long long append(const unsigned char* data, unsigned int size) throw (ActiveException);
+
+		/**
+		 * Method that writes the records appended to the log, of all connections
+		 *
+		 * @throws ActiveException if the records can not be written
+		 */
+		void flush() throw (ActiveException);
+
+		/**
+		 * Method that synchronizes the log to disk, with the records of all
+		 * connections
+		 *
+		 * @throws ActiveException if the log can not be synchronized
+		 */
+		void sync() throw (ActiveException);
+
+		/**
+		 * Method that sets the next record that will be read
+		 *
+		 * @param sequence sequence of the record
+		 *
+		 * @throws ActiveException if the record is not in the log
+		 */
+		void seek(long long sequence) throw (ActiveException);
+
+		/**
+		 * Method that reads the next record of the connection
+		 *
+		 * @param record vector in which the record is stored
+		 *
+		 * @return false if there are no more records
+		 *
+		 * @throws ActiveException if the record can not be read
+		 */
+		bool read(std::vector<unsigned char>& record) throw (ActiveException);
+
+		/**
+		 * Method that frees the records before a sequence
+		 *
+		 * @param sequence first record that is not acknowledged
+		 */
+		void acknowledge(long long sequence);
+
+		/**
+		 * Nothing to do, the log starts a new segment when it is full
+		 */
+		void roll() throw (ActiveException){}
+
+		/**
+		 * Method that frees all the records of the connection
+		 */
+		void reset() throw (ActiveException);
+
+		/**
+		 * Method that writes the records appended, the log is closed by the
+		 * manager
+		 */
+		void close();
+
+		/**
+		 * Method that writes the first sequence not sent, instead of the
+		 * control file
+		 *
+		 * @param sequence first sequence not sent
+		 *
+		 * @throws ActiveException if it can not be written
+		 */
+		void writeCursor(long long sequence) throw (ActiveException);
+
+		/**
+		 * Method that reads the first sequence not sent
+		 *
+		 * @param sequence sequence read
+		 *
+		 * @return false if it was not written
+		 */
+		bool readCursor(long long& sequence);
+
+		/**
+		 * Default destructor
+		 */
+		virtual ~ActiveSharedStore(){}
+
+		/////////////////////////////////////////////////////////////////
+		//getters
+		long long getFirstSequence(){return activeSharedLog->getFirstSequence(connectionId);}
+		long long getNextSequence(){return activeSharedLog->getNextSequence(connectionId);}
+		long long getReadSequence(){return readSequence;}
+		long long getSegmentRecords(){return 0;}
+	};
+}
+
+#endif /* ACTIVESHAREDSTORE_H_ */
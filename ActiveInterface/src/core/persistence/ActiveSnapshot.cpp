@@ -0,0 +1,175 @@
+/**
+ * @file
+ * @author  Oscar Pernas <oscar@pernas.es>
+ * @version 1.2.3
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * Snapshot of the messages in memory of a connection without persistence.
+ */
+
+#include <boost/archive/binary_oarchive.hpp>
+#include <boost/archive/binary_iarchive.hpp>
+#include <boost/iostreams/device/array.hpp>
+#include <boost/iostreams/stream.hpp>
+
+#include "ActiveSnapshot.h"
+#include "../../utils/defines.h"
+#include "../../utils/ActiveCrc32c.h"
+
+#include <cstring>
+
+using namespace log4cxx;
+using namespace log4cxx::helpers;
+using namespace ai;
+
+LoggerPtr ActiveSnapshot::logger(Logger::getLogger("ActiveSnapshot"));
+
+/**
+ * Functions that write and read the numbers of the header of a record, big endian
+ */
+static void encodeNumber(unsigned char* buffer, apr_uint32_t number){
+	buffer[0]=(unsigned char)(number>>24);
+	buffer[1]=(unsigned char)(number>>16);
+	buffer[2]=(unsigned char)(number>>8);
+	buffer[3]=(unsigned char)number;
+}
+
+static apr_uint32_t decodeNumber(const unsigned char* buffer){
+	return ((apr_uint32_t)buffer[0]<<24) | ((apr_uint32_t)buffer[1]<<16) |
+			((apr_uint32_t)buffer[2]<<8) | (apr_uint32_t)buffer[3];
+}
+
+void ActiveSnapshot::write(const std::string& path, const std::vector<ActiveMessage>& messages) throw (ActiveException){
+	apr_pool_t* pool=NULL;
+	apr_file_t* file=NULL;
+	std::string temporaryPath=path+".tmp";
+
+	apr_pool_create(&pool,NULL);
+	if (apr_file_open(&file,temporaryPath.c_str(),APR_FOPEN_WRITE | APR_FOPEN_CREATE | APR_FOPEN_TRUNCATE |
+			APR_FOPEN_BINARY | APR_FOPEN_BUFFERED,APR_OS_DEFAULT,pool)!=APR_SUCCESS){
+		apr_pool_destroy(pool);
+		throw ActiveException("ActiveSnapshot. Impossible to open the file "+temporaryPath);
+	}
+	unsigned char header[ACTIVE_SNAPSHOT_HEADER_SIZE];
+	memset(header,0,ACTIVE_SNAPSHOT_HEADER_SIZE);
+	memcpy(header,ACTIVE_SNAPSHOT_MAGIC,4);
+	header[4]=ACTIVE_SNAPSHOT_VERSION;
+	apr_status_t status=apr_file_write_full(file,header,ACTIVE_SNAPSHOT_HEADER_SIZE,NULL);
+
+	std::string recordData;
+	unsigned char recordHeader[ACTIVE_SNAPSHOT_RECORD_HEADER];
+	for (unsigned int i=0; i<messages.size() && status==APR_SUCCESS; i++){
+		std::ostringstream recordStream;
+		{
+			boost::archive::binary_oarchive snapshotFile(recordStream,boost::archive::no_header);
+			snapshotFile << messages[i];
+		}
+		recordData=recordStream.str();
+		encodeNumber(recordHeader,recordData.size());
+		encodeNumber(recordHeader+4,ActiveCrc32c::compute((const unsigned char*)recordData.data(),recordData.size()));
+		status=apr_file_write_full(file,recordHeader,ACTIVE_SNAPSHOT_RECORD_HEADER,NULL);
+		if (status==APR_SUCCESS){
+			status=apr_file_write_full(file,recordData.data(),recordData.size(),NULL);
+		}
+	}
+	if (status==APR_SUCCESS){
+		status=apr_file_flush(file);
+	}
+	if (status==APR_SUCCESS){
+		status=apr_file_datasync(file);
+	}
+	apr_file_close(file);
+	//the snapshot before is replaced only by a complete one
+	if (status==APR_SUCCESS){
+		status=apr_file_rename(temporaryPath.c_str(),path.c_str(),pool);
+	}
+	if (status!=APR_SUCCESS){
+		apr_file_remove(temporaryPath.c_str(),pool);
+		apr_pool_destroy(pool);
+		throw ActiveException("ActiveSnapshot. Error writing the file "+path+". Disk is full?");
+	}
+	apr_pool_destroy(pool);
+}
+
+bool ActiveSnapshot::read(const std::string& path, std::vector<ActiveMessage>& messages) throw (ActiveException){
+	std::stringstream logMessage;
+	apr_pool_t* pool=NULL;
+	apr_file_t* file=NULL;
+
+	messages.clear();
+	apr_pool_create(&pool,NULL);
+	if (apr_file_open(&file,path.c_str(),APR_FOPEN_READ | APR_FOPEN_BINARY | APR_FOPEN_BUFFERED,
+			APR_OS_DEFAULT,pool)!=APR_SUCCESS){
+		apr_pool_destroy(pool);
+		return false;
+	}
+	apr_finfo_t info;
+	apr_file_info_get(&info,APR_FINFO_SIZE,file);
+	apr_off_t fileSize=info.size;
+
+	unsigned char header[ACTIVE_SNAPSHOT_HEADER_SIZE];
+	if (fileSize<ACTIVE_SNAPSHOT_HEADER_SIZE ||
+			apr_file_read_full(file,header,ACTIVE_SNAPSHOT_HEADER_SIZE,NULL)!=APR_SUCCESS ||
+			memcmp(header,ACTIVE_SNAPSHOT_MAGIC,4)!=0 || header[4]!=ACTIVE_SNAPSHOT_VERSION){
+		apr_file_close(file);
+		apr_pool_destroy(pool);
+		throw ActiveException("ActiveSnapshot. Not valid header in the file "+path);
+	}
+
+	apr_off_t offset=ACTIVE_SNAPSHOT_HEADER_SIZE;
+	unsigned char recordHeader[ACTIVE_SNAPSHOT_RECORD_HEADER];
+	std::vector<unsigned char> record;
+	while (offset+ACTIVE_SNAPSHOT_RECORD_HEADER<=fileSize &&
+			apr_file_read_full(file,recordHeader,ACTIVE_SNAPSHOT_RECORD_HEADER,NULL)==APR_SUCCESS){
+		apr_uint32_t length=decodeNumber(recordHeader);
+		if (length==0 || offset+ACTIVE_SNAPSHOT_RECORD_HEADER+length>fileSize){
+			break;
+		}
+		record.resize(length);
+		if (apr_file_read_full(file,&record[0],length,NULL)!=APR_SUCCESS ||
+				ActiveCrc32c::compute(&record[0],length)!=decodeNumber(recordHeader+4)){
+			break;
+		}
+		//added only once it is decoded
+		ActiveMessage activeMessage;
+		try{
+			boost::iostreams::stream<boost::iostreams::array_source> recordStream((const char*)&record[0],record.size());
+			boost::archive::binary_iarchive snapshotFile(recordStream,boost::archive::no_header);
+			snapshotFile >> activeMessage;
+		}catch (...){
+			break;
+		}
+		messages.push_back(activeMessage);
+		offset+=ACTIVE_SNAPSHOT_RECORD_HEADER+length;
+	}
+	apr_file_close(file);
+	apr_pool_destroy(pool);
+
+	if (offset<fileSize){
+		logMessage << "POSSIBLE DATA LOSS. "<<(fileSize-offset)<<" bytes of the snapshot "<<path
+				<<" not valid, "<<messages.size()<<" messages read before them";
+		LOG4CXX_ERROR(logger,logMessage.str().c_str());
+	}
+	return true;
+}
+
+void ActiveSnapshot::remove(const std::string& path){
+	apr_pool_t* pool=NULL;
+	apr_pool_create(&pool,NULL);
+	apr_file_remove(path.c_str(),pool);
+	apr_pool_destroy(pool);
+}
@@ -0,0 +1,90 @@
+/**
+ * @file
+ * @author  Oscar Pernas <oscar@pernas.es>
+ * @version 1.2.3
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * Snapshot of the messages in memory of a connection without persistence.
+ * It is written when the library is closed and read when it is started, so
+ * the messages not sent are kept between runs without writing each one.
+ * The file has a header and each message is a record with its length and
+ * its CRC32C (4 bytes each, big endian). It is written to a temporary file
+ * that is renamed, so a snapshot is never found written in part.
+ */
+
+#ifndef ACTIVESNAPSHOT_H_
+#define ACTIVESNAPSHOT_H_
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "apr_general.h"
+#include "apr_pools.h"
+#include "apr_file_io.h"
+
+#include "../../utils/exception/ActiveException.h"
+#include "../message/ActiveMessage.h"
+
+#include "log4cxx/logger.h"
+
+using namespace ai::message;
+
+namespace ai{
+
+	class ActiveSnapshot {
+	private:
+
+		//static var for logger
+		static log4cxx::LoggerPtr logger;
+
+	public:
+
+		/**
+		 * Method that writes the messages to a snapshot, replacing the one
+		 * that exists
+		 *
+		 * @param path path of the snapshot
+		 * @param messages messages to write, in order
+		 *
+		 * @throws ActiveException if the snapshot can not be written
+		 */
+		static void write(const std::string& path, const std::vector<ActiveMessage>& messages) throw (ActiveException);
+
+		/**
+		 * Method that reads the messages of a snapshot. Records after one not
+		 * complete or with a wrong checksum are lost.
+		 *
+		 * @param path path of the snapshot
+		 * @param messages vector in which the messages are stored, in order
+		 *
+		 * @return false if the snapshot does not exist
+		 *
+		 * @throws ActiveException if the snapshot is not valid
+		 */
+		static bool read(const std::string& path, std::vector<ActiveMessage>& messages) throw (ActiveException);
+
+		/**
+		 * Method that deletes a snapshot, once its messages are enqueued
+		 *
+		 * @param path path of the snapshot
+		 */
+		static void remove(const std::string& path);
+	};
+}
+
+#endif /* ACTIVESNAPSHOT_H_ */
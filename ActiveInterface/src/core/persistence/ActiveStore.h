@@ -0,0 +1,139 @@
+/**
+ * @file
+ * @author  Oscar Pernas <oscar@pernas.es>
+ * @version 1.2.3
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * Interface of the stores in which the persistence writes the messages. Each
+ * record has a sequence number; records are read in order and acknowledged
+ * when they are sent, so their space can be freed.
+ * Stores are not thread safe, the persistence locks them.
+ */
+
+#ifndef ACTIVESTORE_H_
+#define ACTIVESTORE_H_
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../../utils/exception/ActiveException.h"
+
+namespace ai{
+
+	class ActiveStore {
+	public:
+
+		/**
+		 * Method that opens the store, finding the records written before
+		 *
+		 * @param baseNameR name of the store
+		 * @param sizeR size in bytes, its meaning depends on the store
+		 *
+		 * @throws ActiveException if the store can not be opened
+		 */
+		virtual void open(const std::string& baseNameR, unsigned int sizeR) throw (ActiveException)=0;
+
+		/**
+		 * Method that appends a record. It is buffered until flush is invoked.
+		 *
+		 * @param data bytes of the record
+		 * @param size number of bytes
+		 *
+		 * @return sequence of the record
+		 *
+		 * @throws ActiveException if the record can not be stored
+		 */
+		virtual long long append(const unsigned char* data, unsigned int size) throw (ActiveException)=0;
+
+		/**
+		 * Method that writes the records appended
+		 *
+		 * @throws ActiveException if the records can not be written
+		 */
+		virtual void flush() throw (ActiveException)=0;
+
+		/**
+		 * Method that writes the records appended and waits until they are
+		 * on disk
+		 *
+		 * @throws ActiveException if the records can not be synchronized
+		 */
+		virtual void sync() throw (ActiveException)=0;
+
+		/**
+		 * Method that sets the next record that will be read
+		 *
+		 * @param sequence sequence of the record
+		 *
+		 * @throws ActiveException if the record is not in the store
+		 */
+		virtual void seek(long long sequence) throw (ActiveException)=0;
+
+		/**
+		 * Method that reads the next record
+		 *
+		 * @param record vector in which the record is stored
+		 *
+		 * @return false if there are no more records
+		 *
+		 * @throws ActiveException if the record can not be read
+		 */
+		virtual bool read(std::vector<unsigned char>& record) throw (ActiveException)=0;
+
+		/**
+		 * Method that frees the records before a sequence
+		 *
+		 * @param sequence first record that is not acknowledged
+		 */
+		virtual void acknowledge(long long sequence)=0;
+
+		/**
+		 * Method that is invoked when all records are sent and there are more
+		 * records than the size of the persistence, to start again
+		 *
+		 * @throws ActiveException if something bad happens
+		 */
+		virtual void roll() throw (ActiveException)=0;
+
+		/**
+		 * Method that deletes all the records. Sequences are not restarted.
+		 *
+		 * @throws ActiveException if something bad happens
+		 */
+		virtual void reset() throw (ActiveException)=0;
+
+		/**
+		 * Method that writes pending records and closes the store
+		 */
+		virtual void close()=0;
+
+		/**
+		 * Default destructor
+		 */
+		virtual ~ActiveStore(){}
+
+		/////////////////////////////////////////////////////////////////
+		//getters
+		virtual long long getFirstSequence()=0;
+		virtual long long getNextSequence()=0;
+		virtual long long getReadSequence()=0;
+		virtual long long getSegmentRecords()=0;
+	};
+}
+
+#endif /* ACTIVESTORE_H_ */
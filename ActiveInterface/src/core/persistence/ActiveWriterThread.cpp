@@ -0,0 +1,165 @@
+/**
+ * @file
+ * @author  Oscar Pernas <oscar@pernas.es>
+ * @version 1.2.3
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * Thread that writes to the persistence the records accepted by deliver.
+ */
+
+#include "ActivePersistence.h"
+#include "ActiveWriterThread.h"
+#include "../../utils/exception/ActiveException.h"
+
+using namespace log4cxx;
+using namespace log4cxx::helpers;
+using namespace ai;
+
+LoggerPtr ActiveWriterThread::logger(Logger::getLogger("ActiveWriterThread"));
+
+ActiveWriterThread::ActiveWriterThread() {
+	rv=-1;
+	mp=NULL;
+	thd_arr=NULL;
+	thd_attr=NULL;
+	writtenCond=NULL;
+	written=0;
+	sleeping=0;
+
+	activePersistence=NULL;
+	threadRunning=-1;
+}
+
+void ActiveWriterThread::init (ActivePersistence& activePersistenceR){
+
+	try {
+		activePersistence=&activePersistenceR;
+
+		apr_pool_create(&mp, NULL);
+		apr_threadattr_create(&thd_attr, mp);
+
+		apr_thread_mutex_create(activeSharedObject.getMutexPtr(), APR_THREAD_MUTEX_UNNESTED, mp);
+		apr_thread_cond_create(activeSharedObject.getCondPtr(), mp);
+		apr_thread_cond_create(&writtenCond, mp);
+
+	}catch (...){
+		throw ActiveException ("Persistence writer thread can not be initialized.");
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////
+//// thread that writes
+///////////////////////////////////////////////////////////////////////////////////////////
+static void* APR_THREAD_FUNC writerThread(apr_thread_t *thd, void *data){
+
+	if (data){
+		ActiveWriterThread* myWriterThread=(ActiveWriterThread*)data;
+		ActivePersistence* myActivePersistence=myWriterThread->getActivePersistence();
+
+		while(true){
+			if (myActivePersistence->writeBatch()>0){
+				continue;
+			}
+			//if records could not be written they are tried again later
+			apr_interval_time_t timeout=myActivePersistence->hasPendingWrites()?ACTIVE_WRITE_RETRY:0;
+			if (!myWriterThread->waitRecords(timeout)){
+				break;
+			}
+		}
+		apr_thread_exit(thd, APR_SUCCESS);
+		return NULL;
+	}else{
+		std::cout << "Persistence writer thread can not start." << std::endl;
+		return NULL;
+	}
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int ActiveWriterThread::runWriterThread (){
+
+	activeSharedObject.setRunningThread();
+	threadRunning=apr_thread_create(&thd_arr, thd_attr, writerThread, (void*)this, mp);
+	return threadRunning;
+}
+
+void ActiveWriterThread::wakeUp(){
+	if (apr_atomic_read32(&sleeping)!=0){
+		apr_thread_mutex_lock(activeSharedObject.getMutex());
+		apr_thread_cond_signal(activeSharedObject.getCond());
+		apr_thread_mutex_unlock(activeSharedObject.getMutex());
+	}
+}
+
+bool ActiveWriterThread::waitRecords(apr_interval_time_t timeout){
+	apr_thread_mutex_lock(activeSharedObject.getMutex());
+	//set before looking at the queue, so a record pushed after it wakes us up
+	apr_atomic_xchg32(&sleeping,1);
+	if (!activeSharedObject.getEndThread() && (timeout>0 || !activePersistence->hasPendingWrites())){
+		if (timeout>0){
+			apr_thread_cond_timedwait(activeSharedObject.getCond(), activeSharedObject.getMutex(), timeout);
+		}else{
+			apr_thread_cond_wait(activeSharedObject.getCond(), activeSharedObject.getMutex());
+		}
+	}
+	apr_atomic_xchg32(&sleeping,0);
+	bool running=!activeSharedObject.getEndThread();
+	apr_thread_mutex_unlock(activeSharedObject.getMutex());
+	return running;
+}
+
+void ActiveWriterThread::setWritten(long long writtenR){
+	if (activeSharedObject.getMutex()==NULL){
+		written=writtenR;
+		return;
+	}
+	apr_thread_mutex_lock(activeSharedObject.getMutex());
+	written=writtenR;
+	apr_thread_cond_broadcast(writtenCond);
+	apr_thread_mutex_unlock(activeSharedObject.getMutex());
+}
+
+void ActiveWriterThread::waitWritten(long long sequence){
+	if (threadRunning!=APR_SUCCESS){
+		return;
+	}
+	apr_thread_mutex_lock(activeSharedObject.getMutex());
+	while (written<sequence && !activeSharedObject.getEndThread()){
+		apr_thread_cond_wait(writtenCond, activeSharedObject.getMutex());
+	}
+	apr_thread_mutex_unlock(activeSharedObject.getMutex());
+}
+
+void ActiveWriterThread::stop(){
+	if (threadRunning==APR_SUCCESS){
+		LOG4CXX_DEBUG (logger,"Stopping persistence writer thread");
+		apr_thread_mutex_lock(activeSharedObject.getMutex());
+		activeSharedObject.setEndThread();
+		apr_thread_cond_signal(activeSharedObject.getCond());
+		apr_thread_cond_broadcast(writtenCond);
+		apr_thread_mutex_unlock(activeSharedObject.getMutex());
+		apr_thread_join(&rv, thd_arr);
+		threadRunning=-1;
+		LOG4CXX_DEBUG (logger,"Stopped persistence writer thread succesfully!.");
+	}
+}
+
+ActiveWriterThread::~ActiveWriterThread() {
+	stop();
+	if (mp!=NULL){
+		apr_pool_destroy(mp);
+	}
+}
@@ -0,0 +1,176 @@
+/**
+ * @file
+ * @author  Oscar Pernas <oscar@pernas.es>
+ * @version 1.2.3
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * Thread that writes to the persistence the records accepted by deliver, when
+ * the connection uses writebehind. It publishes the sequence up to which the
+ * records are written, the send thread waits for it before a message sent is
+ * counted.
+ */
+
+#ifndef ACTIVEWRITERTHREAD_H_
+#define ACTIVEWRITERTHREAD_H_
+
+#include <apr_general.h>
+#include <apr_atomic.h>
+#include <apr_thread_proc.h>
+#include <apr_thread_cond.h>
+
+#include "log4cxx/logger.h"
+#include "log4cxx/helpers/exception.h"
+
+#include "../wrapper/ActiveSharedObject.h"
+
+
+namespace ai{
+
+	class ActivePersistence;
+
+	class ActiveWriterThread {
+	private:
+		/**
+		 * APR flag that saves the status of the thread
+		 */
+		apr_status_t rv;
+
+		/**
+		 * APR pool to manage threads
+		 */
+		apr_pool_t *mp;
+
+		/**
+		 * APR pointer to the real thread
+		 */
+		apr_thread_t *thd_arr;
+
+		/**
+		 * APR pointer to pass atts to the thread
+		 */
+		apr_threadattr_t *thd_attr;
+
+		/**
+		 * Static var use by log4cxx for the logging system
+		 */
+		static log4cxx::LoggerPtr logger;
+
+		/**
+		 * APR mutex and condition to wake up the writer
+		 */
+		ActiveSharedObject activeSharedObject;
+
+		/**
+		 * APR condition signaled when more records are written
+		 */
+		apr_thread_cond_t* writtenCond;
+
+		/**
+		 * Sequence of the first record not written, protected by the mutex
+		 */
+		long long written;
+
+		/**
+		 * 1 while the writer waits for records, so deliver only locks the
+		 * mutex to wake it up when it is needed
+		 */
+		volatile apr_uint32_t sleeping;
+
+		/**
+		 * Flag to know if the thread started to run
+		 */
+		int threadRunning;
+
+		/**
+		 * Pointer to active persistence to invoke the method that writes.
+		 */
+		ActivePersistence* activePersistence;
+
+	public:
+
+		/**
+		 * Default constructor
+		 */
+		ActiveWriterThread();
+
+		/**
+		 * Method that initializes the structures used by the thread
+		 *
+		 * @param activePersistenceR persistence whose records are written
+		 */
+		void init (ActivePersistence& activePersistenceR);
+
+		/**
+		 * Method that starts the thread
+		 *
+		 * @return 0 if the thread spawn went fine. See more documentation at APR returns values of creating threads
+		 */
+		int runWriterThread ();
+
+		/**
+		 * Method that wakes up the thread if it is waiting for records
+		 */
+		void wakeUp();
+
+		/**
+		 * Method that waits for records, or for the time given
+		 *
+		 * @param timeout microseconds to wait, 0 to wait until it is woken up
+		 *
+		 * @return false if the thread has to end
+		 */
+		bool waitRecords(apr_interval_time_t timeout);
+
+		/**
+		 * Method that publishes the sequence of the first record not written
+		 *
+		 * @param writtenR sequence of the first record not written
+		 */
+		void setWritten(long long writtenR);
+
+		/**
+		 * Method that waits until the records before a sequence are written.
+		 * It returns when the thread is stopped.
+		 *
+		 * @param sequence sequence of the first record that is not needed
+		 */
+		void waitWritten(long long sequence);
+
+		/**
+		 * Method to know if the thread is running
+		 */
+		bool isRunning(){ return threadRunning==APR_SUCCESS;}
+
+		/**
+		 * Method that returns the persistence associated
+		 */
+		ActivePersistence* getActivePersistence(){ return activePersistence;}
+
+		/**
+		 * Method that stops the thread and waits for it. The records not
+		 * written yet stay in the queue.
+		 */
+		void stop();
+
+		/**
+		 *	Default destructor
+		 */
+		virtual ~ActiveWriterThread();
+	};
+}
+
+#endif /* ACTIVEWRITERTHREAD_H_ */
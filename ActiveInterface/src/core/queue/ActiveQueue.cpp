@@ -39,18 +39,34 @@ using namespace ai;
 //initializing logger
 LoggerPtr ActiveQueue::logger(Logger::getLogger("ActiveQueue"));
 
+ActiveQueue::ActiveQueue(){
+	apr_atomic_set32(&queuedBytes,0);
+	notPersisted=0;
+	dequeuedNotPersisted=0;
+	windowWaiters=0;
+	apr_pool_create(&windowPool,NULL);
+	apr_thread_mutex_create(&windowMutex,APR_THREAD_MUTEX_UNNESTED,windowPool);
+	apr_thread_cond_create(&windowCond,windowPool);
+}
+
 void ActiveQueue::init (int maxQueueSizeR){
 	//clearing all data of queue
-	std::queue<ActiveMessage> messageQueueEmpty;
+	std::deque<ActiveMessage> messageQueueEmpty;
 	std::swap( messageQueue, messageQueueEmpty );
+	messageSizes.clear();
+	apr_atomic_set32(&queuedBytes,0);
+	notPersisted=0;
+	dequeuedNotPersisted=0;
 	maxQueueSize=maxQueueSizeR;
 	//setting the state to accepting
 	working=true;
 }
 
-int ActiveQueue::enqueue(const ActiveMessage& activeMessage) throw (ActiveException){
+int ActiveQueue::enqueue(const ActiveMessage& activeMessage, bool persisted) throw (ActiveException){
 
 	std::stringstream logMessage;
+	//estimated out of the lock, it goes through all the fields
+	unsigned int size=activeMessage.getEstimatedSize();
 	try {
 		//mutex to access the concurrent queue
 		accessQueue.lock();
@@ -60,7 +76,12 @@ int ActiveQueue::enqueue(const ActiveMessage& activeMessage) throw (ActiveExcept
 			getMaxSizeQueue()==0){
 
 			//inserting the message into the queue
-			messageQueue.push(activeMessage);
+			messageQueue.push_back(activeMessage);
+			messageSizes.push_back(size);
+			apr_atomic_add32(&queuedBytes,size);
+			if (!persisted){
+				notPersisted++;
+			}
 
 			//unlocking the queue
 			accessQueue.unlock();
@@ -85,16 +106,18 @@ int ActiveQueue::enqueue(const ActiveMessage& activeMessage) throw (ActiveExcept
 	return -1;
 }
 
-void ActiveQueue::dequeue (ActiveMessage& activeMessage) throw (ActiveException) {
+bool ActiveQueue::dequeue (ActiveMessage& activeMessage) throw (ActiveException) {
 
 	std::string key;
 	std::stringstream logMessage;
+	bool dequeued=false;
 
 	try{
 		accessQueue.lock();
 		if (!messageQueue.empty()){
 			activeMessage.clone(messageQueue.front());
-			messageQueue.pop();
+			popFront();
+			dequeued=true;
 		}
 		//logMessage << "Dequeue message in position "<<messageQueue.size();
 		//LOG4CXX_DEBUG(logger,logMessage.str().c_str());
@@ -103,7 +126,139 @@ void ActiveQueue::dequeue (ActiveMessage& activeMessage) throw (ActiveException)
 		accessQueue.unlock();
 		throw ActiveException ("Unknown exception getting message from the queue.");
 	}
+	return dequeued;
+}
+
+bool ActiveQueue::dequeueBatchable(const ActiveMessage& first, ActiveMessage& activeMessage)
+	throw (ActiveException) {
+
+	bool dequeued=false;
+
+	try{
+		accessQueue.lock();
+		if (!messageQueue.empty() && first.isBatchableWith(messageQueue.front())){
+			activeMessage.clone(messageQueue.front());
+			popFront();
+			dequeued=true;
+		}
+		accessQueue.unlock();
+	}catch (...){
+		accessQueue.unlock();
+		throw ActiveException ("Unknown exception getting message from the queue.");
+	}
+	return dequeued;
+}
+
+void ActiveQueue::popFront(){
+	//only written with the queue locked, the atomic is for the readers
+	apr_uint32_t size=messageSizes.front();
+	apr_uint32_t bytes=apr_atomic_read32(&queuedBytes);
+	apr_atomic_set32(&queuedBytes,(size<bytes)?bytes-size:0);
+	messageQueue.pop_front();
+	messageSizes.pop_front();
+	if (notPersisted>0){
+		notPersisted--;
+		dequeuedNotPersisted++;
+	}
+	signalWindow();
+}
+
+void ActiveQueue::signalWindow(){
+	if (apr_atomic_read32(&windowWaiters)>0){
+		apr_thread_mutex_lock(windowMutex);
+		apr_thread_cond_broadcast(windowCond);
+		apr_thread_mutex_unlock(windowMutex);
+	}
+}
+
+bool ActiveQueue::waitQueuedBytes(unsigned long limit, apr_interval_time_t timeout){
+	apr_atomic_inc32(&windowWaiters);
+	apr_thread_mutex_lock(windowMutex);
+	//the bytes are checked with the mutex locked, a message dequeued after it wakes up this thread
+	if (apr_atomic_read32(&queuedBytes)>limit){
+		apr_thread_cond_timedwait(windowCond,windowMutex,timeout);
+	}
+	bool below=apr_atomic_read32(&queuedBytes)<=limit;
+	apr_thread_mutex_unlock(windowMutex);
+	apr_atomic_dec32(&windowWaiters);
+	return below;
+}
+
+unsigned int ActiveQueue::takeDequeuedNotPersisted(){
+	accessQueue.lock();
+	unsigned int dequeued=dequeuedNotPersisted;
+	dequeuedNotPersisted=0;
+	accessQueue.unlock();
+	return dequeued;
+}
+
+void ActiveQueue::spillNotPersisted(std::vector<ActiveMessage>& messages) throw (ActiveException){
+	try{
+		accessQueue.lock();
+		messages.assign(messageQueue.begin(),messageQueue.begin()+notPersisted);
+		accessQueue.unlock();
+	}catch (...){
+		accessQueue.unlock();
+		throw ActiveException ("Unknown exception copying messages from the queue.");
+	}
+}
+
+unsigned int ActiveQueue::spilled(unsigned int persisted){
+	accessQueue.lock();
+	unsigned int removed=(notPersisted>persisted)?notPersisted-persisted:0;
+	//the ones that could not be persisted are not sent, they would be counted as sent in the log
+	for (unsigned int it=0; it<removed; it++){
+		apr_uint32_t size=messageSizes[persisted];
+		apr_uint32_t bytes=apr_atomic_read32(&queuedBytes);
+		apr_atomic_set32(&queuedBytes,(size<bytes)?bytes-size:0);
+		messageQueue.erase(messageQueue.begin()+persisted);
+		messageSizes.erase(messageSizes.begin()+persisted);
+	}
+	notPersisted=0;
+	if (removed>0){
+		signalWindow();
+	}
+	accessQueue.unlock();
+	return removed;
+}
+
+void ActiveQueue::takeAll(std::vector<ActiveMessage>& messages) throw (ActiveException){
+	try{
+		accessQueue.lock();
+		messages.assign(messageQueue.begin(),messageQueue.end());
+		messageQueue.clear();
+		messageSizes.clear();
+		apr_atomic_set32(&queuedBytes,0);
+		notPersisted=0;
+		signalWindow();
+		accessQueue.unlock();
+	}catch (...){
+		accessQueue.unlock();
+		throw ActiveException ("Unknown exception copying messages from the queue.");
+	}
+}
 
+unsigned int ActiveQueue::restore(const std::vector<ActiveMessage>& messages) throw (ActiveException){
+	unsigned int restored=0;
+	std::vector<unsigned int> sizes(messages.size());
+	for (unsigned int it=0; it<messages.size(); it++){
+		sizes[it]=messages[it].getEstimatedSize();
+	}
+	try{
+		accessQueue.lock();
+		while (restored<messages.size() &&
+				(messageQueue.size()<getMaxSizeQueue() || getMaxSizeQueue()==0)){
+			messageQueue.push_back(messages[restored]);
+			messageSizes.push_back(sizes[restored]);
+			apr_atomic_add32(&queuedBytes,sizes[restored]);
+			restored++;
+		}
+		accessQueue.unlock();
+	}catch (...){
+		accessQueue.unlock();
+		throw ActiveException ("POSSIBLE DATA LOSS! Error inserting in messages queue.");
+	}
+	return restored;
 }
 
 bool ActiveQueue::isFull(){
@@ -149,4 +304,5 @@ void ActiveQueue::congestionControl (){
 }
 
 ActiveQueue::~ActiveQueue() {
+	apr_pool_destroy(windowPool);
 }
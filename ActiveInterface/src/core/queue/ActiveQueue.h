@@ -32,7 +32,11 @@
 #ifndef ACTIVEQUEUE_H_
 #define ACTIVEQUEUE_H_
 
-#include <queue>
+#include <deque>
+#include <vector>
+
+#include <apr_atomic.h>
+#include <apr_thread_cond.h>
 
 #include "../mutex/ActiveMutex.h"
 #include "../message/ActiveMessage.h"
@@ -49,7 +53,26 @@ namespace ai{
 		/**
 		 * Concurrent queue used to store messages before to be sent
 		 */
-		std::queue<ActiveMessage> messageQueue;
+		std::deque<ActiveMessage> messageQueue;
+
+		/**
+		 * Messages at the front of the queue that are not in the persistence,
+		 * and the ones of them dequeued since the sender asked for it
+		 */
+		unsigned int notPersisted;
+		unsigned int dequeuedNotPersisted;
+
+		/**
+		 * Estimated bytes of the messages stored in the queue. It is written with
+		 * the queue locked and read atomically by the threads that wait for it.
+		 */
+		volatile apr_uint32_t queuedBytes;
+
+		/**
+		 * Estimated size of each message of the queue, in the same order. It is
+		 * computed before the queue is locked and not again when it is dequeued.
+		 */
+		std::deque<unsigned int> messageSizes;
 
 		/**
 		 * mutex to guard from concurrent access queue
@@ -77,12 +100,33 @@ namespace ai{
 		 */
 		static log4cxx::LoggerPtr logger;
 
+		/**
+		 * APR pool, mutex and condition to wake up the threads that wait for
+		 * the queued bytes to go down, and number of them waiting. The queue
+		 * only locks this mutex when some thread is waiting.
+		 */
+		apr_pool_t* windowPool;
+		apr_thread_mutex_t* windowMutex;
+		apr_thread_cond_t* windowCond;
+		volatile apr_uint32_t windowWaiters;
+
+		/**
+		 * Method that removes the first message, the queue must be locked
+		 */
+		void popFront();
+
+		/**
+		 * Method that wakes up the threads waiting in waitQueuedBytes, called
+		 * when messages leave the queue
+		 */
+		void signalWindow();
+
 	public:
 
 		/**
 		 * Default constructor
 		 */
-		ActiveQueue(){}
+		ActiveQueue();
 
 		/**
 		 * Method that initializes the queue
@@ -110,20 +154,88 @@ namespace ai{
 		 * Method used to enqueue messages into the queue
 		 *
 		 * @param activeMessage message to be stored into queue
+		 * @param persisted false if the message is not in the persistence. Those
+		 * messages can only be enqueued before the ones that are in it.
 		 * @return position of the message in the queue
 		 *
 		 * @throws ActiveException if something bad happens.
 		 */
-		int enqueue(const ActiveMessage& activeMessage) throw (ActiveException);
+		int enqueue(const ActiveMessage& activeMessage, bool persisted=true) throw (ActiveException);
 
 		/**
 		 * Method used to dequeue a message from the queue
 		 *
 		 * @param activeMessage reference to the message that is filled with the message pop from the queue
 		 *
+		 * @return true if a message was dequeued, false if the queue was empty
+		 *
 		 * @throws ActiveException if something bad happens.
 		 */
-		void dequeue(ActiveMessage& activeMessage) throw (ActiveException);
+		bool dequeue(ActiveMessage& activeMessage) throw (ActiveException);
+
+		/**
+		 * Method that gets the first message of the queue only if it can be sent
+		 * in the same envelope that other message.
+		 *
+		 * @param first message that starts the envelope
+		 * @param activeMessage where the message is copied
+		 *
+		 * @return true if a message was dequeued
+		 *
+		 * @throws ActiveException if something bad happens
+		 */
+		bool dequeueBatchable(const ActiveMessage& first, ActiveMessage& activeMessage) throw (ActiveException);
+
+		/**
+		 * Method that returns how many of the messages dequeued since the last
+		 * call were not in the persistence
+		 *
+		 * @return messages dequeued that were not persisted
+		 */
+		unsigned int takeDequeuedNotPersisted();
+
+		/**
+		 * Method that copies the messages that are not in the persistence, so
+		 * they can be written to it. They are counted as not persisted until
+		 * spilled is invoked.
+		 *
+		 * @param messages vector in which the messages are copied, in order
+		 */
+		void spillNotPersisted(std::vector<ActiveMessage>& messages) throw (ActiveException);
+
+		/**
+		 * Method invoked after the messages copied by spillNotPersisted are
+		 * written to the persistence. The first ones written are counted as
+		 * persisted and the rest are removed from the queue. Nothing can be
+		 * enqueued or dequeued between both calls.
+		 *
+		 * @param persisted number of messages written, the first ones
+		 *
+		 * @return number of messages removed
+		 */
+		unsigned int spilled(unsigned int persisted);
+
+		/**
+		 * Method that removes all the messages of the queue, to write them to
+		 * the snapshot
+		 *
+		 * @param messages vector in which the messages are stored
+		 *
+		 * @throws ActiveException if they can not be copied
+		 */
+		void takeAll(std::vector<ActiveMessage>& messages) throw (ActiveException);
+
+		/**
+		 * Method that enqueues the messages read from a snapshot, without
+		 * congestion control. Messages over the max size are not enqueued.
+		 *
+		 * @param messages messages to enqueue
+		 *
+		 * @return number of messages enqueued
+		 *
+		 * @throws ActiveException if they can not be enqueued
+		 */
+		unsigned int restore(const std::vector<ActiveMessage>& messages) throw (ActiveException);
 
 		/**
 		 *	method to know if the queue is full or not
@@ -155,6 +267,25 @@ namespace ai{
 		 */
 		unsigned int getSizeQueue (){return messageQueue.size();}
 
+		/**
+		 * Method that returns the estimated bytes of the messages stored. It is read
+		 * without lock, so it is only an approximation.
+		 *
+		 * @return bytes stored
+		 */
+		unsigned long getQueuedBytes (){return apr_atomic_read32(&queuedBytes);}
+
+		/**
+		 * Method that waits until the estimated bytes of the messages stored are
+		 * not more than a limit, or until the timeout expires
+		 *
+		 * @param limit max bytes stored
+		 * @param timeout max time to wait (microseconds)
+		 *
+		 * @return true if the bytes stored are not more than the limit
+		 */
+		bool waitQueuedBytes (unsigned long limit, apr_interval_time_t timeout);
+
 		/**
 		 * Default destructor
 		 */
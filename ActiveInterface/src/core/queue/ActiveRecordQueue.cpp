@@ -0,0 +1,108 @@
+/**
+ * @file
+ * @author  Oscar Pernas <oscar@pernas.es>
+ * @version 1.2.3
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * Bounded queue of records waiting to be written to the persistence.
+ */
+
+#include "ActiveRecordQueue.h"
+
+using namespace ai;
+
+ActiveRecordQueue::ActiveRecordQueue(){
+	cells=NULL;
+	mask=0;
+	enqueuePosition=0;
+	dequeuePosition=0;
+}
+
+void ActiveRecordQueue::init(unsigned int size){
+	apr_uint32_t capacity=2;
+	while (capacity<size && capacity<0x80000000U){
+		capacity<<=1;
+	}
+	delete[] cells;
+	cells=new Cell[capacity];
+	mask=capacity-1;
+	for (apr_uint32_t i=0; i<capacity; i++){
+		cells[i].sequence=i;
+		cells[i].time=0;
+	}
+	apr_atomic_set32(&enqueuePosition,0);
+	apr_atomic_set32(&dequeuePosition,0);
+}
+
+bool ActiveRecordQueue::push(std::string& data, apr_time_t time){
+	if (cells==NULL){
+		return false;
+	}
+	apr_uint32_t position=apr_atomic_read32(&enqueuePosition);
+	while (true){
+		Cell* cell=&cells[position & mask];
+		int difference=(int)(apr_atomic_read32(&cell->sequence)-position);
+		if (difference==0){
+			//the cell is free, taking it if no other thread did it before
+			apr_uint32_t old=apr_atomic_cas32(&enqueuePosition,position+1,position);
+			if (old==position){
+				cell->data.swap(data);
+				cell->time=time;
+				//the record is visible for the reader
+				apr_atomic_xchg32(&cell->sequence,position+1);
+				return true;
+			}
+			position=old;
+		}else if (difference<0){
+			//the reader has not freed this cell yet
+			return false;
+		}else{
+			position=apr_atomic_read32(&enqueuePosition);
+		}
+	}
+}
+
+bool ActiveRecordQueue::front(std::string*& data, apr_time_t& time){
+	if (cells==NULL){
+		return false;
+	}
+	apr_uint32_t position=apr_atomic_read32(&dequeuePosition);
+	Cell* cell=&cells[position & mask];
+	if (apr_atomic_read32(&cell->sequence)!=position+1){
+		return false;
+	}
+	data=&cell->data;
+	time=cell->time;
+	return true;
+}
+
+void ActiveRecordQueue::pop(){
+	apr_uint32_t position=apr_atomic_read32(&dequeuePosition);
+	Cell* cell=&cells[position & mask];
+	cell->data.clear();
+	apr_atomic_set32(&dequeuePosition,position+1);
+	//the cell is free for the position of the next turn
+	apr_atomic_xchg32(&cell->sequence,position+mask+1);
+}
+
+bool ActiveRecordQueue::isEmpty(){
+	return apr_atomic_read32(&enqueuePosition)==apr_atomic_read32(&dequeuePosition);
+}
+
+ActiveRecordQueue::~ActiveRecordQueue(){
+	delete[] cells;
+}
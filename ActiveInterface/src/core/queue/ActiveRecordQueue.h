@@ -0,0 +1,123 @@
+/**
+ * @file
+ * @author  Oscar Pernas <oscar@pernas.es>
+ * @version 1.2.3
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * Bounded queue of records waiting to be written to the persistence. Several
+ * threads push records without locks; each cell has a counter that says if it
+ * is free or has a record, and a thread takes a cell moving the position of
+ * the queue with compare and swap. Only one thread at a time can read records,
+ * the persistence reads them with its mutex locked.
+ */
+
+#ifndef ACTIVERECORDQUEUE_H_
+#define ACTIVERECORDQUEUE_H_
+
+#include <string>
+
+#include "apr_general.h"
+#include "apr_atomic.h"
+#include "apr_time.h"
+
+namespace ai{
+
+	class ActiveRecordQueue {
+	private:
+
+		/**
+		 * Cell of the queue. Its sequence is the position in which it can be
+		 * pushed, or that position plus one when it has a record.
+		 */
+		struct Cell {
+			volatile apr_uint32_t sequence;
+			std::string data;
+			apr_time_t time;
+		};
+
+		/**
+		 * Cells of the queue, a power of two
+		 */
+		Cell* cells;
+		apr_uint32_t mask;
+
+		/**
+		 * Positions in which the next record is pushed and read
+		 */
+		volatile apr_uint32_t enqueuePosition;
+		volatile apr_uint32_t dequeuePosition;
+
+	public:
+
+		/**
+		 * Default constructor
+		 */
+		ActiveRecordQueue();
+
+		/**
+		 * Method that creates the cells of the queue
+		 *
+		 * @param size number of records, rounded up to a power of two
+		 */
+		void init(unsigned int size);
+
+		/**
+		 * Method that pushes a record. The data is swapped with the cell, so the
+		 * string passed gets a buffer that can be used again.
+		 *
+		 * @param data bytes of the record
+		 * @param time when the record was accepted
+		 *
+		 * @return false if the queue is full
+		 */
+		bool push(std::string& data, apr_time_t time);
+
+		/**
+		 * Method that returns the first record without taking it out of the queue
+		 *
+		 * @param data set to the bytes of the record
+		 * @param time set to when the record was accepted
+		 *
+		 * @return false if there are no records
+		 */
+		bool front(std::string*& data, apr_time_t& time);
+
+		/**
+		 * Method that takes out the first record, after front returned it
+		 */
+		void pop();
+
+		/**
+		 * Method to know if there are no records, counting the ones that are
+		 * being pushed
+		 *
+		 * @return true if the queue is empty
+		 */
+		bool isEmpty();
+
+		/**
+		 * Default destructor
+		 */
+		virtual ~ActiveRecordQueue();
+
+		/////////////////////////////////////////////////////////////////
+		//getters
+		unsigned int getSize(){return (cells==NULL)?0:mask+1;}
+	};
+}
+
+#endif /* ACTIVERECORDQUEUE_H_ */
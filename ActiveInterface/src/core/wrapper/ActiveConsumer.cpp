@@ -235,11 +235,21 @@ int ActiveConsumer::onReceive(){
 
 	std::vector<unsigned char> packetDesc(MAX_PARAMETERS);
 
+	//buffer reused to read bytes parameters
+	std::vector<unsigned char> data;
+	data.reserve(MAX_PARAMETERS);
+
+	//message reused for every message received, recycling it keeps
+	//its parameters and buffers so steady consumption does not allocate.
+	//Binary messages are only decoded when the user asks for them.
+	ActiveMessageView messageView;
+	ActiveMessage& activeMessage=messageView.getMessageHeader();
+
 	try{
 		//loop to get messages
 		while (!getEndConsumerThread()){
 
-			ActiveMessage activeMessage;
+			messageView.recycle();
 			activeMessage.setConnectionId(getId());
 			std::auto_ptr<Message> message( consumer->receive() );
 
@@ -272,13 +282,18 @@ int ActiveConsumer::onReceive(){
 							break;
 							case ACTIVE_BYTES_PARAMETER:{
 								std::string key=streamMessage->readString();
-								int sizeBytesData=packetDesc.at(++it);
-								std::vector<unsigned char> data(sizeBytesData);
-								streamMessage->readBytes(data);
-								streamMessage->readBytes(data);
+								//size in packet description is only one byte, it is skipped
+								++it;
+								readBytesField(streamMessage,data);
 								activeMessage.insertBytesParameter(key,data);
 							}
 							break;
+							case ACTIVE_INT_ARRAY_PARAMETER:
+							case ACTIVE_REAL_ARRAY_PARAMETER:
+							case ACTIVE_INT64_ARRAY_PARAMETER:{
+								readArrayParameter(streamMessage,packetDesc[it],activeMessage);
+							}
+							break;
 							case ACTIVE_INT_PROPERTY:{
 								std::string key=streamMessage->readString();
 								int value=streamMessage->getIntProperty(key);
@@ -304,6 +319,22 @@ int ActiveConsumer::onReceive(){
 						LOG4CXX_DEBUG(logger, logMessage.str().c_str());
 					}
 
+				}else if (message->getCMSType()==ACTIVE_BINARY_CMS_TYPE){
+					////////////////////////////////////////////////////////////////////
+					/// Active message in binary format
+					try{
+						readBinaryMessage((BytesMessage*)message.get(),messageView);
+					}catch (ActiveException& ae){
+						//discarding the message, not the consumer
+						logMessage << "Consumer::onMessage. Binary message discarded. "<< ae.getMessage();
+						LOG4CXX_ERROR(logger, logMessage.str().c_str());
+						logMessage.str("");
+						if( getClientAck() ) {
+							message->acknowledge();
+						}
+						continue;
+					}
+
 				}else if (message->getCMSType()=="Advisory"){
 					//Advisory messages
 					handleAdvisoryMessages(message, activeMessage);
@@ -321,21 +352,26 @@ int ActiveConsumer::onReceive(){
 				logMessage << "Message received from connection "<< getId() << std::endl;
 				LOG4CXX_DEBUG(logger, logMessage.str().c_str());
 
-				//inserting in message if i can answer if is a request reply consumer
-				if (getRequestReply()){
-					//setting parameter for how to make the answer
-					activeMessage.setRequestReply(true);
-					//Set the correlation ID from the received message
-					std::string corId=message->getCMSCorrelationID();
-					activeMessage.setCorrelationId(corId);
-					//setting requestReply destination
-					activeMessage.cloneDestination(message->getCMSReplyTo());
-				}
+				//an envelope has several messages, a callback for each one
+				do{
+					activeMessage.setConnectionId(getId());
+
+					//inserting in message if i can answer if is a request reply consumer
+					if (getRequestReply()){
+						//setting parameter for how to make the answer
+						activeMessage.setRequestReply(true);
+						//Set the correlation ID from the received message
+						std::string corId=message->getCMSCorrelationID();
+						activeMessage.setCorrelationId(corId);
+						//setting requestReply destination
+						activeMessage.cloneDestination(message->getCMSReplyTo());
+					}
 
-				//setting others parameters to the message
-				activeMessage.setLinkId(getLinkId());
-				//sending callback to user with message
-				ActiveManager::getInstance()->onMessageCallback(activeMessage);
+					//setting others parameters to the message
+					activeMessage.setLinkId(getLinkId());
+					//sending callback to user with message
+					ActiveManager::getInstance()->onMessageCallback(messageView);
+				}while (nextEnvelopeMessage(messageView));
 
 				//message read sending acknowledge
 				if( getClientAck() ) {
@@ -507,7 +543,10 @@ int ActiveConsumer::send(){
 
 		if (replyProducer != NULL || connection != NULL || session != NULL || destination != NULL){
 
-			if (activeMessageToSend.isTextMessage()){
+			//parameter messages in binary format and big texts to compress
+			bool binaryMessage=isSentAsBinary(activeMessageToSend);
+
+			if (activeMessageToSend.isTextMessage() && !binaryMessage){
 				//sending a textMessage
 				TextMessage* textMessage=session->createTextMessage(activeMessageToSend.getText());
 
@@ -532,25 +571,33 @@ int ActiveConsumer::send(){
 				//deleting memory for message
 				delete textMessage;
 			}else{
-				//charging all data description in message
-				loadPacketDesc(activeMessageToSend);
+				Message* parametersMessage=NULL;
+
+				if (binaryMessage){
+					//whole message encoded in only one buffer
+					parametersMessage=createBinaryMessage(session,activeMessageToSend);
+				}else{
+					//charging all data description in message
+					loadPacketDesc(activeMessageToSend);
 
-				//creating message text
-				StreamMessage* streamMessage=session->createStreamMessage();
-				streamMessage->setCMSType("ActiveMessage");
+					//creating message text
+					StreamMessage* streamMessage=session->createStreamMessage();
+					streamMessage->setCMSType("ActiveMessage");
 
-				////////////////////////////////////////////////////////////////////////////////////////
-				insertParameters(streamMessage,activeMessageToSend);
-				insertUserProperties(streamMessage,activeMessageToSend);
+					////////////////////////////////////////////////////////////////////////////////////////
+					insertParameters(streamMessage,activeMessageToSend);
+					insertUserProperties(streamMessage,activeMessageToSend);
+					parametersMessage=streamMessage;
+				}
 
 				//Set the correlation ID from the received message to be the correlation id of the response message
 				//this lets the client identify which message this is a response to if it has more than
 				//one outstanding message to the server
-				streamMessage->setCMSCorrelationID(activeMessageToSend.getCorrelationId());
+				parametersMessage->setCMSCorrelationID(activeMessageToSend.getCorrelationId());
 
 				//sending message
 				if (activeMessageToSend.getDestination().getReplyTo()){
-					replyProducer->send(activeMessageToSend.getDestination().getReplyTo(),streamMessage);
+					replyProducer->send(activeMessageToSend.getDestination().getReplyTo(),parametersMessage);
 					isQueueReadyAgain(activeMessageToSend);
 				}else{
 					throw ActiveException ("ERROR: Unknown request reply destination.");
@@ -560,7 +607,7 @@ int ActiveConsumer::send(){
 				LOG4CXX_DEBUG(logger, logMessage.str().c_str());
 
 				//deleting memory for message
-				delete streamMessage;
+				delete parametersMessage;
 			}
 			return 0;
 
@@ -617,6 +664,12 @@ void ActiveConsumer::insertParameters(StreamMessage* streamMessage, ActiveMessag
 				streamMessage->writeBytes(bytesParameter->getValue());
 			}
 			break;
+			case ACTIVE_INT_ARRAY_PARAMETER:
+			case ACTIVE_REAL_ARRAY_PARAMETER:
+			case ACTIVE_INT64_ARRAY_PARAMETER:{
+				writeArrayParameter(streamMessage,key,parameter);
+			}
+			break;
 			}
 		}
 	}catch (CMSException& e){
@@ -899,6 +952,8 @@ void ActiveConsumer::close() {
 	//cleaning up
 	cleanup();
 
+	logCompressionStats();
+
 	logMessage.str("");
 	logMessage << "Consumer::close. Consumer " << getId()<< " connected to " << getIpBroker() << " " << getDestination() << " closed succesfully!";
 	LOG4CXX_INFO(logger, logMessage.str().c_str());
@@ -280,6 +280,22 @@ namespace ai{
 		 */
 		int deliver (ActiveMessage& activeMessageR, ActiveLink& activeLink){return -1;}
 
+		/**
+		 * Consumers have not persistence, nothing is replayed
+		 *
+		 * @param messages messages read from the persistence
+		 *
+		 * @return number of messages enqueued, always 0
+		 */
+		unsigned int replay (const std::vector<ActiveMessage>& messages) throw (ActiveException){return 0;}
+
+		/**
+		 * Consumers have not persistence, there are no histograms
+		 *
+		 * @return always false
+		 */
+		bool getDurabilityStats (ActiveHistogram& commitLatencyR, ActiveHistogram& syncBatchSizeR){return false;}
+
 		/**
 		 * Method that initializes some things that connections needs
 		 */
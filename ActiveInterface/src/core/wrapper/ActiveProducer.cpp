@@ -26,6 +26,8 @@
  */
 
 #include "ActiveProducer.h"
+#include "../persistence/ActiveSnapshot.h"
+#include "../ActiveManager.h"
 #include "../../utils/exception/ActiveException.h"
 
 #include <activemq/core/ActiveMQConnectionFactory.h>
@@ -77,6 +79,7 @@ ActiveProducer::ActiveProducer(	std::string& idR,
 	producer = NULL;
     tempDest=NULL;
     responseConsumer=NULL;
+    sendSync.reset(new ActiveSendSync());
 
     init();
 }
@@ -96,12 +99,10 @@ void ActiveProducer::init (){
     activeCallbackThread.init(activeCallbackQueue);
     activeCallbackThread.runCallbackThread();
 
-    activePersistence.init(*this);
-
-	//method to know if the application crash and
-	//we have to resend messages that was not sent but
-	//was serialized.
-	activePersistence.crashRecovery();
+    //persistence is initialized when it is used, see startPersistence
+    apr_atomic_set32(&persistenceStarted,0);
+    apr_atomic_set32(&spilling,0);
+    apr_atomic_set32(&interrupted,0);
 
     //initializing ssl support
 	#ifdef WITH_SSL
@@ -110,12 +111,119 @@ void ActiveProducer::init (){
     ////////////////////////////////////////////////
 }
 
+void ActiveProducer::startPersistence(){
+	if (apr_atomic_read32(&persistenceStarted)==0){
+		activateRecoveryMutex.lock();
+		try{
+			if (apr_atomic_read32(&persistenceStarted)==0){
+				activePersistence.init(*this);
+
+				//method to know if the application crash and
+				//we have to resend messages that was not sent but
+				//was serialized.
+				activePersistence.crashRecovery();
+				//set last, a thread that reads 1 finds the persistence initialized
+				apr_atomic_set32(&persistenceStarted,1);
+			}
+		}catch (...){
+			activateRecoveryMutex.unlock();
+			throw;
+		}
+		activateRecoveryMutex.unlock();
+	}
+}
+
+std::string ActiveProducer::getSnapshotPath(){
+	std::stringstream path;
+	path << "snapshot_file_" << getId();
+	return path.str();
+}
+
+void ActiveProducer::loadSnapshot(){
+	std::stringstream logMessage;
+	std::vector<ActiveMessage> messages;
+	std::string path=getSnapshotPath();
+
+	try{
+		if (!ActiveSnapshot::read(path,messages)){
+			return;
+		}
+		unsigned int restored=activeQueue.restore(messages);
+		for (unsigned int i=0; i<restored; i++){
+			activeThread.newMessage(true);
+		}
+		ActiveSnapshot::remove(path);
+		logMessage << "Producer " << getId() << " enqueued " << restored << " messages of the snapshot " << path;
+		LOG4CXX_INFO(logger, logMessage.str().c_str());
+		if (restored<messages.size()){
+			logMessage.str("");
+			logMessage << "POSSIBLE DATA LOSS. " << (messages.size()-restored) << " messages of the snapshot "
+					<< path << " do not fit in the queue of producer " << getId();
+			LOG4CXX_ERROR(logger, logMessage.str().c_str());
+		}
+	}catch (ActiveException& ae){
+		logMessage << "Snapshot of producer " << getId() << " could not be read. " << ae.getMessage();
+		LOG4CXX_ERROR(logger, logMessage.str().c_str());
+	}
+}
+
+void ActiveProducer::takeSnapshot(){
+	std::stringstream logMessage;
+	std::vector<ActiveMessage> messages;
+
+	if (!getSnapshot() || getSizePersistence()>0){
+		return;
+	}
+	//nothing more is sent, the producer is closed after it
+	setState(CONNECTION_CLOSED);
+	activeThread.stop();
+
+	//the sender does not dequeue while the messages are taken
+	activateRecoveryMutex.lock();
+	try{
+		activeQueue.takeAll(messages);
+		activateRecoveryMutex.unlock();
+	}catch (ActiveException& ae){
+		activateRecoveryMutex.unlock();
+		logMessage << "POSSIBLE DATA LOSS. Snapshot of producer " << getId() << " not written. " << ae.getMessage();
+		LOG4CXX_ERROR(logger, logMessage.str().c_str());
+		return;
+	}
+	if (messages.empty()){
+		return;
+	}
+	try{
+		ActiveSnapshot::write(getSnapshotPath(),messages);
+		for (unsigned int i=0; i<messages.size(); i++){
+			completeSend(messages[i],ACTIVE_SEND_PERSISTED,0);
+		}
+		logMessage << "Producer " << getId() << " wrote " << messages.size() << " messages in memory to the snapshot "
+				<< getSnapshotPath();
+		LOG4CXX_INFO(logger, logMessage.str().c_str());
+	}catch (ActiveException& ae){
+		//back to the queue, so the close reports them
+		activeQueue.restore(messages);
+		logMessage << "POSSIBLE DATA LOSS. Snapshot of producer " << getId() << " not written. " << ae.getMessage();
+		LOG4CXX_ERROR(logger, logMessage.str().c_str());
+	}
+}
+
 void ActiveProducer::run() throw (ActiveException){
 
 	std::stringstream logMessage;
 
 	try {
 
+		//messages in memory when the library was closed are sent before the new ones
+		if (getSnapshot() && getSizePersistence()==0){
+			loadSnapshot();
+		}
+
+		//recovery threads of the manager do it, a message delivered before waits for it
+		if (!getDeferredPersistence()){
+			startPersistence();
+		}
+
 		//if connection is initiated before, dont do anything
 		if (getState()==CONNECTION_RUNNING){
 
@@ -215,6 +323,9 @@ int ActiveProducer::send(){
 	std::stringstream logMessage;
 	bool dequeuedInRecovery=false;
 	ActiveMessage activeMessageToSend;
+	unsigned int batched=0;
+	unsigned int notPersisted=0;
+	apr_time_t sendStart=0;
 
 	try{
 
@@ -235,14 +346,29 @@ int ActiveProducer::send(){
 
 		activeThread.newMessage(false);
 
-		activeQueue.dequeue(activeMessageToSend);
+		//messages that could not be spilled are removed, their signals find the queue empty
+		if (!activeQueue.dequeue(activeMessageToSend)){
+			activateRecoveryMutex.unlock();
+			return 0;
+		}
 		if (activePersistence.getRecoveryMode()){
 			dequeuedInRecovery=true;
 		}
 
+		//messages ready at the same time are packed in one envelope, request reply
+		//messages need their own correlation id and recovery sends one by one
+		if (isBatching() && !dequeuedInRecovery){
+			batched=dequeueBatch(activeMessageToSend);
+		}
+		//with spill the first messages can be only in memory, they are not counted as sent
+		notPersisted=activeQueue.takeDequeuedNotPersisted();
+
 		if (connection != NULL || session != NULL || destination != NULL || producer != NULL){
 
-			if (activeMessageToSend.isTextMessage()){
+			//parameter messages in binary format and big texts to compress
+			bool binaryMessage=batched>0 || isSentAsBinary(activeMessageToSend);
+
+			if (activeMessageToSend.isTextMessage() && !binaryMessage){
 
 				//sending a textMessage
 				TextMessage* textMessage=session->createTextMessage(activeMessageToSend.getText());
@@ -265,61 +391,82 @@ int ActiveProducer::send(){
 				LOG4CXX_DEBUG(logger, logMessage.str().c_str());
 
 				//sending message
+				sendStart=apr_time_now();
 				producer->send(	textMessage,
 								getPersistent(),
 								activeMessageToSend.getPriority(),
 								activeMessageToSend.getTimeToLive());
+				completeSends(activeMessageToSend,0,notPersisted,true,apr_time_now()-sendStart);
 
 				if (getState()!=CONNECTION_CLOSED){
 
 					isQueueReadyAgain(activeMessageToSend);
 
-					activePersistence.oneMoreSent(dequeuedInRecovery);
+					if (notPersisted==0){
+						activePersistence.oneMoreSent(dequeuedInRecovery);
+					}
+					oneMoreBatch(1);
 				}
 
 				//deleting memory for message
 				delete textMessage;
 			}else{
-				//charging all data description in message
-				loadPacketDesc(activeMessageToSend);
+				Message* parametersMessage=NULL;
+
+				if (batched>0){
+					//all messages in only one envelope
+					parametersMessage=createEnvelopeMessage(session,activeMessageToSend,batchMessages,batched);
+				}else if (binaryMessage){
+					//whole message encoded in only one buffer
+					parametersMessage=createBinaryMessage(session,activeMessageToSend);
+				}else{
+					//charging all data description in message
+					loadPacketDesc(activeMessageToSend);
 
-				//creating message text
-				StreamMessage* streamMessage=session->createStreamMessage();
-				streamMessage->setCMSType("ActiveMessage");
+					//creating message text
+					StreamMessage* streamMessage=session->createStreamMessage();
+					streamMessage->setCMSType("ActiveMessage");
 
-				////////////////////////////////////////////////////////////////////////////////////////
-				insertParameters(streamMessage,activeMessageToSend);
-				insertUserProperties(streamMessage,activeMessageToSend);
+					////////////////////////////////////////////////////////////////////////////////////////
+					insertParameters(streamMessage,activeMessageToSend);
+					insertUserProperties(streamMessage,activeMessageToSend);
+					parametersMessage=streamMessage;
+				}
 
 				//inserting properties for request reply
 				//current time for determines each packet and only one
 				if (getRequestReply()){
 					//to know where to answer
-					streamMessage->setCMSReplyTo(tempDest);
+					parametersMessage->setCMSReplyTo(tempDest);
 					//user has defined correlation id
-					streamMessage->setCMSCorrelationID(activeMessageToSend.getCorrelationId());
+					parametersMessage->setCMSCorrelationID(activeMessageToSend.getCorrelationId());
 				}
 
 				//mutex for starting recovery mode
 				activateRecoveryMutex.unlock();
 
 				//sending message
-				producer->send(	streamMessage,
+				sendStart=apr_time_now();
+				producer->send(	parametersMessage,
 								getPersistent(),
 								activeMessageToSend.getPriority(),
 								activeMessageToSend.getTimeToLive());
+				completeSends(activeMessageToSend,batched,notPersisted,true,apr_time_now()-sendStart);
 
 				if (getState()!=CONNECTION_CLOSED){
 					isQueueReadyAgain(activeMessageToSend);
 
-					activePersistence.oneMoreSent(dequeuedInRecovery);
+					for (unsigned int it=notPersisted; it<=batched; it++){
+						activePersistence.oneMoreSent(dequeuedInRecovery);
+					}
+					oneMoreBatch(batched+1);
 
-					logMessage << "ActiveMessage sent from connection "<< getId() << " to queue " << getDestination();
+					logMessage << (batched+1) << " ActiveMessage sent from connection "<< getId() << " to queue " << getDestination();
 					LOG4CXX_DEBUG(logger, logMessage.str().c_str());
 				}
 
 				//deleting memory for message
-				delete streamMessage;
+				delete parametersMessage;
 			}
 			//mutex for starting recovery mode
 			activateRecoveryMutex.unlock();
@@ -330,6 +477,8 @@ int ActiveProducer::send(){
 			LOG4CXX_ERROR(logger, logMessage.str().c_str());
 			//mutex for starting recovery mode
 			activateRecoveryMutex.unlock();
+			notPersisted=spillNotSent(activeMessageToSend,notPersisted);
+			completeSends(activeMessageToSend,batched,notPersisted,false,0,logMessage.str());
 			return -1;
 		}
 		return 1;
@@ -338,6 +487,8 @@ int ActiveProducer::send(){
 		activateRecoveryMutex.unlock();
 		logMessage << "Producer::sendData CMSException: " << ae.getMessage();
 		LOG4CXX_ERROR(logger, logMessage.str().c_str());
+		notPersisted=spillNotSent(activeMessageToSend,notPersisted);
+		completeSends(activeMessageToSend,batched,notPersisted,false,sendStart>0?apr_time_now()-sendStart:0,ae.getMessage());
 		return -1;
 	}catch (CMSException& cmse){
 		//mutex for starting recovery mode
@@ -345,6 +496,8 @@ int ActiveProducer::send(){
 		logMessage.str("Producer received a CMSException. We are going to close it. Reason: ");
 		logMessage << cmse.what() << getId();
 		LOG4CXX_FATAL (logger,logMessage.str().c_str());
+		notPersisted=spillNotSent(activeMessageToSend,notPersisted);
+		completeSends(activeMessageToSend,batched,notPersisted,false,sendStart>0?apr_time_now()-sendStart:0,cmse.what());
 		return -1;
 	}
 }
@@ -387,6 +540,12 @@ void ActiveProducer::insertParameters(StreamMessage* streamMessage, ActiveMessag
 				streamMessage->writeBytes(bytesParameter->getValue());
 			}
 			break;
+			case ACTIVE_INT_ARRAY_PARAMETER:
+			case ACTIVE_REAL_ARRAY_PARAMETER:
+			case ACTIVE_INT64_ARRAY_PARAMETER:{
+				writeArrayParameter(streamMessage,key,parameter);
+			}
+			break;
 			}
 		}
 	}catch (CMSException& e){
@@ -482,11 +641,21 @@ int ActiveProducer::onReceive(){
 
 	std::vector<unsigned char> packetDesc(MAX_PARAMETERS);
 
+	//buffer reused to read bytes parameters
+	std::vector<unsigned char> data;
+	data.reserve(MAX_PARAMETERS);
+
+	//message reused for every message received, recycling it keeps
+	//its parameters and buffers so steady consumption does not allocate.
+	//Binary messages are only decoded when the user asks for them.
+	ActiveMessageView messageView;
+	ActiveMessage& activeMessage=messageView.getMessageHeader();
+
 	try{
 		//loop to get messages
 		while (!getEndConsumerThread()){
 
-			ActiveMessage activeMessage;
+			messageView.recycle();
 			activeMessage.setConnectionId(getId());
 			std::auto_ptr<Message> message( responseConsumer->receive() );
 			if (message.get()!=NULL){
@@ -518,13 +687,18 @@ int ActiveProducer::onReceive(){
 							break;
 							case ACTIVE_BYTES_PARAMETER:{
 								std::string key=streamMessage->readString();
-								int sizeBytesData=packetDesc.at(++it);
-								std::vector<unsigned char> data(sizeBytesData);
-								streamMessage->readBytes(data);
-								streamMessage->readBytes(data);
+								//size in packet description is only one byte, it is skipped
+								++it;
+								readBytesField(streamMessage,data);
 								activeMessage.insertBytesParameter(key,data);
 							}
 							break;
+							case ACTIVE_INT_ARRAY_PARAMETER:
+							case ACTIVE_REAL_ARRAY_PARAMETER:
+							case ACTIVE_INT64_ARRAY_PARAMETER:{
+								readArrayParameter(streamMessage,packetDesc[it],activeMessage);
+							}
+							break;
 							case ACTIVE_INT_PROPERTY:{
 								std::string key=streamMessage->readString();
 								int value=streamMessage->getIntProperty(key);
@@ -549,6 +723,22 @@ int ActiveProducer::onReceive(){
 						logMessage << "Consumer::onMessage. Exceptions ocurred when message received. Packet description error";
 						LOG4CXX_DEBUG(logger, logMessage.str().c_str());
 					}
+
+				}else if (message->getCMSType()==ACTIVE_BINARY_CMS_TYPE){
+					////////////////////////////////////////////////////////////////////
+					/// Active message in binary format
+					try{
+						readBinaryMessage((BytesMessage*)message.get(),messageView);
+					}catch (ActiveException& ae){
+						//discarding the message, not the consumer
+						logMessage << "Consumer::onMessage. Binary message discarded. "<< ae.getMessage();
+						LOG4CXX_ERROR(logger, logMessage.str().c_str());
+						logMessage.str("");
+						if( getClientAck() ) {
+							message->acknowledge();
+						}
+						continue;
+					}
 				/////////////////////////////////////////////////////////////
 				// text message
 				}else{
@@ -562,21 +752,26 @@ int ActiveProducer::onReceive(){
 				logMessage << "Message received from connection "<< getId() << std::endl;
 				LOG4CXX_DEBUG(logger, logMessage.str().c_str());
 
-				//inserting in message if i can answer if is a request reply consumer
-				if (getRequestReply()){
-					//setting parameter for how to make the answer
-					activeMessage.setRequestReply(true);
-					//Set the correlation ID from the received message
-					std::string corId=message->getCMSCorrelationID();
-					activeMessage.setCorrelationId(corId);
-					//setting requestReply destination
-					activeMessage.cloneDestination(message->getCMSReplyTo());
-				}
+				//an envelope has several messages, a callback for each one
+				do{
+					activeMessage.setConnectionId(getId());
+
+					//inserting in message if i can answer if is a request reply consumer
+					if (getRequestReply()){
+						//setting parameter for how to make the answer
+						activeMessage.setRequestReply(true);
+						//Set the correlation ID from the received message
+						std::string corId=message->getCMSCorrelationID();
+						activeMessage.setCorrelationId(corId);
+						//setting requestReply destination
+						activeMessage.cloneDestination(message->getCMSReplyTo());
+					}
 
-				//setting others parameters to the message
-				activeMessage.setLinkId(getLinkId());
-				//sending callback to user with message
-				ActiveManager::getInstance()->onMessageCallback(activeMessage);
+					//setting others parameters to the message
+					activeMessage.setLinkId(getLinkId());
+					//sending callback to user with message
+					ActiveManager::getInstance()->onMessageCallback(messageView);
+				}while (nextEnvelopeMessage(messageView));
 
 				//message read sending acknowledge
 				if( getClientAck() ) {
@@ -660,15 +855,19 @@ int ActiveProducer::deliver (ActiveMessage& activeMessageR, ActiveLink& activeLi
 	std::stringstream logMessage;
 	std::list<std::string> defaultPropertysAdd;
 	int position=-1;
+	bool spillLocked=false;
 	try{
 
 		//if connection is running accepting messages into the queue
 		if (getState()==CONNECTION_CLOSED){
 			logMessage << "ERROR: Producer connection "<< getId() << " was closed.";
 			LOG4CXX_ERROR(logger, logMessage.str().c_str());
+			completeSend(activeMessageR,ACTIVE_SEND_FAILED,0,logMessage.str());
 			return -1;
 		}
 
+		startPersistence();
+
 		//setting the connection id to the message to be marked
 		activeMessageR.setConnectionId(getId());
 
@@ -676,11 +875,21 @@ int ActiveProducer::deliver (ActiveMessage& activeMessageR, ActiveLink& activeLi
 		//this properties are default properties
 		copyDefaultProperties(activeMessageR,activeLink,defaultPropertysAdd);
 
+		//with spill the message is only kept in memory if the connection is healthy
+		if (isSpillOnly()){
+			spillMutex.lock();
+			spillLocked=true;
+			position=enqueueInMemory(activeMessageR);
+		}
+		bool inMemory=(position!=-1);
+
 		//serializing the object into persistence file
-		activePersistence.serialize(activeMessageR);
+		if (!inMemory){
+			activePersistence.serialize(activeMessageR);
+		}
 
 		//enqueue the message we are going to return the position in the queue
-		if (!activePersistence.getRecoveryMode()){
+		if (!inMemory && !activePersistence.getRecoveryMode()){
 
 			position=activeQueue.enqueue(activeMessageR);
 
@@ -720,23 +929,152 @@ int ActiveProducer::deliver (ActiveMessage& activeMessageR, ActiveLink& activeLi
 				LOG4CXX_DEBUG (logger,logMessage.str().c_str());
 			}
 		}
+		if (spillLocked){
+			spillMutex.unlock();
+		}
+		//messages not kept in memory are sent from the persistence, without handle
+		if (position==-1){
+			completeSend(activeMessageR,activePersistence.isEnabled()?ACTIVE_SEND_PERSISTED:ACTIVE_SEND_FAILED,0,
+					"Message not enqueued in memory");
+		}
 		//removing default properties
 		removeDefaultProperties(activeMessageR,defaultPropertysAdd);
 		return position;
 
 	}catch(ActiveException e){
+		if (spillLocked){
+			spillMutex.unlock();
+		}
 		removeDefaultProperties(activeMessageR,defaultPropertysAdd);
 		logMessage 	<< "POSSIBLE DATA LOSS.. Error inserting message into the queue.  "
 					<< e.getMessage();
+		completeSend(activeMessageR,ACTIVE_SEND_FAILED,0,logMessage.str());
 		throw ActiveException (logMessage.str());
 	}catch (...){
+		if (spillLocked){
+			spillMutex.unlock();
+		}
 		removeDefaultProperties(activeMessageR,defaultPropertysAdd);
 		logMessage 	<< "POSSIBLE DATA LOSS. Unknown error delivering data into the queue.  ";
+		completeSend(activeMessageR,ACTIVE_SEND_FAILED,0,logMessage.str());
 		throw ActiveException (logMessage.str());
 	}
 	return -1;
 }
 
+int ActiveProducer::enqueueInMemory(ActiveMessage& activeMessageR) throw (ActiveException){
+	std::stringstream logMessage;
+
+	unsigned int maxSize=activeQueue.getMaxSizeQueue();
+	bool healthy=getState()==CONNECTION_RUNNING && apr_atomic_read32(&interrupted)==0 && !activePersistence.getRecoveryMode() &&
+			(maxSize==0 || activeQueue.getSizeQueue()*100<maxSize*(unsigned int)getSpillWatermark());
+	if (apr_atomic_read32(&spilling)!=0){
+		//messages are kept in memory again when the ones persisted are sent
+		if (!healthy || !activePersistence.isDrained()){
+			return -1;
+		}
+		apr_atomic_set32(&spilling,0);
+		logMessage << "Producer " << getId() << " keeps the messages only in memory again";
+		LOG4CXX_INFO(logger, logMessage.str().c_str());
+	}
+	if (healthy){
+		int position=activeQueue.enqueue(activeMessageR,false);
+		if (position!=-1){
+			activeThread.newMessage(true);
+			return position;
+		}
+	}
+	spill(healthy?"the queue is full":"the connection is not running or the queue is over the watermark");
+	return -1;
+}
+
+void ActiveProducer::spill(const char* reason){
+	std::stringstream logMessage;
+	std::vector<ActiveMessage> messages;
+	unsigned int persisted=0;
+	bool copied=false;
+
+	if (apr_atomic_read32(&spilling)!=0 || !isSpillOnly()){
+		return;
+	}
+	//the sender does not dequeue while the messages in memory are persisted,
+	//they are before any message persisted so the order is kept
+	activateRecoveryMutex.lock();
+	try{
+		activeQueue.spillNotPersisted(messages);
+		copied=true;
+		for (; persisted<messages.size(); persisted++){
+			activePersistence.serialize(messages[persisted]);
+			activePersistence.oneMoreEnqueued();
+		}
+	}catch (ActiveException& ae){
+		logMessage << "POSSIBLE DATA LOSS. Messages in memory of producer " << getId() << " could not be persisted. " << ae.getMessage();
+		LOG4CXX_ERROR(logger, logMessage.str().c_str());
+	}
+	//the ones not written leave the queue, they have not a record to count them as sent
+	if (copied){
+		activeQueue.spilled(persisted);
+	}
+	activateRecoveryMutex.unlock();
+	for (unsigned int i=0; i<messages.size(); i++){
+		if (i<persisted){
+			completeSend(messages[i],ACTIVE_SEND_PERSISTED,0);
+		}else{
+			completeSend(messages[i],ACTIVE_SEND_FAILED,0,logMessage.str());
+		}
+	}
+	logMessage.str("");
+	//it is tried again with the next message kept in memory
+	if (!copied || persisted<messages.size()){
+		logMessage << "Producer " << getId() << " could not persist the messages, " << reason << ". "
+				<< persisted << " of " << messages.size() << " messages in memory persisted, the rest are not sent";
+		LOG4CXX_ERROR(logger, logMessage.str().c_str());
+		return;
+	}
+	apr_atomic_set32(&spilling,1);
+	logMessage << "Producer " << getId() << " persists the messages, " << reason << ". "
+			<< messages.size() << " messages in memory persisted";
+	LOG4CXX_INFO(logger, logMessage.str().c_str());
+}
+
+unsigned int ActiveProducer::spillNotSent(ActiveMessage& first, unsigned int notPersisted){
+	std::stringstream logMessage;
+	unsigned int persisted=0;
+
+	if (notPersisted==0 || !isSpillOnly()){
+		return notPersisted;
+	}
+	//new messages are not delivered until the ones in memory are persisted after these
+	spillMutex.lock();
+	activateRecoveryMutex.lock();
+	try{
+		for (; persisted<notPersisted; persisted++){
+			ActiveMessage& activeMessage=(persisted==0)?first:batchMessages[persisted-1];
+			activePersistence.serialize(activeMessage);
+			activePersistence.oneMoreEnqueued();
+		}
+	}catch (ActiveException& ae){
+		logMessage << "POSSIBLE DATA LOSS. Messages of producer " << getId() << " not sent could not be persisted. " << ae.getMessage();
+		LOG4CXX_ERROR(logger, logMessage.str().c_str());
+		for (unsigned int it=persisted; it<notPersisted; it++){
+			completeSend((it==0)?first:batchMessages[it-1],ACTIVE_SEND_FAILED,0,logMessage.str());
+		}
+		logMessage.str("");
+	}
+	activateRecoveryMutex.unlock();
+	if (persisted==notPersisted){
+		if (apr_atomic_read32(&spilling)!=0){
+			logMessage << "Producer " << getId() << " persisted " << persisted << " messages not sent after messages "
+					<< "delivered while they were being sent, they are sent later than them";
+			LOG4CXX_ERROR(logger, logMessage.str().c_str());
+		}
+		spill("a message could not be sent");
+	}
+	spillMutex.unlock();
+	//the ones not persisted are already completed, the rest as the other ones persisted
+	return 0;
+}
+
 int ActiveProducer::deliver (ActiveMessage& activeMessageR)	throw (ActiveException){
 
 	std::stringstream logMessage;
@@ -790,6 +1128,35 @@ int ActiveProducer::deliver (ActiveMessage& activeMessageR)	throw (ActiveExcepti
 	return -1;
 }
 
+unsigned int ActiveProducer::replay (const std::vector<ActiveMessage>& messages)	throw (ActiveException){
+
+	std::stringstream logMessage;
+
+	if (getState()==CONNECTION_CLOSED){
+		logMessage << "ERROR: Producer in persistence was enqueuing data to connection "<<
+						getId() << ", but was closed.";
+		LOG4CXX_ERROR(logger, logMessage.str().c_str());
+		return 0;
+	}
+	//the persistence reads again the ones that do not fit
+	unsigned int restored=activeQueue.restore(messages);
+	for (unsigned int i=0; i<restored; i++){
+		activeThread.newMessage(true);
+	}
+	logMessage << restored << " recovered messages enqueued in connection " << getId();
+	LOG4CXX_DEBUG(logger, logMessage.str().c_str());
+	return restored;
+}
+
+bool ActiveProducer::getDurabilityStats (ActiveHistogram& commitLatencyR, ActiveHistogram& syncBatchSizeR){
+	if (!activePersistence.isEnabled()){
+		return false;
+	}
+	activePersistence.getCommitLatency().snapshot(commitLatencyR);
+	activePersistence.getSyncBatchSize().snapshot(syncBatchSizeR);
+	return true;
+}
+
 void ActiveProducer::removeDefaultProperties(	ActiveMessage& activeMessage,
 												std::list<std::string>& defaultPropertiesAdd)
 	throw (ActiveException){
@@ -884,6 +1251,13 @@ void ActiveProducer::transportInterrupted() {
 	try{
 		logMessage << "Producer::transportInterrupted. The Connection's Transport has been interrupted."<< getClientId();
 		LOG4CXX_DEBUG(logger, logMessage.str().c_str());
+		//messages only in memory are persisted until the transport is resumed
+		apr_atomic_set32(&interrupted,1);
+		if (isSpillOnly()){
+			spillMutex.lock();
+			spill("the transport is interrupted");
+			spillMutex.unlock();
+		}
 		//making the object
 		ActiveCallbackObject activeCallbackObject(	ON_TRANSPORT_INTERRUPT,
 													getId());
@@ -902,6 +1276,7 @@ void ActiveProducer::transportResumed() {
 	try{
 		logMessage << "Producer::transportResumed. The Connection's Transport has been Restored."<< getClientId();
 		LOG4CXX_DEBUG(logger, logMessage.str().c_str());
+		apr_atomic_set32(&interrupted,0);
 		//making the object
 		ActiveCallbackObject activeCallbackObject(	ON_TRANSPORT_RESUMED,
 													getId());
@@ -913,6 +1288,53 @@ void ActiveProducer::transportResumed() {
 	}
 }
 
+unsigned int ActiveProducer::dequeueBatch(const ActiveMessage& first){
+
+	unsigned int batched=0;
+
+	if (batchMessages.size()<(unsigned int)getBatchSize()-1){
+		batchMessages.resize(getBatchSize()-1);
+	}
+	while (batched<(unsigned int)getBatchSize()-1){
+		ActiveMessage& activeMessage=batchMessages[batched];
+		activeMessage.recycle();
+		if (!activeQueue.dequeueBatchable(first,activeMessage)){
+			break;
+		}
+		activeThread.newMessage(false);
+		batched++;
+	}
+	return batched;
+}
+
+void ActiveProducer::completeSend(ActiveMessage& activeMessageR, int state, long long latency, const std::string& error){
+	ActiveSendHandle* sendHandle=activeMessageR.getSendHandle();
+	if (sendHandle!=NULL){
+		if (sendHandle->complete(state,latency,error)){
+			ActiveManager::getInstance()->onMessageSentCallback(*sendHandle);
+		}
+		activeMessageR.releaseSendHandle();
+	}
+}
+
+void ActiveProducer::completeSends(	ActiveMessage& first,
+									unsigned int batched,
+									unsigned int notPersisted,
+									bool sent,
+									long long latency,
+									const std::string& error){
+
+	for (unsigned int it=0; it<=batched; it++){
+		ActiveMessage& activeMessage=(it==0)?first:batchMessages[it-1];
+		int state=ACTIVE_SEND_DONE;
+		if (!sent){
+			//messages persisted are sent again when the connection is recovered
+			state=(it>=notPersisted && activePersistence.isEnabled())?ACTIVE_SEND_PERSISTED:ACTIVE_SEND_FAILED;
+		}
+		completeSend(activeMessage,state,latency,error);
+	}
+}
+
 void ActiveProducer::isQueueReadyAgain(ActiveMessage& activeMessageR){
 	if (!activeQueue.getWorkingState()){
 		activeQueue.setWorkingState(true);
@@ -949,6 +1371,14 @@ void ActiveProducer::stop(){
 		//activePersistence.stopThread();
 		//ending the producer thread
 		activeThread.stop();
+		//messages only in memory are persisted so they are sent when it is run again
+		if (isSpillOnly()){
+			spillMutex.lock();
+			spill("the producer is stopped");
+			spillMutex.unlock();
+		}
+		//last messages sent written to the control file
+		activePersistence.checkpoint();
 		//clean up
 		cleanup();
 
@@ -966,11 +1396,6 @@ void ActiveProducer::close() {
 	logMessage << "Producer::close. Closing producer " << getIpBroker() <<" " << getDestination()<< "...";
 	LOG4CXX_INFO(logger, logMessage.str().c_str());
 
-	if (activeQueue.getSizeQueue()>0){
-		logMessage.str("Producer::close. POSSIBLE DATA LOSS. There are pending messages in buffer to send.");
-		LOG4CXX_ERROR(logger, logMessage.str().c_str());
-	}
-
 	//setting state to close
 	setState(CONNECTION_CLOSED);
 	//removing link connected to this producer
@@ -981,16 +1406,58 @@ void ActiveProducer::close() {
 	activePersistence.stopThread();
 	//ending the producer thread
 	activeThread.stop();
+	//messages only in memory are persisted so they are sent when it is run again
+	if (isSpillOnly()){
+		spillMutex.lock();
+		spill("the producer is closed");
+		spillMutex.unlock();
+	}
+	//messages not sent are completed, nobody waits for them forever
+	failPending();
+	//last messages sent written to the control file
+	activePersistence.checkpoint();
 	//ending the callback thread
 	activeCallbackThread.stop();
 	//clean up
 	cleanup();
 
+	logCompressionStats();
+	logBatchStats();
+	activePersistence.logDurabilityStats();
+
 	logMessage.str("");
 	logMessage << "Producer::close. Producer " <<  getId()<< " connected to " << getIpBroker() << " " << getDestination()<< " closed succesfully!";
 	LOG4CXX_INFO(logger, logMessage.str().c_str());
 }
 
+void ActiveProducer::failPending(){
+	std::stringstream logMessage;
+	std::vector<ActiveMessage> messages;
+
+	try{
+		activeQueue.takeAll(messages);
+	}catch (ActiveException& ae){
+		logMessage << "Producer::close. Messages pending of producer " << getId() << " could not be taken. " << ae.getMessage();
+		LOG4CXX_ERROR(logger, logMessage.str().c_str());
+		return;
+	}
+	if (messages.empty()){
+		return;
+	}
+	//with persistence they are in the log and are sent when the producer is run again
+	int state=activePersistence.isEnabled()?ACTIVE_SEND_PERSISTED:ACTIVE_SEND_FAILED;
+	if (state==ACTIVE_SEND_FAILED){
+		logMessage << "Producer::close. POSSIBLE DATA LOSS. ";
+	}else{
+		logMessage << "Producer::close. ";
+	}
+	logMessage << messages.size() << " messages pending in buffer of producer " << getId() << " are not sent.";
+	LOG4CXX_ERROR(logger, logMessage.str().c_str());
+	for (unsigned int i=0; i<messages.size(); i++){
+		completeSend(messages[i],state,0,logMessage.str());
+	}
+}
+
 void ActiveProducer::cleanup(){
 
 	/////////////////////////////////////////////////////////////////////////////
@@ -40,6 +40,8 @@
 #include <decaf/lang/Runnable.h>
 #include <activemq/transport/DefaultTransportListener.h>
 
+#include <apr_atomic.h>
+
 #include "log4cxx/logger.h"
 #include "log4cxx/helpers/exception.h"
 
@@ -126,6 +128,45 @@ namespace ai{
 		 */
 		ActiveMutex activateRecoveryMutex;
 
+		/**
+		 * 1 once the persistence was initialized. It is read without the
+		 * mutex by the producer and by the recovery threads of the manager
+		 */
+		volatile apr_uint32_t persistenceStarted;
+
+		/**
+		 * With spill, 1 while messages are persisted, 0 while they are only
+		 * kept in memory; and mutex that keeps the order of the messages
+		 * delivered when it changes. It is changed with the mutex locked.
+		 */
+		volatile apr_uint32_t spilling;
+		ActiveMutex spillMutex;
+
+		/**
+		 * 1 if the transport with the broker is interrupted. It is written by
+		 * the transport threads and read by the ones that deliver
+		 */
+		volatile apr_uint32_t interrupted;
+
+		/**
+		 * Messages dequeued together with the one being sent, packed in the
+		 * same envelope. Reused between sends.
+		 */
+		std::vector<ActiveMessage> batchMessages;
+
+		/**
+		 * Mutex and condition shared by the handles of the messages sent
+		 * asynchronously through the producer
+		 */
+		boost::shared_ptr<ActiveSendSync> sendSync;
+
+		/**
+		 * Method that empties the queue when the producer is closed and completes
+		 * the handles of the messages not sent, as persisted if the persistence
+		 * keeps them or as failed
+		 */
+		void failPending();
+
 		/**
 		 * Method that delete all structures for broker connection, close connection
 		 * and free resources
@@ -243,6 +284,100 @@ namespace ai{
 		 */
 		void isQueueReadyAgain(ActiveMessage& activeMessageR);
 
+		/**
+		 * Method that dequeues the messages that are ready and can be sent in the
+		 * same envelope that first, up to batch size.
+		 *
+		 * @param first message that starts the envelope
+		 *
+		 * @return number of messages dequeued into batchMessages
+		 */
+		unsigned int dequeueBatch(const ActiveMessage& first);
+
+		/**
+		 * Method that completes the handle of a message sent asynchronously
+		 * and invokes the callback of the user, the message releases it.
+		 *
+		 * @param activeMessageR message with the handle, if any
+		 * @param state state of the send
+		 * @param latency microseconds that the send to the broker took
+		 * @param error description of the error if it was not sent
+		 */
+		void completeSend(ActiveMessage& activeMessageR, int state, long long latency, const std::string& error="");
+
+		/**
+		 * Method that completes the handles of a message and the ones sent in its
+		 * envelope. If they were not sent, the ones persisted are sent again later.
+		 *
+		 * @param first first message sent
+		 * @param batched number of messages of batchMessages sent with it
+		 * @param notPersisted number of messages that were only in memory
+		 * @param sent true if the broker accepted them
+		 * @param latency microseconds that the send to the broker took
+		 * @param error description of the error if they were not sent
+		 */
+		void completeSends(	ActiveMessage& first,
+							unsigned int batched,
+							unsigned int notPersisted,
+							bool sent,
+							long long latency,
+							const std::string& error="");
+
+		/**
+		 * Method to know if messages are only persisted when they can not be
+		 * kept in memory
+		 */
+		bool isSpillOnly(){ return getSpill() && activePersistence.isEnabled();}
+
+		/**
+		 * Method that enqueues a message without persisting it, if the connection
+		 * is running and the queue is under the watermark. If not, it starts to
+		 * persist the messages. The spill mutex must be locked.
+		 *
+		 * @param activeMessageR message delivered
+		 *
+		 * @return position in the queue, -1 if the message has to be persisted
+		 *
+		 * @throws ActiveException if the message can not be enqueued
+		 */
+		int enqueueInMemory(ActiveMessage& activeMessageR) throw (ActiveException);
+
+		/**
+		 * Method that writes to the persistence the messages of the queue that
+		 * are only in memory and starts to persist the new ones. The spill mutex
+		 * must be locked. If some of them can not be written they are removed
+		 * from the queue and failed, and it is tried again with the next message.
+		 *
+		 * @param reason why the messages are persisted, for the log
+		 */
+		void spill(const char* reason);
+
+		/**
+		 * Method that writes to the persistence the messages dequeued only in
+		 * memory whose send failed, the first notPersisted of the message sent
+		 * and batchMessages, before the messages still in memory, and starts to
+		 * persist the new ones, so the order is kept.
+		 *
+		 * @param first message sent
+		 * @param notPersisted number of messages dequeued only in memory
+		 *
+		 * @return number of messages dequeued only in memory, 0 once they are
+		 * persisted; the ones that can not be persisted are completed as failed
+		 */
+		unsigned int spillNotSent(ActiveMessage& first, unsigned int notPersisted);
+
+		/**
+		 * Method that returns the path of the snapshot of the producer
+		 *
+		 * @return path of the snapshot
+		 */
+		std::string getSnapshotPath();
+
+		/**
+		 * Method that enqueues the messages of the snapshot written when the
+		 * library was closed, before any new message, and deletes it
+		 */
+		void loadSnapshot();
 	public:
 
 		/**
@@ -284,6 +419,22 @@ namespace ai{
 		 */
 		virtual void run() throw (ActiveException);
 
+		/**
+		 * Method that initializes the persistence and recovers the messages not
+		 * sent before, the first time the producer is run or a message is
+		 * delivered, or by the recovery threads of the manager. It is not done
+		 * when the producer is created, so the options of the connection loaded
+		 * after it are used.
+		 */
+		void startPersistence();
+
+		/**
+		 * Method that stops sending and writes the messages of the queue to the
+		 * snapshot of the producer, when the library is closed. Only producers
+		 * with snapshot and without persistence do it.
+		 */
+		void takeSnapshot();
+
 		/**
 		 * Method used by the thread to send messages
 		 */
@@ -309,6 +460,25 @@ namespace ai{
 		 */
 		int deliver (ActiveMessage& activeMessageR) throw (ActiveException);
 
+		/**
+		 * Method that enqueues the messages replayed by the persistence, without
+		 * congestion control and as many as fit in the queue
+		 *
+		 * @param messages messages read from the persistence
+		 * @return number of messages enqueued
+		 */
+		unsigned int replay (const std::vector<ActiveMessage>& messages) throw (ActiveException);
+
+		/**
+		 * Method that copies the histograms of the persistence
+		 *
+		 * @param commitLatencyR histogram where the commit latency is copied
+		 * @param syncBatchSizeR histogram where the messages of each sync are copied
+		 *
+		 * @return true if copied, false if the persistence is not enabled
+		 */
+		bool getDurabilityStats (ActiveHistogram& commitLatencyR, ActiveHistogram& syncBatchSizeR);
+
 		/**
 		 * Method that initializes some things that connections needs
 		 */
@@ -319,6 +489,32 @@ namespace ai{
 		 */
 		bool isInRecoveryMode(){return activePersistence.getRecoveryMode();}
 
+		/**
+		 * Method that returns the estimated bytes of messages waiting in the queue
+		 *
+		 * @return bytes waiting
+		 */
+		unsigned long getQueuedBytes (){ return activeQueue.getQueuedBytes();}
+
+		/**
+		 * Method that waits until the estimated bytes of messages in the queue
+		 * are not more than a limit, or until the timeout expires
+		 *
+		 * @param limit max bytes waiting
+		 * @param timeout max time to wait (microseconds)
+		 *
+		 * @return true if the bytes waiting are not more than the limit
+		 */
+		bool waitQueuedBytes (unsigned long limit, apr_interval_time_t timeout){ return activeQueue.waitQueuedBytes(limit,timeout);}
+
+		/**
+		 * Method that returns the mutex and condition shared by the handles of
+		 * the messages sent asynchronously through the producer
+		 *
+		 * @return mutex and condition of the producer
+		 */
+		boost::shared_ptr<ActiveSendSync> getSendSync (){ return sendSync;}
+
 		/**
 		 * method to stop the current connection
 		 */
@@ -37,6 +37,7 @@ ActiveProducerThread::ActiveProducerThread() {
 	thd_arr=NULL;
 	thd_attr=NULL;
 	activeConnection=NULL;
+	lingering=true;
 }
 
 void ActiveProducerThread::init (	ActiveConnection* activeConnectionR ){
@@ -86,6 +87,9 @@ static void* APR_THREAD_FUNC sendThread(apr_thread_t *thd, void *data){
 				break;
 			}
 
+			//waiting more messages to send them in the same envelope
+			((ActiveProducerThread*)data)->linger();
+
 			apr_thread_mutex_unlock(mySharedObject->getMutex());
 
 			if (mySharedObject->getMessagesReady()>0){
@@ -140,6 +144,41 @@ void ActiveProducerThread::newMessage(bool received){
 
 }
 
+void ActiveProducerThread::linger(){
+
+	if (!activeConnection->isBatching() || activeConnection->getLingerTime()<=0){
+		return;
+	}
+
+	long long batchSize=activeConnection->getBatchSize();
+	unsigned long batchBytes=activeConnection->getBatchBytes();
+
+	//messages were queued while sending, traffic is not sparse
+	if (activeSharedObject.getMessagesReady()>1){
+		lingering=true;
+	}
+	if (!lingering){
+		return;
+	}
+
+	apr_time_t deadline=apr_time_now()+activeConnection->getLingerTime();
+	while (	!activeSharedObject.getEndThread() &&
+			activeSharedObject.getMessagesReady()<batchSize &&
+			(batchBytes==0 || activeConnection->getQueuedBytes()<batchBytes)){
+		apr_time_t now=apr_time_now();
+		if (now>=deadline){
+			break;
+		}
+		//each new message signals the condition
+		apr_thread_cond_timedwait(activeSharedObject.getCond(), activeSharedObject.getMutex(), deadline-now);
+	}
+
+	//nothing else came, next messages are sent without waiting
+	if (activeSharedObject.getMessagesReady()<=1){
+		lingering=false;
+	}
+}
+
 void ActiveProducerThread::endThread(){
 	apr_thread_mutex_lock(activeSharedObject.getMutex());
 	activeSharedObject.setEndThread();
@@ -82,6 +82,13 @@ namespace ai{
 		 */
 		static log4cxx::LoggerPtr logger;
 
+		/**
+		 * Flag to know if the thread waits to fill envelopes. It is turned off
+		 * when waiting does not bring more messages (sparse traffic), and on
+		 * again when messages are queued faster than they are sent.
+		 */
+		bool lingering;
+
 	public:
 		/**
 		 * Default constructor that initializes all APR symbols
@@ -142,6 +149,13 @@ namespace ai{
 		 */
 		int congestionControl(long long messagesReady);
 
+		/**
+		 * Method that waits, with the mutex of the shared object locked, until
+		 * there are enough messages to fill an envelope, enough bytes or the
+		 * linger time of the connection expires.
+		 */
+		void linger();
+
 		/**
 		 * Method that sets a value to threadrunning
 		 *
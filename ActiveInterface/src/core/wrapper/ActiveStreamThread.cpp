@@ -0,0 +1,120 @@
+/**
+ * @file
+ * @author  Oscar Pernas <oscar@pernas.es>
+ * @version 1.2.3
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * Thread that wakes up periodically so the manager closes the streams being
+ * received whose sender stopped sending chunks.
+ */
+
+#include "ActiveStreamThread.h"
+#include "../ActiveManager.h"
+#include "../../utils/exception/ActiveException.h"
+
+using namespace log4cxx;
+using namespace log4cxx::helpers;
+
+LoggerPtr ActiveStreamThread::logger(Logger::getLogger("ActiveStreamThread"));
+
+ActiveStreamThread::ActiveStreamThread() {
+	//initializing attributes
+	rv=-1;
+	mp=NULL;
+	thd_arr=NULL;
+	thd_attr=NULL;
+
+	activeManager=NULL;
+	checkInterval=0;
+	threadRunning=-1;
+}
+
+void ActiveStreamThread::init (ActiveManager& activeManagerR, apr_interval_time_t checkIntervalR){
+
+	try {
+		activeManager=&activeManagerR;
+		checkInterval=checkIntervalR;
+
+		apr_pool_create(&mp, NULL);
+		apr_threadattr_create(&thd_attr, mp);
+
+		//initializing mutex and condition lock with mutex
+	    apr_thread_mutex_create(activeSharedObject.getMutexPtr(), APR_THREAD_MUTEX_UNNESTED, mp);
+	    apr_thread_cond_create(activeSharedObject.getCondPtr(), mp);
+
+	}catch (...){
+		throw ActiveException ("Stream thread can not be created.");
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////
+//// thread that closes the idle streams
+///////////////////////////////////////////////////////////////////////////////////////////
+static void* APR_THREAD_FUNC streamThread(apr_thread_t *thd, void *data){
+
+	if (data){
+		ActiveManager* myActiveManager=((ActiveStreamThread*)data)->getActiveManager();
+		ActiveSharedObject* mySharedObject=((ActiveStreamThread*)data)->getActiveSharedObject();
+		apr_interval_time_t checkInterval=((ActiveStreamThread*)data)->getCheckInterval();
+
+		while(true){
+			apr_thread_mutex_lock(mySharedObject->getMutex());
+			if (!mySharedObject->getEndThread()){
+				apr_thread_cond_timedwait(mySharedObject->getCond(), mySharedObject->getMutex(), checkInterval);
+			}
+			if (mySharedObject->getEndThread()){
+				apr_thread_mutex_unlock(mySharedObject->getMutex());
+				break;
+			}
+			apr_thread_mutex_unlock(mySharedObject->getMutex());
+
+			myActiveManager->closeIdleStreams();
+		}
+		apr_thread_exit(thd, APR_SUCCESS);
+		return NULL;
+	}else{
+		std::cout << "Stream thread without manager, it can not run." << std::endl;
+		return NULL;
+	}
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int ActiveStreamThread::runStreamThread (){
+
+	threadRunning=apr_thread_create(&thd_arr, thd_attr, streamThread, (void*)this, mp);
+	return threadRunning;
+}
+
+void ActiveStreamThread::stop(){
+	LOG4CXX_DEBUG (logger,"Stopping stream thread");
+	if (threadRunning==APR_SUCCESS){
+		apr_thread_mutex_lock(activeSharedObject.getMutex());
+		activeSharedObject.setEndThread();
+		apr_thread_cond_signal(activeSharedObject.getCond());
+		apr_thread_mutex_unlock(activeSharedObject.getMutex());
+		apr_thread_join(&rv, thd_arr);
+		threadRunning=-1;
+	}
+	LOG4CXX_DEBUG (logger,"Stopped stream thread succesfully!.");
+}
+
+ActiveStreamThread::~ActiveStreamThread() {
+	stop();
+	if (mp){
+		apr_pool_destroy(mp);
+	}
+}
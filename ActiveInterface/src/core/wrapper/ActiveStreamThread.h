@@ -0,0 +1,147 @@
+/**
+ * @file
+ * @author  Oscar Pernas <oscar@pernas.es>
+ * @version 1.2.3
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * Thread that wakes up periodically so the manager closes the streams being
+ * received whose sender stopped sending chunks. Without it a stream whose
+ * last chunk never arrives keeps its sink open until the library is closed.
+ */
+
+#ifndef ACTIVESTREAMTHREAD_H_
+#define ACTIVESTREAMTHREAD_H_
+
+#include <apr_general.h>
+#include <apr_thread_proc.h>
+#include <apr_thread_cond.h>
+
+#include "log4cxx/logger.h"
+#include "log4cxx/helpers/exception.h"
+
+#include "ActiveSharedObject.h"
+
+
+namespace ai{
+
+	class ActiveManager;
+
+	class ActiveStreamThread {
+	private:
+		/**
+		 * APR flag that saves the status of the thread
+		 */
+		apr_status_t rv;
+
+		/**
+		 * APR pool to manage threads
+		 */
+		apr_pool_t *mp;
+
+		/**
+		 * APR pointer to the real thread
+		 */
+		apr_thread_t *thd_arr;
+
+		/**
+		 * APR pointer to pass atts to the thread
+		 */
+		apr_threadattr_t *thd_attr;
+
+		/**
+		 * Static var use by log4cxx for the logging system
+		 */
+		static log4cxx::LoggerPtr logger;
+
+		/**
+		 * APR mutex and condition used to wait between checks and to end the thread
+		 */
+		ActiveSharedObject activeSharedObject;
+
+		/**
+		 * Flag to know if the thread started to run
+		 */
+		int threadRunning;
+
+		/**
+		 * Manager whose streams are checked
+		 */
+		ActiveManager* activeManager;
+
+		/**
+		 * Time between checks (microseconds)
+		 */
+		apr_interval_time_t checkInterval;
+
+	public:
+
+		/**
+		 * Default constructor
+		 */
+		ActiveStreamThread();
+
+		/**
+		 * Method that initializes the structures used by the thread
+		 *
+		 * @param activeManagerR manager whose streams are checked
+		 * @param checkIntervalR time between checks (microseconds)
+		 *
+		 * @throws ActiveException if the structures can not be created
+		 */
+		void init (ActiveManager& activeManagerR, apr_interval_time_t checkIntervalR);
+
+		/**
+		 * Method that starts the thread
+		 *
+		 * @return 0 if the thread spawn went fine. See more documentation at APR returns values of creating threads
+		 */
+		int runStreamThread ();
+
+		/**
+		 * Method that returns the manager whose streams are checked
+		 *
+		 * @return manager of the library
+		 */
+		ActiveManager* getActiveManager(){ return activeManager;}
+
+		/**
+		 * Method that returns the time between checks
+		 *
+		 * @return time between checks (microseconds)
+		 */
+		apr_interval_time_t getCheckInterval(){ return checkInterval;}
+
+		/**
+		 * Method that returns the shared object
+		 *
+		 * @return Shared object used to wait and to end the thread
+		 */
+		ActiveSharedObject* getActiveSharedObject(){ return &activeSharedObject;}
+
+		/**
+		 * Method that ends the thread and waits for it
+		 */
+		void stop();
+
+		/**
+		 *	Default destructor
+		 */
+		virtual ~ActiveStreamThread();
+	};
+}
+
+#endif /* ACTIVESTREAMTHREAD_H_ */
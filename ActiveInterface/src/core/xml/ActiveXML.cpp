@@ -62,6 +62,15 @@ void ActiveXML::loadConnections() throw (ActiveException){
 
 	try{
 		ticpp::Element* connectionlist = doc->FirstChildElement("connectionslist");
+
+		//threads that recover the persistence of the connections when they are started
+		int recoveryThreads=DEFAULT_RECOVERY_THREADS;
+		getInt(connectionlist,"recoverythreads",recoveryThreads,false);
+		ActiveManager::getInstance()->setRecoveryThreads(recoveryThreads);
+		//seconds without chunks after which a stream being received is closed
+		int streamIdleTimeout=DEFAULT_STREAM_IDLE_TIMEOUT;
+		getInt(connectionlist,"streamidletimeout",streamIdleTimeout,false);
+		ActiveManager::getInstance()->setStreamIdleTimeout(streamIdleTimeout);
 		ticpp::Iterator<ticpp::Element> connectionsIterator;
 
 		for (connectionsIterator = connectionsIterator.begin(connectionlist); connectionsIterator != connectionsIterator.end(); connectionsIterator++){
@@ -126,10 +135,13 @@ void ActiveXML::loadConnections() throw (ActiveException){
 
 				/////////////////////////////////////////////////////////////////////////////////////
 				//saving active link to map
-				if (ActiveManager::getInstance()->
+				ActiveConnection* activeConnection=ActiveManager::getInstance()->
 						saveConnection(	id, ipBroker, type, topic, destination,
 										persistent,selector,durable,clientAck,maxSizeQueue,
-										username,password,clientId,persistence,certificate)){
+										username,password,clientId,persistence,certificate);
+				if (activeConnection){
+
+					loadConnectionOptions(connection,activeConnection);
 
 					logMessage << "Loaded connection " << id << " OK! ";
 					logIt(logMessage);
@@ -327,6 +339,137 @@ void ActiveXML::loadServices() throw (ActiveException){
 	}
 }
 
+void ActiveXML::loadConnectionOptions(ticpp::Element* connection, ActiveConnection* activeConnection){
+
+	std::stringstream logMessage;
+
+	//format of the parameter messages: stream (default) or binary
+	std::string format="";
+	getString(connection,"format",format,false);
+	if (format=="binary"){
+		activeConnection->setMessageFormat(ACTIVE_BINARY_FORMAT);
+	}else if (format.empty() || format=="stream"){
+		activeConnection->setMessageFormat(ACTIVE_STREAM_FORMAT);
+	}else{
+		logMessage << "Unknown format "<< format << " for connection "<< activeConnection->getId() << ". Using stream format.";
+		logIt(logMessage);
+		activeConnection->setMessageFormat(ACTIVE_STREAM_FORMAT);
+	}
+
+	//big messages compressed
+	bool compression=false;
+	getBool(connection,"compression",compression,false);
+	activeConnection->setCompression(compression);
+
+	int compressionThreshold=DEFAULT_COMPRESSION_THRESHOLD;
+	getInt(connection,"compressionthreshold",compressionThreshold,false);
+	activeConnection->setCompressionThreshold(compressionThreshold);
+
+	//messages sent together packed in one envelope
+	int batchSize=DEFAULT_BATCH_SIZE;
+	getInt(connection,"batchsize",batchSize,false);
+	activeConnection->setBatchSize(batchSize);
+
+	//time waiting to fill envelopes and bytes that stops the wait
+	int lingerTime=DEFAULT_LINGER_TIME;
+	getInt(connection,"linger",lingerTime,false);
+	activeConnection->setLingerTime(lingerTime);
+
+	int batchBytes=DEFAULT_BATCH_BYTES;
+	getInt(connection,"batchbytes",batchBytes,false);
+	activeConnection->setBatchBytes(batchBytes);
+
+	//persistence log written in segments of this size
+	int segmentSize=DEFAULT_SEGMENT_SIZE;
+	getInt(connection,"segmentsize",segmentSize,false);
+	activeConnection->setSegmentSize(segmentSize);
+
+	//persistence in a log of segments (default) or in a ring file of fixed size
+	std::string persistenceType="";
+	getString(connection,"persistencetype",persistenceType,false);
+	if (persistenceType=="ring"){
+		activeConnection->setPersistenceType(ACTIVE_RING_PERSISTENCE);
+	}else if (persistenceType=="shared"){
+		activeConnection->setPersistenceType(ACTIVE_SHARED_PERSISTENCE);
+	}else if (persistenceType.empty() || persistenceType=="log"){
+		activeConnection->setPersistenceType(ACTIVE_LOG_PERSISTENCE);
+	}else{
+		logMessage << "Unknown persistence type "<< persistenceType << " for connection "<< activeConnection->getId() << ". Using log.";
+		logIt(logMessage);
+		activeConnection->setPersistenceType(ACTIVE_LOG_PERSISTENCE);
+	}
+
+	int ringSize=DEFAULT_RING_SIZE;
+	getInt(connection,"ringsize",ringSize,false);
+	activeConnection->setRingSize(ringSize);
+
+	//connections with the same shared log write in the same files
+	std::string sharedLog=DEFAULT_SHARED_LOG;
+	getString(connection,"sharedlog",sharedLog,false);
+	activeConnection->setSharedLog(sharedLog);
+
+	//messages sent and milliseconds between checkpoints of the persistence
+	int checkpointMessages=DEFAULT_CHECKPOINT_MESSAGES;
+	getInt(connection,"checkpointmessages",checkpointMessages,false);
+	activeConnection->setCheckpointMessages(checkpointMessages);
+
+	int checkpointTime=DEFAULT_CHECKPOINT_TIME;
+	getInt(connection,"checkpointtime",checkpointTime,false);
+	activeConnection->setCheckpointTime(checkpointTime);
+
+	//when the persistence is synchronized to disk
+	std::string durability="";
+	getString(connection,"durability",durability,false);
+	if (durability.empty() || durability=="none"){
+		activeConnection->setDurability(ACTIVE_SYNC_NONE);
+	}else if (durability=="interval"){
+		activeConnection->setDurability(ACTIVE_SYNC_INTERVAL);
+	}else if (durability=="batch"){
+		activeConnection->setDurability(ACTIVE_SYNC_BATCH);
+	}else if (durability=="always"){
+		activeConnection->setDurability(ACTIVE_SYNC_ALWAYS);
+	}else{
+		logMessage << "Unknown durability "<< durability << " for connection "<< activeConnection->getId() << ". Using none.";
+		logIt(logMessage);
+		activeConnection->setDurability(ACTIVE_SYNC_NONE);
+	}
+
+	int syncInterval=DEFAULT_SYNC_INTERVAL;
+	getInt(connection,"syncinterval",syncInterval,false);
+	activeConnection->setSyncInterval(syncInterval);
+
+	int syncBatch=DEFAULT_SYNC_BATCH;
+	getInt(connection,"syncbatch",syncBatch,false);
+	activeConnection->setSyncBatch(syncBatch);
+
+	//persistence written by its own thread, deliver does not wait for the disk
+	bool writeBehind=false;
+	getBool(connection,"writebehind",writeBehind,false);
+	activeConnection->setWriteBehind(writeBehind);
+
+	int writeQueueSize=DEFAULT_WRITE_QUEUE_SIZE;
+	getInt(connection,"writequeuesize",writeQueueSize,false);
+	activeConnection->setWriteQueueSize(writeQueueSize);
+
+	//messages persisted only when the queue fills, the transport is down or on close
+	bool spill=false;
+	getBool(connection,"spill",spill,false);
+	activeConnection->setSpill(spill);
+
+	int spillWatermark=DEFAULT_SPILL_WATERMARK;
+	getInt(connection,"spillwatermark",spillWatermark,false);
+	activeConnection->setSpillWatermark(spillWatermark);
+
+	bool persistFrames=false;
+	getBool(connection,"persistframes",persistFrames,false);
+	activeConnection->setPersistFrames(persistFrames);
+
+	//messages in memory kept between runs of connections without persistence
+	bool snapshot=false;
+	getBool(connection,"snapshot",snapshot,false);
+	activeConnection->setSnapshot(snapshot);
+}
+
 void ActiveXML::getString(ticpp::Element*  link, std::string name, std::string& result, bool forcedParameter)
 	throw (ActiveException){
 
@@ -115,6 +115,15 @@ namespace ai{
 		 */
 		void loadProperties(ActiveLink* activeLink, ticpp::Element* link);
 
+		/**
+		 * Method that loads the optional attributes of a connection that tune
+		 * how it works (all of them have a default value).
+		 *
+		 * @param connection is a pointer to a element of ticpp xml library
+		 * @param activeConnection connection where options are set
+		 */
+		void loadConnectionOptions(ticpp::Element* connection, ActiveConnection* activeConnection);
+
 		/**
 		 * Method that for a element of xml library returns the string property associated
 		 *
@@ -0,0 +1,199 @@
+/**
+ * @file
+ * @author  Oscar Pernas <oscar@pernas.es>
+ * @version 1.2.3
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * CRC32C (Castagnoli) checksum of the records of the persistence.
+ */
+
+#include "ActiveCrc32c.h"
+
+#include <cstring>
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#include <cpuid.h>
+#define ACTIVE_CRC32C_GCC
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#include <nmmintrin.h>
+#define ACTIVE_CRC32C_MSVC
+#endif
+
+using namespace ai;
+
+//reflected polynomial of CRC32C
+#define ACTIVE_CRC32C_POLYNOMIAL 0x82F63B78U
+
+/**
+ * Tables of the software checksum, table[k][i] is the checksum of the byte i
+ * followed by k zero bytes. They are filled when the library is loaded.
+ */
+static apr_uint32_t crcTables[8][256];
+
+/**
+ * Processor detection, done when the library is loaded too
+ */
+static bool hasHardware();
+
+namespace {
+	struct Crc32cInit {
+		bool hardware;
+		Crc32cInit(){
+			for (unsigned int i=0; i<256; i++){
+				apr_uint32_t crc=i;
+				for (int j=0; j<8; j++){
+					crc=(crc>>1) ^ ((crc&1)?ACTIVE_CRC32C_POLYNOMIAL:0);
+				}
+				crcTables[0][i]=crc;
+			}
+			for (unsigned int i=0; i<256; i++){
+				for (int k=1; k<8; k++){
+					crcTables[k][i]=(crcTables[k-1][i]>>8) ^ crcTables[0][crcTables[k-1][i]&0xFF];
+				}
+			}
+			hardware=hasHardware();
+		}
+	};
+}
+
+static Crc32cInit crc32cInit;
+
+/**
+ * Software checksum, eight bytes at a time
+ */
+static apr_uint32_t extendTables(apr_uint32_t crc, const unsigned char* data, size_t size){
+	while (size>=8){
+		apr_uint32_t low=crc ^ ((apr_uint32_t)data[0] | ((apr_uint32_t)data[1]<<8) |
+				((apr_uint32_t)data[2]<<16) | ((apr_uint32_t)data[3]<<24));
+		crc=crcTables[7][low&0xFF] ^ crcTables[6][(low>>8)&0xFF] ^
+				crcTables[5][(low>>16)&0xFF] ^ crcTables[4][low>>24] ^
+				crcTables[3][data[4]] ^ crcTables[2][data[5]] ^
+				crcTables[1][data[6]] ^ crcTables[0][data[7]];
+		data+=8;
+		size-=8;
+	}
+	while (size>0){
+		crc=(crc>>8) ^ crcTables[0][(crc ^ *data)&0xFF];
+		data++;
+		size--;
+	}
+	return crc;
+}
+
+#if defined(ACTIVE_CRC32C_GCC)
+
+static bool hasHardware(){
+	unsigned int eax=0, ebx=0, ecx=0, edx=0;
+	return __get_cpuid(1,&eax,&ebx,&ecx,&edx) && (ecx & bit_SSE4_2)!=0;
+}
+
+/**
+ * Checksum with the crc32 instruction, only called when the processor has it
+ */
+__attribute__((target("sse4.2")))
+static apr_uint32_t extendHardware(apr_uint32_t crc, const unsigned char* data, size_t size){
+#if defined(__x86_64__)
+	unsigned long long crc64=crc;
+	while (size>=8){
+		unsigned long long word;
+		memcpy(&word,data,8);
+		crc64=__builtin_ia32_crc32di(crc64,word);
+		data+=8;
+		size-=8;
+	}
+	crc=(apr_uint32_t)crc64;
+#endif
+	while (size>=4){
+		unsigned int word;
+		memcpy(&word,data,4);
+		crc=__builtin_ia32_crc32si(crc,word);
+		data+=4;
+		size-=4;
+	}
+	while (size>0){
+		crc=__builtin_ia32_crc32qi(crc,*data);
+		data++;
+		size--;
+	}
+	return crc;
+}
+
+#elif defined(ACTIVE_CRC32C_MSVC)
+
+static bool hasHardware(){
+	int info[4];
+	__cpuid(info,1);
+	return (info[2] & (1<<20))!=0;
+}
+
+static apr_uint32_t extendHardware(apr_uint32_t crc, const unsigned char* data, size_t size){
+#if defined(_M_X64)
+	unsigned __int64 crc64=crc;
+	while (size>=8){
+		unsigned __int64 word;
+		memcpy(&word,data,8);
+		crc64=_mm_crc32_u64(crc64,word);
+		data+=8;
+		size-=8;
+	}
+	crc=(apr_uint32_t)crc64;
+#endif
+	while (size>=4){
+		unsigned int word;
+		memcpy(&word,data,4);
+		crc=_mm_crc32_u32(crc,word);
+		data+=4;
+		size-=4;
+	}
+	while (size>0){
+		crc=_mm_crc32_u8(crc,*data);
+		data++;
+		size--;
+	}
+	return crc;
+}
+
+#else
+
+static bool hasHardware(){
+	return false;
+}
+
+static apr_uint32_t extendHardware(apr_uint32_t crc, const unsigned char* data, size_t size){
+	return extendTables(crc,data,size);
+}
+
+#endif
+
+apr_uint32_t ActiveCrc32c::extend(apr_uint32_t crc, const unsigned char* data, size_t size){
+	crc=~crc;
+	if (crc32cInit.hardware){
+		crc=extendHardware(crc,data,size);
+	}else{
+		crc=extendTables(crc,data,size);
+	}
+	return ~crc;
+}
+
+apr_uint32_t ActiveCrc32c::extendSoftware(apr_uint32_t crc, const unsigned char* data, size_t size){
+	return ~extendTables(~crc,data,size);
+}
+
+bool ActiveCrc32c::isHardware(){
+	return crc32cInit.hardware;
+}
@@ -0,0 +1,81 @@
+/**
+ * @file
+ * @author  Oscar Pernas <oscar@pernas.es>
+ * @version 1.2.3
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * CRC32C (Castagnoli) checksum of the records of the persistence. It uses
+ * the crc32 instruction of SSE4.2 when the processor has it, and tables of
+ * eight bytes at a time otherwise; both give the same value.
+ */
+
+#ifndef ACTIVECRC32C_H_
+#define ACTIVECRC32C_H_
+
+#include <cstddef>
+
+#include "apr_general.h"
+
+namespace ai{
+
+	class ActiveCrc32c {
+	public:
+
+		/**
+		 * Method that computes the checksum of some bytes
+		 *
+		 * @param data bytes
+		 * @param size number of bytes
+		 *
+		 * @return checksum
+		 */
+		static apr_uint32_t compute(const unsigned char* data, size_t size){return extend(0,data,size);}
+
+		/**
+		 * Method that continues a checksum with more bytes, so it is computed
+		 * from several parts
+		 *
+		 * @param crc checksum of the previous parts, 0 for the first one
+		 * @param data bytes
+		 * @param size number of bytes
+		 *
+		 * @return checksum of all the parts
+		 */
+		static apr_uint32_t extend(apr_uint32_t crc, const unsigned char* data, size_t size);
+
+		/**
+		 * Method that continues a checksum with the tables, without the
+		 * instruction of the processor even if it has it
+		 *
+		 * @param crc checksum of the previous parts, 0 for the first one
+		 * @param data bytes
+		 * @param size number of bytes
+		 *
+		 * @return checksum of all the parts
+		 */
+		static apr_uint32_t extendSoftware(apr_uint32_t crc, const unsigned char* data, size_t size);
+
+		/**
+		 * Method that tells if the checksum is computed by the processor
+		 *
+		 * @return true if SSE4.2 is used
+		 */
+		static bool isHardware();
+	};
+}
+
+#endif /* ACTIVECRC32C_H_ */
@@ -0,0 +1,177 @@
+/**
+ * @file
+ * @author  Oscar Pernas <oscar@pernas.es>
+ * @version 1.2.3
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * Histogram of values with buckets of powers of two. Bucket 0 counts the
+ * value 0 and bucket i the values from 2^(i-1) to 2^i-1. It can be updated
+ * from several threads.
+ */
+
+#ifndef ACTIVEHISTOGRAM_H_
+#define ACTIVEHISTOGRAM_H_
+
+#include <sstream>
+#include <string>
+
+#include "apr_general.h"
+#include "../core/mutex/ActiveMutex.h"
+
+#define ACTIVE_HISTOGRAM_BUCKETS 40
+
+namespace ai{
+
+	class ActiveHistogram {
+	private:
+
+		/**
+		 * Values counted in each bucket
+		 */
+		apr_uint64_t buckets[ACTIVE_HISTOGRAM_BUCKETS];
+
+		/**
+		 * Number of values, their sum and the max value
+		 */
+		apr_uint64_t count;
+		apr_uint64_t sum;
+		apr_uint64_t max;
+
+		/**
+		 * Mutex to update the histogram
+		 */
+		ActiveMutex histogramMutex;
+
+	public:
+
+		/**
+		 * Default constructor
+		 */
+		ActiveHistogram(){ clear();}
+
+		/**
+		 * Method that counts a value
+		 *
+		 * @param value value counted
+		 */
+		void add(apr_uint64_t value){
+			unsigned int bucket=0;
+			while (bucket<ACTIVE_HISTOGRAM_BUCKETS-1 && (value>>bucket)!=0){
+				bucket++;
+			}
+			histogramMutex.lock();
+			buckets[bucket]++;
+			count++;
+			sum+=value;
+			if (value>max){
+				max=value;
+			}
+			histogramMutex.unlock();
+		}
+
+		/**
+		 * Method that removes all the values
+		 */
+		void clear(){
+			histogramMutex.lock();
+			for (unsigned int i=0; i<ACTIVE_HISTOGRAM_BUCKETS; i++){
+				buckets[i]=0;
+			}
+			count=0;
+			sum=0;
+			max=0;
+			histogramMutex.unlock();
+		}
+
+		/**
+		 * Method that copies the values counted until now to another histogram
+		 *
+		 * @param snapshotR histogram where the values are copied
+		 */
+		void snapshot(ActiveHistogram& snapshotR){
+			apr_uint64_t copy[ACTIVE_HISTOGRAM_BUCKETS];
+			histogramMutex.lock();
+			for (unsigned int i=0; i<ACTIVE_HISTOGRAM_BUCKETS; i++){
+				copy[i]=buckets[i];
+			}
+			apr_uint64_t copyCount=count;
+			apr_uint64_t copySum=sum;
+			apr_uint64_t copyMax=max;
+			histogramMutex.unlock();
+
+			snapshotR.histogramMutex.lock();
+			for (unsigned int i=0; i<ACTIVE_HISTOGRAM_BUCKETS; i++){
+				snapshotR.buckets[i]=copy[i];
+			}
+			snapshotR.count=copyCount;
+			snapshotR.sum=copySum;
+			snapshotR.max=copyMax;
+			snapshotR.histogramMutex.unlock();
+		}
+
+		/**
+		 * Method that returns an upper bound of a percentile, the max value of its bucket
+		 *
+		 * @param percent percentile from 0 to 100
+		 *
+		 * @return upper bound of the percentile, 0 if there are no values
+		 */
+		apr_uint64_t getPercentile(double percent){
+			apr_uint64_t result=0;
+			histogramMutex.lock();
+			apr_uint64_t accumulated=0;
+			for (unsigned int i=0; i<ACTIVE_HISTOGRAM_BUCKETS && count>0; i++){
+				accumulated+=buckets[i];
+				if (accumulated*100.0>=percent*count){
+					result=(i==0)?0:((((apr_uint64_t)1)<<i)-1);
+					break;
+				}
+			}
+			histogramMutex.unlock();
+			return (result>max)?max:result;
+		}
+
+		/**
+		 * Method that returns the histogram as text, each bucket not empty
+		 * as <max value of the bucket>:<count>
+		 *
+		 * @return histogram as text
+		 */
+		std::string toString(){
+			std::stringstream text;
+			histogramMutex.lock();
+			text << "count " << count << ", mean " << ((count==0)?0:sum/count) << ", max " << max << " [";
+			for (unsigned int i=0; i<ACTIVE_HISTOGRAM_BUCKETS; i++){
+				if (buckets[i]>0){
+					text << " <" << ((i==0)?1:(((apr_uint64_t)1)<<i)) << ":" << buckets[i];
+				}
+			}
+			text << " ]";
+			histogramMutex.unlock();
+			return text.str();
+		}
+
+		/////////////////////////////////////////////////////////////////
+		//getters
+		apr_uint64_t getBucket(unsigned int bucket){return (bucket<ACTIVE_HISTOGRAM_BUCKETS)?buckets[bucket]:0;}
+		apr_uint64_t getCount(){return count;}
+		apr_uint64_t getSum(){return sum;}
+		apr_uint64_t getMax(){return max;}
+	};
+}
+
+#endif /* ACTIVEHISTOGRAM_H_ */
@@ -42,6 +42,12 @@
 #define ACTIVE_REAL_PARAMETER 1
 #define ACTIVE_STRING_PARAMETER 2
 #define ACTIVE_BYTES_PARAMETER 3
+#define ACTIVE_INT_ARRAY_PARAMETER 4
+#define ACTIVE_REAL_ARRAY_PARAMETER 5
+#define ACTIVE_INT64_ARRAY_PARAMETER 6
+
+//number of types of parameter
+#define ACTIVE_PARAMETER_TYPES 7
 
 //define the type of property
 #define ACTIVE_INT_PROPERTY 10
@@ -56,6 +62,145 @@
 //define the max parameter of a message
 #define MAX_PARAMETERS 255
 
+//formats used to send parameter messages
+#define ACTIVE_STREAM_FORMAT 0
+#define ACTIVE_BINARY_FORMAT 1
+
+//binary format of messages
+#define ACTIVE_BINARY_CMS_TYPE "ActiveBinaryMessage"
+#define ACTIVE_CODEC_MAGIC 0xAC
+#define ACTIVE_CODEC_VERSION 1
+#define ACTIVE_CODEC_SCHEMA_VERSION 2
+#define ACTIVE_CODEC_COMPRESSED_VERSION 3
+#define ACTIVE_CODEC_ENVELOPE_VERSION 4
+#define ACTIVE_CODEC_SHARED_VERSION 5
+#define ACTIVE_CODEC_MAX_VERSION 5
+#define ACTIVE_CODEC_TEXT_FLAG 0x01
+#define ACTIVE_CODEC_SCHEMA_FLAG 0x02
+#define ACTIVE_CODEC_DEFINITION_FLAG 0x04
+#define ACTIVE_CODEC_COMPRESSED_FLAG 0x08
+#define ACTIVE_CODEC_ENVELOPE_FLAG 0x10
+#define ACTIVE_CODEC_SHARED_FLAG 0x20
+
+//by default messages of this size or bigger are compressed, if compression is on
+#define DEFAULT_COMPRESSION_THRESHOLD 1024
+
+//by default each message is sent alone, without envelope
+#define DEFAULT_BATCH_SIZE 1
+
+//by default the producer thread does not wait to fill envelopes (microseconds)
+#define DEFAULT_LINGER_TIME 0
+
+//by default there is not a limit of bytes to stop waiting
+#define DEFAULT_BATCH_BYTES 0
+
+//streams of bytes sent in chunks, properties and parameter of each chunk
+#define ACTIVE_STREAM_ID_PROPERTY "AI_STREAM_ID"
+#define ACTIVE_STREAM_SEQUENCE_PROPERTY "AI_STREAM_SEQUENCE"
+#define ACTIVE_STREAM_LAST_PROPERTY "AI_STREAM_LAST"
+#define ACTIVE_STREAM_DATA_KEY "AI_STREAM_DATA"
+
+//by default size of each chunk of a stream
+#define DEFAULT_STREAM_CHUNK_SIZE 65536
+
+//bytes read at once from a bytes field of a StreamMessage, its length is not known
+#define ACTIVE_BYTES_FIELD_BLOCK 4096
+
+//chunks of a stream that can be waiting in the queue of a connection
+#define ACTIVE_STREAM_WINDOW 4
+
+//by default seconds without chunks after which a stream being received is
+//closed as not complete, 0 to wait for the last chunk until the library is closed
+#define DEFAULT_STREAM_IDLE_TIMEOUT 60
+
+//time between checks of the streams being received (microseconds)
+#define ACTIVE_STREAM_CHECK_TIME 1000000
+
+//max time to wait for the queue to send chunks of a stream before the state of
+//the connection is checked again (microseconds)
+#define ACTIVE_STREAM_WAIT_TIME 100000
+
+//by default max size in bytes of each segment of the persistence log
+#define DEFAULT_SEGMENT_SIZE 16777216
+
+//header written at the beginning of each segment of the persistence log
+#define ACTIVE_LOG_MAGIC "AILG"
+#define ACTIVE_LOG_VERSION 2
+#define ACTIVE_LOG_HEADER_SIZE 8
+
+//header of each record of the persistence log: length, and checksum from version 2
+#define ACTIVE_LOG_RECORD_HEADER 8
+#define ACTIVE_LOG_CHECKSUM_VERSION 2
+
+//bytes read ahead from the persistence log, and max messages enqueued together when recovering
+#define ACTIVE_LOG_READ_AHEAD 262144
+#define ACTIVE_REPLAY_BATCH 256
+
+//types of persistence: log in segments (default), ring file of fixed size or
+//log in segments shared by several connections
+#define ACTIVE_LOG_PERSISTENCE 0
+#define ACTIVE_RING_PERSISTENCE 1
+#define ACTIVE_SHARED_PERSISTENCE 2
+
+//log shared by connections: name by default, types of records and max records
+//of other connections read instead of seeking
+#define DEFAULT_SHARED_LOG "persistence_shared"
+#define ACTIVE_SHARED_DATA 0
+#define ACTIVE_SHARED_CURSOR 1
+#define ACTIVE_SHARED_SKIP 64
+
+//threads that recover the persistence of the connections when they are started
+#define DEFAULT_RECOVERY_THREADS 4
+
+//ring file of the persistence, header page and by default size of its data.
+//Records have a checksum from version 2
+#define ACTIVE_RING_MAGIC "AIRG"
+#define ACTIVE_RING_VERSION 2
+#define ACTIVE_RING_CHECKSUM_VERSION 2
+#define ACTIVE_RING_HEADER_SIZE 4096
+#define DEFAULT_RING_SIZE 67108864
+
+//checkpoint of the persistence, two slots of this size written alternately
+#define ACTIVE_CHECKPOINT_MAGIC "AICP"
+#define ACTIVE_CHECKPOINT_SLOT_SIZE 20
+
+//snapshot of the messages in memory of a connection without persistence: header,
+//and length and checksum of each record
+#define ACTIVE_SNAPSHOT_MAGIC "AISN"
+#define ACTIVE_SNAPSHOT_VERSION 1
+#define ACTIVE_SNAPSHOT_HEADER_SIZE 8
+#define ACTIVE_SNAPSHOT_RECORD_HEADER 8
+
+//by default the message sent is written to the checkpoint each this number of
+//messages, or each this time in milliseconds. After a crash at most the messages
+//sent since the last checkpoint are sent again.
+#define DEFAULT_CHECKPOINT_MESSAGES 100
+#define DEFAULT_CHECKPOINT_TIME 1000
+
+//durability of the messages written to the persistence: none (left to the
+//system), synchronized to disk each interval of milliseconds, each batch of
+//messages, or before the deliver of each message returns
+#define ACTIVE_SYNC_NONE 0
+#define ACTIVE_SYNC_INTERVAL 1
+#define ACTIVE_SYNC_BATCH 2
+#define ACTIVE_SYNC_ALWAYS 3
+#define DEFAULT_SYNC_INTERVAL 1000
+#define DEFAULT_SYNC_BATCH 100
+
+//records accepted by deliver waiting for the persistence writer thread, max
+//records written together, and microseconds before writing again after an error
+#define DEFAULT_WRITE_QUEUE_SIZE 4096
+#define ACTIVE_WRITE_BATCH 256
+#define ACTIVE_WRITE_RETRY 100000
+
+//with spill, messages are persisted only when the queue is over this percent
+//of its size, the transport is interrupted or the producer is closed
+#define DEFAULT_SPILL_WATERMARK 80
+
+//first byte of a persistence record with the message encoded as it is sent,
+//a serialized message never starts with it
+#define ACTIVE_FRAME_RECORD 0xFE
+
 ///definitions of type of callback
 #define ON_PACKET_DROPPED 0
 #define ON_EXCEPTION 1
@@ -63,6 +208,12 @@
 #define ON_TRANSPORT_RESUMED 3
 #define ON_QUEUE_READY 4
 
+//states of a message sent asynchronously through a link
+#define ACTIVE_SEND_PENDING 0
+#define ACTIVE_SEND_DONE 1
+#define ACTIVE_SEND_PERSISTED 2
+#define ACTIVE_SEND_FAILED 3
+
 //max % of queue full to send all messages
 //Ready to send
 #define LEVEL1_PERCENT_MESSAGES_READY 50
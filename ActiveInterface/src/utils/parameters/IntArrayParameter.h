@@ -0,0 +1,134 @@
+/**
+ * @file
+ * @author  Oscar Pernas <oscar@pernas.es>
+ * @version 1.2.3
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * Class that extends the parameter parent class with an array of integers.
+ * The whole array is stored in one contiguous block, so it is encoded and
+ * decoded as one block instead of one parameter for each element.
+ */
+
+#ifndef INTARRAYPARAMETER_H_
+#define INTARRAYPARAMETER_H_
+
+#ifdef ACTIVEINTERFACE_DLL
+ #ifdef ACTIVEINTERFACE_EXPORTS
+  #define ACTIVEINTERFACE_API __declspec( dllexport )
+ #else
+  #define ACTIVEINTERFACE_API __declspec( dllimport )
+ #endif
+#else 
+ #define ACTIVEINTERFACE_API
+#endif
+
+#include "Parameter.h"
+#include "../defines.h"
+#include <vector>
+
+#include <boost/serialization/vector.hpp>
+#include <boost/serialization/base_object.hpp>
+
+namespace ai{
+ namespace utils{
+
+	class ACTIVEINTERFACE_API IntArrayParameter: public Parameter {
+	private:
+		/**
+		 * Value of the parameter
+		 */
+		std::vector<int> value;
+
+		/**
+		 * Method that copy the values of the given parameter to this one
+		 *
+		 * @param intArrayParameter Pointer to the object that is going to be copied
+		 */
+		void copy (const IntArrayParameter* intArrayParameter){ type=intArrayParameter->getType(); value=intArrayParameter->getValue();}
+
+	public:
+
+		/**
+		 * Default constructor
+		 */
+		IntArrayParameter(){type=ACTIVE_INT_ARRAY_PARAMETER;}
+
+		/**
+		 * Constructor
+		 *
+		 * @param valueR array that is going to be assigned to value of object
+		 */
+		IntArrayParameter(const std::vector<int>& valueR){type=ACTIVE_INT_ARRAY_PARAMETER;value=valueR;}
+
+		/**
+		 * Copy constructor by reference
+		 *
+		 * @param intArrayParameter Reference to the object that is going to be copied to new one
+		 */
+		IntArrayParameter(const IntArrayParameter& intArrayParameter){ copy(&intArrayParameter);}
+
+		/*
+		 * Copy constructor by pointer
+		 *
+		 * @param Pointer to the object that is going to be copied to new one
+		 */
+		IntArrayParameter(const IntArrayParameter* intArrayParameter){ copy(intArrayParameter);}
+
+		/**
+		 * Method to get value of parameter
+		 *
+		 * @return the value of the parameter
+		 */
+		const std::vector<int>& getValue() const { return value;}
+
+		/**
+		 * Method to get value of parameter to be filled
+		 *
+		 * @return the value of the parameter
+		 */
+		std::vector<int>& getValue() { return value;}
+
+		/**
+		 * Method to set the value of parameter, assign keeps the capacity
+		 * of the array when the parameter is recycled
+		 *
+		 * @param valueR value that is going to set to this object
+		 */
+		void setValue (const std::vector<int>& valueR){ value.assign(valueR.begin(),valueR.end());}
+
+		/**
+		 * Default destructor
+		 */
+		virtual ~IntArrayParameter(){};
+
+		/**
+		 *  Serializing parameters map
+		 */
+		friend class boost::serialization::access;
+		template<class Archive>
+
+		void serialize(Archive & ar, const unsigned int version){
+			// serialize base class information
+			ar & boost::serialization::base_object<Parameter>(*this);
+			ar & value;
+			ar & type;
+		}
+	};
+ }
+}
+
+#endif /* INTARRAYPARAMETER_H_ */
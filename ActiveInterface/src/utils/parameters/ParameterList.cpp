@@ -67,6 +67,24 @@ void ParameterList::clone(const ParameterList& parameterListR){
 			insertToMap(key,bytesParameter);
 		}
 		break;
+		case ACTIVE_INT_ARRAY_PARAMETER:{
+			IntArrayParameter* intArrayParameter=
+					new IntArrayParameter(((IntArrayParameter*)parameter)->getValue());
+			insertToMap(key,intArrayParameter);
+		}
+		break;
+		case ACTIVE_REAL_ARRAY_PARAMETER:{
+			RealArrayParameter* realArrayParameter=
+					new RealArrayParameter(((RealArrayParameter*)parameter)->getValue());
+			insertToMap(key,realArrayParameter);
+		}
+		break;
+		case ACTIVE_INT64_ARRAY_PARAMETER:{
+			Int64ArrayParameter* int64ArrayParameter=
+					new Int64ArrayParameter(((Int64ArrayParameter*)parameter)->getValue());
+			insertToMap(key,int64ArrayParameter);
+		}
+		break;
 		}
 	}
 }
@@ -149,10 +167,54 @@ BytesParameter* ParameterList::getBytes(std::string& key) const{
 	}
 }
 
+IntArrayParameter* ParameterList::getIntArray(std::string& key) const{
+	std::stringstream logMessage;
+	try{
+		Parameter* parameter=get(key);
+		if (parameter->getType()==ACTIVE_INT_ARRAY_PARAMETER){
+			return (IntArrayParameter*)parameter;
+		}else{
+			return NULL;
+		}
+	}catch (...){
+		logMessage << "ParameterList::get. Something wrong happened getting value property "<<key;
+		return NULL;
+	}
+}
+
+RealArrayParameter* ParameterList::getRealArray(std::string& key) const{
+	std::stringstream logMessage;
+	try{
+		Parameter* parameter=get(key);
+		if (parameter->getType()==ACTIVE_REAL_ARRAY_PARAMETER){
+			return (RealArrayParameter*)parameter;
+		}else{
+			return NULL;
+		}
+	}catch (...){
+		logMessage << "ParameterList::get. Something wrong happened getting value property "<<key;
+		return NULL;
+	}
+}
+
+Int64ArrayParameter* ParameterList::getInt64Array(std::string& key) const{
+	std::stringstream logMessage;
+	try{
+		Parameter* parameter=get(key);
+		if (parameter->getType()==ACTIVE_INT64_ARRAY_PARAMETER){
+			return (Int64ArrayParameter*)parameter;
+		}else{
+			return NULL;
+		}
+	}catch (...){
+		logMessage << "ParameterList::get. Something wrong happened getting value property "<<key;
+		return NULL;
+	}
+}
+
 Parameter* ParameterList::get(int index, std::string& key) const{
 
     int i = 0;
-	std::stringstream logMessage;
 
 	std::map <std::string,Parameter*>::const_iterator mapIterator;
 
@@ -170,28 +232,54 @@ Parameter* ParameterList::get(int index, std::string& key) const{
 
 void ParameterList::insertToMap(std::string& name, Parameter* parameter){
 
-	std::stringstream logMessage;
+	std::pair<std::map<std::string,Parameter*>::iterator,bool> ret;
 	try{
-		std::pair<std::map<std::string,Parameter*>::iterator,bool> ret;
 		ret=parametersMap.insert(std::map<std::string,Parameter*>::value_type(name,parameter));
-		if (!ret.second){
-			throw ActiveException(logMessage);
-		}
 	}catch (...){
-			logMessage<<"ERROR inserting property. This property is not going to be used. Key: "<<name;
-			throw ActiveException(logMessage);
+		ret.second=false;
+	}
+	if (!ret.second){
+		std::stringstream logMessage;
+		logMessage<<"ERROR inserting property. This property is not going to be used. Key: "<<name;
+		throw ActiveException(logMessage);
 	}
 }
 
 
-void ParameterList::insertIntParameter(std::string& key, int value){
+Parameter* ParameterList::getRecycled(int type){
 
-	std::stringstream logMessage;
+	if (type<0 || type>=ACTIVE_PARAMETER_TYPES || recycledParameters[type].empty()){
+		return NULL;
+	}
+	Parameter* parameter=recycledParameters[type].back();
+	recycledParameters[type].pop_back();
+	return parameter;
+}
+
+void ParameterList::recycleParameter(Parameter* parameter){
+
+	int type=parameter->getType();
+	if (type>=0 && type<ACTIVE_PARAMETER_TYPES){
+		recycledParameters[type].push_back(parameter);
+	}else{
+		delete parameter;
+	}
+}
+
+void ParameterList::insertIntParameter(std::string& key, int value){
 
+	IntParameter* intParameter=(IntParameter*)getRecycled(ACTIVE_INT_PARAMETER);
 	try{
-		IntParameter* intParameter=new IntParameter(value);
+		if (intParameter){
+			intParameter->setValue(value);
+		}else{
+			intParameter=new IntParameter(value);
+		}
 		insertToMap(key,intParameter);
 	}catch (ActiveException& ae){
+		recycleParameter(intParameter);
+		//built only on errors, it is expensive to create for each insert
+		std::stringstream logMessage;
 		logMessage << ae.getMessage();
 		logIt(logMessage);
 	}
@@ -199,36 +287,103 @@ void ParameterList::insertIntParameter(std::string& key, int value){
 }
 
 void ParameterList::insertRealParameter(std::string& key,float value){
-	std::stringstream logMessage;
-
+	RealParameter* realParameter=(RealParameter*)getRecycled(ACTIVE_REAL_PARAMETER);
 	try{
-		RealParameter* realParameter=new RealParameter(value);
+		if (realParameter){
+			realParameter->setValue(value);
+		}else{
+			realParameter=new RealParameter(value);
+		}
 		insertToMap(key,realParameter);
 	}catch (ActiveException& ae){
+		recycleParameter(realParameter);
+		std::stringstream logMessage;
 		logMessage << ae.getMessage();
 		logIt(logMessage);
 	}
 }
 
 void ParameterList::insertStringParameter(std::string& key,const std::string& value){
-	std::stringstream logMessage;
-
+	StringParameter* stringParameter=(StringParameter*)getRecycled(ACTIVE_STRING_PARAMETER);
 	try{
-		StringParameter* stringParameter=new StringParameter(value);
+		if (stringParameter){
+			//assigning keeps the capacity of the recycled string
+			stringParameter->getValue().assign(value);
+		}else{
+			stringParameter=new StringParameter(value);
+		}
 		insertToMap(key,stringParameter);
 	}catch (ActiveException& ae){
+		recycleParameter(stringParameter);
+		std::stringstream logMessage;
 		logMessage << ae.getMessage();
 		logIt(logMessage);
 	}
 }
 
 void ParameterList::insertBytesParameter(std::string& key, std::vector<unsigned char>& value){
-	std::stringstream logMessage;
-
+	BytesParameter* bytesParameter=(BytesParameter*)getRecycled(ACTIVE_BYTES_PARAMETER);
 	try{
-		BytesParameter* bytesParameter=new BytesParameter(value);
+		if (bytesParameter){
+			bytesParameter->setValue(value);
+		}else{
+			bytesParameter=new BytesParameter(value);
+		}
 		insertToMap(key,bytesParameter);
 	}catch (ActiveException& ae){
+		recycleParameter(bytesParameter);
+		std::stringstream logMessage;
+		logMessage << ae.getMessage();
+		logIt(logMessage);
+	}
+}
+
+void ParameterList::insertIntArrayParameter(std::string& key, const std::vector<int>& value){
+	IntArrayParameter* intArrayParameter=(IntArrayParameter*)getRecycled(ACTIVE_INT_ARRAY_PARAMETER);
+	try{
+		if (intArrayParameter){
+			intArrayParameter->setValue(value);
+		}else{
+			intArrayParameter=new IntArrayParameter(value);
+		}
+		insertToMap(key,intArrayParameter);
+	}catch (ActiveException& ae){
+		recycleParameter(intArrayParameter);
+		std::stringstream logMessage;
+		logMessage << ae.getMessage();
+		logIt(logMessage);
+	}
+}
+
+void ParameterList::insertRealArrayParameter(std::string& key, const std::vector<float>& value){
+	RealArrayParameter* realArrayParameter=(RealArrayParameter*)getRecycled(ACTIVE_REAL_ARRAY_PARAMETER);
+	try{
+		if (realArrayParameter){
+			realArrayParameter->setValue(value);
+		}else{
+			realArrayParameter=new RealArrayParameter(value);
+		}
+		insertToMap(key,realArrayParameter);
+	}catch (ActiveException& ae){
+		recycleParameter(realArrayParameter);
+		std::stringstream logMessage;
+		logMessage << ae.getMessage();
+		logIt(logMessage);
+	}
+}
+
+void ParameterList::insertInt64ArrayParameter(std::string& key, const std::vector<long long>& value){
+	Int64ArrayParameter* int64ArrayParameter=(Int64ArrayParameter*)getRecycled(ACTIVE_INT64_ARRAY_PARAMETER);
+	try{
+		if (int64ArrayParameter){
+			int64ArrayParameter->setValue(value);
+		}else{
+			int64ArrayParameter=new Int64ArrayParameter(value);
+		}
+		insertToMap(key,int64ArrayParameter);
+	}catch (ActiveException& ae){
+		recycleParameter(int64ArrayParameter);
+		std::stringstream logMessage;
 		logMessage << ae.getMessage();
 		logIt(logMessage);
 	}
@@ -278,6 +433,7 @@ void ParameterList::logIt (std::stringstream& logMessage){
 
 ParameterList::~ParameterList() {
 	clear();
+	clearRecycled();
 }
 
 void ParameterList::clear(){
@@ -289,3 +445,67 @@ void ParameterList::clear(){
 	parametersMap.clear();
 
 }
+
+void ParameterList::recycle(){
+	//keeping all parameters to be reused
+	for( std::map <std::string,Parameter*>::iterator ii=parametersMap.begin();
+		ii!=parametersMap.end(); ++ii){
+		if ((*ii).second!=NULL){
+			recycleParameter((*ii).second);
+		}
+	}
+	parametersMap.clear();
+}
+
+bool ParameterList::equals(const ParameterList& parameterList) const{
+
+	if (size()!=parameterList.size()){
+		return false;
+	}
+	//maps are ordered by key, so both are walked at the same time
+	const_iterator other=parameterList.begin();
+	for (const_iterator it=begin(); it!=end(); ++it, ++other){
+		Parameter* parameter=(*it).second;
+		Parameter* otherParameter=(*other).second;
+		if ((*it).first!=(*other).first || parameter->getType()!=otherParameter->getType()){
+			return false;
+		}
+		bool equal=false;
+		switch (parameter->getType()){
+		case ACTIVE_INT_PARAMETER:
+			equal=((IntParameter*)parameter)->getValue()==((IntParameter*)otherParameter)->getValue();
+		break;
+		case ACTIVE_REAL_PARAMETER:
+			equal=((RealParameter*)parameter)->getValue()==((RealParameter*)otherParameter)->getValue();
+		break;
+		case ACTIVE_STRING_PARAMETER:
+			equal=((StringParameter*)parameter)->getValue()==((StringParameter*)otherParameter)->getValue();
+		break;
+		case ACTIVE_BYTES_PARAMETER:
+			equal=((BytesParameter*)parameter)->getValue()==((BytesParameter*)otherParameter)->getValue();
+		break;
+		case ACTIVE_INT_ARRAY_PARAMETER:
+			equal=((IntArrayParameter*)parameter)->getValue()==((IntArrayParameter*)otherParameter)->getValue();
+		break;
+		case ACTIVE_REAL_ARRAY_PARAMETER:
+			equal=((RealArrayParameter*)parameter)->getValue()==((RealArrayParameter*)otherParameter)->getValue();
+		break;
+		case ACTIVE_INT64_ARRAY_PARAMETER:
+			equal=((Int64ArrayParameter*)parameter)->getValue()==((Int64ArrayParameter*)otherParameter)->getValue();
+		break;
+		}
+		if (!equal){
+			return false;
+		}
+	}
+	return true;
+}
+
+void ParameterList::clearRecycled(){
+	for (int type=0; type<ACTIVE_PARAMETER_TYPES; type++){
+		for (unsigned int it=0; it<recycledParameters[type].size(); it++){
+			delete recycledParameters[type][it];
+		}
+		recycledParameters[type].clear();
+	}
+}
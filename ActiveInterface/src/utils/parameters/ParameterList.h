@@ -47,6 +47,9 @@
 #include "RealParameter.h"
 #include "StringParameter.h"
 #include "BytesParameter.h"
+#include "IntArrayParameter.h"
+#include "RealArrayParameter.h"
+#include "Int64ArrayParameter.h"
 #include "../../utils/defines.h"
 
 namespace ai{
@@ -66,6 +69,12 @@ namespace ai{
 		 */
 		std::map <std::string,Parameter*> parametersMap;
 
+		/**
+		 * Parameters released by recycle() stored by type, so next inserts
+		 * reuse them (and the capacity of its values) instead of allocating.
+		 */
+		std::vector<Parameter*> recycledParameters[ACTIVE_PARAMETER_TYPES];
+
 		/**
 		 * static var for logger
 		 */
@@ -86,8 +95,49 @@ namespace ai{
 		 */
 		void insertToMap(std::string& name, Parameter* parameter);
 
+		/**
+		 * Method that takes a recycled parameter of the given type.
+		 *
+		 * @param type type of the parameter wanted
+		 *
+		 * @return recycled parameter or NULL if there is not any of this type.
+		 */
+		Parameter* getRecycled(int type);
+
+		/**
+		 * Method that stores a parameter that is not used anymore to be reused later.
+		 *
+		 * @param parameter parameter to store.
+		 */
+		void recycleParameter(Parameter* parameter);
+
+		/**
+		 * Method that deletes all parameters stored for reuse.
+		 */
+		void clearRecycled();
+
 	public:
 
+		/**
+		 * Iterator to walk through the parameters in order of key
+		 */
+		typedef std::map <std::string,Parameter*>::const_iterator const_iterator;
+
+		/**
+		 * Method that returns an iterator to the first parameter. Walking the list
+		 * with iterators avoids the linear search done by get(index,key).
+		 *
+		 * @return iterator to the first parameter
+		 */
+		const_iterator begin() const { return parametersMap.begin();}
+
+		/**
+		 * Method that returns the iterator past the last parameter
+		 *
+		 * @return iterator past the end
+		 */
+		const_iterator end() const { return parametersMap.end();}
+
 		/**
 		 * Methods that returns the size of the parameters list
 		 *
@@ -95,6 +145,15 @@ namespace ai{
 		 */
 		unsigned int size ()const { return parametersMap.size();}
 
+		/**
+		 * Method to know if other list has the same keys, types and values
+		 *
+		 * @param parameterList list to compare with
+		 *
+		 * @return true if both lists are equal
+		 */
+		bool equals (const ParameterList& parameterList) const;
+
 		/**
 		 * Method that insert a integer parameter into parameter list.
 		 *
@@ -131,6 +190,33 @@ namespace ai{
 		void insertBytesParameter(	std::string& key,
 									std::vector<unsigned char>& value);
 
+		/**
+		 * Method that insert an array of integers into parameter list.
+		 *
+		 * @param key Key that will be associated with the param
+		 * @param value array that will be added
+		 */
+		void insertIntArrayParameter(	std::string& key,
+										const std::vector<int>& value);
+
+		/**
+		 * Method that insert an array of reals into parameter list.
+		 *
+		 * @param key Key that will be associated with the param
+		 * @param value array that will be added
+		 */
+		void insertRealArrayParameter(	std::string& key,
+										const std::vector<float>& value);
+
+		/**
+		 * Method that insert an array of 64 bits integers into parameter list.
+		 *
+		 * @param key Key that will be associated with the param
+		 * @param value array that will be added
+		 */
+		void insertInt64ArrayParameter(	std::string& key,
+										const std::vector<long long>& value);
+
 		/**
 		 * Method that insert a parameter pointer into parameter list.
 		 *
@@ -187,6 +273,27 @@ namespace ai{
 		 */
 		BytesParameter* getBytes(std::string& key) const;
 
+		/**
+		 * Method that returns the direct object of the aproppiate type
+		 *
+		 * @returns parameter casted, NULL if parameter is not the appropiate
+		 */
+		IntArrayParameter* getIntArray(std::string& key) const;
+
+		/**
+		 * Method that returns the direct object of the aproppiate type
+		 *
+		 * @returns parameter casted, NULL if parameter is not the appropiate
+		 */
+		RealArrayParameter* getRealArray(std::string& key) const;
+
+		/**
+		 * Method that returns the direct object of the aproppiate type
+		 *
+		 * @returns parameter casted, NULL if parameter is not the appropiate
+		 */
+		Int64ArrayParameter* getInt64Array(std::string& key) const;
+
 		/**
 		 * Methods that returns the parameter placed in the index position
 		 * into the map.
@@ -216,6 +323,13 @@ namespace ai{
 		 */
 		void clear();
 
+		/**
+		 * Empties the parameter list like clear() but keeping the parameter objects
+		 * to be reused by next inserts. Used when the same list is filled again and
+		 * again (receiving loops) to avoid allocating each parameter.
+		 */
+		void recycle();
+
 		/**
 		 * Clone a parameterList into another parameter list.
 		 *
@@ -252,6 +366,10 @@ namespace ai{
 			ar.template register_type<RealParameter>();
 			ar.template register_type<BytesParameter>();
 			ar.template register_type<IntParameter>();
+			//registered at the end to keep the class ids of old persistence files
+			ar.template register_type<IntArrayParameter>();
+			ar.template register_type<RealArrayParameter>();
+			ar.template register_type<Int64ArrayParameter>();
 			ar & parametersMap;
 			ar & id;
 		}
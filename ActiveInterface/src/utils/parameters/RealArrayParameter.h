@@ -0,0 +1,134 @@
+/**
+ * @file
+ * @author  Oscar Pernas <oscar@pernas.es>
+ * @version 1.2.3
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * Class that extends the parameter parent class with an array of reals.
+ * The whole array is stored in one contiguous block, so it is encoded and
+ * decoded as one block instead of one parameter for each element.
+ */
+
+#ifndef REALARRAYPARAMETER_H_
+#define REALARRAYPARAMETER_H_
+
+#ifdef ACTIVEINTERFACE_DLL
+ #ifdef ACTIVEINTERFACE_EXPORTS
+  #define ACTIVEINTERFACE_API __declspec( dllexport )
+ #else
+  #define ACTIVEINTERFACE_API __declspec( dllimport )
+ #endif
+#else 
+ #define ACTIVEINTERFACE_API
+#endif
+
+#include "Parameter.h"
+#include "../defines.h"
+#include <vector>
+
+#include <boost/serialization/vector.hpp>
+#include <boost/serialization/base_object.hpp>
+
+namespace ai{
+ namespace utils{
+
+	class ACTIVEINTERFACE_API RealArrayParameter: public Parameter {
+	private:
+		/**
+		 * Value of the parameter
+		 */
+		std::vector<float> value;
+
+		/**
+		 * Method that copy the values of the given parameter to this one
+		 *
+		 * @param realArrayParameter Pointer to the object that is going to be copied
+		 */
+		void copy (const RealArrayParameter* realArrayParameter){ type=realArrayParameter->getType(); value=realArrayParameter->getValue();}
+
+	public:
+
+		/**
+		 * Default constructor
+		 */
+		RealArrayParameter(){type=ACTIVE_REAL_ARRAY_PARAMETER;}
+
+		/**
+		 * Constructor
+		 *
+		 * @param valueR array that is going to be assigned to value of object
+		 */
+		RealArrayParameter(const std::vector<float>& valueR){type=ACTIVE_REAL_ARRAY_PARAMETER;value=valueR;}
+
+		/**
+		 * Copy constructor by reference
+		 *
+		 * @param realArrayParameter Reference to the object that is going to be copied to new one
+		 */
+		RealArrayParameter(const RealArrayParameter& realArrayParameter){ copy(&realArrayParameter);}
+
+		/*
+		 * Copy constructor by pointer
+		 *
+		 * @param Pointer to the object that is going to be copied to new one
+		 */
+		RealArrayParameter(const RealArrayParameter* realArrayParameter){ copy(realArrayParameter);}
+
+		/**
+		 * Method to get value of parameter
+		 *
+		 * @return the value of the parameter
+		 */
+		const std::vector<float>& getValue() const { return value;}
+
+		/**
+		 * Method to get value of parameter to be filled
+		 *
+		 * @return the value of the parameter
+		 */
+		std::vector<float>& getValue() { return value;}
+
+		/**
+		 * Method to set the value of parameter, assign keeps the capacity
+		 * of the array when the parameter is recycled
+		 *
+		 * @param valueR value that is going to set to this object
+		 */
+		void setValue (const std::vector<float>& valueR){ value.assign(valueR.begin(),valueR.end());}
+
+		/**
+		 * Default destructor
+		 */
+		virtual ~RealArrayParameter(){};
+
+		/**
+		 *  Serializing parameters map
+		 */
+		friend class boost::serialization::access;
+		template<class Archive>
+
+		void serialize(Archive & ar, const unsigned int version){
+			// serialize base class information
+			ar & boost::serialization::base_object<Parameter>(*this);
+			ar & value;
+			ar & type;
+		}
+	};
+ }
+}
+
+#endif /* REALARRAYPARAMETER_H_ */
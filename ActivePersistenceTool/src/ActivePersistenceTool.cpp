@@ -0,0 +1,307 @@
+/**
+ * @file
+ * @author  Oscar Pernas <oscar@pernas.es>
+ * @version 1.2.3
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * Offline tool over the persistence of a connection.
+ */
+
+#include <boost/archive/binary_oarchive.hpp>
+#include <boost/archive/binary_iarchive.hpp>
+#include <boost/archive/text_iarchive.hpp>
+#include <boost/iostreams/device/array.hpp>
+#include <boost/iostreams/stream.hpp>
+
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+
+#include "apr_time.h"
+
+#include "ActivePersistenceTool.h"
+#include "core/persistence/ActiveRingFile.h"
+#include "utils/defines.h"
+#include "utils/ActiveHistogram.h"
+
+using namespace ai;
+
+ActivePersistenceTool::ActivePersistenceTool(const std::string& connectionIdR, int persistenceTypeR){
+	connectionId=connectionIdR;
+	persistenceType=persistenceTypeR;
+	dataFilename="persistence_file_"+connectionId;
+	controlFilename="control_file_"+connectionId;
+	activeStore=NULL;
+	activeLog=NULL;
+}
+
+void ActivePersistenceTool::openStore() throw (ActiveException){
+	if (activeStore!=NULL){
+		return;
+	}
+	if (persistenceType==ACTIVE_RING_PERSISTENCE){
+		//the ring file is not created if it does not exist
+		std::ifstream ring((dataFilename+".ring").c_str(),std::ios::in | std::ios::binary);
+		if (!ring.is_open()){
+			throw ActiveException("ActivePersistenceTool. There is not ring file "+dataFilename+".ring");
+		}
+		ring.close();
+		activeStore=new ActiveRingFile();
+		try{
+			activeStore->open(dataFilename,DEFAULT_RING_SIZE);
+		}catch (ActiveException& ae){
+			close();
+			throw ae;
+		}
+	}else{
+		activeLog=new ActiveLog();
+		activeStore=activeLog;
+		try{
+			activeStore->open(dataFilename,DEFAULT_SEGMENT_SIZE);
+		}catch (ActiveException& ae){
+			close();
+			throw ae;
+		}
+	}
+	activeCheckpoint.open(controlFilename);
+}
+
+long long ActivePersistenceTool::readSent(bool clamp){
+	long long sent=0;
+	if (!activeCheckpoint.read(sent)){
+		//control file written by older versions
+		try{
+			std::ifstream ifs(controlFilename.c_str(),std::ios::in);
+			boost::archive::text_iarchive controlPersistence(ifs);
+			controlPersistence>>sent;
+		}catch (...){
+			sent=0;
+		}
+	}
+	//segments of records sent could be deleted after the checkpoint was written
+	if (clamp && activeStore!=NULL){
+		if (sent<activeStore->getFirstSequence()){
+			sent=activeStore->getFirstSequence();
+		}else if (sent>activeStore->getNextSequence()){
+			sent=activeStore->getNextSequence();
+		}
+	}
+	return sent;
+}
+
+void ActivePersistenceTool::describe(std::ostream& out, const char* label, long long sequence, const std::vector<unsigned char>& record){
+	out << label << ": record " << sequence << ", " << record.size() << " bytes";
+	if (record.empty()){
+		out << std::endl;
+		return;
+	}
+	//records encoded as they are sent have the body encoded, only the size is shown
+	if (record[0]==ACTIVE_FRAME_RECORD){
+		out << ", encoded as sent" << std::endl;
+		return;
+	}
+	try{
+		ActiveMessage activeMessage;
+		boost::iostreams::stream<boost::iostreams::array_source> recordStream((const char*)&record[0],record.size());
+		boost::archive::binary_iarchive persistenceFile(recordStream,boost::archive::no_header);
+		persistenceFile >> activeMessage;
+		out << ", connection " << activeMessage.getConnectionId()
+			<< ", service " << activeMessage.getServiceId()
+			<< ", priority " << activeMessage.getPriority()
+			<< ", ttl " << activeMessage.getTimeToLive()
+			<< ", " << activeMessage.getPropertiesSize() << " properties";
+		if (activeMessage.isTextMessage()){
+			out << ", text of " << activeMessage.getText().size() << " bytes";
+		}else{
+			out << ", " << activeMessage.getParametersSize() << " parameters";
+		}
+		out << std::endl;
+	}catch (...){
+		out << ", message can not be decoded" << std::endl;
+	}
+}
+
+void ActivePersistenceTool::throughput(std::ostream& out, long long records, apr_uint64_t bytes, apr_time_t start){
+	double seconds=(double)(apr_time_now()-start)/APR_USEC_PER_SEC;
+	out << records << " records, " << bytes << " bytes in " << std::fixed << std::setprecision(3) << seconds << " s";
+	if (seconds>0){
+		out << ", " << std::setprecision(1) << (bytes/1048576.0)/seconds << " MB/s, "
+			<< std::setprecision(0) << records/seconds << " records/s";
+	}
+	out << std::endl;
+	out.unsetf(std::ios::fixed);
+}
+
+void ActivePersistenceTool::inspect(std::ostream& out) throw (ActiveException){
+	openStore();
+	long long first=activeStore->getFirstSequence();
+	long long next=activeStore->getNextSequence();
+	long long sent=readSent(true);
+
+	out << "Persistence of connection " << connectionId << ": "
+		<< ((persistenceType==ACTIVE_RING_PERSISTENCE)?"ring file ":"log ") << dataFilename;
+	if (activeLog!=NULL){
+		out << ", " << activeLog->getNumberSegments() << " segments, " << activeLog->getDiskSize() << " bytes";
+	}
+	out << std::endl;
+	out << "Records from " << first << " to " << next << ": " << (next-first) << " records, first not sent "
+		<< sent << ", " << (next-sent) << " not sent" << std::endl;
+
+	ActiveHistogram sizes;
+	std::vector<unsigned char> record;
+	std::vector<unsigned char> newest;
+	std::vector<unsigned char> oldest;
+	apr_uint64_t bytes=0;
+	long long sequence=first;
+	apr_time_t start=apr_time_now();
+	try{
+		if (first<next){
+			activeStore->seek(first);
+			while (activeStore->read(record)){
+				sizes.add(record.size());
+				bytes+=record.size();
+				if (sequence==sent){
+					oldest=record;
+				}
+				newest.swap(record);
+				sequence++;
+			}
+		}
+	}catch (ActiveException& ae){
+		out << ae.getMessage() << std::endl;
+	}
+	if (sequence<next){
+		out << "POSSIBLE DATA LOSS. Records from " << sequence << " can not be read" << std::endl;
+	}
+	out << "Sizes: " << sizes.toString() << ", p50 " << sizes.getPercentile(50) << ", p99 " << sizes.getPercentile(99) << std::endl;
+	if (sent<sequence){
+		describe(out,"Oldest not sent",sent,oldest);
+	}
+	if (sequence>first){
+		describe(out,"Newest",sequence-1,newest);
+	}
+	out << "Read ";
+	throughput(out,sequence-first,bytes,start);
+}
+
+void ActivePersistenceTool::compact(std::ostream& out) throw (ActiveException){
+	openStore();
+	long long first=activeStore->getFirstSequence();
+	long long sent=readSent(true);
+	apr_off_t before=(activeLog!=NULL)?activeLog->getDiskSize():0;
+	apr_time_t start=apr_time_now();
+
+	if (activeLog!=NULL){
+		activeLog->compact(sent);
+	}else{
+		activeStore->acknowledge(sent);
+		activeStore->sync();
+	}
+	out << "Records from " << first << " to " << sent << " deleted, first record is " << activeStore->getFirstSequence();
+	if (activeLog!=NULL){
+		out << ", " << before << " bytes before and " << activeLog->getDiskSize() << " after";
+	}
+	out << std::endl;
+	out << "Compacted ";
+	throughput(out,sent-first,(activeLog!=NULL)?(apr_uint64_t)(before-activeLog->getDiskSize()):0,start);
+}
+
+void ActivePersistenceTool::convert(std::ostream& out) throw (ActiveException){
+	if (persistenceType!=ACTIVE_LOG_PERSISTENCE){
+		throw ActiveException("ActivePersistenceTool. Persistence files of older versions are moved to the log only");
+	}
+	std::ifstream ifs(dataFilename.c_str(),std::ios::in | std::ios::binary);
+	if (!ifs.is_open()){
+		throw ActiveException("ActivePersistenceTool. There is not persistence file of older versions "+dataFilename);
+	}
+	openStore();
+
+	//in the old file the control file has the number of messages sent
+	long long legacySent=readSent(false);
+	long long firstSequence=activeStore->getNextSequence();
+	long long position=0;
+	long long localPositionInFile=0;
+	apr_uint64_t bytes=0;
+	apr_time_t start=apr_time_now();
+	std::stringstream logMessage;
+	try{
+		while (true){
+			ActiveMessage messageAux;
+			ifs.seekg(localPositionInFile);
+			//the end of the file is only found between messages
+			if (ifs.peek()==std::char_traits<char>::eof()){
+				break;
+			}
+			{
+				boost::archive::binary_iarchive persistenceFile(ifs);
+				persistenceFile >> messageAux;
+			}
+			localPositionInFile=ifs.tellg();
+			if (position>=legacySent){
+				std::ostringstream recordStream;
+				{
+					boost::archive::binary_oarchive persistenceFile(recordStream,boost::archive::no_header);
+					persistenceFile << messageAux;
+				}
+				std::string recordData=recordStream.str();
+				activeStore->append((const unsigned char*)recordData.data(),recordData.size());
+				bytes+=recordData.size();
+				//written as it is read, not all of them kept in memory
+				if ((position-legacySent+1)%ACTIVE_REPLAY_BATCH==0){
+					activeStore->flush();
+				}
+			}
+			position++;
+		}
+		activeStore->sync();
+		//checkpoint has now the sequence of the first message moved, before the file is removed
+		activeCheckpoint.write(firstSequence);
+	}catch (ActiveException& ae){
+		logMessage << "ActivePersistenceTool. Persistence file " << dataFilename << " not moved, it is kept. "
+				<< ae.getMessage();
+		throw ActiveException(logMessage);
+	}catch (...){
+		logMessage << "ActivePersistenceTool. Persistence file " << dataFilename << " not moved, it is kept. Message "
+				<< position << " can not be read";
+		throw ActiveException(logMessage);
+	}
+	ifs.close();
+	if (std::remove(dataFilename.c_str())!=0){
+		logMessage << "ActivePersistenceTool. Persistence file " << dataFilename << " moved to the log but not removed, "
+				<< "remove it before the connection starts or its messages are sent twice";
+		throw ActiveException(logMessage);
+	}
+
+	out << "Persistence file " << dataFilename << " moved to the log, " << position << " messages, "
+		<< (activeStore->getNextSequence()-firstSequence) << " not sent from record " << firstSequence << std::endl;
+	out << "Converted ";
+	throughput(out,activeStore->getNextSequence()-firstSequence,bytes,start);
+}
+
+void ActivePersistenceTool::close(){
+	activeCheckpoint.close();
+	if (activeStore!=NULL){
+		activeStore->close();
+		delete activeStore;
+		activeStore=NULL;
+		activeLog=NULL;
+	}
+}
+
+ActivePersistenceTool::~ActivePersistenceTool(){
+	close();
+}
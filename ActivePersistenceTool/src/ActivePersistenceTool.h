@@ -0,0 +1,165 @@
+/**
+ * @file
+ * @author  Oscar Pernas <oscar@pernas.es>
+ * @version 1.2.3
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * Offline tool over the persistence of a connection, used while the library
+ * is not running. It reports the records of the store, the first one not
+ * sent, the distribution of their sizes and the oldest and newest records,
+ * deletes the records already sent, and moves a persistence file written by
+ * older versions, all messages in boost archives, to the log. Records are
+ * read and copied one after the other, so it goes as fast as the disk.
+ */
+
+#ifndef ACTIVEPERSISTENCETOOL_H_
+#define ACTIVEPERSISTENCETOOL_H_
+
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "apr_general.h"
+
+#include "utils/exception/ActiveException.h"
+#include "core/message/ActiveMessage.h"
+#include "core/persistence/ActiveStore.h"
+#include "core/persistence/ActiveLog.h"
+#include "core/persistence/ActiveCheckpoint.h"
+
+using namespace ai::message;
+
+namespace ai{
+
+	class ActivePersistenceTool {
+	private:
+
+		/**
+		 * Id of the connection and type of its persistence
+		 */
+		std::string connectionId;
+		int persistenceType;
+
+		/**
+		 * Names of the files of the persistence of the connection
+		 */
+		std::string dataFilename;
+		std::string controlFilename;
+
+		/**
+		 * Store opened, and the log if the store is a log
+		 */
+		ActiveStore* activeStore;
+		ActiveLog* activeLog;
+
+		/**
+		 * Checkpoint with the first record not sent
+		 */
+		ActiveCheckpoint activeCheckpoint;
+
+		/**
+		 * Method that opens the store of the connection
+		 *
+		 * @throws ActiveException if it does not exist or can not be opened
+		 */
+		void openStore() throw (ActiveException);
+
+		/**
+		 * Method that reads the first record not sent, from the checkpoint or
+		 * from the control file of older versions
+		 *
+		 * @param clamp true to keep it between the first and the next record
+		 * of the store, as the persistence does when it starts
+		 *
+		 * @return sequence of the first record not sent
+		 */
+		long long readSent(bool clamp);
+
+		/**
+		 * Method that writes a record to the output: sequence, size and the
+		 * fields of the message
+		 *
+		 * @param out output
+		 * @param label name of the record
+		 * @param sequence sequence of the record
+		 * @param record bytes of the record
+		 */
+		void describe(std::ostream& out, const char* label, long long sequence, const std::vector<unsigned char>& record);
+
+		/**
+		 * Method that writes the speed of an operation to the output
+		 *
+		 * @param out output
+		 * @param records records processed
+		 * @param bytes bytes processed
+		 * @param start time when it started
+		 */
+		void throughput(std::ostream& out, long long records, apr_uint64_t bytes, apr_time_t start);
+
+	public:
+
+		/**
+		 * Constructor
+		 *
+		 * @param connectionIdR id of the connection
+		 * @param persistenceTypeR ACTIVE_LOG_PERSISTENCE or ACTIVE_RING_PERSISTENCE
+		 */
+		ActivePersistenceTool(const std::string& connectionIdR, int persistenceTypeR);
+
+		/**
+		 * Method that reads all the records and writes the report to the output
+		 *
+		 * @param out output
+		 *
+		 * @throws ActiveException if the persistence can not be read
+		 */
+		void inspect(std::ostream& out) throw (ActiveException);
+
+		/**
+		 * Method that deletes the records already sent
+		 *
+		 * @param out output
+		 *
+		 * @throws ActiveException if the persistence can not be compacted
+		 */
+		void compact(std::ostream& out) throw (ActiveException);
+
+		/**
+		 * Method that moves the messages not sent of a persistence file of
+		 * older versions to the log, as the library does when it starts
+		 *
+		 * @param out output
+		 *
+		 * @throws ActiveException if there is not such file or the log can not
+		 * be written
+		 */
+		void convert(std::ostream& out) throw (ActiveException);
+
+		/**
+		 * Method that closes the store
+		 */
+		void close();
+
+		/**
+		 * Default destructor
+		 */
+		virtual ~ActivePersistenceTool();
+	};
+}
+
+#endif /* ACTIVEPERSISTENCETOOL_H_ */
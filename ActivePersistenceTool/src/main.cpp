@@ -0,0 +1,88 @@
+/**
+ * @file
+ * @author  Oscar Pernas <oscar@pernas.es>
+ * @version 1.2.3
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * Command line tool over the persistence of a connection, run in the
+ * directory of the application while it is stopped:
+ *
+ * ActivePersistenceTool inspect|compact|convert <connection id> [ring]
+ *
+ * inspect shows the records, the first one not sent, their sizes and the
+ * oldest and newest ones; compact deletes the records already sent; convert
+ * moves a persistence file of older versions to the log.
+ */
+
+#include <iostream>
+#include <string>
+
+#include "apr_general.h"
+#include "log4cxx/propertyconfigurator.h"
+
+#include "ActivePersistenceTool.h"
+#include "utils/defines.h"
+
+using namespace log4cxx;
+using namespace ai;
+
+static int usage(){
+	std::cerr << "Usage: ActivePersistenceTool inspect|compact|convert <connection id> [ring]" << std::endl;
+	return 2;
+}
+
+int main(int argc, char* argv[]) {
+
+	if (argc<3 || argc>4){
+		return usage();
+	}
+	std::string command=argv[1];
+	std::string connectionId=argv[2];
+	int persistenceType=ACTIVE_LOG_PERSISTENCE;
+	if (argc==4){
+		if (std::string(argv[3])!="ring"){
+			return usage();
+		}
+		persistenceType=ACTIVE_RING_PERSISTENCE;
+	}
+	if (command!="inspect" && command!="compact" && command!="convert"){
+		return usage();
+	}
+
+	apr_initialize();
+	//same logging configuration as the application
+	PropertyConfigurator::configure("log4j.properties");
+
+	int result=0;
+	{
+		ActivePersistenceTool activePersistenceTool(connectionId,persistenceType);
+		try{
+			if (command=="inspect"){
+				activePersistenceTool.inspect(std::cout);
+			}else if (command=="compact"){
+				activePersistenceTool.compact(std::cout);
+			}else{
+				activePersistenceTool.convert(std::cout);
+			}
+		}catch (ActiveException& ae){
+			std::cerr << ae.getMessage() << std::endl;
+			result=1;
+		}
+	}
+	apr_terminate();
+	return result;
+}